@@ -10,11 +10,16 @@ struct config {
         bool debug;
         bool jit;
         bool tearing;
+        int texture_budget; // MiB, 0 if unlimited
     } experimental;
 
     struct {
         int32_t fullscreen_width;
         int32_t fullscreen_height;
+        double render_scale;
+
+        int32_t projector_width; // 0 if there is no projector
+        int32_t projector_height;
     } window;
 
     struct {
@@ -8,6 +8,7 @@ struct config_action;
 struct config_vm_waker;
 
 typedef void (*config_vm_waker_destroy_func_t)(struct config_vm_waker *waker, void *data);
+typedef int (*config_vm_push_func_t)(lua_State *L, void *data);
 
 struct config_vm {
     lua_State *L;
@@ -39,5 +40,8 @@ void config_vm_register_actions(struct config_vm *vm, lua_State *L);
 void config_vm_register_event(struct config_vm *vm, lua_State *L, const char *name);
 void config_vm_register_lib(struct config_vm *vm, const struct luaL_Reg *lib, const char *name);
 void config_vm_resume(struct config_vm_waker *waker);
+void config_vm_resume_with(struct config_vm_waker *waker, config_vm_push_func_t push, void *data);
 void config_vm_signal_event(struct config_vm *vm, const char *name);
+void config_vm_signal_event_with(struct config_vm *vm, const char *name, config_vm_push_func_t push,
+                                 void *data);
 bool config_vm_try_action(struct config_vm *vm, size_t index);
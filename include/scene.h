@@ -11,9 +11,25 @@
 [[maybe_unused]] static constexpr int SHADER_SRC_RGBA_ATTRIB_LOC = 2;
 [[maybe_unused]] static constexpr int SHADER_DST_RGBA_ATTRIB_LOC = 3;
 
+[[maybe_unused]] static constexpr int32_t SCENE_READBACK_MAX_PIXELS = 256 * 256;
+[[maybe_unused]] static constexpr int32_t SCENE_COUNT_MAX_SIZE = 1024;
+[[maybe_unused]] static constexpr size_t SCENE_COUNT_MAX_COLORS = 8;
+[[maybe_unused]] static constexpr int32_t SCENE_WATCH_MAX_SIZE = 1024;
+[[maybe_unused]] static constexpr uint32_t SCENE_RES_TIMEOUT_MS = 250;
+[[maybe_unused]] static constexpr size_t SCENE_TEXT_LIVE_MAX = 256;
+
+struct scene_shader {
+    struct server_gl_shader *shader;
+    int shader_u_src_size, shader_u_dst_size;
+    int shader_u_offset, shader_u_tint;
+
+    char *name;
+};
+
 struct scene {
     struct server_gl *gl;
     struct server_ui *ui;
+    struct ww_timer *timer;
 
     uint32_t image_max_size;
 
@@ -25,18 +41,41 @@ struct scene {
     struct {
         unsigned int debug;
         size_t debug_vtxcount;
+        struct box debug_bounds;
 
         unsigned int stencil_rect;
+        unsigned int readback;
+
+        // Vertex array objects for the buffers above, or 0 if they are unsupported.
+        unsigned int debug_vao, stencil_rect_vao, readback_vao;
 
         unsigned int font_tex;
     } buffers;
 
     struct {
         int32_t width, height;
-        int32_t tex_width, tex_height;
+        struct box game; // the game anchor the stencil buffer was drawn for
+        struct box bounds;
         uint32_t equal_frames;
     } prev_frame;
 
+    struct box frame_bounds;
+
+    struct {
+        struct box screen, game; // render coordinates
+    } anchors;
+
+    struct {
+        int32_t width, height;
+    } active_res;
+
+    struct {
+        int32_t width, height;
+        int32_t buffer_width, buffer_height;
+        uint64_t deadline; // milliseconds
+        bool active;
+    } pending_res;
+
     struct {
         struct wl_list sorted; // scene_object.link
 
@@ -45,20 +84,92 @@ struct scene {
         struct wl_list unsorted_text;    // scene_object.link
     } objects;
 
-    int skipped_frames;
+    struct {
+        struct scene_shader count, reduce, downsample;
+        int count_u_box, count_u_colors, count_u_tolerance;
+        int reduce_u_count_size, reduce_u_offset;
+        int downsample_u_box, downsample_u_block;
+
+        bool enabled;
+    } reduction;
+
+    // Image textures are counted against the texture budget along with the font atlas and the
+    // imported capture buffers. When the budget is exceeded, the textures of hidden images are
+    // evicted and uploaded again from their decoded pixels when the images become visible.
+    struct {
+        struct wl_list images; // scene_image.texture_link, most recently drawn first
+        size_t usage;          // bytes used by image textures
+        size_t budget;         // bytes, 0 if unlimited
+    } textures;
+
+    struct scene_profile *profile; // nullptr unless GPU timing is enabled
+
+    // The target which objects are currently being drawn to.
+    enum scene_target {
+        SCENE_TARGET_OVERLAY,
+        SCENE_TARGET_PROJECTOR,  // see draw_projector
+        SCENE_TARGET_SCREENSHOT, // see readback_copy_screenshot
+    } target;
+
+    struct wl_list readbacks; // scene_readback.link
+
+    struct wl_list watches; // scene_watch.link
+    bool dispatching_watches;
+
+    // Polls readbacks and watches while the game is not committing frames (see poll_schedule.)
+    struct ww_timer_entry *poll_timer; // nullptr if nothing is waiting
+
+    struct {
+        uint64_t start; // milliseconds
+        uint32_t frames;
+        uint32_t value;
+    } fps;
 
     struct wl_listener on_gl_frame;
 };
 
-struct scene_shader {
-    struct server_gl_shader *shader;
-    int shader_u_src_size, shader_u_dst_size;
+enum scene_anchor_position {
+    SCENE_ANCHOR_TOPLEFT,
+    SCENE_ANCHOR_TOP,
+    SCENE_ANCHOR_TOPRIGHT,
+    SCENE_ANCHOR_LEFT,
+    SCENE_ANCHOR_CENTER,
+    SCENE_ANCHOR_RIGHT,
+    SCENE_ANCHOR_BOTTOMLEFT,
+    SCENE_ANCHOR_BOTTOM,
+    SCENE_ANCHOR_BOTTOMRIGHT,
+};
 
-    char *name;
+enum scene_anchor_target {
+    SCENE_ANCHOR_SCREEN,
+    SCENE_ANCHOR_GAME,
+};
+
+// The position of a scene object is relative to its anchor, which is resolved every frame. The
+// default (zeroed) anchor is the top left corner of the screen, i.e. absolute render coordinates.
+struct scene_anchor {
+    enum scene_anchor_target target;
+    enum scene_anchor_position position;
+};
+
+// Restricts a scene object to only appear while the given game resolution is active.
+struct scene_visible_at {
+    int32_t width, height;
+    bool enabled;
+};
+
+// Places a scene object in the projector window (see server_gl_set_projector), in addition to its
+// usual place in the overlay.
+struct scene_projection {
+    struct box dst; // projector coordinates, a width or height of 0 keeps the object's own size
+    bool enabled;
 };
 
 struct scene_image_options {
     struct box dst;
+    struct scene_anchor anchor;
+    struct scene_visible_at visible_at;
+    struct scene_projection projector;
 
     int32_t depth;
     char *shader_name;
@@ -66,6 +177,9 @@ struct scene_image_options {
 
 struct scene_mirror_options {
     struct box src, dst;
+    struct scene_anchor anchor;
+    struct scene_visible_at visible_at;
+    struct scene_projection projector;
     float src_rgba[4];
     float dst_rgba[4];
 
@@ -73,21 +187,98 @@ struct scene_mirror_options {
     char *shader_name;
 };
 
+// A span of text with its own style. The runs of a text object cover its text in order.
+struct scene_text_run {
+    size_t length; // in bytes
+
+    float rgba[4];
+    int32_t size_multiplier;
+
+    bool shadow, outline;
+    float shadow_rgba[4];
+    float outline_rgba[4];
+};
+
 struct scene_text_options {
     int32_t x;
     int32_t y;
+    struct scene_anchor anchor;
+    struct scene_visible_at visible_at;
+    struct scene_projection projector;
 
     float rgba[4];
     int32_t size_multiplier;
 
+    // If no runs are given, the whole text is drawn with the color and size given above.
+    const struct scene_text_run *runs;
+    size_t num_runs;
+
     int32_t depth;
     char *shader_name;
 };
 
+struct scene_transform {
+    float x, y;    // position of the object's top left corner, relative to its anchor
+    float rgba[4]; // multiplied with the object's color
+};
+
+enum scene_easing {
+    SCENE_EASING_LINEAR,
+    SCENE_EASING_IN,
+    SCENE_EASING_OUT,
+    SCENE_EASING_IN_OUT,
+};
+
+// The GPU time taken to draw an object, or all objects using a shader.
+struct scene_timing {
+    const char *type; // "image", "mirror", "text", or nullptr for shader totals
+    const char *shader;
+    struct box bounds; // render coordinates, zero for shader totals
+    float ms;          // per frame, averaged over the last second
+};
+
 struct scene_object;
+struct scene_profile;
+struct scene_readback;
+struct scene_watch;
+
+// Called with the RGBA pixel data of a completed readback, from top to bottom.
+typedef void (*scene_readback_func_t)(void *data, int32_t width, int32_t height,
+                                      const uint8_t *rgba);
+
+// Called with the RGBA pixel data of a completed screenshot, from top to bottom. The callee takes
+// ownership of the pixel data, which is nullptr if the screenshot failed.
+typedef void (*scene_screenshot_func_t)(void *data, int32_t width, int32_t height, uint8_t *rgba);
 
-struct scene *scene_create(struct config *cfg, struct server_gl *gl, struct server_ui *ui);
+// Called with the number of pixels matching each color of a completed color count.
+typedef void (*scene_count_func_t)(void *data, size_t num_colors, const uint32_t *counts);
+
+// Called if a pending readback is destroyed along with the scene.
+typedef void (*scene_readback_destroy_func_t)(void *data);
+
+// Called when the contents of a watched region change by more than the watch's threshold. The
+// change is the mean difference between the old and new contents, from 0 to 1.
+typedef void (*scene_watch_func_t)(void *data, float change);
+
+// Writes the current contents of a live text object to buf, which is size bytes long. Returns the
+// length of the contents.
+typedef size_t (*scene_text_source_func_t)(void *data, char *buf, size_t size);
+
+// Called when a live text object is destroyed, to free the data passed to its source.
+typedef void (*scene_text_source_destroy_func_t)(void *data);
+
+struct scene *scene_create(struct config *cfg, struct server_gl *gl, struct server_ui *ui,
+                           struct ww_timer *timer);
 void scene_destroy(struct scene *scene);
+uint32_t scene_get_fps(struct scene *scene);
+bool scene_enable_profiling(struct scene *scene);
+size_t scene_get_shader_timings(struct scene *scene, struct scene_timing *out, size_t max);
+size_t scene_get_object_timings(struct scene *scene, struct scene_timing *out, size_t max);
+void scene_batch_begin(struct scene *scene);
+void scene_batch_end(struct scene *scene);
+void scene_set_texture_budget(struct scene *scene, size_t budget);
+void scene_set_active_res(struct scene *scene, int32_t width, int32_t height, int32_t buffer_width,
+                          int32_t buffer_height);
 
 struct scene_image *scene_add_image(struct scene *scene, const struct scene_image_options *options,
                                     const char *path);
@@ -95,7 +286,34 @@ struct scene_mirror *scene_add_mirror(struct scene *scene,
                                       const struct scene_mirror_options *options);
 struct scene_text *scene_add_text(struct scene *scene, const char *data,
                                   const struct scene_text_options *options);
+struct scene_text *scene_add_live_text(struct scene *scene,
+                                       const struct scene_text_options *options,
+                                       scene_text_source_func_t source,
+                                       scene_text_source_destroy_func_t destroy, void *data);
+void *scene_text_get_source(struct scene_text *text);
+
+struct scene_readback *scene_read_pixels(struct scene *scene, const struct box *src,
+                                         scene_readback_func_t done,
+                                         scene_readback_destroy_func_t destroy, void *data);
+struct scene_readback *scene_count_colors(struct scene *scene, const struct box *src,
+                                          const float colors[][4], size_t num_colors,
+                                          uint8_t tolerance, scene_count_func_t done,
+                                          scene_readback_destroy_func_t destroy, void *data);
+struct scene_readback *scene_screenshot(struct scene *scene, bool overlay,
+                                        scene_screenshot_func_t done,
+                                        scene_readback_destroy_func_t destroy, void *data);
+void scene_readback_destroy(struct scene_readback *readback);
+
+struct scene_watch *scene_watch_region(struct scene *scene, const struct box *src,
+                                       float threshold, scene_watch_func_t changed,
+                                       scene_readback_destroy_func_t destroy, void *data);
+void scene_watch_destroy(struct scene_watch *watch);
 
 void scene_object_destroy(struct scene_object *object);
 int32_t scene_object_get_depth(struct scene_object *object);
 void scene_object_set_depth(struct scene_object *object, int32_t depth);
+void scene_object_get_transform(struct scene_object *object, struct scene_transform *out);
+void scene_object_set_transform(struct scene_object *object,
+                                const struct scene_transform *transform);
+void scene_object_animate(struct scene_object *object, const struct scene_transform *transform,
+                          uint32_t duration, enum scene_easing easing);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+#include <wayland-server-core.h>
+#include <wayland-util.h>
+
+struct server;
+
+// Called once a screenshot has been written (or has failed to be written.)
+typedef void (*screenshot_func_t)(void *data, bool ok);
+
+// Called if a screenshot which has not been reported yet is destroyed along with its writer.
+typedef void (*screenshot_destroy_func_t)(void *data);
+
+// Screenshots are encoded and written one at a time by a single worker thread, which signals the
+// event loop through an eventfd whenever it finishes one.
+struct screenshot_writer {
+    pthread_t thread;
+    int fd; // eventfd, signalled by the thread whenever a screenshot has been written
+    struct wl_event_source *src;
+
+    // The lists and the stopping flag are shared with the thread.
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct wl_list queue;    // screenshot.link, oldest last
+    struct wl_list finished; // screenshot.link, oldest last
+    bool stopping;
+};
+
+struct screenshot {
+    struct wl_list link; // screenshot_writer.queue or screenshot_writer.finished
+
+    char *path;
+    uint8_t *rgba;
+    int32_t width, height;
+    bool ok; // written by the thread
+
+    // Only used from the event loop. Both are nullptr once the screenshot has been cancelled.
+    screenshot_func_t done;
+    screenshot_destroy_func_t destroy;
+    void *data;
+};
+
+struct screenshot_writer *screenshot_writer_create(struct server *server);
+void screenshot_writer_destroy(struct screenshot_writer *writer);
+
+struct screenshot *screenshot_write(struct screenshot_writer *writer, const char *path,
+                                    uint8_t *rgba, int32_t width, int32_t height,
+                                    screenshot_func_t done, screenshot_destroy_func_t destroy,
+                                    void *data);
+void screenshot_cancel(struct screenshot *screenshot);
@@ -19,6 +19,7 @@ struct server_backend {
         struct wl_pointer *pointer;
     } seat;
     struct wl_array shm_formats; // data: uint32_t
+    uint32_t presentation_clock; // only valid if presentation is non-null
 
     // mandatory globals
     struct wl_compositor *compositor;
@@ -33,8 +34,12 @@ struct server_backend {
 
     // optional globals
     struct wp_alpha_modifier_v1 *alpha_modifier;
+    struct wp_commit_timing_manager_v1 *commit_timing_manager;
     struct wp_cursor_shape_manager_v1 *cursor_shape_manager;
+    struct wp_fifo_manager_v1 *fifo_manager;
+    struct zwp_input_timestamps_manager_v1 *input_timestamps_manager;
     struct wp_linux_drm_syncobj_manager_v1 *linux_drm_syncobj_manager;
+    struct wp_presentation *presentation;
     struct wp_single_pixel_buffer_manager_v1 *single_pixel_buffer_manager;
     struct wp_tearing_control_manager_v1 *tearing_control;
     struct zxdg_decoration_manager_v1 *xdg_decoration_manager;
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// zwp_linux_dmabuf_feedback_v1.tranche_flags.scanout
+static constexpr uint32_t DMABUF_TRANCHE_SCANOUT = 1;
+
+struct dmabuf_tranche {
+    dev_t target_device;
+    uint32_t flags;
+
+    uint16_t *indices; // into the format table
+    size_t num_indices;
+};
+
+// Accumulates one batch of dmabuf feedback (everything up to a `done` event) from the host
+// compositor, so that its tranches can be adjusted before being sent on to the client.
+struct dmabuf_feedback {
+    int table_fd; // -1 if no format table was sent in this batch
+    uint32_t table_size;
+    dev_t main_device;
+
+    struct dmabuf_tranche *tranches;
+    size_t num_tranches;
+
+    struct dmabuf_tranche pending;
+};
+
+void dmabuf_feedback_init(struct dmabuf_feedback *feedback);
+void dmabuf_feedback_finish(struct dmabuf_feedback *feedback);
+void dmabuf_feedback_merge(struct dmabuf_feedback *feedback);
+void dmabuf_feedback_reset(struct dmabuf_feedback *feedback);
+
+void dmabuf_feedback_format_table(struct dmabuf_feedback *feedback, int fd, uint32_t size);
+void dmabuf_feedback_main_device(struct dmabuf_feedback *feedback, dev_t device);
+void dmabuf_feedback_tranche_done(struct dmabuf_feedback *feedback);
+void dmabuf_feedback_tranche_flags(struct dmabuf_feedback *feedback, uint32_t flags);
+void dmabuf_feedback_tranche_formats(struct dmabuf_feedback *feedback, const uint16_t *indices,
+                                     size_t num_indices);
+void dmabuf_feedback_tranche_target_device(struct dmabuf_feedback *feedback, dev_t device);
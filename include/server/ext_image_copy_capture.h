@@ -0,0 +1,59 @@
+#pragma once
+
+#include "server/server.h"
+#include <stdint.h>
+#include <time.h>
+#include <wayland-server-core.h>
+#include <wayland-util.h>
+
+struct server_image_copy_capture {
+    struct wl_global *global;        // ext_image_copy_capture_manager_v1
+    struct wl_global *source_global; // ext_output_image_capture_source_manager_v1
+    struct wl_list objects;          // wl_resource link (ext_image_copy_capture_manager_v1)
+
+    struct server *server;
+    struct server_gl *gl;
+
+    struct wl_list sessions; // server_image_copy_session.link
+
+    struct wl_listener on_gl_capture;
+    struct wl_listener on_gl_frame;
+};
+
+struct server_image_copy_session {
+    struct wl_list link; // server_image_copy_capture.sessions
+    struct wl_resource *resource;
+
+    struct server_image_copy_capture *parent; // nullptr once the session has stopped
+    struct server_image_copy_frame *frame;
+
+    // The buffer constraints most recently sent to the client. They are sent again whenever the
+    // game's buffer changes size or format.
+    struct {
+        int32_t width, height;
+        uint32_t format;
+        uint64_t modifier;
+        bool sent;
+    } constraints;
+
+    bool damaged; // whether the game has presented a frame since the last capture
+};
+
+struct server_image_copy_frame {
+    struct wl_resource *resource;
+    struct server_image_copy_session *session; // nullptr once the session is destroyed
+
+    struct server_buffer *buffer;
+    bool capturing, done;
+
+    // SHM destinations are written once the game frame has been read back from the GPU, and
+    // DMABUF destinations are ready once the copy into them has finished. Both are checked whenever
+    // the game commits (see on_gl_frame.)
+    struct server_gl_readback *readback;
+    struct server_gl_fence *fence;
+    struct timespec captured;
+};
+
+struct server_image_copy_capture *server_image_copy_capture_create(struct server *server,
+                                                                   struct server_gl *gl);
+void server_image_copy_capture_destroy(struct server_image_copy_capture *capture);
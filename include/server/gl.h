@@ -5,19 +5,27 @@
 #include <EGL/eglext.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
+#include <sys/types.h>
 #include <wayland-server-core.h>
 
+// OpenGL ES 3.0 constants for pixel buffer objects, which the OpenGL ES 2.0 headers do not define.
+static constexpr GLenum GLES3_PIXEL_PACK_BUFFER = 0x88EB;
+static constexpr GLenum GLES3_STREAM_READ = 0x88E1;
+
 #define server_gl_with(gl, surface)                                                                \
     for (int _glscope = (server_gl_enter((gl), (surface)), 0); _glscope == 0;                      \
          _glscope = (server_gl_exit((gl)), 1))
 
-#define gl_using_buffer(type, buffer)                                                              \
-    for (int _gl_bufscope = (glBindBuffer((type), (buffer)), 0); _gl_bufscope == 0;                \
-         _gl_bufscope = (glBindBuffer((type), 0), 1))
+// Bindings made with gl_using_buffer and gl_using_texture are left in place when the scope ends,
+// so that drawing the same buffer or texture again does not need to bind it again. See
+// server_gl.state.
+#define gl_using_buffer(gl, type, buffer)                                                          \
+    for (int _gl_bufscope = (server_gl_bind_buffer((gl), (type), (buffer)), 0); _gl_bufscope == 0; \
+         _gl_bufscope = 1)
 
-#define gl_using_texture(type, texture)                                                            \
-    for (int _gl_texscope = (glBindTexture((type), (texture)), 0); _gl_texscope == 0;              \
-         _gl_texscope = (glBindTexture((type), 0), 1))
+#define gl_using_texture(gl, type, texture)                                                        \
+    for (int _gl_texscope = (server_gl_bind_texture((gl), (type), (texture)), 0);                  \
+         _gl_texscope == 0; _gl_texscope = 1)
 
 struct server_gl {
     struct server *server;
@@ -29,12 +37,65 @@ struct server_gl {
         PFNEGLGETPLATFORMDISPLAYEXTPROC GetPlatformDisplayEXT;
         PFNGLEGLIMAGETARGETTEXTURE2DOESPROC ImageTargetTexture2DOES;
 
+        // EGL_KHR_fence_sync (optional)
+        PFNEGLCREATESYNCKHRPROC CreateSyncKHR;
+        PFNEGLDESTROYSYNCKHRPROC DestroySyncKHR;
+        PFNEGLGETSYNCATTRIBKHRPROC GetSyncAttribKHR;
+
         EGLDisplay display;
         EGLConfig config;
         EGLContext ctx;
         EGLint major, minor;
+
+        dev_t device; // the DRM device used by EGL, if known (see server_gl_get_device)
+        bool has_device;
     } egl;
 
+    struct {
+        // Vertex array objects (optional, nullptr if unsupported)
+        PFNGLBINDVERTEXARRAYOESPROC BindVertexArray;
+        PFNGLDELETEVERTEXARRAYSOESPROC DeleteVertexArrays;
+        PFNGLGENVERTEXARRAYSOESPROC GenVertexArrays;
+
+        // Buffer mapping, used for asynchronous readback into pixel buffer objects (OpenGL ES 3.0
+        // only, nullptr if unsupported)
+        PFNGLMAPBUFFERRANGEEXTPROC MapBufferRange;
+        PFNGLUNMAPBUFFEROESPROC UnmapBuffer;
+
+        // GL_EXT_disjoint_timer_query (optional, nullptr if unsupported)
+        PFNGLBEGINQUERYEXTPROC BeginQueryEXT;
+        PFNGLDELETEQUERIESEXTPROC DeleteQueriesEXT;
+        PFNGLENDQUERYEXTPROC EndQueryEXT;
+        PFNGLGENQUERIESEXTPROC GenQueriesEXT;
+        PFNGLGETQUERYOBJECTUI64VEXTPROC GetQueryObjectui64vEXT;
+        PFNGLGETQUERYOBJECTUIVEXTPROC GetQueryObjectuivEXT;
+
+        int version; // major version of the OpenGL ES context
+    } gles;
+
+    struct {
+        int depth;
+        EGLSurface surface; // the surface bound to the context, if any
+        bool current;       // the context is left current between entries
+    } context; // see server_gl_enter
+
+    // A cache of the OpenGL state which waywall changes, used to skip calls which would not change
+    // anything. All changes to this state must go through the server_gl_* functions below.
+    struct {
+        GLuint program;
+        GLuint array_buffer;
+        GLuint texture_2d;
+        GLuint vertex_array;
+        uint32_t attribs; // enabled vertex attribute arrays of the default vertex array object
+
+        bool blend;
+        GLenum blend_func[4];
+
+        struct {
+            uint32_t issued, skipped;
+        } calls; // during the current frame
+    } state;
+
     struct {
         struct wl_surface *remote;
         struct wl_subsurface *subsurface;
@@ -42,14 +103,37 @@ struct server_gl {
         struct wl_egl_window *window;
         EGLSurface egl;
 
+        struct box bounds; // render coordinates, see server_gl_set_bounds
+        bool reposition;
+        bool unmapped; // see server_gl_unmap
+
         struct wl_callback *frame_callback;
         uint32_t swaps_since_frame_cb;
     } surface;
 
+    // The projector is an optional second toplevel on the host compositor which shows some of the
+    // scene's objects, so that they can be captured on their own (e.g. by OBS.)
+    struct {
+        struct wl_surface *remote; // nullptr if there is no projector
+        struct xdg_surface *xdg_surface;
+        struct xdg_toplevel *xdg_toplevel;
+        struct zxdg_toplevel_decoration_v1 *xdg_decoration;
+        struct wl_egl_window *window;
+        EGLSurface egl;
+
+        int32_t requested_width, requested_height;
+        int32_t width, height; // the size given by the host compositor
+        bool configured;
+    } projector; // see server_gl_set_projector
+
     struct {
         struct server_surface *surface;
         struct wl_list buffers; // gl_buffer.link
         struct gl_buffer *current;
+        size_t bytes; // estimated size of the imported buffers
+
+        struct wl_list exports; // gl_buffer.link, buffers of capture clients
+        GLuint fbo;             // see server_gl_copy_capture
     } capture;
 
     struct wl_listener on_surface_commit;
@@ -57,15 +141,22 @@ struct server_gl {
     struct wl_listener on_ui_resize;
 
     struct {
-        struct wl_signal frame; // data: nullptr
+        struct wl_signal frame;   // data: nullptr
+        struct wl_signal capture; // data: nullptr, emitted once a new game frame is available
     } events;
 };
 
 struct server_gl_shader {
+    struct server_gl *gl;
+
     GLuint vert, frag;
     GLuint program;
 };
 
+struct server_buffer;
+struct server_gl_fence;
+struct server_gl_readback;
+
 struct server_gl *server_gl_create(struct server *server);
 void server_gl_destroy(struct server_gl *gl);
 void server_gl_enter(struct server_gl *gl, bool surface);
@@ -73,10 +164,39 @@ void server_gl_exit(struct server_gl *gl);
 
 struct server_gl_shader *server_gl_compile(struct server_gl *gl, const char *vertex,
                                            const char *fragment);
+bool server_gl_copy_capture(struct server_gl *gl, struct server_buffer *buffer);
 GLuint server_gl_get_capture(struct server_gl *gl);
+void server_gl_get_capture_format(struct server_gl *gl, uint32_t *format, uint64_t *modifier);
 void server_gl_get_capture_size(struct server_gl *gl, int32_t *width, int32_t *height);
+bool server_gl_get_device(struct server_gl *gl, dev_t *device);
+void server_gl_set_bounds(struct server_gl *gl, struct box *bounds);
 void server_gl_set_capture(struct server_gl *gl, struct server_surface *surface);
+void server_gl_set_projector(struct server_gl *gl, int32_t width, int32_t height);
 void server_gl_swap_buffers(struct server_gl *gl);
+void server_gl_unmap(struct server_gl *gl);
+
+bool server_gl_projector_begin(struct server_gl *gl);
+void server_gl_projector_swap(struct server_gl *gl);
+
+void server_gl_bind_buffer(struct server_gl *gl, GLenum type, GLuint buffer);
+void server_gl_bind_texture(struct server_gl *gl, GLenum type, GLuint texture);
+void server_gl_bind_vertex_array(struct server_gl *gl, GLuint vao);
+void server_gl_delete_buffers(struct server_gl *gl, size_t n, const GLuint *buffers);
+void server_gl_delete_textures(struct server_gl *gl, size_t n, const GLuint *textures);
+void server_gl_delete_vertex_arrays(struct server_gl *gl, size_t n, const GLuint *vaos);
+void server_gl_enable_attribs(struct server_gl *gl, uint32_t mask);
+void server_gl_set_blend(struct server_gl *gl, bool enabled);
+void server_gl_set_blend_func(struct server_gl *gl, GLenum src_rgb, GLenum dst_rgb,
+                              GLenum src_alpha, GLenum dst_alpha);
+
+struct server_gl_fence *server_gl_fence_create(struct server_gl *gl);
+void server_gl_fence_destroy(struct server_gl_fence *fence);
+bool server_gl_fence_signaled(struct server_gl_fence *fence);
+
+struct server_gl_readback *server_gl_readback_create(struct server_gl *gl);
+void server_gl_readback_destroy(struct server_gl_readback *readback);
+bool server_gl_readback_ready(struct server_gl_readback *readback);
+bool server_gl_readback_write(struct server_gl_readback *readback, struct server_buffer *buffer);
 
 void server_gl_shader_destroy(struct server_gl_shader *shader);
 void server_gl_shader_use(struct server_gl_shader *shader);
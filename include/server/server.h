@@ -16,12 +16,16 @@ struct server {
 
     struct wl_event_source *backend_source;
 
+    struct server_commit_timing_manager *commit_timing;
     struct server_compositor *compositor;
     struct server_data_device_manager *data_device_manager;
     struct server_drm_syncobj_manager *drm_syncobj;
+    struct server_fifo_manager *fifo;
+    struct server_input_timestamps *input_timestamps;
     struct server_linux_dmabuf *linux_dmabuf;
     struct server_output *output;
     struct server_pointer_constraints *pointer_constraints;
+    struct server_presentation *presentation;
     struct server_relative_pointer *relative_pointer;
     struct server_seat *seat;
     struct server_shm *shm;
@@ -12,11 +12,13 @@ struct server_surface {
     struct server_surface_state {
         struct server_buffer *buffer;
         struct wl_array damage, buffer_damage; // data: struct server_surface_damage
+        bool opaque;                           // whether the client set an opaque region
 
         enum {
             SURFACE_STATE_BUFFER = (1 << 0),
             SURFACE_STATE_DAMAGE = (1 << 1),
             SURFACE_STATE_DAMAGE_BUFFER = (1 << 2),
+            SURFACE_STATE_OPAQUE = (1 << 3),
         } present;
     } current, pending;
 
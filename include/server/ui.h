@@ -13,6 +13,7 @@ struct server_ui {
     struct server_ui_config *config;
 
     struct wl_region *empty_region;
+    struct wl_region *opaque_region; // covers any surface it is set on
 
     struct {
         struct wl_surface *surface;
@@ -47,6 +48,7 @@ struct server_ui {
 
 struct server_ui_config {
     struct wl_buffer *background;
+    bool background_opaque;
     bool tearing;
 
     int32_t fullscreen_width;
@@ -64,10 +66,12 @@ struct server_view {
     struct wp_alpha_modifier_surface_v1 *alpha_surface;
     struct wl_subsurface *subsurface;
     struct wp_viewport *viewport;
+    bool opaque; // whether the host compositor was given an opaque region for the surface
 
     struct server_view_state {
         uint32_t x, y;
         uint32_t width, height;
+        double scale; // buffer pixels per render pixel (centered views only)
         bool centered;
         bool visible;
 
@@ -76,6 +80,7 @@ struct server_view {
             VIEW_STATE_SIZE = (1 << 1),
             VIEW_STATE_CENTERED = (1 << 2),
             VIEW_STATE_VISIBLE = (1 << 3),
+            VIEW_STATE_SCALE = (1 << 4),
         } present;
     } current, pending;
 
@@ -117,6 +122,7 @@ void server_view_commit(struct server_view *view);
 void server_view_refresh(struct server_view *view);
 void server_view_set_centered(struct server_view *view, bool centered);
 void server_view_set_pos(struct server_view *view, uint32_t x, uint32_t y);
+void server_view_set_scale(struct server_view *view, double scale);
 void server_view_set_size(struct server_view *view, uint32_t width, uint32_t height);
 void server_view_set_visible(struct server_view *view, bool visible);
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "server/server.h"
+#include <stddef.h>
 #include <stdint.h>
 #include <wayland-server-core.h>
 #include <wayland-util.h>
@@ -24,4 +25,25 @@ struct server_shm_pool {
     int32_t fd, sz;
 };
 
+struct server_shm_buffer_data {
+    int fd; // duplicated from the pool
+    int32_t offset;
+    int32_t width, height, stride;
+    uint32_t format; // enum wl_shm_format
+};
+
+// An access to the contents of a client's SHM buffer. Clients can shrink the file backing a buffer
+// at any time, so accesses must be guarded (see server_shm_buffer_begin_access.)
+struct server_shm_access {
+    uint8_t *data; // the start of the buffer (after the offset into its pool)
+
+    void *map;
+    size_t size;
+    volatile bool failed; // set if the client shrank the buffer's file during the access
+};
+
 struct server_shm *server_shm_create(struct server *server);
+
+bool server_shm_buffer_begin_access(struct server_shm_buffer_data *data,
+                                    struct server_shm_access *access);
+bool server_shm_buffer_end_access(struct server_shm_access *access);
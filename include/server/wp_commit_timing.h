@@ -0,0 +1,30 @@
+#pragma once
+
+#include "server/server.h"
+#include <wayland-server-core.h>
+#include <wayland-util.h>
+
+struct server_commit_timing_manager {
+    struct wl_global *global;
+    struct wl_list timers; // wl_resource link (server_commit_timer)
+
+    struct wp_commit_timing_manager_v1 *remote;
+
+    struct wl_listener on_display_destroy;
+};
+
+struct server_commit_timer {
+    struct wl_resource *resource;
+
+    struct server_surface *parent; // nullptr once the surface is destroyed
+    struct wp_commit_timer_v1 *remote;
+
+    // Whether a timestamp has been set since the last commit. The host compositor would raise a
+    // protocol error against waywall for a second one, so it is checked here instead.
+    bool pending;
+
+    struct wl_listener on_surface_commit;
+    struct wl_listener on_surface_destroy;
+};
+
+struct server_commit_timing_manager *server_commit_timing_manager_create(struct server *server);
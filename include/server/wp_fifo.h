@@ -0,0 +1,25 @@
+#pragma once
+
+#include "server/server.h"
+#include <wayland-server-core.h>
+#include <wayland-util.h>
+
+struct server_fifo_manager {
+    struct wl_global *global;
+    struct wl_list surfaces; // wl_resource link (server_fifo_surface)
+
+    struct wp_fifo_manager_v1 *remote;
+
+    struct wl_listener on_display_destroy;
+};
+
+struct server_fifo_surface {
+    struct wl_resource *resource;
+
+    struct server_surface *parent; // nullptr once the surface is destroyed
+    struct wp_fifo_v1 *remote;
+
+    struct wl_listener on_surface_destroy;
+};
+
+struct server_fifo_manager *server_fifo_manager_create(struct server *server);
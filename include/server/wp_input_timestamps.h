@@ -0,0 +1,42 @@
+#pragma once
+
+#include "server/server.h"
+#include <stdint.h>
+#include <time.h>
+#include <wayland-server-core.h>
+#include <wayland-util.h>
+
+enum server_input_device {
+    SERVER_INPUT_KEYBOARD,
+    SERVER_INPUT_POINTER,
+};
+
+struct server_input_timestamps {
+    struct wl_global *global;
+    struct wl_list keyboards; // wl_resource (zwp_input_timestamps_v1) link
+    struct wl_list pointers;  // wl_resource (zwp_input_timestamps_v1) link
+
+    struct server *server;
+
+    struct zwp_input_timestamps_manager_v1 *remote;
+    struct server_input_timestamps_remote {
+        struct zwp_input_timestamps_v1 *wl;
+
+        // The host sends a timestamp immediately before the input event it belongs to.
+        struct timespec last;
+        bool pending;
+    } remote_keyboard, remote_pointer;
+
+    struct wl_listener on_keyboard;
+    struct wl_listener on_pointer;
+
+    struct wl_listener on_display_destroy;
+};
+
+struct server_input_timestamps *server_input_timestamps_create(struct server *server);
+void server_input_timestamps_send(struct server_input_timestamps *input_timestamps,
+                                  enum server_input_device device,
+                                  struct wl_resource *input_resource, const struct timespec *time);
+bool server_input_timestamps_take(struct server_input_timestamps *input_timestamps,
+                                  enum server_input_device device, uint32_t time,
+                                  struct timespec *out);
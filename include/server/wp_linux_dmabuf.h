@@ -1,5 +1,6 @@
 #pragma once
 
+#include "server/dmabuf_feedback.h"
 #include "server/server.h"
 #include <wayland-client-core.h>
 #include <wayland-server-core.h>
@@ -40,6 +41,8 @@ struct server_linux_dmabuf_feedback {
     struct wl_resource *resource;
 
     struct zwp_linux_dmabuf_feedback_v1 *remote;
+
+    struct dmabuf_feedback state; // the batch currently being received from the host
 };
 
 struct server_dmabuf_data {
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "server/server.h"
+#include <wayland-server-core.h>
+#include <wayland-util.h>
+
+struct server_presentation {
+    struct wl_global *global;
+
+    struct wp_presentation *remote;
+    uint32_t clock_id; // the host compositor's presentation clock
+
+    struct wl_listener on_display_destroy;
+};
+
+struct server_presentation_feedback {
+    struct wl_resource *resource;
+    struct wp_presentation_feedback *remote;
+};
+
+struct server_presentation *server_presentation_create(struct server *server);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <sys/types.h>
 
@@ -39,6 +40,21 @@ extern struct util_debug {
 
         bool fullscreen;
     } ui;
+
+    struct {
+        size_t images, font, capture; // bytes
+        size_t budget;                // bytes, 0 if unlimited
+
+        size_t num_images, num_resident;
+    } textures;
+
+    struct {
+        char table[2048];
+    } profile;
+
+    struct {
+        uint32_t issued, skipped; // state changes during the last frame
+    } gl;
 } util_debug_data;
 
 bool util_debug_init();
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+
+struct util_glyph_options {
+    uint8_t rgb[3];
+    uint8_t tolerance;
+    int32_t scale;
+};
+
+char *util_glyph_read(const uint8_t *rgba, int32_t width, int32_t height,
+                      const struct util_glyph_options *options);
@@ -11,3 +11,4 @@ struct util_png {
 };
 
 struct util_png util_png_decode(const char *path, int max_size);
+bool util_png_encode(const char *path, const uint8_t *rgba, uint32_t width, uint32_t height);
@@ -10,7 +10,9 @@ struct wrap {
 
     struct server *server;
     struct server_gl *gl;
+    struct server_image_copy_capture *image_capture;
     struct scene *scene;
+    struct screenshot_writer *screenshots;
 
     struct inotify *inotify;
     struct subproc *subproc;
@@ -24,6 +26,7 @@ struct wrap {
     struct instance *instance;
     struct {
         int32_t w, h;
+        double scale; // 0 = use window.render_scale
     } active_res;
 
     struct wrap_floating {
@@ -58,6 +61,6 @@ int wrap_set_config(struct wrap *wrap, struct config *cfg);
 
 void wrap_lua_exec(struct wrap *wrap, struct strs cmd);
 void wrap_lua_press_key(struct wrap *wrap, uint32_t keycode);
-int wrap_lua_set_res(struct wrap *wrap, int32_t width, int32_t height);
+int wrap_lua_set_res(struct wrap *wrap, int32_t width, int32_t height, double scale);
 void wrap_lua_show_floating(struct wrap *wrap, bool show);
 void wrap_lua_toggle_fullscreen(struct wrap *wrap);
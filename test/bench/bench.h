@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <wayland-server-core.h>
+#include <wayland-util.h>
+
+// Written by the synthetic game client at the start of each buffer it commits. The host checks for
+// it on every commit so that it can tell which commits came from the game, and how long it took for
+// them to be forwarded.
+static constexpr uint64_t BENCH_FRAME_MAGIC = 0x574157424e434821; // "WAWBNCH!"
+
+struct bench_frame_header {
+    uint64_t magic;
+    uint64_t commit_ns; // CLOCK_MONOTONIC
+};
+
+struct bench_samples {
+    uint64_t *data;
+    size_t len, cap;
+};
+
+struct bench_summary {
+    uint64_t count;
+    uint64_t mean_ns, p50_ns, p99_ns, max_ns;
+};
+
+// Written by the synthetic game client to the report pipe just before it exits.
+struct bench_client_report {
+    uint64_t frames_committed;
+    uint64_t frames_dropped; // no buffer was free when the frame was due
+    bool input_precise;      // whether input events had nanosecond timestamps
+    struct bench_summary input_latency;
+};
+
+struct bench_host_options {
+    int32_t width, height;
+    int input_rate;
+};
+
+struct bench_host {
+    struct wl_display *display;
+    const char *socket_name;
+    struct bench_host_options options;
+
+    char *keymap;
+    size_t keymap_size;
+    uint32_t serial;
+
+    struct wl_list keyboards;           // wl_resource link
+    struct wl_list pointers;            // wl_resource link
+    struct wl_list keyboard_timestamps; // wl_resource link
+    struct wl_list pointer_timestamps;  // wl_resource link
+
+    struct wl_event_source *input_timer;
+    bool key_pressed;
+    uint32_t input_step;
+
+    uint64_t frames_received;
+    struct bench_samples commit_latency;
+
+    void (*first_frame)(void *data);
+    void *first_frame_data;
+};
+
+struct bench_host *bench_host_create(const struct bench_host_options *options);
+void bench_host_destroy(struct bench_host *host);
+void bench_host_stop_input(struct bench_host *host);
+
+int bench_client_main(int argc, char **argv);
+
+bool bench_env_setup(const char *tmpdir);
+void bench_env_remove(const char *path);
+
+uint64_t bench_now();
+void bench_samples_add(struct bench_samples *samples, uint64_t value);
+void bench_samples_free(struct bench_samples *samples);
+struct bench_summary bench_samples_summarize(struct bench_samples *samples);
@@ -0,0 +1,603 @@
+#include "bench.h"
+#include "input-timestamps-unstable-v1-client-protocol.h"
+#include "util/alloc.h"
+#include "util/prelude.h"
+#include "util/syscall.h"
+#include "xdg-shell-client-protocol.h"
+#include <errno.h>
+#include <linux/memfd.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <wayland-client-core.h>
+#include <wayland-client-protocol.h>
+
+/*
+ * A synthetic game client. It commits shm buffers at a fixed rate, each of which starts with a
+ * bench_frame_header, and measures how long input events take to reach it from the host. When the
+ * benchmark is over, it writes a bench_client_report to the report pipe and exits.
+ */
+
+static constexpr int BUFFER_COUNT = 3;
+
+struct client_buffer {
+    struct wl_buffer *wl;
+    void *data;
+    bool busy;
+};
+
+struct client_timestamp {
+    uint64_t ns;
+    bool pending;
+};
+
+struct client {
+    struct wl_display *display;
+    struct wl_registry *registry;
+
+    struct wl_compositor *compositor;
+    struct wl_shm *shm;
+    struct xdg_wm_base *xdg_wm_base;
+    struct wl_seat *seat;
+    struct zwp_input_timestamps_manager_v1 *input_timestamps_manager;
+
+    struct wl_keyboard *keyboard;
+    struct wl_pointer *pointer;
+    struct zwp_input_timestamps_v1 *keyboard_timestamps;
+    struct zwp_input_timestamps_v1 *pointer_timestamps;
+    struct client_timestamp keyboard_timestamp, pointer_timestamp;
+
+    struct wl_surface *surface;
+    struct xdg_surface *xdg_surface;
+    struct xdg_toplevel *xdg_toplevel;
+    bool configured;
+
+    int32_t width, height;
+    size_t buffer_size;
+    void *shm_data;
+    struct client_buffer buffers[BUFFER_COUNT];
+
+    struct bench_client_report report;
+    struct bench_samples input_latency;
+};
+
+static void
+record_input(struct client *client, struct client_timestamp *timestamp, uint32_t time) {
+    uint64_t now = bench_now();
+
+    if (timestamp->pending) {
+        timestamp->pending = false;
+        bench_samples_add(&client->input_latency, now - timestamp->ns);
+        return;
+    }
+
+    // Without input timestamps, only millisecond precision is available. The subtraction is done
+    // in 32 bits to account for the event time wrapping around.
+    client->report.input_precise = false;
+
+    uint32_t now_ms = (uint32_t)(now / 1000000);
+    bench_samples_add(&client->input_latency, (uint64_t)(uint32_t)(now_ms - time) * 1000000);
+}
+
+static void
+on_timestamp(void *data, struct zwp_input_timestamps_v1 *wl, uint32_t tv_sec_hi,
+             uint32_t tv_sec_lo, uint32_t tv_nsec) {
+    struct client_timestamp *timestamp = data;
+
+    uint64_t sec = ((uint64_t)tv_sec_hi << 32) | tv_sec_lo;
+    timestamp->ns = sec * 1000000000 + tv_nsec;
+    timestamp->pending = true;
+}
+
+static const struct zwp_input_timestamps_v1_listener timestamps_listener = {
+    .timestamp = on_timestamp,
+};
+
+static void
+on_keyboard_enter(void *data, struct wl_keyboard *wl, uint32_t serial, struct wl_surface *surface,
+                  struct wl_array *keys) {
+    // Unused.
+}
+
+static void
+on_keyboard_key(void *data, struct wl_keyboard *wl, uint32_t serial, uint32_t time, uint32_t key,
+                uint32_t state) {
+    struct client *client = data;
+
+    record_input(client, &client->keyboard_timestamp, time);
+}
+
+static void
+on_keyboard_keymap(void *data, struct wl_keyboard *wl, uint32_t format, int32_t fd, uint32_t size) {
+    close(fd);
+}
+
+static void
+on_keyboard_leave(void *data, struct wl_keyboard *wl, uint32_t serial, struct wl_surface *surface) {
+    // Unused.
+}
+
+static void
+on_keyboard_modifiers(void *data, struct wl_keyboard *wl, uint32_t serial, uint32_t mods_depressed,
+                      uint32_t mods_latched, uint32_t mods_locked, uint32_t group) {
+    // Unused.
+}
+
+static void
+on_keyboard_repeat_info(void *data, struct wl_keyboard *wl, int32_t rate, int32_t delay) {
+    // Unused.
+}
+
+static const struct wl_keyboard_listener keyboard_listener = {
+    .enter = on_keyboard_enter,
+    .key = on_keyboard_key,
+    .keymap = on_keyboard_keymap,
+    .leave = on_keyboard_leave,
+    .modifiers = on_keyboard_modifiers,
+    .repeat_info = on_keyboard_repeat_info,
+};
+
+static void
+on_pointer_axis(void *data, struct wl_pointer *wl, uint32_t time, uint32_t axis, wl_fixed_t value) {
+    // Unused.
+}
+
+static void
+on_pointer_axis_discrete(void *data, struct wl_pointer *wl, uint32_t axis, int32_t discrete) {
+    // Unused.
+}
+
+static void
+on_pointer_axis_source(void *data, struct wl_pointer *wl, uint32_t source) {
+    // Unused.
+}
+
+static void
+on_pointer_axis_stop(void *data, struct wl_pointer *wl, uint32_t time, uint32_t axis) {
+    // Unused.
+}
+
+static void
+on_pointer_button(void *data, struct wl_pointer *wl, uint32_t serial, uint32_t time,
+                  uint32_t button, uint32_t state) {
+    // Unused.
+}
+
+static void
+on_pointer_enter(void *data, struct wl_pointer *wl, uint32_t serial, struct wl_surface *surface,
+                 wl_fixed_t surface_x, wl_fixed_t surface_y) {
+    // Unused.
+}
+
+static void
+on_pointer_frame(void *data, struct wl_pointer *wl) {
+    // Unused.
+}
+
+static void
+on_pointer_leave(void *data, struct wl_pointer *wl, uint32_t serial, struct wl_surface *surface) {
+    // Unused.
+}
+
+static void
+on_pointer_motion(void *data, struct wl_pointer *wl, uint32_t time, wl_fixed_t surface_x,
+                  wl_fixed_t surface_y) {
+    struct client *client = data;
+
+    record_input(client, &client->pointer_timestamp, time);
+}
+
+static const struct wl_pointer_listener pointer_listener = {
+    .axis = on_pointer_axis,
+    .axis_discrete = on_pointer_axis_discrete,
+    .axis_source = on_pointer_axis_source,
+    .axis_stop = on_pointer_axis_stop,
+    .button = on_pointer_button,
+    .enter = on_pointer_enter,
+    .frame = on_pointer_frame,
+    .leave = on_pointer_leave,
+    .motion = on_pointer_motion,
+};
+
+static void
+on_seat_capabilities(void *data, struct wl_seat *wl, uint32_t caps) {
+    struct client *client = data;
+
+    if ((caps & WL_SEAT_CAPABILITY_KEYBOARD) && !client->keyboard) {
+        client->keyboard = wl_seat_get_keyboard(client->seat);
+        check_alloc(client->keyboard);
+        wl_keyboard_add_listener(client->keyboard, &keyboard_listener, client);
+
+        if (client->input_timestamps_manager) {
+            client->keyboard_timestamps =
+                zwp_input_timestamps_manager_v1_get_keyboard_timestamps(
+                    client->input_timestamps_manager, client->keyboard);
+            check_alloc(client->keyboard_timestamps);
+            zwp_input_timestamps_v1_add_listener(client->keyboard_timestamps,
+                                                 &timestamps_listener, &client->keyboard_timestamp);
+        }
+    }
+
+    if ((caps & WL_SEAT_CAPABILITY_POINTER) && !client->pointer) {
+        client->pointer = wl_seat_get_pointer(client->seat);
+        check_alloc(client->pointer);
+        wl_pointer_add_listener(client->pointer, &pointer_listener, client);
+
+        if (client->input_timestamps_manager) {
+            client->pointer_timestamps = zwp_input_timestamps_manager_v1_get_pointer_timestamps(
+                client->input_timestamps_manager, client->pointer);
+            check_alloc(client->pointer_timestamps);
+            zwp_input_timestamps_v1_add_listener(client->pointer_timestamps, &timestamps_listener,
+                                                 &client->pointer_timestamp);
+        }
+    }
+}
+
+static void
+on_seat_name(void *data, struct wl_seat *wl, const char *name) {
+    // Unused.
+}
+
+static const struct wl_seat_listener seat_listener = {
+    .capabilities = on_seat_capabilities,
+    .name = on_seat_name,
+};
+
+static void
+on_xdg_wm_base_ping(void *data, struct xdg_wm_base *wl, uint32_t serial) {
+    xdg_wm_base_pong(wl, serial);
+}
+
+static const struct xdg_wm_base_listener xdg_wm_base_listener = {
+    .ping = on_xdg_wm_base_ping,
+};
+
+static void
+on_xdg_surface_configure(void *data, struct xdg_surface *wl, uint32_t serial) {
+    struct client *client = data;
+
+    xdg_surface_ack_configure(wl, serial);
+    client->configured = true;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+    .configure = on_xdg_surface_configure,
+};
+
+static void
+on_xdg_toplevel_close(void *data, struct xdg_toplevel *wl) {
+    // Unused.
+}
+
+static void
+on_xdg_toplevel_configure(void *data, struct xdg_toplevel *wl, int32_t width, int32_t height,
+                          struct wl_array *states) {
+    // Unused. The client always draws at the size it was started with.
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+    .close = on_xdg_toplevel_close,
+    .configure = on_xdg_toplevel_configure,
+};
+
+static void
+on_buffer_release(void *data, struct wl_buffer *wl) {
+    struct client_buffer *buffer = data;
+
+    buffer->busy = false;
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+    .release = on_buffer_release,
+};
+
+static void
+on_registry_global(void *data, struct wl_registry *wl, uint32_t name, const char *iface,
+                   uint32_t version) {
+    struct client *client = data;
+
+    if (strcmp(iface, wl_compositor_interface.name) == 0) {
+        if (version < 4) {
+            return;
+        }
+
+        client->compositor = wl_registry_bind(wl, name, &wl_compositor_interface, 4);
+        check_alloc(client->compositor);
+    } else if (strcmp(iface, wl_seat_interface.name) == 0) {
+        client->seat = wl_registry_bind(wl, name, &wl_seat_interface, version < 5 ? version : 5);
+        check_alloc(client->seat);
+    } else if (strcmp(iface, wl_shm_interface.name) == 0) {
+        client->shm = wl_registry_bind(wl, name, &wl_shm_interface, 1);
+        check_alloc(client->shm);
+    } else if (strcmp(iface, xdg_wm_base_interface.name) == 0) {
+        client->xdg_wm_base = wl_registry_bind(wl, name, &xdg_wm_base_interface, 1);
+        check_alloc(client->xdg_wm_base);
+    } else if (strcmp(iface, zwp_input_timestamps_manager_v1_interface.name) == 0) {
+        client->input_timestamps_manager =
+            wl_registry_bind(wl, name, &zwp_input_timestamps_manager_v1_interface, 1);
+        check_alloc(client->input_timestamps_manager);
+    }
+}
+
+static void
+on_registry_global_remove(void *data, struct wl_registry *wl, uint32_t name) {
+    // Unused.
+}
+
+static const struct wl_registry_listener registry_listener = {
+    .global = on_registry_global,
+    .global_remove = on_registry_global_remove,
+};
+
+static bool
+create_buffers(struct client *client) {
+    int32_t stride = client->width * 4;
+    client->buffer_size = (size_t)stride * (size_t)client->height;
+    size_t pool_size = client->buffer_size * BUFFER_COUNT;
+
+    int fd = memfd_create("bench-client", MFD_CLOEXEC);
+    if (fd == -1) {
+        perror("memfd_create");
+        return false;
+    }
+
+    if (ftruncate(fd, pool_size) != 0) {
+        perror("ftruncate");
+        goto fail_truncate;
+    }
+
+    client->shm_data = mmap(nullptr, pool_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (client->shm_data == MAP_FAILED) {
+        perror("mmap");
+        goto fail_truncate;
+    }
+
+    struct wl_shm_pool *pool = wl_shm_create_pool(client->shm, fd, pool_size);
+    check_alloc(pool);
+
+    for (int i = 0; i < BUFFER_COUNT; i++) {
+        struct client_buffer *buffer = &client->buffers[i];
+
+        buffer->data = (char *)client->shm_data + client->buffer_size * i;
+        buffer->wl = wl_shm_pool_create_buffer(pool, client->buffer_size * i, client->width,
+                                               client->height, stride, WL_SHM_FORMAT_XRGB8888);
+        check_alloc(buffer->wl);
+        wl_buffer_add_listener(buffer->wl, &buffer_listener, buffer);
+    }
+
+    wl_shm_pool_destroy(pool);
+    close(fd);
+    return true;
+
+fail_truncate:
+    close(fd);
+    return false;
+}
+
+static void
+commit_frame(struct client *client) {
+    struct client_buffer *buffer = nullptr;
+    for (int i = 0; i < BUFFER_COUNT; i++) {
+        if (!client->buffers[i].busy) {
+            buffer = &client->buffers[i];
+            break;
+        }
+    }
+
+    if (!buffer) {
+        client->report.frames_dropped++;
+        return;
+    }
+
+    struct bench_frame_header header = {
+        .magic = BENCH_FRAME_MAGIC,
+        .commit_ns = bench_now(),
+    };
+    memcpy(buffer->data, &header, sizeof(header));
+
+    wl_surface_attach(client->surface, buffer->wl, 0, 0);
+    wl_surface_damage_buffer(client->surface, 0, 0, client->width, client->height);
+    wl_surface_commit(client->surface);
+    buffer->busy = true;
+
+    client->report.frames_committed++;
+}
+
+static int
+run(struct client *client, int rate, int duration) {
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (tfd == -1) {
+        perror("timerfd_create");
+        return 1;
+    }
+
+    long interval = 1000000000L / rate;
+    struct itimerspec spec = {
+        .it_interval = {.tv_sec = interval / 1000000000L, .tv_nsec = interval % 1000000000L},
+        .it_value = {.tv_sec = interval / 1000000000L, .tv_nsec = interval % 1000000000L},
+    };
+    if (timerfd_settime(tfd, 0, &spec, nullptr) != 0) {
+        perror("timerfd_settime");
+        goto fail;
+    }
+
+    uint64_t end = bench_now() + (uint64_t)duration * 1000000000;
+
+    struct pollfd pfds[] = {
+        {.fd = wl_display_get_fd(client->display), .events = POLLIN},
+        {.fd = tfd, .events = POLLIN},
+    };
+
+    while (bench_now() < end) {
+        while (wl_display_prepare_read(client->display) != 0) {
+            if (wl_display_dispatch_pending(client->display) == -1) {
+                goto fail_display;
+            }
+        }
+
+        if (wl_display_flush(client->display) == -1 && errno != EAGAIN) {
+            wl_display_cancel_read(client->display);
+            goto fail_display;
+        }
+
+        if (poll(pfds, STATIC_ARRLEN(pfds), 100) == -1) {
+            wl_display_cancel_read(client->display);
+            if (errno == EINTR) {
+                continue;
+            }
+
+            perror("poll");
+            goto fail;
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            if (wl_display_read_events(client->display) == -1) {
+                goto fail_display;
+            }
+        } else {
+            wl_display_cancel_read(client->display);
+        }
+
+        if (wl_display_dispatch_pending(client->display) == -1) {
+            goto fail_display;
+        }
+
+        if (pfds[1].revents & POLLIN) {
+            uint64_t expirations;
+            ww_assert(read(tfd, &expirations, sizeof(expirations)) == (ssize_t)sizeof(expirations));
+
+            // Frames which were missed entirely because the client was too slow to process its
+            // timer are counted as dropped, too.
+            client->report.frames_dropped += expirations - 1;
+            commit_frame(client);
+            wl_display_flush(client->display);
+        }
+    }
+
+    close(tfd);
+    return 0;
+
+fail_display:
+    fprintf(stderr, "lost connection to the compositor\n");
+
+fail:
+    close(tfd);
+    return 1;
+}
+
+static bool
+parse_int(const char *arg, int *out) {
+    char *end;
+    long value = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || value <= 0 || value > INT32_MAX) {
+        return false;
+    }
+
+    *out = (int)value;
+    return true;
+}
+
+int
+bench_client_main(int argc, char **argv) {
+    int report_fd = -1, rate = 0, duration = 0, width = 0, height = 0;
+
+    const struct {
+        const char *name;
+        int *value;
+    } opts[] = {
+        {"--report-fd", &report_fd}, {"--rate", &rate},     {"--duration", &duration},
+        {"--width", &width},         {"--height", &height},
+    };
+
+    for (int i = 1; i < argc; i++) {
+        bool ok = false;
+        for (size_t j = 0; j < STATIC_ARRLEN(opts); j++) {
+            if (strcmp(argv[i], opts[j].name) == 0 && i + 1 < argc) {
+                ok = parse_int(argv[++i], opts[j].value);
+                break;
+            }
+        }
+
+        if (!ok) {
+            fprintf(stderr, "client: invalid argument '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (report_fd < 0 || rate == 0 || duration == 0 || width == 0 || height == 0) {
+        fprintf(stderr, "client: missing arguments\n");
+        return 1;
+    }
+
+    struct client client = {.width = width, .height = height};
+    client.report.input_precise = true;
+
+    client.display = wl_display_connect(nullptr);
+    if (!client.display) {
+        fprintf(stderr, "client: failed to connect to wayland display\n");
+        return 1;
+    }
+
+    client.registry = wl_display_get_registry(client.display);
+    check_alloc(client.registry);
+    wl_registry_add_listener(client.registry, &registry_listener, &client);
+    wl_display_roundtrip(client.display);
+
+    if (!client.compositor || !client.shm || !client.xdg_wm_base || !client.seat) {
+        fprintf(stderr, "client: compositor is missing required globals\n");
+        goto fail;
+    }
+
+    xdg_wm_base_add_listener(client.xdg_wm_base, &xdg_wm_base_listener, &client);
+    wl_seat_add_listener(client.seat, &seat_listener, &client);
+
+    if (!create_buffers(&client)) {
+        goto fail;
+    }
+
+    client.surface = wl_compositor_create_surface(client.compositor);
+    check_alloc(client.surface);
+
+    client.xdg_surface = xdg_wm_base_get_xdg_surface(client.xdg_wm_base, client.surface);
+    check_alloc(client.xdg_surface);
+    xdg_surface_add_listener(client.xdg_surface, &xdg_surface_listener, &client);
+
+    client.xdg_toplevel = xdg_surface_get_toplevel(client.xdg_surface);
+    check_alloc(client.xdg_toplevel);
+    xdg_toplevel_add_listener(client.xdg_toplevel, &xdg_toplevel_listener, &client);
+    xdg_toplevel_set_title(client.xdg_toplevel, "bench");
+
+    wl_surface_commit(client.surface);
+    while (!client.configured) {
+        if (wl_display_dispatch(client.display) == -1) {
+            fprintf(stderr, "client: lost connection to the compositor\n");
+            goto fail;
+        }
+    }
+
+    if (run(&client, rate, duration) != 0) {
+        goto fail;
+    }
+
+    client.report.input_latency = bench_samples_summarize(&client.input_latency);
+    bench_samples_free(&client.input_latency);
+
+    ssize_t written = write(report_fd, &client.report, sizeof(client.report));
+    if (written != (ssize_t)sizeof(client.report)) {
+        perror("write");
+        goto fail;
+    }
+    close(report_fd);
+
+    wl_display_disconnect(client.display);
+    return 0;
+
+fail:
+    bench_samples_free(&client.input_latency);
+    wl_display_disconnect(client.display);
+    return 1;
+}
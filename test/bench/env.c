@@ -0,0 +1,87 @@
+#include "bench.h"
+#include "util/prelude.h"
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Sets up a temporary environment for running waywall, so that it does not pick up the user's
+ * configuration or runtime directory.
+ */
+
+static bool
+make_dir(const char *base, const char *name, mode_t mode, char *out, size_t out_len) {
+    snprintf(out, out_len, "%s/%s", base, name);
+    if (mkdir(out, mode) != 0) {
+        fprintf(stderr, "failed to create directory '%s': %s\n", out, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+bool
+bench_env_setup(const char *tmpdir) {
+    char runtime_dir[PATH_MAX], config_dir[PATH_MAX], state_dir[PATH_MAX], path[PATH_MAX];
+
+    if (!make_dir(tmpdir, "runtime", 0700, runtime_dir, STATIC_ARRLEN(runtime_dir))) {
+        return false;
+    }
+    if (!make_dir(tmpdir, "config", 0755, config_dir, STATIC_ARRLEN(config_dir))) {
+        return false;
+    }
+    if (!make_dir(config_dir, "waywall", 0755, path, STATIC_ARRLEN(path))) {
+        return false;
+    }
+    if (!make_dir(tmpdir, "state", 0755, state_dir, STATIC_ARRLEN(state_dir))) {
+        return false;
+    }
+
+    // An empty configuration has no keybinds, so all input is forwarded to the client.
+    snprintf(path, STATIC_ARRLEN(path), "%s/waywall/init.lua", config_dir);
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "failed to create '%s': %s\n", path, strerror(errno));
+        return false;
+    }
+    fputs("return {}\n", file);
+    fclose(file);
+
+    setenv("XDG_RUNTIME_DIR", runtime_dir, 1);
+    setenv("XDG_CONFIG_HOME", config_dir, 1);
+    setenv("XDG_STATE_HOME", state_dir, 1);
+    unsetenv("WAYLAND_DISPLAY");
+    unsetenv("WAYLAND_SOCKET");
+    return true;
+}
+
+void
+bench_env_remove(const char *path) {
+    DIR *dir = opendir(path);
+    if (dir) {
+        struct dirent *dirent;
+        while ((dirent = readdir(dir))) {
+            if (strcmp(dirent->d_name, ".") == 0 || strcmp(dirent->d_name, "..") == 0) {
+                continue;
+            }
+
+            char child[PATH_MAX];
+            snprintf(child, STATIC_ARRLEN(child), "%s/%s", path, dirent->d_name);
+
+            struct stat child_stat;
+            if (lstat(child, &child_stat) == 0 && S_ISDIR(child_stat.st_mode)) {
+                bench_env_remove(child);
+            } else {
+                unlink(child);
+            }
+        }
+        closedir(dir);
+    }
+
+    rmdir(path);
+}
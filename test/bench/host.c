@@ -0,0 +1,1230 @@
+#include "bench.h"
+#include "input-timestamps-unstable-v1-server-protocol.h"
+#include "linux-dmabuf-v1-server-protocol.h"
+#include "pointer-constraints-unstable-v1-server-protocol.h"
+#include "relative-pointer-unstable-v1-server-protocol.h"
+#include "util/alloc.h"
+#include "util/prelude.h"
+#include "util/syscall.h"
+#include "viewporter-server-protocol.h"
+#include "xdg-shell-server-protocol.h"
+#include <dirent.h>
+#include <linux/input-event-codes.h>
+#include <linux/memfd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+#include <wayland-server-protocol.h>
+#include <xkbcommon/xkbcommon.h>
+
+/*
+ * A headless stand-in for the host compositor, which provides the globals that waywall requires
+ * (see server_backend_create) and nothing more. Surfaces are never drawn. Buffers are released as
+ * soon as they are committed, and frame callbacks are completed at the same time.
+ *
+ * Only the contents of shm buffers are ever read, to find the commits made by the game client.
+ * dmabuf buffers are accepted without being imported so that waywall's EGL context can be backed by
+ * a real GPU.
+ */
+
+static constexpr uint32_t DRM_FORMAT_ARGB8888 = 0x34325241;
+static constexpr uint32_t DRM_FORMAT_XRGB8888 = 0x34325258;
+static constexpr uint64_t DRM_FORMAT_MOD_LINEAR = 0;
+
+struct host_surface {
+    struct wl_resource *resource;
+    struct bench_host *host;
+
+    struct wl_resource *pending_buffer;
+    struct wl_listener on_pending_buffer_destroy;
+
+    struct wl_list frames; // wl_resource (wl_callback) link
+
+    struct host_xdg_surface *xdg_surface;
+};
+
+struct host_xdg_surface {
+    struct wl_resource *resource;
+    struct host_surface *surface;
+
+    struct wl_resource *toplevel;
+    bool configured;
+};
+
+static uint32_t
+now_ms() {
+    return (uint32_t)(bench_now() / 1000000);
+}
+
+static void
+resource_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static void
+resource_unlink(struct wl_resource *resource) {
+    wl_list_remove(wl_resource_get_link(resource));
+}
+
+/*
+ * wl_buffer (dmabuf)
+ */
+
+static const struct wl_buffer_interface buffer_impl = {
+    .destroy = resource_destroy,
+};
+
+/*
+ * wl_region
+ */
+
+static void
+region_add(struct wl_client *client, struct wl_resource *resource, int32_t x, int32_t y,
+           int32_t width, int32_t height) {
+    // Unused.
+}
+
+static void
+region_subtract(struct wl_client *client, struct wl_resource *resource, int32_t x, int32_t y,
+                int32_t width, int32_t height) {
+    // Unused.
+}
+
+static const struct wl_region_interface region_impl = {
+    .add = region_add,
+    .destroy = resource_destroy,
+    .subtract = region_subtract,
+};
+
+/*
+ * wl_surface
+ */
+
+static void
+check_frame(struct host_surface *surface, struct wl_resource *buffer_resource) {
+    struct wl_shm_buffer *buffer = wl_shm_buffer_get(buffer_resource);
+    if (!buffer) {
+        return;
+    }
+
+    int32_t size = wl_shm_buffer_get_stride(buffer) * wl_shm_buffer_get_height(buffer);
+    if (size < (int32_t)sizeof(struct bench_frame_header)) {
+        return;
+    }
+
+    uint64_t now = bench_now();
+
+    struct bench_frame_header header;
+    wl_shm_buffer_begin_access(buffer);
+    memcpy(&header, wl_shm_buffer_get_data(buffer), sizeof(header));
+    wl_shm_buffer_end_access(buffer);
+
+    if (header.magic != BENCH_FRAME_MAGIC) {
+        return;
+    }
+
+    struct bench_host *host = surface->host;
+    host->frames_received++;
+    bench_samples_add(&host->commit_latency, now - header.commit_ns);
+
+    if (host->frames_received == 1) {
+        if (host->first_frame) {
+            host->first_frame(host->first_frame_data);
+        }
+        wl_event_source_timer_update(host->input_timer, 1);
+    }
+}
+
+static void
+on_pending_buffer_destroy(struct wl_listener *listener, void *data) {
+    struct host_surface *surface = wl_container_of(listener, surface, on_pending_buffer_destroy);
+
+    surface->pending_buffer = nullptr;
+
+    wl_list_remove(&surface->on_pending_buffer_destroy.link);
+    wl_list_init(&surface->on_pending_buffer_destroy.link);
+}
+
+static void
+surface_resource_destroy(struct wl_resource *resource) {
+    struct host_surface *surface = wl_resource_get_user_data(resource);
+
+    struct wl_resource *frame, *tmp;
+    wl_resource_for_each_safe(frame, tmp, &surface->frames) {
+        wl_resource_destroy(frame);
+    }
+
+    if (surface->xdg_surface) {
+        surface->xdg_surface->surface = nullptr;
+    }
+
+    wl_list_remove(&surface->on_pending_buffer_destroy.link);
+    free(surface);
+}
+
+static void
+surface_attach(struct wl_client *client, struct wl_resource *resource,
+               struct wl_resource *buffer_resource, int32_t x, int32_t y) {
+    struct host_surface *surface = wl_resource_get_user_data(resource);
+
+    wl_list_remove(&surface->on_pending_buffer_destroy.link);
+    wl_list_init(&surface->on_pending_buffer_destroy.link);
+
+    surface->pending_buffer = buffer_resource;
+    if (buffer_resource) {
+        wl_resource_add_destroy_listener(buffer_resource, &surface->on_pending_buffer_destroy);
+    }
+}
+
+static void
+surface_commit(struct wl_client *client, struct wl_resource *resource) {
+    struct host_surface *surface = wl_resource_get_user_data(resource);
+
+    if (surface->pending_buffer) {
+        check_frame(surface, surface->pending_buffer);
+        wl_buffer_send_release(surface->pending_buffer);
+
+        wl_list_remove(&surface->on_pending_buffer_destroy.link);
+        wl_list_init(&surface->on_pending_buffer_destroy.link);
+        surface->pending_buffer = nullptr;
+    }
+
+    uint32_t time = now_ms();
+    struct wl_resource *frame, *tmp;
+    wl_resource_for_each_safe(frame, tmp, &surface->frames) {
+        wl_callback_send_done(frame, time);
+        wl_resource_destroy(frame);
+    }
+
+    // The first commit of an xdg_toplevel is answered with its initial configure.
+    struct host_xdg_surface *xdg_surface = surface->xdg_surface;
+    if (xdg_surface && xdg_surface->toplevel && !xdg_surface->configured) {
+        struct wl_array states;
+        wl_array_init(&states);
+        xdg_toplevel_send_configure(xdg_surface->toplevel, surface->host->options.width,
+                                    surface->host->options.height, &states);
+        wl_array_release(&states);
+
+        xdg_surface_send_configure(xdg_surface->resource, ++surface->host->serial);
+        xdg_surface->configured = true;
+    }
+}
+
+static void
+surface_damage(struct wl_client *client, struct wl_resource *resource, int32_t x, int32_t y,
+               int32_t width, int32_t height) {
+    // Unused.
+}
+
+static void
+surface_damage_buffer(struct wl_client *client, struct wl_resource *resource, int32_t x, int32_t y,
+                      int32_t width, int32_t height) {
+    // Unused.
+}
+
+static void
+surface_frame(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    struct host_surface *surface = wl_resource_get_user_data(resource);
+
+    struct wl_resource *frame = wl_resource_create(client, &wl_callback_interface, 1, id);
+    check_alloc(frame);
+    wl_resource_set_implementation(frame, nullptr, nullptr, resource_unlink);
+
+    wl_list_insert(&surface->frames, wl_resource_get_link(frame));
+}
+
+static void
+surface_offset(struct wl_client *client, struct wl_resource *resource, int32_t x, int32_t y) {
+    // Unused.
+}
+
+static void
+surface_set_buffer_scale(struct wl_client *client, struct wl_resource *resource, int32_t scale) {
+    // Unused.
+}
+
+static void
+surface_set_buffer_transform(struct wl_client *client, struct wl_resource *resource,
+                             int32_t transform) {
+    // Unused.
+}
+
+static void
+surface_set_input_region(struct wl_client *client, struct wl_resource *resource,
+                         struct wl_resource *region_resource) {
+    // Unused.
+}
+
+static void
+surface_set_opaque_region(struct wl_client *client, struct wl_resource *resource,
+                          struct wl_resource *region_resource) {
+    // Unused.
+}
+
+static const struct wl_surface_interface surface_impl = {
+    .attach = surface_attach,
+    .commit = surface_commit,
+    .damage = surface_damage,
+    .damage_buffer = surface_damage_buffer,
+    .destroy = resource_destroy,
+    .frame = surface_frame,
+    .offset = surface_offset,
+    .set_buffer_scale = surface_set_buffer_scale,
+    .set_buffer_transform = surface_set_buffer_transform,
+    .set_input_region = surface_set_input_region,
+    .set_opaque_region = surface_set_opaque_region,
+};
+
+/*
+ * wl_compositor
+ */
+
+static void
+compositor_create_region(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    struct wl_resource *region_resource =
+        wl_resource_create(client, &wl_region_interface, wl_resource_get_version(resource), id);
+    check_alloc(region_resource);
+    wl_resource_set_implementation(region_resource, &region_impl, nullptr, nullptr);
+}
+
+static void
+compositor_create_surface(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    struct bench_host *host = wl_resource_get_user_data(resource);
+
+    struct host_surface *surface = zalloc(1, sizeof(*surface));
+    surface->host = host;
+
+    surface->resource =
+        wl_resource_create(client, &wl_surface_interface, wl_resource_get_version(resource), id);
+    check_alloc(surface->resource);
+    wl_resource_set_implementation(surface->resource, &surface_impl, surface,
+                                   surface_resource_destroy);
+
+    wl_list_init(&surface->frames);
+
+    surface->on_pending_buffer_destroy.notify = on_pending_buffer_destroy;
+    wl_list_init(&surface->on_pending_buffer_destroy.link);
+}
+
+static const struct wl_compositor_interface compositor_impl = {
+    .create_region = compositor_create_region,
+    .create_surface = compositor_create_surface,
+};
+
+static void
+on_compositor_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    struct wl_resource *resource =
+        wl_resource_create(client, &wl_compositor_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &compositor_impl, data, nullptr);
+}
+
+/*
+ * wl_subcompositor
+ */
+
+static void
+subsurface_place_above(struct wl_client *client, struct wl_resource *resource,
+                       struct wl_resource *sibling_resource) {
+    // Unused.
+}
+
+static void
+subsurface_place_below(struct wl_client *client, struct wl_resource *resource,
+                       struct wl_resource *sibling_resource) {
+    // Unused.
+}
+
+static void
+subsurface_set_desync(struct wl_client *client, struct wl_resource *resource) {
+    // Unused.
+}
+
+static void
+subsurface_set_position(struct wl_client *client, struct wl_resource *resource, int32_t x,
+                        int32_t y) {
+    // Unused.
+}
+
+static void
+subsurface_set_sync(struct wl_client *client, struct wl_resource *resource) {
+    // Unused.
+}
+
+static const struct wl_subsurface_interface subsurface_impl = {
+    .destroy = resource_destroy,
+    .place_above = subsurface_place_above,
+    .place_below = subsurface_place_below,
+    .set_desync = subsurface_set_desync,
+    .set_position = subsurface_set_position,
+    .set_sync = subsurface_set_sync,
+};
+
+static void
+subcompositor_get_subsurface(struct wl_client *client, struct wl_resource *resource, uint32_t id,
+                             struct wl_resource *surface_resource,
+                             struct wl_resource *parent_resource) {
+    struct wl_resource *subsurface_resource =
+        wl_resource_create(client, &wl_subsurface_interface, wl_resource_get_version(resource), id);
+    check_alloc(subsurface_resource);
+    wl_resource_set_implementation(subsurface_resource, &subsurface_impl, nullptr, nullptr);
+}
+
+static const struct wl_subcompositor_interface subcompositor_impl = {
+    .destroy = resource_destroy,
+    .get_subsurface = subcompositor_get_subsurface,
+};
+
+static void
+on_subcompositor_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    struct wl_resource *resource =
+        wl_resource_create(client, &wl_subcompositor_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &subcompositor_impl, data, nullptr);
+}
+
+/*
+ * wl_data_device_manager
+ */
+
+static void
+data_device_set_selection(struct wl_client *client, struct wl_resource *resource,
+                          struct wl_resource *source_resource, uint32_t serial) {
+    // Unused.
+}
+
+static void
+data_device_start_drag(struct wl_client *client, struct wl_resource *resource,
+                       struct wl_resource *source_resource, struct wl_resource *origin_resource,
+                       struct wl_resource *icon_resource, uint32_t serial) {
+    // Unused.
+}
+
+static const struct wl_data_device_interface data_device_impl = {
+    .release = resource_destroy,
+    .set_selection = data_device_set_selection,
+    .start_drag = data_device_start_drag,
+};
+
+static void
+data_source_offer(struct wl_client *client, struct wl_resource *resource, const char *mime_type) {
+    // Unused.
+}
+
+static void
+data_source_set_actions(struct wl_client *client, struct wl_resource *resource,
+                        uint32_t dnd_actions) {
+    // Unused.
+}
+
+static const struct wl_data_source_interface data_source_impl = {
+    .destroy = resource_destroy,
+    .offer = data_source_offer,
+    .set_actions = data_source_set_actions,
+};
+
+static void
+data_device_manager_create_data_source(struct wl_client *client, struct wl_resource *resource,
+                                       uint32_t id) {
+    struct wl_resource *source_resource = wl_resource_create(
+        client, &wl_data_source_interface, wl_resource_get_version(resource), id);
+    check_alloc(source_resource);
+    wl_resource_set_implementation(source_resource, &data_source_impl, nullptr, nullptr);
+}
+
+static void
+data_device_manager_get_data_device(struct wl_client *client, struct wl_resource *resource,
+                                    uint32_t id, struct wl_resource *seat_resource) {
+    struct wl_resource *device_resource = wl_resource_create(
+        client, &wl_data_device_interface, wl_resource_get_version(resource), id);
+    check_alloc(device_resource);
+    wl_resource_set_implementation(device_resource, &data_device_impl, nullptr, nullptr);
+}
+
+static const struct wl_data_device_manager_interface data_device_manager_impl = {
+    .create_data_source = data_device_manager_create_data_source,
+    .get_data_device = data_device_manager_get_data_device,
+};
+
+static void
+on_data_device_manager_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    struct wl_resource *resource =
+        wl_resource_create(client, &wl_data_device_manager_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &data_device_manager_impl, data, nullptr);
+}
+
+/*
+ * zwp_linux_dmabuf_v1
+ */
+
+static void
+buffer_params_add(struct wl_client *client, struct wl_resource *resource, int32_t fd,
+                  uint32_t plane_idx, uint32_t offset, uint32_t stride, uint32_t modifier_hi,
+                  uint32_t modifier_lo) {
+    // The buffer is never imported, so its planes do not need to be kept.
+    close(fd);
+}
+
+static struct wl_resource *
+create_dmabuf_buffer(struct wl_client *client, uint32_t id) {
+    struct wl_resource *buffer_resource = wl_resource_create(client, &wl_buffer_interface, 1, id);
+    check_alloc(buffer_resource);
+    wl_resource_set_implementation(buffer_resource, &buffer_impl, nullptr, nullptr);
+
+    return buffer_resource;
+}
+
+static void
+buffer_params_create(struct wl_client *client, struct wl_resource *resource, int32_t width,
+                     int32_t height, uint32_t format, uint32_t flags) {
+    struct wl_resource *buffer_resource = create_dmabuf_buffer(client, 0);
+    zwp_linux_buffer_params_v1_send_created(resource, buffer_resource);
+}
+
+static void
+buffer_params_create_immed(struct wl_client *client, struct wl_resource *resource,
+                           uint32_t buffer_id, int32_t width, int32_t height, uint32_t format,
+                           uint32_t flags) {
+    create_dmabuf_buffer(client, buffer_id);
+}
+
+static const struct zwp_linux_buffer_params_v1_interface buffer_params_impl = {
+    .add = buffer_params_add,
+    .create = buffer_params_create,
+    .create_immed = buffer_params_create_immed,
+    .destroy = resource_destroy,
+};
+
+static const struct zwp_linux_dmabuf_feedback_v1_interface dmabuf_feedback_impl = {
+    .destroy = resource_destroy,
+};
+
+static dev_t
+find_render_device() {
+    DIR *dir = opendir("/dev/dri");
+    if (!dir) {
+        return 0;
+    }
+
+    dev_t device = 0;
+    struct dirent *dirent;
+    while ((dirent = readdir(dir))) {
+        if (strncmp(dirent->d_name, "renderD", STATIC_STRLEN("renderD")) != 0) {
+            continue;
+        }
+
+        char path[64];
+        snprintf(path, STATIC_ARRLEN(path), "/dev/dri/%s", dirent->d_name);
+
+        struct stat dev_stat;
+        if (stat(path, &dev_stat) == 0) {
+            device = dev_stat.st_rdev;
+            break;
+        }
+    }
+
+    closedir(dir);
+    return device;
+}
+
+static void
+send_dmabuf_feedback(struct wl_resource *resource) {
+    struct {
+        uint32_t format;
+        uint32_t padding;
+        uint64_t modifier;
+    } table[] = {
+        {DRM_FORMAT_ARGB8888, 0, DRM_FORMAT_MOD_LINEAR},
+        {DRM_FORMAT_XRGB8888, 0, DRM_FORMAT_MOD_LINEAR},
+    };
+
+    int fd = memfd_create("bench-dmabuf-table", MFD_CLOEXEC);
+    ww_assert(fd >= 0);
+    ww_assert(write(fd, table, sizeof(table)) == (ssize_t)sizeof(table));
+
+    zwp_linux_dmabuf_feedback_v1_send_format_table(resource, fd, sizeof(table));
+    close(fd);
+
+    dev_t device = find_render_device();
+    struct wl_array device_array = {
+        .size = sizeof(device),
+        .alloc = 0,
+        .data = &device,
+    };
+    zwp_linux_dmabuf_feedback_v1_send_main_device(resource, &device_array);
+    zwp_linux_dmabuf_feedback_v1_send_tranche_target_device(resource, &device_array);
+
+    uint16_t indices[] = {0, 1};
+    struct wl_array indices_array = {
+        .size = sizeof(indices),
+        .alloc = 0,
+        .data = indices,
+    };
+    zwp_linux_dmabuf_feedback_v1_send_tranche_formats(resource, &indices_array);
+    zwp_linux_dmabuf_feedback_v1_send_tranche_flags(resource, 0);
+    zwp_linux_dmabuf_feedback_v1_send_tranche_done(resource);
+
+    zwp_linux_dmabuf_feedback_v1_send_done(resource);
+}
+
+static void
+create_dmabuf_feedback(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    struct wl_resource *feedback_resource = wl_resource_create(
+        client, &zwp_linux_dmabuf_feedback_v1_interface, wl_resource_get_version(resource), id);
+    check_alloc(feedback_resource);
+    wl_resource_set_implementation(feedback_resource, &dmabuf_feedback_impl, nullptr, nullptr);
+
+    send_dmabuf_feedback(feedback_resource);
+}
+
+static void
+linux_dmabuf_create_params(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    struct wl_resource *params_resource = wl_resource_create(
+        client, &zwp_linux_buffer_params_v1_interface, wl_resource_get_version(resource), id);
+    check_alloc(params_resource);
+    wl_resource_set_implementation(params_resource, &buffer_params_impl, nullptr, nullptr);
+}
+
+static void
+linux_dmabuf_get_default_feedback(struct wl_client *client, struct wl_resource *resource,
+                                  uint32_t id) {
+    create_dmabuf_feedback(client, resource, id);
+}
+
+static void
+linux_dmabuf_get_surface_feedback(struct wl_client *client, struct wl_resource *resource,
+                                  uint32_t id, struct wl_resource *surface_resource) {
+    create_dmabuf_feedback(client, resource, id);
+}
+
+static const struct zwp_linux_dmabuf_v1_interface linux_dmabuf_impl = {
+    .create_params = linux_dmabuf_create_params,
+    .destroy = resource_destroy,
+    .get_default_feedback = linux_dmabuf_get_default_feedback,
+    .get_surface_feedback = linux_dmabuf_get_surface_feedback,
+};
+
+static void
+on_linux_dmabuf_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    struct wl_resource *resource =
+        wl_resource_create(client, &zwp_linux_dmabuf_v1_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &linux_dmabuf_impl, data, nullptr);
+}
+
+/*
+ * zwp_pointer_constraints_v1
+ */
+
+static void
+pointer_constraints_confine_pointer(struct wl_client *client, struct wl_resource *resource,
+                                    uint32_t id, struct wl_resource *surface_resource,
+                                    struct wl_resource *pointer_resource,
+                                    struct wl_resource *region_resource, uint32_t lifetime) {
+    wl_client_post_implementation_error(client, "pointer confinement is not supported");
+}
+
+static void
+pointer_constraints_lock_pointer(struct wl_client *client, struct wl_resource *resource,
+                                 uint32_t id, struct wl_resource *surface_resource,
+                                 struct wl_resource *pointer_resource,
+                                 struct wl_resource *region_resource, uint32_t lifetime) {
+    wl_client_post_implementation_error(client, "pointer locking is not supported");
+}
+
+static const struct zwp_pointer_constraints_v1_interface pointer_constraints_impl = {
+    .confine_pointer = pointer_constraints_confine_pointer,
+    .destroy = resource_destroy,
+    .lock_pointer = pointer_constraints_lock_pointer,
+};
+
+static void
+on_pointer_constraints_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    struct wl_resource *resource =
+        wl_resource_create(client, &zwp_pointer_constraints_v1_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &pointer_constraints_impl, data, nullptr);
+}
+
+/*
+ * zwp_relative_pointer_manager_v1
+ */
+
+static const struct zwp_relative_pointer_v1_interface relative_pointer_impl = {
+    .destroy = resource_destroy,
+};
+
+static void
+relative_pointer_manager_get_relative_pointer(struct wl_client *client,
+                                              struct wl_resource *resource, uint32_t id,
+                                              struct wl_resource *pointer_resource) {
+    struct wl_resource *relative_pointer_resource = wl_resource_create(
+        client, &zwp_relative_pointer_v1_interface, wl_resource_get_version(resource), id);
+    check_alloc(relative_pointer_resource);
+    wl_resource_set_implementation(relative_pointer_resource, &relative_pointer_impl, nullptr,
+                                   nullptr);
+}
+
+static const struct zwp_relative_pointer_manager_v1_interface relative_pointer_manager_impl = {
+    .destroy = resource_destroy,
+    .get_relative_pointer = relative_pointer_manager_get_relative_pointer,
+};
+
+static void
+on_relative_pointer_manager_bind(struct wl_client *client, void *data, uint32_t version,
+                                 uint32_t id) {
+    struct wl_resource *resource =
+        wl_resource_create(client, &zwp_relative_pointer_manager_v1_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &relative_pointer_manager_impl, data, nullptr);
+}
+
+/*
+ * zwp_input_timestamps_manager_v1
+ */
+
+static const struct zwp_input_timestamps_v1_interface input_timestamps_impl = {
+    .destroy = resource_destroy,
+};
+
+static void
+create_input_timestamps(struct wl_client *client, struct wl_resource *resource, uint32_t id,
+                        struct wl_list *list) {
+    struct wl_resource *timestamps_resource = wl_resource_create(
+        client, &zwp_input_timestamps_v1_interface, wl_resource_get_version(resource), id);
+    check_alloc(timestamps_resource);
+    wl_resource_set_implementation(timestamps_resource, &input_timestamps_impl, nullptr,
+                                   resource_unlink);
+
+    wl_list_insert(list, wl_resource_get_link(timestamps_resource));
+}
+
+static void
+input_timestamps_manager_get_keyboard_timestamps(struct wl_client *client,
+                                                 struct wl_resource *resource, uint32_t id,
+                                                 struct wl_resource *keyboard_resource) {
+    struct bench_host *host = wl_resource_get_user_data(resource);
+
+    create_input_timestamps(client, resource, id, &host->keyboard_timestamps);
+}
+
+static void
+input_timestamps_manager_get_pointer_timestamps(struct wl_client *client,
+                                                struct wl_resource *resource, uint32_t id,
+                                                struct wl_resource *pointer_resource) {
+    struct bench_host *host = wl_resource_get_user_data(resource);
+
+    create_input_timestamps(client, resource, id, &host->pointer_timestamps);
+}
+
+static void
+input_timestamps_manager_get_touch_timestamps(struct wl_client *client,
+                                              struct wl_resource *resource, uint32_t id,
+                                              struct wl_resource *touch_resource) {
+    wl_client_post_implementation_error(client, "touch input is not supported");
+}
+
+static const struct zwp_input_timestamps_manager_v1_interface input_timestamps_manager_impl = {
+    .destroy = resource_destroy,
+    .get_keyboard_timestamps = input_timestamps_manager_get_keyboard_timestamps,
+    .get_pointer_timestamps = input_timestamps_manager_get_pointer_timestamps,
+    .get_touch_timestamps = input_timestamps_manager_get_touch_timestamps,
+};
+
+static void
+on_input_timestamps_manager_bind(struct wl_client *client, void *data, uint32_t version,
+                                 uint32_t id) {
+    struct wl_resource *resource =
+        wl_resource_create(client, &zwp_input_timestamps_manager_v1_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &input_timestamps_manager_impl, data, nullptr);
+}
+
+/*
+ * wl_seat
+ */
+
+static void
+pointer_set_cursor(struct wl_client *client, struct wl_resource *resource, uint32_t serial,
+                   struct wl_resource *surface_resource, int32_t hotspot_x, int32_t hotspot_y) {
+    // Unused.
+}
+
+static const struct wl_pointer_interface pointer_impl = {
+    .release = resource_destroy,
+    .set_cursor = pointer_set_cursor,
+};
+
+static const struct wl_keyboard_interface keyboard_impl = {
+    .release = resource_destroy,
+};
+
+static void
+seat_get_keyboard(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    struct bench_host *host = wl_resource_get_user_data(resource);
+
+    struct wl_resource *keyboard_resource =
+        wl_resource_create(client, &wl_keyboard_interface, wl_resource_get_version(resource), id);
+    check_alloc(keyboard_resource);
+    wl_resource_set_implementation(keyboard_resource, &keyboard_impl, host, resource_unlink);
+
+    wl_list_insert(&host->keyboards, wl_resource_get_link(keyboard_resource));
+
+    int fd = memfd_create("bench-keymap", MFD_CLOEXEC);
+    ww_assert(fd >= 0);
+    ww_assert(write(fd, host->keymap, host->keymap_size) == (ssize_t)host->keymap_size);
+
+    wl_keyboard_send_keymap(keyboard_resource, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1, fd,
+                            host->keymap_size);
+    close(fd);
+
+    if (wl_resource_get_version(keyboard_resource) >= WL_KEYBOARD_REPEAT_INFO_SINCE_VERSION) {
+        wl_keyboard_send_repeat_info(keyboard_resource, 0, 0);
+    }
+}
+
+static void
+seat_get_pointer(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    struct bench_host *host = wl_resource_get_user_data(resource);
+
+    struct wl_resource *pointer_resource =
+        wl_resource_create(client, &wl_pointer_interface, wl_resource_get_version(resource), id);
+    check_alloc(pointer_resource);
+    wl_resource_set_implementation(pointer_resource, &pointer_impl, host, resource_unlink);
+
+    wl_list_insert(&host->pointers, wl_resource_get_link(pointer_resource));
+}
+
+static void
+seat_get_touch(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    wl_client_post_implementation_error(client, "touch input is not supported");
+}
+
+static const struct wl_seat_interface seat_impl = {
+    .get_keyboard = seat_get_keyboard,
+    .get_pointer = seat_get_pointer,
+    .get_touch = seat_get_touch,
+    .release = resource_destroy,
+};
+
+static void
+on_seat_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    struct wl_resource *resource = wl_resource_create(client, &wl_seat_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &seat_impl, data, nullptr);
+
+    if (version >= WL_SEAT_NAME_SINCE_VERSION) {
+        wl_seat_send_name(resource, "bench");
+    }
+    wl_seat_send_capabilities(resource, WL_SEAT_CAPABILITY_KEYBOARD | WL_SEAT_CAPABILITY_POINTER);
+}
+
+/*
+ * wp_viewporter
+ */
+
+static void
+viewport_set_destination(struct wl_client *client, struct wl_resource *resource, int32_t width,
+                         int32_t height) {
+    // Unused.
+}
+
+static void
+viewport_set_source(struct wl_client *client, struct wl_resource *resource, wl_fixed_t x,
+                    wl_fixed_t y, wl_fixed_t width, wl_fixed_t height) {
+    // Unused.
+}
+
+static const struct wp_viewport_interface viewport_impl = {
+    .destroy = resource_destroy,
+    .set_destination = viewport_set_destination,
+    .set_source = viewport_set_source,
+};
+
+static void
+viewporter_get_viewport(struct wl_client *client, struct wl_resource *resource, uint32_t id,
+                        struct wl_resource *surface_resource) {
+    struct wl_resource *viewport_resource =
+        wl_resource_create(client, &wp_viewport_interface, wl_resource_get_version(resource), id);
+    check_alloc(viewport_resource);
+    wl_resource_set_implementation(viewport_resource, &viewport_impl, nullptr, nullptr);
+}
+
+static const struct wp_viewporter_interface viewporter_impl = {
+    .destroy = resource_destroy,
+    .get_viewport = viewporter_get_viewport,
+};
+
+static void
+on_viewporter_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    struct wl_resource *resource =
+        wl_resource_create(client, &wp_viewporter_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &viewporter_impl, data, nullptr);
+}
+
+/*
+ * xdg_wm_base
+ */
+
+static void
+xdg_toplevel_move(struct wl_client *client, struct wl_resource *resource,
+                  struct wl_resource *seat_resource, uint32_t serial) {
+    // Unused.
+}
+
+static void
+xdg_toplevel_resize(struct wl_client *client, struct wl_resource *resource,
+                    struct wl_resource *seat_resource, uint32_t serial, uint32_t edges) {
+    // Unused.
+}
+
+static void
+xdg_toplevel_set_app_id(struct wl_client *client, struct wl_resource *resource,
+                        const char *app_id) {
+    // Unused.
+}
+
+static void
+xdg_toplevel_set_fullscreen(struct wl_client *client, struct wl_resource *resource,
+                            struct wl_resource *output_resource) {
+    // Unused.
+}
+
+static void
+xdg_toplevel_set_max_size(struct wl_client *client, struct wl_resource *resource, int32_t width,
+                          int32_t height) {
+    // Unused.
+}
+
+static void
+xdg_toplevel_set_maximized(struct wl_client *client, struct wl_resource *resource) {
+    // Unused.
+}
+
+static void
+xdg_toplevel_set_min_size(struct wl_client *client, struct wl_resource *resource, int32_t width,
+                          int32_t height) {
+    // Unused.
+}
+
+static void
+xdg_toplevel_set_minimized(struct wl_client *client, struct wl_resource *resource) {
+    // Unused.
+}
+
+static void
+xdg_toplevel_set_parent(struct wl_client *client, struct wl_resource *resource,
+                        struct wl_resource *parent_resource) {
+    // Unused.
+}
+
+static void
+xdg_toplevel_set_title(struct wl_client *client, struct wl_resource *resource, const char *title) {
+    // Unused.
+}
+
+static void
+xdg_toplevel_show_window_menu(struct wl_client *client, struct wl_resource *resource,
+                              struct wl_resource *seat_resource, uint32_t serial, int32_t x,
+                              int32_t y) {
+    // Unused.
+}
+
+static void
+xdg_toplevel_unset_fullscreen(struct wl_client *client, struct wl_resource *resource) {
+    // Unused.
+}
+
+static void
+xdg_toplevel_unset_maximized(struct wl_client *client, struct wl_resource *resource) {
+    // Unused.
+}
+
+static const struct xdg_toplevel_interface xdg_toplevel_impl = {
+    .destroy = resource_destroy,
+    .move = xdg_toplevel_move,
+    .resize = xdg_toplevel_resize,
+    .set_app_id = xdg_toplevel_set_app_id,
+    .set_fullscreen = xdg_toplevel_set_fullscreen,
+    .set_max_size = xdg_toplevel_set_max_size,
+    .set_maximized = xdg_toplevel_set_maximized,
+    .set_min_size = xdg_toplevel_set_min_size,
+    .set_minimized = xdg_toplevel_set_minimized,
+    .set_parent = xdg_toplevel_set_parent,
+    .set_title = xdg_toplevel_set_title,
+    .show_window_menu = xdg_toplevel_show_window_menu,
+    .unset_fullscreen = xdg_toplevel_unset_fullscreen,
+    .unset_maximized = xdg_toplevel_unset_maximized,
+};
+
+static void
+xdg_toplevel_resource_destroy(struct wl_resource *resource) {
+    struct host_xdg_surface *xdg_surface = wl_resource_get_user_data(resource);
+
+    if (xdg_surface) {
+        xdg_surface->toplevel = nullptr;
+    }
+}
+
+static void
+xdg_surface_resource_destroy(struct wl_resource *resource) {
+    struct host_xdg_surface *xdg_surface = wl_resource_get_user_data(resource);
+
+    if (xdg_surface->surface) {
+        xdg_surface->surface->xdg_surface = nullptr;
+    }
+    if (xdg_surface->toplevel) {
+        wl_resource_set_user_data(xdg_surface->toplevel, nullptr);
+    }
+
+    free(xdg_surface);
+}
+
+static void
+xdg_surface_ack_configure(struct wl_client *client, struct wl_resource *resource,
+                          uint32_t serial) {
+    // Unused.
+}
+
+static void
+xdg_surface_get_popup(struct wl_client *client, struct wl_resource *resource, uint32_t id,
+                      struct wl_resource *parent_resource,
+                      struct wl_resource *positioner_resource) {
+    wl_client_post_implementation_error(client, "xdg_popup is not supported");
+}
+
+static void
+xdg_surface_get_toplevel(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    struct host_xdg_surface *xdg_surface = wl_resource_get_user_data(resource);
+
+    xdg_surface->toplevel =
+        wl_resource_create(client, &xdg_toplevel_interface, wl_resource_get_version(resource), id);
+    check_alloc(xdg_surface->toplevel);
+    wl_resource_set_implementation(xdg_surface->toplevel, &xdg_toplevel_impl, xdg_surface,
+                                   xdg_toplevel_resource_destroy);
+}
+
+static void
+xdg_surface_set_window_geometry(struct wl_client *client, struct wl_resource *resource, int32_t x,
+                                int32_t y, int32_t width, int32_t height) {
+    // Unused.
+}
+
+static const struct xdg_surface_interface xdg_surface_impl = {
+    .ack_configure = xdg_surface_ack_configure,
+    .destroy = resource_destroy,
+    .get_popup = xdg_surface_get_popup,
+    .get_toplevel = xdg_surface_get_toplevel,
+    .set_window_geometry = xdg_surface_set_window_geometry,
+};
+
+static void
+xdg_wm_base_create_positioner(struct wl_client *client, struct wl_resource *resource,
+                              uint32_t id) {
+    wl_client_post_implementation_error(client, "xdg_positioner is not supported");
+}
+
+static void
+xdg_wm_base_get_xdg_surface(struct wl_client *client, struct wl_resource *resource, uint32_t id,
+                            struct wl_resource *surface_resource) {
+    struct host_surface *surface = wl_resource_get_user_data(surface_resource);
+
+    struct host_xdg_surface *xdg_surface = zalloc(1, sizeof(*xdg_surface));
+    xdg_surface->surface = surface;
+
+    xdg_surface->resource =
+        wl_resource_create(client, &xdg_surface_interface, wl_resource_get_version(resource), id);
+    check_alloc(xdg_surface->resource);
+    wl_resource_set_implementation(xdg_surface->resource, &xdg_surface_impl, xdg_surface,
+                                   xdg_surface_resource_destroy);
+
+    surface->xdg_surface = xdg_surface;
+}
+
+static void
+xdg_wm_base_pong(struct wl_client *client, struct wl_resource *resource, uint32_t serial) {
+    // Unused.
+}
+
+static const struct xdg_wm_base_interface xdg_wm_base_impl = {
+    .create_positioner = xdg_wm_base_create_positioner,
+    .destroy = resource_destroy,
+    .get_xdg_surface = xdg_wm_base_get_xdg_surface,
+    .pong = xdg_wm_base_pong,
+};
+
+static void
+on_xdg_wm_base_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    struct wl_resource *resource = wl_resource_create(client, &xdg_wm_base_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &xdg_wm_base_impl, data, nullptr);
+}
+
+/*
+ * Input injection
+ */
+
+static void
+send_timestamps(struct wl_list *timestamps, uint64_t now) {
+    uint64_t sec = now / 1000000000;
+    uint32_t nsec = now % 1000000000;
+
+    struct wl_resource *resource;
+    wl_resource_for_each(resource, timestamps) {
+        zwp_input_timestamps_v1_send_timestamp(resource, (uint32_t)(sec >> 32),
+                                               (uint32_t)(sec & UINT32_MAX), nsec);
+    }
+}
+
+static int
+handle_input_timer(void *data) {
+    struct bench_host *host = data;
+
+    wl_event_source_timer_update(host->input_timer, 1000 / host->options.input_rate);
+
+    // Input alternates between pointer motion and presses or releases of a key which has no
+    // keybind, both of which waywall forwards to the game.
+    uint64_t now = bench_now();
+    uint32_t time = (uint32_t)(now / 1000000);
+
+    if (host->input_step++ % 2 == 0) {
+        double x = (double)(host->input_step % host->options.width);
+        double y = (double)(host->input_step % host->options.height);
+
+        send_timestamps(&host->pointer_timestamps, now);
+
+        struct wl_resource *resource;
+        wl_resource_for_each(resource, &host->pointers) {
+            wl_pointer_send_motion(resource, time, wl_fixed_from_double(x),
+                                   wl_fixed_from_double(y));
+            if (wl_resource_get_version(resource) >= WL_POINTER_FRAME_SINCE_VERSION) {
+                wl_pointer_send_frame(resource);
+            }
+        }
+    } else {
+        host->key_pressed = !host->key_pressed;
+
+        send_timestamps(&host->keyboard_timestamps, now);
+
+        struct wl_resource *resource;
+        wl_resource_for_each(resource, &host->keyboards) {
+            wl_keyboard_send_key(resource, ++host->serial, time, KEY_F13,
+                                 host->key_pressed ? WL_KEYBOARD_KEY_STATE_PRESSED
+                                                   : WL_KEYBOARD_KEY_STATE_RELEASED);
+        }
+    }
+
+    return 0;
+}
+
+static bool
+create_keymap(struct bench_host *host) {
+    struct xkb_context *ctx = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+    if (!ctx) {
+        fprintf(stderr, "failed to create xkb_context\n");
+        return false;
+    }
+
+    struct xkb_keymap *keymap =
+        xkb_keymap_new_from_names(ctx, nullptr, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    if (!keymap) {
+        fprintf(stderr, "failed to create keymap\n");
+        xkb_context_unref(ctx);
+        return false;
+    }
+
+    host->keymap = xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
+    check_alloc(host->keymap);
+    host->keymap_size = strlen(host->keymap) + 1;
+
+    xkb_keymap_unref(keymap);
+    xkb_context_unref(ctx);
+    return true;
+}
+
+struct bench_host *
+bench_host_create(const struct bench_host_options *options) {
+    struct bench_host *host = zalloc(1, sizeof(*host));
+    host->options = *options;
+
+    wl_list_init(&host->keyboards);
+    wl_list_init(&host->pointers);
+    wl_list_init(&host->keyboard_timestamps);
+    wl_list_init(&host->pointer_timestamps);
+
+    if (!create_keymap(host)) {
+        goto fail_keymap;
+    }
+
+    host->display = wl_display_create();
+    check_alloc(host->display);
+
+    host->socket_name = wl_display_add_socket_auto(host->display);
+    if (!host->socket_name) {
+        fprintf(stderr, "failed to create host display socket\n");
+        goto fail_socket;
+    }
+
+    ww_assert(wl_display_init_shm(host->display) == 0);
+
+    // These are the versions which waywall requires (see backend.c).
+    const struct {
+        const struct wl_interface *interface;
+        int version;
+        wl_global_bind_func_t bind;
+    } globals[] = {
+        {&wl_compositor_interface, 5, on_compositor_bind},
+        {&wl_data_device_manager_interface, 2, on_data_device_manager_bind},
+        {&wl_seat_interface, 5, on_seat_bind},
+        {&wl_subcompositor_interface, 1, on_subcompositor_bind},
+        {&wp_viewporter_interface, 1, on_viewporter_bind},
+        {&xdg_wm_base_interface, 1, on_xdg_wm_base_bind},
+        {&zwp_input_timestamps_manager_v1_interface, 1, on_input_timestamps_manager_bind},
+        {&zwp_linux_dmabuf_v1_interface, 4, on_linux_dmabuf_bind},
+        {&zwp_pointer_constraints_v1_interface, 1, on_pointer_constraints_bind},
+        {&zwp_relative_pointer_manager_v1_interface, 1, on_relative_pointer_manager_bind},
+    };
+
+    for (size_t i = 0; i < STATIC_ARRLEN(globals); i++) {
+        struct wl_global *global = wl_global_create(host->display, globals[i].interface,
+                                                    globals[i].version, host, globals[i].bind);
+        check_alloc(global);
+    }
+
+    host->input_timer = wl_event_loop_add_timer(wl_display_get_event_loop(host->display),
+                                                handle_input_timer, host);
+    check_alloc(host->input_timer);
+
+    return host;
+
+fail_socket:
+    wl_display_destroy(host->display);
+    free(host->keymap);
+
+fail_keymap:
+    free(host);
+    return nullptr;
+}
+
+void
+bench_host_destroy(struct bench_host *host) {
+    wl_event_source_remove(host->input_timer);
+
+    wl_display_destroy_clients(host->display);
+    wl_display_destroy(host->display);
+
+    bench_samples_free(&host->commit_latency);
+    free(host->keymap);
+    free(host);
+}
+
+void
+bench_host_stop_input(struct bench_host *host) {
+    wl_event_source_timer_update(host->input_timer, 0);
+}
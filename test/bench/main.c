@@ -0,0 +1,511 @@
+#include "bench.h"
+#include "util/prelude.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+
+/*
+ * Measures the overhead waywall adds between a game and the host compositor. The synthetic game
+ * client is run twice against a stand-in host: once connected to the host directly, and once
+ * through `waywall wrap`. The difference between the two runs is waywall's cost.
+ *
+ * The benchmark exits with status 77 (skipped) if waywall could not be run, e.g. because there is
+ * no EGL implementation available to it.
+ */
+
+static constexpr int EXIT_SKIP = 77;
+static constexpr int TIMEOUT_GRACE = 30; // seconds
+
+struct bench_options {
+    int duration;
+    int frame_rate;
+    int input_rate;
+    int32_t width, height;
+    const char *waywall;
+};
+
+struct bench_result {
+    uint64_t frames_received;
+    struct bench_summary commit_latency;
+
+    bool has_report;
+    struct bench_client_report report;
+
+    bool has_cpu;
+    double cpu_per_frame_us;
+};
+
+struct bench_run {
+    struct bench_host *host;
+    pid_t pid;
+    bool exited, timed_out;
+    int status;
+
+    struct wl_event_source *report_src;
+    struct bench_client_report report;
+    size_t report_len;
+
+    // Only used when the client is run through waywall.
+    bool measure_cpu;
+    uint64_t cpu_start, cpu_end;
+    uint64_t frames_start, frames_end;
+};
+
+static void
+usage(const char *argv0) {
+    fprintf(stderr,
+            "USAGE: %s [--duration SECONDS] [--frame-rate HZ] [--input-rate HZ] [--size WxH] "
+            "WAYWALL\n",
+            argv0);
+}
+
+static bool
+parse_int(const char *arg, int *out) {
+    char *end;
+    long value = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || value <= 0 || value > INT32_MAX) {
+        return false;
+    }
+
+    *out = (int)value;
+    return true;
+}
+
+static bool
+parse_size(const char *arg, int32_t *width, int32_t *height) {
+    char *end;
+    long w = strtol(arg, &end, 10);
+    if (end == arg || *end != 'x') {
+        return false;
+    }
+
+    const char *rest = end + 1;
+    long h = strtol(rest, &end, 10);
+    if (end == rest || *end != '\0') {
+        return false;
+    }
+
+    if (w <= 0 || h <= 0 || w > 16384 || h > 16384) {
+        return false;
+    }
+
+    *width = (int32_t)w;
+    *height = (int32_t)h;
+    return true;
+}
+
+static bool
+parse_options(int argc, char **argv, struct bench_options *opts) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--duration") == 0 && value) {
+            if (!parse_int(value, &opts->duration)) {
+                return false;
+            }
+            i++;
+        } else if (strcmp(arg, "--frame-rate") == 0 && value) {
+            if (!parse_int(value, &opts->frame_rate)) {
+                return false;
+            }
+            i++;
+        } else if (strcmp(arg, "--input-rate") == 0 && value) {
+            if (!parse_int(value, &opts->input_rate) || opts->input_rate > 1000) {
+                return false;
+            }
+            i++;
+        } else if (strcmp(arg, "--size") == 0 && value) {
+            if (!parse_size(value, &opts->width, &opts->height)) {
+                return false;
+            }
+            i++;
+        } else if (arg[0] != '-' && !opts->waywall) {
+            opts->waywall = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return opts->waywall != nullptr;
+}
+
+static bool
+read_cpu_ticks(pid_t pid, uint64_t *out) {
+    char path[64];
+    snprintf(path, STATIC_ARRLEN(path), "/proc/%d/stat", (int)pid);
+
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    char buf[1024];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, file);
+    fclose(file);
+    buf[n] = '\0';
+
+    // The process name is enclosed in parentheses and may contain spaces, so the remaining fields
+    // are parsed from the last closing parenthesis. utime and stime are the 14th and 15th fields.
+    char *fields = strrchr(buf, ')');
+    if (!fields) {
+        return false;
+    }
+
+    unsigned long long utime, stime;
+    int ret = sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime,
+                     &stime);
+    if (ret != 2) {
+        return false;
+    }
+
+    *out = utime + stime;
+    return true;
+}
+
+static void
+on_first_frame(void *data) {
+    struct bench_run *run = data;
+
+    if (run->measure_cpu && read_cpu_ticks(run->pid, &run->cpu_start)) {
+        run->frames_start = run->host->frames_received;
+    } else {
+        run->measure_cpu = false;
+    }
+}
+
+static int
+handle_report(int32_t fd, uint32_t mask, void *data) {
+    struct bench_run *run = data;
+
+    ssize_t n = 0;
+    if (mask & WL_EVENT_READABLE) {
+        n = read(fd, (char *)&run->report + run->report_len, sizeof(run->report) - run->report_len);
+        if (n == -1 && errno == EINTR) {
+            return 0;
+        }
+    }
+
+    if (n > 0) {
+        run->report_len += n;
+        if (run->report_len < sizeof(run->report)) {
+            return 0;
+        }
+    }
+
+    // The client has either finished writing its report or exited without doing so. Either way,
+    // it is no longer committing frames.
+    if (run->measure_cpu && read_cpu_ticks(run->pid, &run->cpu_end)) {
+        run->frames_end = run->host->frames_received;
+    } else {
+        run->measure_cpu = false;
+    }
+
+    bench_host_stop_input(run->host);
+    wl_event_source_remove(run->report_src);
+    run->report_src = nullptr;
+    return 0;
+}
+
+static int
+handle_sigchld(int signal_number, void *data) {
+    struct bench_run *run = data;
+
+    int status;
+    if (waitpid(run->pid, &status, WNOHANG) == run->pid) {
+        run->exited = true;
+        run->status = status;
+    }
+
+    return 0;
+}
+
+static int
+handle_timeout(void *data) {
+    struct bench_run *run = data;
+
+    fprintf(stderr, "benchmark timed out\n");
+    run->timed_out = true;
+    kill(run->pid, SIGKILL);
+    return 0;
+}
+
+static pid_t
+spawn(const struct bench_options *opts, const char *self, const char *socket_name, int report_fd,
+      bool use_waywall) {
+    pid_t pid = fork();
+    if (pid != 0) {
+        if (pid == -1) {
+            perror("fork");
+        }
+        return pid;
+    }
+
+    // The event loop blocks SIGCHLD so that it can be read from a signalfd. The signal mask is
+    // inherited across exec, so it has to be restored here.
+    sigset_t set;
+    sigemptyset(&set);
+    sigprocmask(SIG_SETMASK, &set, nullptr);
+
+    // The report pipe is passed down to the client, through waywall if need be.
+    if (fcntl(report_fd, F_SETFD, 0) == -1) {
+        perror("fcntl");
+        _exit(EXIT_FAILURE);
+    }
+
+    if (setenv("WAYLAND_DISPLAY", socket_name, 1) != 0) {
+        perror("setenv");
+        _exit(EXIT_FAILURE);
+    }
+
+    char fd_str[16], rate_str[16], duration_str[16], width_str[16], height_str[16];
+    snprintf(fd_str, STATIC_ARRLEN(fd_str), "%d", report_fd);
+    snprintf(rate_str, STATIC_ARRLEN(rate_str), "%d", opts->frame_rate);
+    snprintf(duration_str, STATIC_ARRLEN(duration_str), "%d", opts->duration);
+    snprintf(width_str, STATIC_ARRLEN(width_str), "%d", (int)opts->width);
+    snprintf(height_str, STATIC_ARRLEN(height_str), "%d", (int)opts->height);
+
+    char *client_argv[] = {
+        (char *)self, "client",     "--report-fd", fd_str,    "--rate",   rate_str,
+        "--duration", duration_str, "--width",     width_str, "--height", height_str,
+        nullptr,
+    };
+
+    if (use_waywall) {
+        char *argv[STATIC_ARRLEN(client_argv) + 3] = {(char *)opts->waywall, "wrap", "--"};
+        memcpy(argv + 3, client_argv, sizeof(client_argv));
+
+        execv(opts->waywall, argv);
+        perror("execv");
+    } else {
+        execv(self, client_argv);
+        perror("execv");
+    }
+
+    _exit(EXIT_FAILURE);
+}
+
+static bool
+run_pass(const struct bench_options *opts, const char *self, bool use_waywall,
+         struct bench_result *result) {
+    struct bench_host_options host_opts = {
+        .width = opts->width,
+        .height = opts->height,
+        .input_rate = opts->input_rate,
+    };
+
+    struct bench_run run = {.measure_cpu = use_waywall};
+
+    run.host = bench_host_create(&host_opts);
+    if (!run.host) {
+        return false;
+    }
+    run.host->first_frame = on_first_frame;
+    run.host->first_frame_data = &run;
+
+    struct wl_event_loop *loop = wl_display_get_event_loop(run.host->display);
+
+    struct wl_event_source *sigchld_src =
+        wl_event_loop_add_signal(loop, SIGCHLD, handle_sigchld, &run);
+    if (!sigchld_src) {
+        fprintf(stderr, "failed to create SIGCHLD event source\n");
+        goto fail_sigchld;
+    }
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        goto fail_pipe;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    run.pid = spawn(opts, self, run.host->socket_name, fds[1], use_waywall);
+    close(fds[1]);
+    if (run.pid == -1) {
+        close(fds[0]);
+        goto fail_pipe;
+    }
+
+    run.report_src = wl_event_loop_add_fd(loop, fds[0], WL_EVENT_READABLE, handle_report, &run);
+    close(fds[0]);
+    if (!run.report_src) {
+        fprintf(stderr, "failed to create report event source\n");
+        kill(run.pid, SIGKILL);
+    }
+
+    struct wl_event_source *timeout_src = wl_event_loop_add_timer(loop, handle_timeout, &run);
+    if (!timeout_src) {
+        fprintf(stderr, "failed to create timeout event source\n");
+        kill(run.pid, SIGKILL);
+    } else {
+        wl_event_source_timer_update(timeout_src, (opts->duration + TIMEOUT_GRACE) * 1000);
+    }
+
+    while (!run.exited) {
+        wl_display_flush_clients(run.host->display);
+        if (wl_event_loop_dispatch(loop, -1) == -1 && errno != EINTR) {
+            perror("wl_event_loop_dispatch");
+            kill(run.pid, SIGKILL);
+            waitpid(run.pid, &run.status, 0);
+            run.exited = true;
+        }
+    }
+
+    if (timeout_src) {
+        wl_event_source_remove(timeout_src);
+    }
+    if (run.report_src) {
+        wl_event_source_remove(run.report_src);
+    }
+    wl_event_source_remove(sigchld_src);
+
+    result->frames_received = run.host->frames_received;
+    result->commit_latency = bench_samples_summarize(&run.host->commit_latency);
+
+    result->has_report = (run.report_len == sizeof(run.report));
+    result->report = run.report;
+
+    uint64_t frames = run.frames_end - run.frames_start;
+    result->has_cpu = run.measure_cpu && frames > 0;
+    if (result->has_cpu) {
+        double ticks = (double)(run.cpu_end - run.cpu_start);
+        result->cpu_per_frame_us = ticks * 1e6 / (double)sysconf(_SC_CLK_TCK) / (double)frames;
+    }
+
+    bench_host_destroy(run.host);
+
+    if (run.timed_out || !WIFEXITED(run.status) || WEXITSTATUS(run.status) != 0) {
+        fprintf(stderr, "%s exited abnormally (status %d)\n",
+                use_waywall ? "waywall" : "synthetic client", run.status);
+    }
+    return result->has_report && result->frames_received > 0;
+
+fail_pipe:
+    wl_event_source_remove(sigchld_src);
+
+fail_sigchld:
+    bench_host_destroy(run.host);
+    return false;
+}
+
+static void
+print_row(const char *label, double direct, double waywall, bool has_direct, bool has_waywall) {
+    char direct_str[32] = "-", waywall_str[32] = "-", overhead_str[32] = "-";
+
+    if (has_direct) {
+        snprintf(direct_str, STATIC_ARRLEN(direct_str), "%.1f", direct);
+    }
+    if (has_waywall) {
+        snprintf(waywall_str, STATIC_ARRLEN(waywall_str), "%.1f", waywall);
+    }
+    if (has_direct && has_waywall) {
+        snprintf(overhead_str, STATIC_ARRLEN(overhead_str), "%+.1f", waywall - direct);
+    }
+
+    printf("%-32s %12s %12s %12s\n", label, direct_str, waywall_str, overhead_str);
+}
+
+static void
+print_results(const struct bench_options *opts, const struct bench_result *direct,
+              const struct bench_result *waywall) {
+    printf("%d seconds, %dx%d @ %d Hz, %d Hz input\n\n", opts->duration, (int)opts->width,
+           (int)opts->height, opts->frame_rate, opts->input_rate);
+    printf("%-32s %12s %12s %12s\n", "", "direct", "waywall", "overhead");
+
+    print_row("frames committed", direct->report.frames_committed,
+              waywall->report.frames_committed, true, true);
+    print_row("frames dropped by client", direct->report.frames_dropped,
+              waywall->report.frames_dropped, true, true);
+    print_row("frames received by host", direct->frames_received, waywall->frames_received, true,
+              true);
+
+    print_row("commit latency p50 (us)", direct->commit_latency.p50_ns / 1e3,
+              waywall->commit_latency.p50_ns / 1e3, true, true);
+    print_row("commit latency p99 (us)", direct->commit_latency.p99_ns / 1e3,
+              waywall->commit_latency.p99_ns / 1e3, true, true);
+
+    const struct bench_summary *direct_input = &direct->report.input_latency;
+    const struct bench_summary *waywall_input = &waywall->report.input_latency;
+    bool has_direct_input = direct_input->count > 0;
+    bool has_waywall_input = waywall_input->count > 0;
+
+    print_row("input latency p50 (us)", direct_input->p50_ns / 1e3, waywall_input->p50_ns / 1e3,
+              has_direct_input, has_waywall_input);
+    print_row("input latency p99 (us)", direct_input->p99_ns / 1e3, waywall_input->p99_ns / 1e3,
+              has_direct_input, has_waywall_input);
+
+    print_row("waywall cpu per frame (us)", 0, waywall->cpu_per_frame_us, false,
+              waywall->has_cpu);
+
+    if (!direct->report.input_precise || !waywall->report.input_precise) {
+        printf("\nnote: input latency was measured with millisecond precision\n");
+    }
+}
+
+int
+main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "client") == 0) {
+        return bench_client_main(argc - 1, argv + 1);
+    }
+
+    struct bench_options opts = {
+        .duration = 5,
+        .frame_rate = 240,
+        .input_rate = 500,
+        .width = 1920,
+        .height = 1080,
+    };
+
+    if (!parse_options(argc, argv, &opts)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // The client is started by waywall as well, so it needs a path which does not refer to
+    // whichever process happens to resolve it.
+    char self[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", self, STATIC_ARRLEN(self) - 1);
+    if (len == -1) {
+        perror("readlink");
+        return 1;
+    }
+    self[len] = '\0';
+
+    char tmpdir[] = "/tmp/waywall-bench-XXXXXX";
+    if (!mkdtemp(tmpdir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    if (!bench_env_setup(tmpdir)) {
+        bench_env_remove(tmpdir);
+        return 1;
+    }
+
+    struct bench_result direct = {}, waywall = {};
+
+    if (!run_pass(&opts, self, false, &direct)) {
+        fprintf(stderr, "the synthetic client failed to run against the stand-in host\n");
+        bench_env_remove(tmpdir);
+        return 1;
+    }
+
+    if (!run_pass(&opts, self, true, &waywall)) {
+        fprintf(stderr, "waywall did not forward any frames, skipping (logs are in %s/state)\n",
+                tmpdir);
+        return EXIT_SKIP;
+    }
+
+    print_results(&opts, &direct, &waywall);
+
+    bench_env_remove(tmpdir);
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "bench.h"
+#include "util/alloc.h"
+#include "util/prelude.h"
+#include <stdlib.h>
+#include <time.h>
+
+static int
+compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+uint64_t
+bench_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+void
+bench_samples_add(struct bench_samples *samples, uint64_t value) {
+    if (samples->len == samples->cap) {
+        samples->cap = samples->cap ? samples->cap * 2 : 1024;
+        samples->data = realloc(samples->data, samples->cap * sizeof(*samples->data));
+        check_alloc(samples->data);
+    }
+
+    samples->data[samples->len++] = value;
+}
+
+void
+bench_samples_free(struct bench_samples *samples) {
+    free(samples->data);
+    *samples = (struct bench_samples){};
+}
+
+struct bench_summary
+bench_samples_summarize(struct bench_samples *samples) {
+    struct bench_summary summary = {.count = samples->len};
+    if (samples->len == 0) {
+        return summary;
+    }
+
+    qsort(samples->data, samples->len, sizeof(*samples->data), compare_u64);
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < samples->len; i++) {
+        total += samples->data[i];
+    }
+
+    summary.mean_ns = total / samples->len;
+    summary.p50_ns = samples->data[(samples->len - 1) / 2];
+    summary.p99_ns = samples->data[(samples->len - 1) * 99 / 100];
+    summary.max_ns = samples->data[samples->len - 1];
+    return summary;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+// Written by the game to the report pipe just before it exits.
+static constexpr uint8_t CAPTURE_PASS = 0;
+static constexpr uint8_t CAPTURE_FAIL = 1;
+static constexpr uint8_t CAPTURE_SKIP = 77; // the game could not draw with EGL
+
+int capture_game_main(int argc, char **argv);
@@ -0,0 +1,627 @@
+#include "capture.h"
+#include "ext-image-capture-source-v1-client-protocol.h"
+#include "ext-image-copy-capture-v1-client-protocol.h"
+#include "util/alloc.h"
+#include "util/prelude.h"
+#include "util/syscall.h"
+#include "xdg-shell-client-protocol.h"
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <linux/memfd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client-core.h>
+#include <wayland-client-protocol.h>
+#include <wayland-egl.h>
+
+/*
+ * The game run through waywall by the capture test. It draws frames of a single color with EGL, so
+ * that its buffers are DMABUFs which waywall can import, and captures them itself through
+ * waywall's ext-image-copy-capture-v1 implementation into a SHM buffer.
+ *
+ * A second capture is made after the SHM buffer's file has been truncated, which must fail without
+ * bringing down waywall.
+ */
+
+static constexpr int32_t GAME_WIDTH = 320;
+static constexpr int32_t GAME_HEIGHT = 240;
+
+// The color of each frame, as 8-bit components. Each is exactly representable when converted to
+// and from the floating point values given to glClearColor.
+static constexpr uint8_t GAME_COLOR[3] = {0x20, 0x60, 0xA0}; // RGB
+
+// The number of frames to draw while waiting for waywall to respond to a request.
+static constexpr int MAX_WAIT_FRAMES = 600;
+
+struct game {
+    struct wl_display *display;
+    struct wl_registry *registry;
+
+    struct wl_compositor *compositor;
+    struct wl_output *output;
+    struct wl_shm *shm;
+    struct xdg_wm_base *xdg_wm_base;
+    struct ext_image_copy_capture_manager_v1 *capture_manager;
+    struct ext_output_image_capture_source_manager_v1 *source_manager;
+
+    struct wl_surface *surface;
+    struct xdg_surface *xdg_surface;
+    struct xdg_toplevel *xdg_toplevel;
+    bool configured;
+
+    struct {
+        struct wl_egl_window *window;
+        EGLDisplay display;
+        EGLContext ctx;
+        EGLSurface surface;
+    } egl;
+
+    struct {
+        struct ext_image_capture_source_v1 *source;
+        struct ext_image_copy_capture_session_v1 *wl;
+
+        int32_t width, height;
+        bool has_argb, has_xrgb;
+        bool done, stopped;
+    } session;
+
+    struct {
+        int fd;
+        uint8_t *data;
+        size_t size;
+        int32_t stride;
+        uint32_t format;
+        struct wl_buffer *wl;
+    } buffer;
+
+    struct {
+        bool ready, failed;
+        uint32_t reason;
+    } frame;
+};
+
+static void
+on_xdg_wm_base_ping(void *data, struct xdg_wm_base *wl, uint32_t serial) {
+    xdg_wm_base_pong(wl, serial);
+}
+
+static const struct xdg_wm_base_listener xdg_wm_base_listener = {
+    .ping = on_xdg_wm_base_ping,
+};
+
+static void
+on_xdg_surface_configure(void *data, struct xdg_surface *wl, uint32_t serial) {
+    struct game *game = data;
+
+    xdg_surface_ack_configure(wl, serial);
+    game->configured = true;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+    .configure = on_xdg_surface_configure,
+};
+
+static void
+on_xdg_toplevel_close(void *data, struct xdg_toplevel *wl) {
+    // Unused.
+}
+
+static void
+on_xdg_toplevel_configure(void *data, struct xdg_toplevel *wl, int32_t width, int32_t height,
+                          struct wl_array *states) {
+    // Unused. The game always draws at the same size.
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+    .close = on_xdg_toplevel_close,
+    .configure = on_xdg_toplevel_configure,
+};
+
+static void
+on_session_buffer_size(void *data, struct ext_image_copy_capture_session_v1 *wl, uint32_t width,
+                       uint32_t height) {
+    struct game *game = data;
+
+    game->session.width = (int32_t)width;
+    game->session.height = (int32_t)height;
+}
+
+static void
+on_session_dmabuf_device(void *data, struct ext_image_copy_capture_session_v1 *wl,
+                         struct wl_array *device) {
+    // Unused. Only SHM buffers are tested.
+}
+
+static void
+on_session_dmabuf_format(void *data, struct ext_image_copy_capture_session_v1 *wl, uint32_t format,
+                         struct wl_array *modifiers) {
+    // Unused. Only SHM buffers are tested.
+}
+
+static void
+on_session_done(void *data, struct ext_image_copy_capture_session_v1 *wl) {
+    struct game *game = data;
+
+    game->session.done = true;
+}
+
+static void
+on_session_shm_format(void *data, struct ext_image_copy_capture_session_v1 *wl, uint32_t format) {
+    struct game *game = data;
+
+    if (format == WL_SHM_FORMAT_ARGB8888) {
+        game->session.has_argb = true;
+    } else if (format == WL_SHM_FORMAT_XRGB8888) {
+        game->session.has_xrgb = true;
+    }
+}
+
+static void
+on_session_stopped(void *data, struct ext_image_copy_capture_session_v1 *wl) {
+    struct game *game = data;
+
+    game->session.stopped = true;
+}
+
+static const struct ext_image_copy_capture_session_v1_listener session_listener = {
+    .buffer_size = on_session_buffer_size,
+    .dmabuf_device = on_session_dmabuf_device,
+    .dmabuf_format = on_session_dmabuf_format,
+    .done = on_session_done,
+    .shm_format = on_session_shm_format,
+    .stopped = on_session_stopped,
+};
+
+static void
+on_frame_damage(void *data, struct ext_image_copy_capture_frame_v1 *wl, int32_t x, int32_t y,
+                int32_t width, int32_t height) {
+    // Unused.
+}
+
+static void
+on_frame_failed(void *data, struct ext_image_copy_capture_frame_v1 *wl, uint32_t reason) {
+    struct game *game = data;
+
+    game->frame.failed = true;
+    game->frame.reason = reason;
+}
+
+static void
+on_frame_presentation_time(void *data, struct ext_image_copy_capture_frame_v1 *wl,
+                           uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec) {
+    // Unused.
+}
+
+static void
+on_frame_ready(void *data, struct ext_image_copy_capture_frame_v1 *wl) {
+    struct game *game = data;
+
+    game->frame.ready = true;
+}
+
+static void
+on_frame_transform(void *data, struct ext_image_copy_capture_frame_v1 *wl, uint32_t transform) {
+    // Unused.
+}
+
+static const struct ext_image_copy_capture_frame_v1_listener frame_listener = {
+    .damage = on_frame_damage,
+    .failed = on_frame_failed,
+    .presentation_time = on_frame_presentation_time,
+    .ready = on_frame_ready,
+    .transform = on_frame_transform,
+};
+
+static void
+on_registry_global(void *data, struct wl_registry *wl, uint32_t name, const char *iface,
+                   uint32_t version) {
+    struct game *game = data;
+
+    if (strcmp(iface, wl_compositor_interface.name) == 0) {
+        if (version < 4) {
+            return;
+        }
+
+        game->compositor = wl_registry_bind(wl, name, &wl_compositor_interface, 4);
+        check_alloc(game->compositor);
+    } else if (strcmp(iface, wl_output_interface.name) == 0) {
+        game->output = wl_registry_bind(wl, name, &wl_output_interface, 1);
+        check_alloc(game->output);
+    } else if (strcmp(iface, wl_shm_interface.name) == 0) {
+        game->shm = wl_registry_bind(wl, name, &wl_shm_interface, 1);
+        check_alloc(game->shm);
+    } else if (strcmp(iface, xdg_wm_base_interface.name) == 0) {
+        game->xdg_wm_base = wl_registry_bind(wl, name, &xdg_wm_base_interface, 1);
+        check_alloc(game->xdg_wm_base);
+    } else if (strcmp(iface, ext_image_copy_capture_manager_v1_interface.name) == 0) {
+        game->capture_manager =
+            wl_registry_bind(wl, name, &ext_image_copy_capture_manager_v1_interface, 1);
+        check_alloc(game->capture_manager);
+    } else if (strcmp(iface, ext_output_image_capture_source_manager_v1_interface.name) == 0) {
+        game->source_manager =
+            wl_registry_bind(wl, name, &ext_output_image_capture_source_manager_v1_interface, 1);
+        check_alloc(game->source_manager);
+    }
+}
+
+static void
+on_registry_global_remove(void *data, struct wl_registry *wl, uint32_t name) {
+    // Unused.
+}
+
+static const struct wl_registry_listener registry_listener = {
+    .global = on_registry_global,
+    .global_remove = on_registry_global_remove,
+};
+
+static bool
+egl_init(struct game *game) {
+    game->egl.display = eglGetDisplay((EGLNativeDisplayType)game->display);
+    if (game->egl.display == EGL_NO_DISPLAY) {
+        fprintf(stderr, "game: failed to get EGL display\n");
+        return false;
+    }
+
+    if (!eglInitialize(game->egl.display, nullptr, nullptr)) {
+        fprintf(stderr, "game: failed to initialize EGL (%#x)\n", (unsigned)eglGetError());
+        return false;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_ES_API)) {
+        fprintf(stderr, "game: failed to bind OpenGL ES API\n");
+        return false;
+    }
+
+    // clang-format off
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+        EGL_NONE,
+    };
+    const EGLint context_attributes[] = {
+        EGL_CONTEXT_CLIENT_VERSION, 2,
+        EGL_NONE,
+    };
+    // clang-format on
+
+    EGLConfig config;
+    EGLint num_configs;
+    if (!eglChooseConfig(game->egl.display, config_attributes, &config, 1, &num_configs) ||
+        num_configs == 0) {
+        fprintf(stderr, "game: no suitable EGL config\n");
+        return false;
+    }
+
+    game->egl.ctx =
+        eglCreateContext(game->egl.display, config, EGL_NO_CONTEXT, context_attributes);
+    if (game->egl.ctx == EGL_NO_CONTEXT) {
+        fprintf(stderr, "game: failed to create EGL context (%#x)\n", (unsigned)eglGetError());
+        return false;
+    }
+
+    game->egl.window = wl_egl_window_create(game->surface, GAME_WIDTH, GAME_HEIGHT);
+    check_alloc(game->egl.window);
+
+    game->egl.surface = eglCreateWindowSurface(game->egl.display, config,
+                                               (EGLNativeWindowType)game->egl.window, nullptr);
+    if (game->egl.surface == EGL_NO_SURFACE) {
+        fprintf(stderr, "game: failed to create EGL surface (%#x)\n", (unsigned)eglGetError());
+        return false;
+    }
+
+    if (!eglMakeCurrent(game->egl.display, game->egl.surface, game->egl.surface, game->egl.ctx)) {
+        fprintf(stderr, "game: failed to make EGL context current\n");
+        return false;
+    }
+
+    // Frames are drawn whenever the game is waiting on waywall, and should never wait for frame
+    // callbacks.
+    eglSwapInterval(game->egl.display, 0);
+    return true;
+}
+
+static void
+egl_finish(struct game *game) {
+    if (game->egl.display == EGL_NO_DISPLAY) {
+        return;
+    }
+
+    eglMakeCurrent(game->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (game->egl.surface != EGL_NO_SURFACE) {
+        eglDestroySurface(game->egl.display, game->egl.surface);
+    }
+    if (game->egl.ctx != EGL_NO_CONTEXT) {
+        eglDestroyContext(game->egl.display, game->egl.ctx);
+    }
+    if (game->egl.window) {
+        wl_egl_window_destroy(game->egl.window);
+    }
+    eglTerminate(game->egl.display);
+}
+
+static bool
+draw_frame(struct game *game) {
+    glViewport(0, 0, GAME_WIDTH, GAME_HEIGHT);
+    glClearColor(GAME_COLOR[0] / 255.0f, GAME_COLOR[1] / 255.0f, GAME_COLOR[2] / 255.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (!eglSwapBuffers(game->egl.display, game->egl.surface)) {
+        fprintf(stderr, "game: failed to swap buffers (%#x)\n", (unsigned)eglGetError());
+        return false;
+    }
+
+    if (wl_display_roundtrip(game->display) == -1) {
+        fprintf(stderr, "game: lost connection to waywall\n");
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+wait_frames(struct game *game, bool *cond) {
+    for (int i = 0; i < MAX_WAIT_FRAMES && !*cond; i++) {
+        if (!draw_frame(game)) {
+            return false;
+        }
+    }
+
+    return *cond;
+}
+
+static bool
+create_buffer(struct game *game) {
+    game->buffer.stride = game->session.width * 4;
+    game->buffer.size = (size_t)game->buffer.stride * (size_t)game->session.height;
+    game->buffer.format = game->session.has_xrgb ? WL_SHM_FORMAT_XRGB8888 : WL_SHM_FORMAT_ARGB8888;
+
+    game->buffer.fd = memfd_create("capture-test", MFD_CLOEXEC);
+    if (game->buffer.fd == -1) {
+        perror("game: memfd_create");
+        return false;
+    }
+
+    if (ftruncate(game->buffer.fd, game->buffer.size) != 0) {
+        perror("game: ftruncate");
+        return false;
+    }
+
+    game->buffer.data =
+        mmap(nullptr, game->buffer.size, PROT_READ | PROT_WRITE, MAP_SHARED, game->buffer.fd, 0);
+    if (game->buffer.data == MAP_FAILED) {
+        perror("game: mmap");
+        game->buffer.data = nullptr;
+        return false;
+    }
+    memset(game->buffer.data, 0, game->buffer.size);
+
+    struct wl_shm_pool *pool = wl_shm_create_pool(game->shm, game->buffer.fd, game->buffer.size);
+    check_alloc(pool);
+
+    game->buffer.wl =
+        wl_shm_pool_create_buffer(pool, 0, game->session.width, game->session.height,
+                                  game->buffer.stride, game->buffer.format);
+    check_alloc(game->buffer.wl);
+
+    wl_shm_pool_destroy(pool);
+    return true;
+}
+
+static bool
+capture_frame(struct game *game) {
+    game->frame.ready = game->frame.failed = false;
+
+    struct ext_image_copy_capture_frame_v1 *frame =
+        ext_image_copy_capture_session_v1_create_frame(game->session.wl);
+    check_alloc(frame);
+    ext_image_copy_capture_frame_v1_add_listener(frame, &frame_listener, game);
+
+    ext_image_copy_capture_frame_v1_attach_buffer(frame, game->buffer.wl);
+    ext_image_copy_capture_frame_v1_damage_buffer(frame, 0, 0, game->session.width,
+                                                  game->session.height);
+    ext_image_copy_capture_frame_v1_capture(frame);
+
+    bool finished = false;
+    for (int i = 0; i < MAX_WAIT_FRAMES && !finished; i++) {
+        if (!draw_frame(game)) {
+            ext_image_copy_capture_frame_v1_destroy(frame);
+            return false;
+        }
+        finished = game->frame.ready || game->frame.failed;
+    }
+
+    ext_image_copy_capture_frame_v1_destroy(frame);
+
+    if (!finished) {
+        fprintf(stderr, "game: capture did not finish\n");
+        return false;
+    }
+    return true;
+}
+
+static bool
+check_pixels(struct game *game) {
+    // Both formats are stored as BGRA in memory. The alpha (or padding) byte is not checked.
+    for (int32_t y = 0; y < game->session.height; y++) {
+        const uint8_t *row = game->buffer.data + (size_t)game->buffer.stride * (size_t)y;
+
+        for (int32_t x = 0; x < game->session.width; x++) {
+            const uint8_t *px = row + x * 4;
+            if (px[0] != GAME_COLOR[2] || px[1] != GAME_COLOR[1] || px[2] != GAME_COLOR[0]) {
+                fprintf(stderr,
+                        "game: pixel (%d, %d) is %02x%02x%02x, expected %02x%02x%02x (RGB)\n",
+                        (int)x, (int)y, px[2], px[1], px[0], GAME_COLOR[0], GAME_COLOR[1],
+                        GAME_COLOR[2]);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static uint8_t
+run(struct game *game) {
+    if (!game->compositor || !game->output || !game->shm || !game->xdg_wm_base) {
+        fprintf(stderr, "game: waywall is missing required globals\n");
+        return CAPTURE_FAIL;
+    }
+    if (!game->capture_manager || !game->source_manager) {
+        fprintf(stderr, "game: waywall does not provide ext-image-copy-capture-v1\n");
+        return CAPTURE_FAIL;
+    }
+
+    xdg_wm_base_add_listener(game->xdg_wm_base, &xdg_wm_base_listener, game);
+
+    game->surface = wl_compositor_create_surface(game->compositor);
+    check_alloc(game->surface);
+
+    game->xdg_surface = xdg_wm_base_get_xdg_surface(game->xdg_wm_base, game->surface);
+    check_alloc(game->xdg_surface);
+    xdg_surface_add_listener(game->xdg_surface, &xdg_surface_listener, game);
+
+    game->xdg_toplevel = xdg_surface_get_toplevel(game->xdg_surface);
+    check_alloc(game->xdg_toplevel);
+    xdg_toplevel_add_listener(game->xdg_toplevel, &xdg_toplevel_listener, game);
+    xdg_toplevel_set_title(game->xdg_toplevel, "capture");
+
+    wl_surface_commit(game->surface);
+    while (!game->configured) {
+        if (wl_display_dispatch(game->display) == -1) {
+            fprintf(stderr, "game: lost connection to waywall\n");
+            return CAPTURE_FAIL;
+        }
+    }
+
+    if (!egl_init(game)) {
+        return CAPTURE_SKIP;
+    }
+    if (!draw_frame(game)) {
+        return CAPTURE_FAIL;
+    }
+
+    // waywall only has one output, and capturing it captures the game.
+    game->session.source = ext_output_image_capture_source_manager_v1_create_source(
+        game->source_manager, game->output);
+    check_alloc(game->session.source);
+
+    game->session.wl = ext_image_copy_capture_manager_v1_create_session(
+        game->capture_manager, game->session.source, 0);
+    check_alloc(game->session.wl);
+    ext_image_copy_capture_session_v1_add_listener(game->session.wl, &session_listener, game);
+
+    if (!wait_frames(game, &game->session.done) || game->session.stopped) {
+        fprintf(stderr, "game: capture session did not receive buffer constraints\n");
+        return CAPTURE_FAIL;
+    }
+    if (game->session.width != GAME_WIDTH || game->session.height != GAME_HEIGHT) {
+        fprintf(stderr, "game: capture size is %dx%d, expected %dx%d\n", (int)game->session.width,
+                (int)game->session.height, (int)GAME_WIDTH, (int)GAME_HEIGHT);
+        return CAPTURE_FAIL;
+    }
+    if (!game->session.has_argb && !game->session.has_xrgb) {
+        fprintf(stderr, "game: capture session does not support ARGB8888 or XRGB8888\n");
+        return CAPTURE_FAIL;
+    }
+
+    if (!create_buffer(game)) {
+        return CAPTURE_FAIL;
+    }
+
+    if (!capture_frame(game)) {
+        return CAPTURE_FAIL;
+    }
+    if (!game->frame.ready) {
+        fprintf(stderr, "game: capture failed (reason %u)\n", (unsigned)game->frame.reason);
+        return CAPTURE_FAIL;
+    }
+    if (!check_pixels(game)) {
+        return CAPTURE_FAIL;
+    }
+
+    // Accessing the buffer after its file has been truncated raises SIGBUS, which waywall must
+    // handle by failing the capture.
+    munmap(game->buffer.data, game->buffer.size);
+    game->buffer.data = nullptr;
+    if (ftruncate(game->buffer.fd, 0) != 0) {
+        perror("game: ftruncate");
+        return CAPTURE_FAIL;
+    }
+
+    if (!capture_frame(game)) {
+        return CAPTURE_FAIL;
+    }
+    if (!game->frame.failed) {
+        fprintf(stderr, "game: capture into a truncated buffer did not fail\n");
+        return CAPTURE_FAIL;
+    }
+    if (!draw_frame(game)) {
+        return CAPTURE_FAIL;
+    }
+
+    return CAPTURE_PASS;
+}
+
+static bool
+parse_int(const char *arg, int *out) {
+    char *end;
+    long value = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || value < 0 || value > INT32_MAX) {
+        return false;
+    }
+
+    *out = (int)value;
+    return true;
+}
+
+int
+capture_game_main(int argc, char **argv) {
+    int report_fd = -1;
+    if (argc != 3 || strcmp(argv[1], "--report-fd") != 0 || !parse_int(argv[2], &report_fd)) {
+        fprintf(stderr, "game: invalid arguments\n");
+        return 1;
+    }
+
+    struct game game = {
+        .egl.display = EGL_NO_DISPLAY,
+        .egl.ctx = EGL_NO_CONTEXT,
+        .egl.surface = EGL_NO_SURFACE,
+        .buffer.fd = -1,
+    };
+
+    game.display = wl_display_connect(nullptr);
+    if (!game.display) {
+        fprintf(stderr, "game: failed to connect to wayland display\n");
+        return 1;
+    }
+
+    game.registry = wl_display_get_registry(game.display);
+    check_alloc(game.registry);
+    wl_registry_add_listener(game.registry, &registry_listener, &game);
+    wl_display_roundtrip(game.display);
+
+    uint8_t result = run(&game);
+
+    if (game.buffer.data) {
+        munmap(game.buffer.data, game.buffer.size);
+    }
+    if (game.buffer.fd != -1) {
+        close(game.buffer.fd);
+    }
+    egl_finish(&game);
+    wl_display_disconnect(game.display);
+
+    if (write(report_fd, &result, sizeof(result)) != (ssize_t)sizeof(result)) {
+        perror("game: write");
+        return 1;
+    }
+    close(report_fd);
+
+    return result == CAPTURE_PASS ? 0 : 1;
+}
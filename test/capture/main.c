@@ -0,0 +1,227 @@
+#include "bench.h"
+#include "capture.h"
+#include "util/prelude.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+
+/*
+ * Checks that programs running inside of waywall can capture the game's frames into SHM buffers
+ * with ext-image-copy-capture-v1. A game (see game.c) is run through `waywall wrap` against the
+ * stand-in host from the benchmark, captures its own frames, and reports whether the captured
+ * pixels were correct.
+ *
+ * The test exits with status 77 (skipped) if waywall or the game could not use EGL.
+ */
+
+static constexpr int EXIT_SKIP = 77;
+static constexpr int TIMEOUT = 60; // seconds
+
+struct capture_run {
+    pid_t pid;
+    bool exited, timed_out;
+    int status;
+};
+
+static int
+handle_sigchld(int signal_number, void *data) {
+    struct capture_run *run = data;
+
+    int status;
+    if (waitpid(run->pid, &status, WNOHANG) == run->pid) {
+        run->exited = true;
+        run->status = status;
+    }
+
+    return 0;
+}
+
+static int
+handle_timeout(void *data) {
+    struct capture_run *run = data;
+
+    fprintf(stderr, "capture test timed out\n");
+    run->timed_out = true;
+    kill(run->pid, SIGKILL);
+    return 0;
+}
+
+static pid_t
+spawn(const char *waywall, const char *self, const char *socket_name, int report_fd) {
+    pid_t pid = fork();
+    if (pid != 0) {
+        if (pid == -1) {
+            perror("fork");
+        }
+        return pid;
+    }
+
+    // The event loop blocks SIGCHLD so that it can be read from a signalfd. The signal mask is
+    // inherited across exec, so it has to be restored here.
+    sigset_t set;
+    sigemptyset(&set);
+    sigprocmask(SIG_SETMASK, &set, nullptr);
+
+    // The report pipe is passed down to the game through waywall.
+    if (fcntl(report_fd, F_SETFD, 0) == -1) {
+        perror("fcntl");
+        _exit(EXIT_FAILURE);
+    }
+
+    if (setenv("WAYLAND_DISPLAY", socket_name, 1) != 0) {
+        perror("setenv");
+        _exit(EXIT_FAILURE);
+    }
+
+    char fd_str[16];
+    snprintf(fd_str, STATIC_ARRLEN(fd_str), "%d", report_fd);
+
+    char *argv[] = {
+        (char *)waywall, "wrap", "--", (char *)self, "game", "--report-fd", fd_str, nullptr,
+    };
+    execv(waywall, argv);
+    perror("execv");
+
+    _exit(EXIT_FAILURE);
+}
+
+static int
+run_test(const char *waywall, const char *self) {
+    struct bench_host *host = bench_host_create(&(struct bench_host_options){
+        .width = 1280,
+        .height = 720,
+        .input_rate = 100,
+    });
+    if (!host) {
+        return EXIT_FAILURE;
+    }
+
+    struct wl_event_loop *loop = wl_display_get_event_loop(host->display);
+    struct capture_run run = {};
+    int ret = EXIT_FAILURE;
+
+    struct wl_event_source *sigchld_src =
+        wl_event_loop_add_signal(loop, SIGCHLD, handle_sigchld, &run);
+    if (!sigchld_src) {
+        fprintf(stderr, "failed to create SIGCHLD event source\n");
+        goto fail_sigchld;
+    }
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        goto fail_pipe;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    // Other processes started by waywall (e.g. Xwayland) may inherit the report pipe and outlive
+    // it, so the result is read without waiting for the pipe to be closed.
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    run.pid = spawn(waywall, self, host->socket_name, fds[1]);
+    close(fds[1]);
+    if (run.pid == -1) {
+        close(fds[0]);
+        goto fail_pipe;
+    }
+
+    struct wl_event_source *timeout_src = wl_event_loop_add_timer(loop, handle_timeout, &run);
+    if (!timeout_src) {
+        fprintf(stderr, "failed to create timeout event source\n");
+        kill(run.pid, SIGKILL);
+    } else {
+        wl_event_source_timer_update(timeout_src, TIMEOUT * 1000);
+    }
+
+    while (!run.exited) {
+        wl_display_flush_clients(host->display);
+        if (wl_event_loop_dispatch(loop, -1) == -1 && errno != EINTR) {
+            perror("wl_event_loop_dispatch");
+            kill(run.pid, SIGKILL);
+            waitpid(run.pid, &run.status, 0);
+            run.exited = true;
+        }
+    }
+
+    if (timeout_src) {
+        wl_event_source_remove(timeout_src);
+    }
+
+    // The game writes its result just before it exits, and waywall only exits after the game has.
+    uint8_t result;
+    ssize_t n;
+    do {
+        n = read(fds[0], &result, sizeof(result));
+    } while (n == -1 && errno == EINTR);
+    close(fds[0]);
+
+    if (n != (ssize_t)sizeof(result)) {
+        fprintf(stderr, "waywall did not run the game, skipping (status %d)\n", run.status);
+        ret = EXIT_SKIP;
+    } else if (result == CAPTURE_SKIP) {
+        fprintf(stderr, "the game could not draw with EGL, skipping\n");
+        ret = EXIT_SKIP;
+    } else if (result != CAPTURE_PASS || run.timed_out) {
+        fprintf(stderr, "capture test failed (waywall status %d)\n", run.status);
+    } else {
+        ret = EXIT_SUCCESS;
+    }
+
+fail_pipe:
+    wl_event_source_remove(sigchld_src);
+
+fail_sigchld:
+    bench_host_destroy(host);
+    return ret;
+}
+
+int
+main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "game") == 0) {
+        return capture_game_main(argc - 1, argv + 1);
+    }
+
+    if (argc != 2) {
+        fprintf(stderr, "USAGE: %s WAYWALL\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // The game is started by waywall, so it needs a path which does not refer to whichever process
+    // happens to resolve it.
+    char self[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", self, STATIC_ARRLEN(self) - 1);
+    if (len == -1) {
+        perror("readlink");
+        return EXIT_FAILURE;
+    }
+    self[len] = '\0';
+
+    char tmpdir[] = "/tmp/waywall-capture-XXXXXX";
+    if (!mkdtemp(tmpdir)) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    if (!bench_env_setup(tmpdir)) {
+        bench_env_remove(tmpdir);
+        return EXIT_FAILURE;
+    }
+
+    int ret = run_test(argv[1], self);
+
+    // waywall's logs are kept if anything went wrong.
+    if (ret == EXIT_SUCCESS) {
+        bench_env_remove(tmpdir);
+    } else {
+        fprintf(stderr, "waywall's logs are in %s/state\n", tmpdir);
+    }
+    return ret;
+}
@@ -0,0 +1,115 @@
+#include "server/dmabuf_feedback.h"
+#include "util/prelude.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+static constexpr dev_t RENDER_DEVICE = 0xE280;
+static constexpr dev_t OTHER_DEVICE = 0xE281;
+
+struct fake_tranche {
+    dev_t device;
+    uint32_t flags;
+    uint16_t indices[8];
+    size_t num_indices;
+};
+
+// Sends a batch of feedback in the same way that the host compositor's events would be received.
+// The formats of each tranche are split across two events to check that they are combined.
+static void
+fake_feedback_send(struct dmabuf_feedback *feedback, const struct fake_tranche *tranches,
+                   size_t num_tranches) {
+    dmabuf_feedback_main_device(feedback, RENDER_DEVICE);
+
+    for (size_t i = 0; i < num_tranches; i++) {
+        const struct fake_tranche *tranche = &tranches[i];
+        size_t half = tranche->num_indices / 2;
+
+        dmabuf_feedback_tranche_target_device(feedback, tranche->device);
+        dmabuf_feedback_tranche_flags(feedback, tranche->flags);
+        dmabuf_feedback_tranche_formats(feedback, tranche->indices, half);
+        dmabuf_feedback_tranche_formats(feedback, tranche->indices + half,
+                                        tranche->num_indices - half);
+        dmabuf_feedback_tranche_done(feedback);
+    }
+
+    dmabuf_feedback_merge(feedback);
+}
+
+static void
+check_tranche(const struct dmabuf_tranche *tranche, const struct fake_tranche *expected) {
+    ww_assert(tranche->target_device == expected->device);
+    ww_assert(tranche->flags == expected->flags);
+    ww_assert(tranche->num_indices == expected->num_indices);
+    ww_assert(memcmp(tranche->indices, expected->indices,
+                     expected->num_indices * sizeof(*expected->indices)) == 0);
+}
+
+int
+main() {
+    struct dmabuf_feedback feedback;
+    dmabuf_feedback_init(&feedback);
+
+    // Without a scanout tranche, the host's tranches are left unchanged.
+    const struct fake_tranche render_only[] = {
+        {RENDER_DEVICE, 0, {0, 1, 2, 3}, 4},
+    };
+    fake_feedback_send(&feedback, render_only, STATIC_ARRLEN(render_only));
+    ww_assert(feedback.num_tranches == 1);
+    check_tranche(&feedback.tranches[0], &render_only[0]);
+    dmabuf_feedback_reset(&feedback);
+    ww_assert(feedback.num_tranches == 0);
+
+    // Formats in a scanout tranche which cannot be rendered to on the main device are removed.
+    const struct fake_tranche scanout[] = {
+        {RENDER_DEVICE, DMABUF_TRANCHE_SCANOUT, {4, 1, 5, 2}, 4},
+        {RENDER_DEVICE, 0, {0, 1, 2, 3}, 4},
+    };
+    fake_feedback_send(&feedback, scanout, STATIC_ARRLEN(scanout));
+    ww_assert(feedback.num_tranches == 2);
+    check_tranche(&feedback.tranches[0],
+                  &(struct fake_tranche){RENDER_DEVICE, DMABUF_TRANCHE_SCANOUT, {1, 2}, 2});
+    check_tranche(&feedback.tranches[1], &scanout[1]);
+    dmabuf_feedback_reset(&feedback);
+
+    // Scanout tranches without any importable formats are removed entirely, as are tranches for
+    // other devices which have no formats in common with the main device.
+    const struct fake_tranche scanout_other[] = {
+        {OTHER_DEVICE, DMABUF_TRANCHE_SCANOUT, {6, 7}, 2},
+        {RENDER_DEVICE, 0, {0, 1}, 2},
+        {OTHER_DEVICE, 0, {6, 7}, 2},
+    };
+    fake_feedback_send(&feedback, scanout_other, STATIC_ARRLEN(scanout_other));
+    ww_assert(feedback.num_tranches == 2);
+    check_tranche(&feedback.tranches[0], &scanout_other[1]);
+    check_tranche(&feedback.tranches[1], &scanout_other[2]);
+    dmabuf_feedback_reset(&feedback);
+
+    // Adjacent tranches for the same device and flags are merged without duplicate formats.
+    const struct fake_tranche split[] = {
+        {RENDER_DEVICE, DMABUF_TRANCHE_SCANOUT, {0}, 1},
+        {RENDER_DEVICE, DMABUF_TRANCHE_SCANOUT, {1, 0}, 2},
+        {RENDER_DEVICE, 0, {0, 1, 2}, 3},
+        {RENDER_DEVICE, 0, {2, 3}, 2},
+    };
+    fake_feedback_send(&feedback, split, STATIC_ARRLEN(split));
+    ww_assert(feedback.num_tranches == 2);
+    check_tranche(&feedback.tranches[0],
+                  &(struct fake_tranche){RENDER_DEVICE, DMABUF_TRANCHE_SCANOUT, {0, 1}, 2});
+    check_tranche(&feedback.tranches[1],
+                  &(struct fake_tranche){RENDER_DEVICE, 0, {0, 1, 2, 3}, 4});
+    dmabuf_feedback_reset(&feedback);
+
+    // Without a rendering tranche for the main device, scanout tranches are passed through.
+    const struct fake_tranche no_render[] = {
+        {RENDER_DEVICE, DMABUF_TRANCHE_SCANOUT, {4, 5}, 2},
+        {OTHER_DEVICE, 0, {0, 1}, 2},
+    };
+    fake_feedback_send(&feedback, no_render, STATIC_ARRLEN(no_render));
+    ww_assert(feedback.num_tranches == 2);
+    check_tranche(&feedback.tranches[0], &no_render[0]);
+    check_tranche(&feedback.tranches[1], &no_render[1]);
+
+    dmabuf_feedback_finish(&feedback);
+    return 0;
+}
@@ -7,6 +7,7 @@
 #include "env_reexec.h"
 #include "instance.h"
 #include "scene.h"
+#include "screenshot.h"
 #include "server/server.h"
 #include "server/ui.h"
 #include "server/wl_seat.h"
@@ -14,6 +15,7 @@
 #include "timer.h"
 #include "util/alloc.h"
 #include "util/box.h"
+#include "util/glyph.h"
 #include "util/keycodes.h"
 #include "util/log.h"
 #include "util/prelude.h"
@@ -23,6 +25,7 @@
 #include <luajit-2.1/lauxlib.h>
 #include <luajit-2.1/lua.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
@@ -80,6 +83,7 @@ static constexpr int DEFAULT_DEPTH = 0;
 static constexpr char METATABLE_IMAGE[] = "waywall.image";
 static constexpr char METATABLE_MIRROR[] = "waywall.mirror";
 static constexpr char METATABLE_TEXT[] = "waywall.text";
+static constexpr char METATABLE_WATCH[] = "waywall.watch";
 
 #define STARTUP_ERRMSG(function) function " cannot be called during startup"
 #define CHECK_OBJECT(object)                                                                       \
@@ -89,11 +93,79 @@ static constexpr char METATABLE_TEXT[] = "waywall.text";
         return luaL_error(L, "object already closed");                                             \
     }
 
+struct waker_readback {
+    struct scene_readback *readback;
+    struct config_vm_waker *vm;
+
+    struct util_glyph_options glyph; // read_text only
+};
+
+struct waker_screenshot {
+    struct wrap *wrap;
+    char *path;
+
+    // At most one of these is non-null at a time: the readback while the frame is being captured,
+    // and then the screenshot while it is being encoded.
+    struct scene_readback *readback;
+    struct screenshot *screenshot;
+
+    struct config_vm_waker *vm;
+};
+
 struct waker_sleep {
     struct ww_timer_entry *timer;
     struct config_vm_waker *vm;
 };
 
+struct count_colors_result {
+    size_t num_colors;
+    const uint32_t *counts;
+};
+
+struct read_pixels_result {
+    int32_t width, height;
+    const uint8_t *rgba;
+};
+
+struct watch_region {
+    struct scene_watch *watch;
+    struct config_vm *vm;
+};
+
+struct live_text {
+    struct wrap *wrap;
+
+    char *format;
+    struct live_text_token {
+        enum live_text_field {
+            LIVE_TEXT_LITERAL,
+            LIVE_TEXT_CLOCK,
+            LIVE_TEXT_COUNTER,
+            LIVE_TEXT_FPS,
+            LIVE_TEXT_PERCENT,
+            LIVE_TEXT_SCREEN,
+        } field;
+
+        const char *literal; // points into format
+        size_t len;
+    } *tokens;
+    size_t num_tokens;
+
+    uint64_t clock_start;
+    int64_t counter;
+};
+
+static const char *screen_names[] = {
+    [SCREEN_TITLE] = "title",           [SCREEN_WAITING] = "waiting",
+    [SCREEN_GENERATING] = "generating", [SCREEN_PREVIEWING] = "previewing",
+    [SCREEN_INWORLD] = "inworld",       [SCREEN_WALL] = "wall",
+};
+
+struct watch_region_change {
+    struct watch_region *region;
+    float change;
+};
+
 static int
 object_get_depth(lua_State *L) {
     struct scene_object **object = lua_touserdata(L, 1);
@@ -114,6 +186,141 @@ object_set_depth(lua_State *L) {
     return 0;
 }
 
+static int
+object_set_position(lua_State *L) {
+    struct scene_object **object = lua_touserdata(L, 1);
+    CHECK_OBJECT(object);
+
+    struct scene_transform transform;
+    scene_object_get_transform(*object, &transform);
+    transform.x = luaL_checknumber(L, 2);
+    transform.y = luaL_checknumber(L, 3);
+
+    scene_object_set_transform(*object, &transform);
+    return 0;
+}
+
+static int
+object_set_color(lua_State *L) {
+    struct scene_object **object = lua_touserdata(L, 1);
+    CHECK_OBJECT(object);
+
+    const char *raw = luaL_checkstring(L, 2);
+    uint8_t u8_rgba[4] = {};
+    if (config_parse_hex(u8_rgba, raw) != 0) {
+        return luaL_error(L, "expected a valid hex color, got '%s'", raw);
+    }
+
+    struct scene_transform transform;
+    scene_object_get_transform(*object, &transform);
+    for (size_t i = 0; i < 3; i++) {
+        transform.rgba[i] = (float)u8_rgba[i] / UINT8_MAX;
+    }
+
+    scene_object_set_transform(*object, &transform);
+    return 0;
+}
+
+static int
+object_set_opacity(lua_State *L) {
+    struct scene_object **object = lua_touserdata(L, 1);
+    CHECK_OBJECT(object);
+
+    double opacity = luaL_checknumber(L, 2);
+    luaL_argcheck(L, opacity >= 0 && opacity <= 1, 2, "opacity must be between 0 and 1");
+
+    struct scene_transform transform;
+    scene_object_get_transform(*object, &transform);
+    transform.rgba[3] = opacity;
+
+    scene_object_set_transform(*object, &transform);
+    return 0;
+}
+
+static int
+object_animate(lua_State *L) {
+    static const char *easing_names[] = {"linear", "in", "out", "in_out", nullptr};
+    static const enum scene_easing easing_values[] = {
+        SCENE_EASING_LINEAR,
+        SCENE_EASING_IN,
+        SCENE_EASING_OUT,
+        SCENE_EASING_IN_OUT,
+    };
+
+    struct scene_object **object = lua_touserdata(L, 1);
+    CHECK_OBJECT(object);
+    luaL_checktype(L, 2, LUA_TTABLE);
+
+    struct scene_transform transform;
+    scene_object_get_transform(*object, &transform);
+
+    lua_getfield(L, 2, "x"); // stack: 3
+    transform.x = luaL_optnumber(L, -1, transform.x);
+    lua_getfield(L, 2, "y"); // stack: 4
+    transform.y = luaL_optnumber(L, -1, transform.y);
+    lua_getfield(L, 2, "opacity"); // stack: 5
+    transform.rgba[3] = luaL_optnumber(L, -1, transform.rgba[3]);
+    if (transform.rgba[3] < 0 || transform.rgba[3] > 1) {
+        return luaL_error(L, "opacity must be between 0 and 1");
+    }
+    lua_pop(L, 3); // stack: 2
+
+    lua_getfield(L, 2, "color"); // stack: 3
+    if (!lua_isnil(L, -1)) {
+        if (lua_type(L, -1) != LUA_TSTRING) {
+            return luaL_error(L, "expected 'color' to be a string, got '%s'",
+                              luaL_typename(L, -1));
+        }
+
+        const char *raw = lua_tostring(L, -1);
+        uint8_t u8_rgba[4] = {};
+        if (config_parse_hex(u8_rgba, raw) != 0) {
+            return luaL_error(L, "expected 'color' to be a valid hex color ('%s')", raw);
+        }
+        for (size_t i = 0; i < 3; i++) {
+            transform.rgba[i] = (float)u8_rgba[i] / UINT8_MAX;
+        }
+    }
+    lua_pop(L, 1); // stack: 2
+
+    lua_getfield(L, 2, "duration"); // stack: 3
+    int duration = luaL_optinteger(L, -1, 0);
+    if (duration < 0) {
+        return luaL_error(L, "duration must be non-negative");
+    }
+    lua_getfield(L, 2, "easing"); // stack: 4
+    int easing = luaL_checkoption(L, -1, "linear", easing_names);
+    lua_pop(L, 2); // stack: 2
+
+    scene_object_animate(*object, &transform, duration, easing_values[easing]);
+    return 0;
+}
+
+static bool
+object_index(lua_State *L, const char *key) {
+    // Pushes the method shared by all scene objects with the given name, if there is one.
+    static const struct {
+        const char *name;
+        lua_CFunction func;
+    } methods[] = {
+        {"animate", object_animate},
+        {"get_depth", object_get_depth},
+        {"set_color", object_set_color},
+        {"set_depth", object_set_depth},
+        {"set_opacity", object_set_opacity},
+        {"set_position", object_set_position},
+    };
+
+    for (size_t i = 0; i < STATIC_ARRLEN(methods); i++) {
+        if (strcmp(key, methods[i].name) == 0) {
+            lua_pushcfunction(L, methods[i].func);
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static int
 image_close(lua_State *L) {
     struct scene_image **image = lua_touserdata(L, 1);
@@ -131,11 +338,7 @@ image_index(lua_State *L) {
 
     if (strcmp(key, "close") == 0) {
         lua_pushcfunction(L, image_close);
-    } else if (strcmp(key, "get_depth") == 0) {
-        lua_pushcfunction(L, object_get_depth);
-    } else if (strcmp(key, "set_depth") == 0) {
-        lua_pushcfunction(L, object_set_depth);
-    } else {
+    } else if (!object_index(L, key)) {
         lua_pushnil(L);
     }
 
@@ -171,11 +374,7 @@ mirror_index(lua_State *L) {
 
     if (strcmp(key, "close") == 0) {
         lua_pushcfunction(L, mirror_close);
-    } else if (strcmp(key, "get_depth") == 0) {
-        lua_pushcfunction(L, object_get_depth);
-    } else if (strcmp(key, "set_depth") == 0) {
-        lua_pushcfunction(L, object_set_depth);
-    } else {
+    } else if (!object_index(L, key)) {
         lua_pushnil(L);
     }
 
@@ -205,17 +404,232 @@ text_close(lua_State *L) {
     return 0;
 }
 
+static uint64_t
+live_text_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+static void
+live_text_destroy(void *data) {
+    struct live_text *live = data;
+
+    free(live->tokens);
+    free(live->format);
+    free(live);
+}
+
+static size_t
+live_text_source(void *data, char *buf, size_t size) {
+    // This is called once per frame for each live text object, so it must not allocate.
+    struct live_text *live = data;
+    struct instance *instance = live->wrap->instance;
+
+    size_t len = 0;
+    for (size_t i = 0; i < live->num_tokens && len + 1 < size; i++) {
+        struct live_text_token *token = &live->tokens[i];
+
+        char field[32];
+        const char *value = field;
+        int n = 0;
+
+        switch (token->field) {
+        case LIVE_TEXT_LITERAL:
+            value = token->literal;
+            n = token->len;
+            break;
+        case LIVE_TEXT_CLOCK: {
+            uint64_t ms = live_text_now() - live->clock_start;
+            uint64_t h = ms / 3600000, m = (ms / 60000) % 60, sec = (ms / 1000) % 60;
+
+            if (h > 0) {
+                n = snprintf(field, sizeof(field), "%d:%02d:%02d.%03d", (int)h, (int)m, (int)sec,
+                             (int)(ms % 1000));
+            } else {
+                n = snprintf(field, sizeof(field), "%d:%02d.%03d", (int)m, (int)sec,
+                             (int)(ms % 1000));
+            }
+            break;
+        }
+        case LIVE_TEXT_COUNTER:
+            n = snprintf(field, sizeof(field), "%lld", (long long)live->counter);
+            break;
+        case LIVE_TEXT_FPS:
+            n = snprintf(field, sizeof(field), "%u", (unsigned)scene_get_fps(live->wrap->scene));
+            break;
+        case LIVE_TEXT_PERCENT:
+            if (instance && (instance->state.screen == SCREEN_GENERATING ||
+                             instance->state.screen == SCREEN_PREVIEWING)) {
+                n = snprintf(field, sizeof(field), "%d", instance->state.data.percent);
+            }
+            break;
+        case LIVE_TEXT_SCREEN:
+            if (instance) {
+                value = screen_names[instance->state.screen];
+                n = strlen(value);
+            }
+            break;
+        }
+
+        size_t count = (n > 0) ? (size_t)n : 0;
+        if (value == field && count >= sizeof(field)) {
+            count = sizeof(field) - 1;
+        }
+        if (count > size - 1 - len) {
+            count = size - 1 - len;
+        }
+
+        memcpy(buf + len, value, count);
+        len += count;
+    }
+
+    return len;
+}
+
+static const struct {
+    const char *name;
+    enum live_text_field field;
+} live_text_fields[] = {
+    {"clock", LIVE_TEXT_CLOCK},     {"counter", LIVE_TEXT_COUNTER}, {"fps", LIVE_TEXT_FPS},
+    {"percent", LIVE_TEXT_PERCENT}, {"screen", LIVE_TEXT_SCREEN},
+};
+
+static ssize_t
+live_text_find_field(const char *name, size_t len) {
+    for (size_t i = 0; i < STATIC_ARRLEN(live_text_fields); i++) {
+        if (strlen(live_text_fields[i].name) == len &&
+            strncmp(name, live_text_fields[i].name, len) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static size_t
+live_text_parse(const char *format, struct live_text_token *tokens) {
+    // Splits the format string into literal text and fields. If tokens is null, the tokens are
+    // only counted. The format string must be valid (see unmarshal_live_format.)
+    size_t num_tokens = 0;
+
+    for (const char *c = format; *c;) {
+        struct live_text_token token = {.field = LIVE_TEXT_LITERAL, .literal = c};
+
+        if (c[0] == '{' && c[1] == '{') {
+            token.len = 1;
+            c += 2;
+        } else if (c[0] == '{') {
+            const char *end = strchr(c, '}');
+            token.field = live_text_fields[live_text_find_field(c + 1, end - c - 1)].field;
+            c = end + 1;
+        } else {
+            const char *end = strchr(c, '{');
+            token.len = end ? (size_t)(end - c) : strlen(c);
+            c += token.len;
+        }
+
+        if (tokens) {
+            tokens[num_tokens] = token;
+        }
+        num_tokens++;
+    }
+
+    return num_tokens;
+}
+
+static int
+unmarshal_live_format(lua_State *L, const char *format) {
+    for (const char *c = format; (c = strchr(c, '{'));) {
+        if (c[1] == '{') {
+            c += 2;
+            continue;
+        }
+
+        const char *end = strchr(c, '}');
+        if (!end) {
+            return luaL_error(L, "unterminated field in live text format");
+        }
+        if (live_text_find_field(c + 1, end - c - 1) < 0) {
+            return luaL_error(L, "unknown field in live text format ('%s')", c);
+        }
+
+        c = end + 1;
+    }
+
+    return 0;
+}
+
+static struct live_text *
+live_text_create(struct wrap *wrap, const char *format) {
+    struct live_text *live = zalloc(1, sizeof(*live));
+
+    live->wrap = wrap;
+    live->format = ww_strdup(format);
+    live->clock_start = live_text_now();
+
+    size_t num_tokens = live_text_parse(live->format, nullptr);
+    live->tokens = zalloc(num_tokens > 0 ? num_tokens : 1, sizeof(*live->tokens));
+    live->num_tokens = live_text_parse(live->format, live->tokens);
+
+    return live;
+}
+
+static int
+text_add_counter(lua_State *L) {
+    struct scene_text **text = lua_touserdata(L, 1);
+    CHECK_OBJECT(text);
+
+    struct live_text *live = scene_text_get_source(*text);
+    if (!live) {
+        return luaL_error(L, "text is not live");
+    }
+
+    live->counter += luaL_optinteger(L, 2, 1);
+    return 0;
+}
+
+static int
+text_reset_clock(lua_State *L) {
+    struct scene_text **text = lua_touserdata(L, 1);
+    CHECK_OBJECT(text);
+
+    struct live_text *live = scene_text_get_source(*text);
+    if (!live) {
+        return luaL_error(L, "text is not live");
+    }
+
+    live->clock_start = live_text_now();
+    return 0;
+}
+
+static int
+text_set_counter(lua_State *L) {
+    struct scene_text **text = lua_touserdata(L, 1);
+    CHECK_OBJECT(text);
+
+    struct live_text *live = scene_text_get_source(*text);
+    if (!live) {
+        return luaL_error(L, "text is not live");
+    }
+
+    live->counter = luaL_checkinteger(L, 2);
+    return 0;
+}
+
 static int
 text_index(lua_State *L) {
     const char *key = luaL_checkstring(L, 2);
 
     if (strcmp(key, "close") == 0) {
         lua_pushcfunction(L, text_close);
-    } else if (strcmp(key, "get_depth") == 0) {
-        lua_pushcfunction(L, object_get_depth);
-    } else if (strcmp(key, "set_depth") == 0) {
-        lua_pushcfunction(L, object_set_depth);
-    } else {
+    } else if (strcmp(key, "add_counter") == 0) {
+        lua_pushcfunction(L, text_add_counter);
+    } else if (strcmp(key, "reset_clock") == 0) {
+        lua_pushcfunction(L, text_reset_clock);
+    } else if (strcmp(key, "set_counter") == 0) {
+        lua_pushcfunction(L, text_set_counter);
+    } else if (!object_index(L, key)) {
         lua_pushnil(L);
     }
 
@@ -226,54 +640,536 @@ static int
 text_gc(lua_State *L) {
     struct scene_text **text = lua_touserdata(L, 1);
 
-    if (*text) {
-        scene_object_destroy((struct scene_object *)*text);
+    if (*text) {
+        scene_object_destroy((struct scene_object *)*text);
+    }
+    *text = nullptr;
+
+    return 0;
+}
+
+static int
+watch_close(lua_State *L) {
+    struct watch_region *region = lua_touserdata(L, 1);
+    if (!region) {
+        return luaL_error(L, "object method was called as a function");
+    } else if (!region->watch) {
+        return luaL_error(L, "object already closed");
+    }
+
+    scene_watch_destroy(region->watch);
+    region->watch = nullptr;
+
+    return 0;
+}
+
+static int
+watch_index(lua_State *L) {
+    const char *key = luaL_checkstring(L, 2);
+
+    if (strcmp(key, "close") == 0) {
+        lua_pushcfunction(L, watch_close);
+    } else {
+        lua_pushnil(L);
+    }
+
+    return 1;
+}
+
+static int
+watch_gc(lua_State *L) {
+    struct watch_region *region = lua_touserdata(L, 1);
+
+    if (region->watch) {
+        scene_watch_destroy(region->watch);
+    }
+    region->watch = nullptr;
+
+    return 0;
+}
+
+static int
+watch_region_push(lua_State *L, void *data) {
+    struct watch_region_change *change = data;
+
+    lua_pushlightuserdata(L, change->region); // stack: 1
+    lua_pushnumber(L, change->change);        // stack: 2
+    return 2;
+}
+
+static void
+watch_region_changed(void *data, float change) {
+    struct watch_region *region = data;
+
+    // The region is identified to the Lua code by the address of its userdata, which is returned
+    // alongside the userdata itself from watch_region.
+    struct watch_region_change event = {region, change};
+    config_vm_signal_event_with(region->vm, "region", watch_region_push, &event);
+}
+
+static void
+watch_region_destroy(void *data) {
+    struct watch_region *region = data;
+
+    // This function is called if the watch is destroyed along with the scene. Remove the reference
+    // to it so that it is not destroyed a 2nd time when the userdata is garbage collected.
+    region->watch = nullptr;
+}
+
+static int
+waker_count_colors_push(lua_State *L, void *data) {
+    struct count_colors_result *result = data;
+
+    lua_createtable(L, result->num_colors, 0); // stack: 1
+    for (size_t i = 0; i < result->num_colors; i++) {
+        lua_pushinteger(L, result->counts[i]); // stack: 2
+        lua_rawseti(L, -2, i + 1);             // stack: 1
+    }
+
+    return 1;
+}
+
+static void
+waker_count_colors_done(void *data, size_t num_colors, const uint32_t *counts) {
+    struct waker_readback *waker = data;
+
+    // The readback destroys itself once it has completed.
+    waker->readback = nullptr;
+
+    struct count_colors_result result = {num_colors, counts};
+    config_vm_resume_with(waker->vm, waker_count_colors_push, &result);
+}
+
+static void
+waker_readback_vm_destroy(struct config_vm_waker *vm_waker, void *data) {
+    struct waker_readback *waker = data;
+
+    if (waker->readback) {
+        scene_readback_destroy(waker->readback);
+    }
+
+    free(waker);
+}
+
+static void
+waker_readback_destroy(void *data) {
+    struct waker_readback *waker = data;
+
+    // This function is called if the readback is destroyed along with the scene. Remove the
+    // reference to it so that the VM does not attempt to destroy it a 2nd time.
+    waker->readback = nullptr;
+}
+
+static int
+waker_read_pixels_push(lua_State *L, void *data) {
+    struct read_pixels_result *result = data;
+
+    int32_t count = result->width * result->height;
+    lua_createtable(L, count, 0); // stack: 1
+
+    for (int32_t i = 0; i < count; i++) {
+        const uint8_t *px = &result->rgba[i * 4];
+        uint32_t color = ((uint32_t)px[0] << 24) | ((uint32_t)px[1] << 16) |
+                         ((uint32_t)px[2] << 8) | (uint32_t)px[3];
+
+        lua_pushnumber(L, color);  // stack: 2
+        lua_rawseti(L, -2, i + 1); // stack: 1
+    }
+
+    lua_pushinteger(L, result->width);  // stack: 2
+    lua_pushinteger(L, result->height); // stack: 3
+    return 3;
+}
+
+static void
+waker_read_pixels_done(void *data, int32_t width, int32_t height, const uint8_t *rgba) {
+    struct waker_readback *waker = data;
+
+    // The readback destroys itself once it has completed.
+    waker->readback = nullptr;
+
+    struct read_pixels_result result = {width, height, rgba};
+    config_vm_resume_with(waker->vm, waker_read_pixels_push, &result);
+}
+
+static int
+waker_read_text_push(lua_State *L, void *data) {
+    const char *text = data;
+
+    lua_pushstring(L, text); // stack: 1
+    return 1;
+}
+
+static void
+waker_read_text_done(void *data, int32_t width, int32_t height, const uint8_t *rgba) {
+    struct waker_readback *waker = data;
+
+    // The readback destroys itself once it has completed.
+    waker->readback = nullptr;
+
+    char *text = util_glyph_read(rgba, width, height, &waker->glyph);
+    config_vm_resume_with(waker->vm, waker_read_text_push, text);
+    free(text);
+}
+
+static int
+waker_screenshot_push(lua_State *L, void *data) {
+    bool *ok = data;
+
+    lua_pushboolean(L, *ok); // stack: 1
+    return 1;
+}
+
+static void
+waker_screenshot_written(void *data, bool ok) {
+    struct waker_screenshot *waker = data;
+
+    // The screenshot destroys itself once it has been written.
+    waker->screenshot = nullptr;
+
+    config_vm_resume_with(waker->vm, waker_screenshot_push, &ok);
+}
+
+static void
+waker_screenshot_destroy(void *data) {
+    struct waker_screenshot *waker = data;
+
+    // This function is called if the screenshot is destroyed along with the screenshot writer.
+    waker->screenshot = nullptr;
+}
+
+static void
+waker_screenshot_captured(void *data, int32_t width, int32_t height, uint8_t *rgba) {
+    struct waker_screenshot *waker = data;
+
+    // The readback destroys itself once it has completed.
+    waker->readback = nullptr;
+
+    if (rgba) {
+        waker->screenshot =
+            screenshot_write(waker->wrap->screenshots, waker->path, rgba, width, height,
+                             waker_screenshot_written, waker_screenshot_destroy, waker);
+        return;
+    }
+
+    bool ok = false;
+    config_vm_resume_with(waker->vm, waker_screenshot_push, &ok);
+}
+
+static void
+waker_screenshot_readback_destroy(void *data) {
+    struct waker_screenshot *waker = data;
+
+    // This function is called if the readback is destroyed along with the scene.
+    waker->readback = nullptr;
+}
+
+static void
+waker_screenshot_vm_destroy(struct config_vm_waker *vm_waker, void *data) {
+    struct waker_screenshot *waker = data;
+
+    if (waker->readback) {
+        scene_readback_destroy(waker->readback);
+    }
+    if (waker->screenshot) {
+        screenshot_cancel(waker->screenshot);
+    }
+
+    free(waker->path);
+    free(waker);
+}
+
+static void
+waker_sleep_vm_destroy(struct config_vm_waker *vm_waker, void *data) {
+    struct waker_sleep *waker = data;
+
+    if (waker->timer) {
+        ww_timer_entry_destroy(waker->timer);
+    }
+
+    free(waker);
+}
+
+static void
+waker_sleep_timer_destroy(void *data) {
+    struct waker_sleep *waker = data;
+
+    // This function is called if the timer entry is destroyed (which should only happen if the
+    // global timer manager is destroyed.)
+    //
+    // Remove the reference to the timer entry so that when the VM attempts to destroy the waker
+    // we do not attempt to destroy the timer entry a 2nd time.
+    waker->timer = nullptr;
+}
+
+static void
+waker_sleep_timer_fire(void *data) {
+    struct waker_sleep *waker = data;
+
+    config_vm_resume(waker->vm);
+}
+
+static inline bool
+anchor_is_absolute(const struct scene_anchor *anchor) {
+    return anchor->target == SCENE_ANCHOR_SCREEN && anchor->position == SCENE_ANCHOR_TOPLEFT;
+}
+
+static int
+unmarshal_anchor(lua_State *L, struct scene_anchor *out) {
+    static const char *positions[] = {
+        [SCENE_ANCHOR_TOPLEFT] = "topleft",
+        [SCENE_ANCHOR_TOP] = "top",
+        [SCENE_ANCHOR_TOPRIGHT] = "topright",
+        [SCENE_ANCHOR_LEFT] = "left",
+        [SCENE_ANCHOR_CENTER] = "center",
+        [SCENE_ANCHOR_RIGHT] = "right",
+        [SCENE_ANCHOR_BOTTOMLEFT] = "bottomleft",
+        [SCENE_ANCHOR_BOTTOM] = "bottom",
+        [SCENE_ANCHOR_BOTTOMRIGHT] = "bottomright",
+    };
+    static const char *targets[] = {
+        [SCENE_ANCHOR_SCREEN] = "screen",
+        [SCENE_ANCHOR_GAME] = "game",
+    };
+
+    int top = lua_gettop(L);
+
+    lua_pushstring(L, "anchor"); // stack: n+1
+    lua_rawget(L, -2);           // stack: n+1
+
+    // The anchor can either be given as a position on the screen (e.g. "topright") or as a table
+    // containing a position and a target (e.g. {position = "right", target = "game"}).
+    const char *position = nullptr, *target = "screen";
+    switch (lua_type(L, -1)) {
+    case LUA_TNIL:
+        lua_settop(L, top); // stack: n
+        *out = (struct scene_anchor){};
+        return 0;
+    case LUA_TSTRING:
+        position = lua_tostring(L, -1);
+        break;
+    case LUA_TTABLE:
+        lua_getfield(L, -1, "position"); // stack: n+2
+        lua_getfield(L, -2, "target");   // stack: n+3
+        position = lua_isnil(L, -2) ? "topleft" : lua_tostring(L, -2);
+        target = lua_isnil(L, -1) ? target : lua_tostring(L, -1);
+        if (!position || !target) {
+            return luaL_error(L, "expected 'anchor.position' and 'anchor.target' to be strings");
+        }
+        break;
+    default:
+        return luaL_error(L, "expected 'anchor' to be a string or table, got '%s'",
+                          luaL_typename(L, -1));
+    }
+
+    bool found = false;
+    for (size_t i = 0; i < STATIC_ARRLEN(positions); i++) {
+        if (strcmp(position, positions[i]) == 0) {
+            out->position = i;
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        return luaL_error(L, "unknown anchor position '%s'", position);
+    }
+
+    found = false;
+    for (size_t i = 0; i < STATIC_ARRLEN(targets); i++) {
+        if (strcmp(target, targets[i]) == 0) {
+            out->target = i;
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        return luaL_error(L, "unknown anchor target '%s'", target);
+    }
+
+    lua_settop(L, top); // stack: n
+    return 0;
+}
+
+static int
+unmarshal_text_effect(lua_State *L, const char *key, bool *enabled, float rgba[static 4]) {
+    lua_pushstring(L, key); // stack: n+1
+    lua_rawget(L, -2);      // stack: n+1
+
+    // Text effects can be enabled with a boolean (using the default color) or with a color.
+    switch (lua_type(L, -1)) {
+    case LUA_TNIL:
+        break;
+    case LUA_TBOOLEAN:
+        *enabled = lua_toboolean(L, -1);
+        break;
+    case LUA_TSTRING: {
+        const char *raw = lua_tostring(L, -1);
+
+        uint8_t u8_rgba[4] = {};
+        if (config_parse_hex(u8_rgba, raw) != 0) {
+            return luaL_error(L, "expected '%s' to be a valid hex color ('%s')", key, raw);
+        }
+        for (size_t i = 0; i < 4; i++) {
+            rgba[i] = (float)u8_rgba[i] / UINT8_MAX;
+        }
+
+        *enabled = true;
+        break;
+    }
+    default:
+        return luaL_error(L, "expected '%s' to be a boolean or string, got '%s'", key,
+                          luaL_typename(L, -1));
+    }
+
+    lua_pop(L, 1); // stack: n
+    return 0;
+}
+
+static int
+unmarshal_text_run(lua_State *L, struct scene_text_run *run) {
+    // The run's text is left on the stack (stack: n+1) so that it can be concatenated with the
+    // text of the other runs.
+    if (lua_type(L, -1) == LUA_TSTRING) {
+        run->length = lua_objlen(L, -1);
+        return 0;
+    }
+    if (lua_type(L, -1) != LUA_TTABLE) {
+        return luaL_error(L, "expected text run to be a string or table, got '%s'",
+                          luaL_typename(L, -1));
+    }
+
+    lua_pushstring(L, "color"); // stack: n+2
+    lua_rawget(L, -2);          // stack: n+2
+    bool has_color = !lua_isnil(L, -1);
+    lua_pop(L, 1); // stack: n+1
+    if (has_color) {
+        unmarshal_color(L, "color", run->rgba);
+    }
+
+    lua_pushstring(L, "size"); // stack: n+2
+    lua_rawget(L, -2);         // stack: n+2
+    if (lua_type(L, -1) == LUA_TNUMBER) {
+        run->size_multiplier = lua_tointeger(L, -1);
+        if (run->size_multiplier <= 0) {
+            return luaL_error(L, "expected text run 'size' to be positive, got %d",
+                              (int)run->size_multiplier);
+        }
+    } else if (!lua_isnil(L, -1)) {
+        return luaL_error(L, "expected text run 'size' to be a number, got '%s'",
+                          luaL_typename(L, -1));
+    }
+    lua_pop(L, 1); // stack: n+1
+
+    unmarshal_text_effect(L, "shadow", &run->shadow, run->shadow_rgba);
+    unmarshal_text_effect(L, "outline", &run->outline, run->outline_rgba);
+
+    lua_rawgeti(L, -1, 1); // stack: n+2
+    if (lua_type(L, -1) != LUA_TSTRING) {
+        return luaL_error(L, "expected text run to contain a string, got '%s'",
+                          luaL_typename(L, -1));
+    }
+    run->length = lua_objlen(L, -1);
+
+    lua_replace(L, -2); // stack: n+1
+    return 0;
+}
+
+static int
+unmarshal_visible_at(lua_State *L, struct scene_visible_at *out) {
+    lua_pushstring(L, "visible_at"); // stack: n+1
+    lua_rawget(L, -2);               // stack: n+1
+
+    *out = (struct scene_visible_at){};
+    switch (lua_type(L, -1)) {
+    case LUA_TNIL:
+        break;
+    case LUA_TTABLE:
+        lua_getfield(L, -1, "w"); // stack: n+2
+        lua_getfield(L, -2, "h"); // stack: n+3
+        if (lua_type(L, -2) != LUA_TNUMBER || lua_type(L, -1) != LUA_TNUMBER) {
+            return luaL_error(L, "expected 'visible_at.w' and 'visible_at.h' to be numbers");
+        }
+
+        out->width = lua_tointeger(L, -2);
+        out->height = lua_tointeger(L, -1);
+        out->enabled = true;
+        if (out->width < 0 || out->height < 0 || (out->width == 0) != (out->height == 0)) {
+            return luaL_error(L, "invalid 'visible_at' resolution %dx%d", (int)out->width,
+                              (int)out->height);
+        }
+
+        lua_pop(L, 2); // stack: n+1
+        break;
+    default:
+        return luaL_error(L, "expected 'visible_at' to be a table, got '%s'",
+                          luaL_typename(L, -1));
     }
-    *text = nullptr;
 
+    lua_pop(L, 1); // stack: n
     return 0;
 }
 
-static void
-waker_sleep_vm_destroy(struct config_vm_waker *vm_waker, void *data) {
-    struct waker_sleep *waker = data;
-
-    if (waker->timer) {
-        ww_timer_entry_destroy(waker->timer);
-    }
-
-    free(waker);
-}
+static int
+unmarshal_projection(lua_State *L, struct scene_projection *out) {
+    lua_pushstring(L, "projector"); // stack: n+1
+    lua_rawget(L, -2);              // stack: n+1
 
-static void
-waker_sleep_timer_destroy(void *data) {
-    struct waker_sleep *waker = data;
+    *out = (struct scene_projection){};
+    switch (lua_type(L, -1)) {
+    case LUA_TNIL:
+        break;
+    case LUA_TTABLE: {
+        // The width and height may be omitted, in which case the object keeps its own size.
+        const struct {
+            const char *key;
+            int32_t *out;
+            bool required;
+        } pairs[] = {
+            {"x", &out->dst.x, true},
+            {"y", &out->dst.y, true},
+            {"w", &out->dst.width, false},
+            {"h", &out->dst.height, false},
+        };
+
+        for (size_t i = 0; i < STATIC_ARRLEN(pairs); i++) {
+            lua_getfield(L, -1, pairs[i].key); // stack: n+2
+
+            if (lua_type(L, -1) == LUA_TNUMBER) {
+                *pairs[i].out = lua_tointeger(L, -1);
+            } else if (pairs[i].required || !lua_isnil(L, -1)) {
+                return luaL_error(L, "expected 'projector.%s' to be a number, got '%s'",
+                                  pairs[i].key, luaL_typename(L, -1));
+            }
+            if (*pairs[i].out < 0) {
+                return luaL_error(L, "expected 'projector.%s' to be positive", pairs[i].key);
+            }
 
-    // This function is called if the timer entry is destroyed (which should only happen if the
-    // global timer manager is destroyed.)
-    //
-    // Remove the reference to the timer entry so that when the VM attempts to destroy the waker
-    // we do not attempt to destroy the timer entry a 2nd time.
-    waker->timer = nullptr;
-}
+            lua_pop(L, 1); // stack: n+1
+        }
 
-static void
-waker_sleep_timer_fire(void *data) {
-    struct waker_sleep *waker = data;
+        out->enabled = true;
+        break;
+    }
+    default:
+        return luaL_error(L, "expected 'projector' to be a table, got '%s'", luaL_typename(L, -1));
+    }
 
-    config_vm_resume(waker->vm);
+    lua_pop(L, 1); // stack: n
+    return 0;
 }
 
 static int
-unmarshal_box(lua_State *L, struct box *out) {
+unmarshal_box(lua_State *L, struct box *out, bool relative) {
+    // Relative boxes (i.e. those positioned from an anchor) may have negative X and Y coordinates.
     const struct {
         const char *key;
         int32_t *out;
+        bool allow_negative;
     } pairs[] = {
-        {"x", &out->x},
-        {"y", &out->y},
-        {"w", &out->width},
-        {"h", &out->height},
+        {"x", &out->x, relative},
+        {"y", &out->y, relative},
+        {"w", &out->width, false},
+        {"h", &out->height, false},
     };
 
     for (size_t i = 0; i < STATIC_ARRLEN(pairs); i++) {
@@ -286,7 +1182,7 @@ unmarshal_box(lua_State *L, struct box *out) {
         }
 
         int x = lua_tointeger(L, -1);
-        if (x < 0) {
+        if (x < 0 && !pairs[i].allow_negative) {
             return luaL_error(L, "expected '%s' to be positive", pairs[i].key);
         }
 
@@ -298,7 +1194,7 @@ unmarshal_box(lua_State *L, struct box *out) {
 }
 
 static int
-unmarshal_box_key(lua_State *L, const char *key, struct box *out) {
+unmarshal_box_key(lua_State *L, const char *key, struct box *out, bool relative) {
     lua_pushstring(L, key); // stack: n+1
     lua_rawget(L, -2);      // stack: n+1
 
@@ -306,7 +1202,7 @@ unmarshal_box_key(lua_State *L, const char *key, struct box *out) {
         return luaL_error(L, "expected '%s' to be a table, got '%s'", key, luaL_typename(L, -1));
     }
 
-    unmarshal_box(L, out);
+    unmarshal_box(L, out, relative);
 
     lua_pop(L, 1); // stack: n
 
@@ -354,6 +1250,107 @@ l_active_res(lua_State *L) {
     return 2;
 }
 
+static int
+l_batch(lua_State *L) {
+    static constexpr int ARG_FUNC = 1;
+
+    // Prologue
+    struct config_vm *vm = config_vm_from(L);
+    struct wrap *wrap = config_vm_get_wrap(vm);
+    if (!wrap) {
+        return luaL_error(L, STARTUP_ERRMSG("batch"));
+    }
+
+    luaL_checktype(L, ARG_FUNC, LUA_TFUNCTION);
+    lua_settop(L, ARG_FUNC);
+
+    // Body. The function is called from C, so it cannot yield (e.g. with sleep) and no frames can
+    // be drawn until it has returned. Any error is rethrown after the batch has been closed.
+    scene_batch_begin(wrap->scene);
+    int ret = lua_pcall(L, 0, 0, 0);
+    scene_batch_end(wrap->scene);
+
+    if (ret != 0) {
+        return lua_error(L);
+    }
+
+    // Epilogue
+    return 0;
+}
+
+static int
+l_count_colors(lua_State *L) {
+    static constexpr int ARG_BOX = 1;
+    static constexpr int ARG_COLORS = 2;
+    static constexpr int ARG_TOLERANCE = 3;
+
+    // Prologue
+    struct config_vm *vm = config_vm_from(L);
+    struct wrap *wrap = config_vm_get_wrap(vm);
+    if (!wrap) {
+        return luaL_error(L, STARTUP_ERRMSG("count_colors"));
+    }
+
+    if (!config_vm_is_thread(L)) {
+        // This function can only be called from within a coroutine (i.e. a keybind handler.)
+        return luaL_error(L, "count_colors called from invalid execution context");
+    }
+
+    luaL_checktype(L, ARG_BOX, LUA_TTABLE);
+    luaL_checktype(L, ARG_COLORS, LUA_TTABLE);
+    int tolerance = luaL_optinteger(L, ARG_TOLERANCE, 0);
+    luaL_argcheck(L, tolerance >= 0 && tolerance <= UINT8_MAX, ARG_TOLERANCE,
+                  "tolerance must be between 0 and 255");
+
+    size_t num_colors = lua_objlen(L, ARG_COLORS);
+    luaL_argcheck(L, num_colors > 0, ARG_COLORS, "at least one color must be given");
+    luaL_argcheck(L, num_colors <= SCENE_COUNT_MAX_COLORS, ARG_COLORS, "too many colors");
+
+    float colors[SCENE_COUNT_MAX_COLORS][4] = {};
+    for (size_t i = 0; i < num_colors; i++) {
+        lua_rawgeti(L, ARG_COLORS, i + 1); // stack: 4
+
+        if (lua_type(L, -1) != LUA_TSTRING) {
+            return luaL_error(L, "expected color %d to be a string", (int)i + 1);
+        }
+        const char *raw = lua_tostring(L, -1);
+
+        uint8_t u8_rgba[4] = {};
+        if (config_parse_hex(u8_rgba, raw) != 0) {
+            return luaL_error(L, "expected a valid hex color, got '%s'", raw);
+        }
+        for (size_t j = 0; j < 4; j++) {
+            colors[i][j] = (float)u8_rgba[j] / UINT8_MAX;
+        }
+
+        lua_pop(L, 1); // stack: 3
+    }
+
+    lua_settop(L, ARG_BOX);
+
+    struct box box = {};
+    unmarshal_box(L, &box, false);
+
+    luaL_argcheck(L, box.width > 0 && box.height > 0, ARG_BOX, "box must not be empty");
+    luaL_argcheck(L, box.width <= SCENE_COUNT_MAX_SIZE && box.height <= SCENE_COUNT_MAX_SIZE,
+                  ARG_BOX, "box is too large");
+
+    // Body. The coroutine is resumed once the counts are available.
+    struct waker_readback *waker = zalloc(1, sizeof(*waker));
+    waker->readback =
+        scene_count_colors(wrap->scene, &box, colors, num_colors, tolerance,
+                           waker_count_colors_done, waker_readback_destroy, waker);
+    if (!waker->readback) {
+        free(waker);
+        return luaL_error(L, "failed to prepare color count");
+    }
+
+    waker->vm = config_vm_create_waker(L, waker_readback_vm_destroy, waker);
+
+    // Epilogue
+    return lua_yield(L, 0);
+}
+
 static int
 l_current_time(lua_State *L) {
     // Body
@@ -404,6 +1401,83 @@ l_floating_shown(lua_State *L) {
     return 1;
 }
 
+static int
+l_gpu_timings(lua_State *L) {
+    static constexpr int IDX_BUFFER = 1;
+    static constexpr int IDX_TIMINGS = 2;
+    static constexpr int IDX_SHADERS = 3;
+    static constexpr int IDX_OBJECTS = 3;
+    static constexpr int IDX_OBJECT = 4;
+
+    // Prologue
+    struct config_vm *vm = config_vm_from(L);
+    struct wrap *wrap = config_vm_get_wrap(vm);
+    if (!wrap) {
+        return luaL_error(L, STARTUP_ERRMSG("gpu_timings"));
+    }
+
+    lua_settop(L, 0);
+
+    // Body. GPU timing is only enabled once it has been asked for, since it has a small cost.
+    if (!scene_enable_profiling(wrap->scene)) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    size_t num_shaders = scene_get_shader_timings(wrap->scene, nullptr, 0);
+    size_t num_objects = scene_get_object_timings(wrap->scene, nullptr, 0);
+    size_t max = num_shaders > num_objects ? num_shaders : num_objects;
+
+    // The buffer is kept on the stack so that it is not collected while in use.
+    struct scene_timing *timings =
+        lua_newuserdata(L, max * sizeof(*timings) + 1); // stack: IDX_BUFFER
+
+    lua_newtable(L); // stack: IDX_TIMINGS
+
+    lua_newtable(L); // stack: IDX_SHADERS
+    scene_get_shader_timings(wrap->scene, timings, num_shaders);
+    for (size_t i = 0; i < num_shaders; i++) {
+        lua_pushnumber(L, timings[i].ms);                // stack: IDX_SHADERS + 1
+        lua_setfield(L, IDX_SHADERS, timings[i].shader); // stack: IDX_SHADERS
+    }
+    lua_setfield(L, IDX_TIMINGS, "shaders"); // stack: IDX_TIMINGS
+
+    lua_createtable(L, num_objects, 0); // stack: IDX_OBJECTS
+    scene_get_object_timings(wrap->scene, timings, num_objects);
+    for (size_t i = 0; i < num_objects; i++) {
+        lua_createtable(L, 0, 7); // stack: IDX_OBJECT
+
+        lua_pushstring(L, timings[i].type);  // stack: IDX_OBJECT + 1
+        lua_setfield(L, IDX_OBJECT, "type"); // stack: IDX_OBJECT
+
+        lua_pushstring(L, timings[i].shader);  // stack: IDX_OBJECT + 1
+        lua_setfield(L, IDX_OBJECT, "shader"); // stack: IDX_OBJECT
+
+        lua_pushinteger(L, timings[i].bounds.x); // stack: IDX_OBJECT + 1
+        lua_setfield(L, IDX_OBJECT, "x");        // stack: IDX_OBJECT
+
+        lua_pushinteger(L, timings[i].bounds.y); // stack: IDX_OBJECT + 1
+        lua_setfield(L, IDX_OBJECT, "y");        // stack: IDX_OBJECT
+
+        lua_pushinteger(L, timings[i].bounds.width); // stack: IDX_OBJECT + 1
+        lua_setfield(L, IDX_OBJECT, "w");            // stack: IDX_OBJECT
+
+        lua_pushinteger(L, timings[i].bounds.height); // stack: IDX_OBJECT + 1
+        lua_setfield(L, IDX_OBJECT, "h");             // stack: IDX_OBJECT
+
+        lua_pushnumber(L, timings[i].ms);    // stack: IDX_OBJECT + 1
+        lua_setfield(L, IDX_OBJECT, "time"); // stack: IDX_OBJECT
+
+        lua_rawseti(L, IDX_OBJECTS, i + 1); // stack: IDX_OBJECTS
+    }
+    lua_setfield(L, IDX_TIMINGS, "objects"); // stack: IDX_TIMINGS
+
+    // Epilogue
+    lua_remove(L, IDX_BUFFER); // stack: IDX_TIMINGS - 1
+    ww_assert(lua_gettop(L) == IDX_TIMINGS - 1);
+    return 1;
+}
+
 static int
 l_image(lua_State *L) {
     static constexpr int ARG_PATH = 1;
@@ -421,7 +1495,10 @@ l_image(lua_State *L) {
     lua_settop(L, ARG_OPTIONS);
 
     struct scene_image_options options = {};
-    unmarshal_box_key(L, "dst", &options.dst);
+    unmarshal_anchor(L, &options.anchor);
+    unmarshal_visible_at(L, &options.visible_at);
+    unmarshal_projection(L, &options.projector);
+    unmarshal_box_key(L, "dst", &options.dst, !anchor_is_absolute(&options.anchor));
 
     lua_pushstring(L, "shader");
     lua_rawget(L, ARG_OPTIONS);
@@ -472,8 +1549,11 @@ l_mirror(lua_State *L) {
 
     struct scene_mirror_options options = {};
 
-    unmarshal_box_key(L, "src", &options.src);
-    unmarshal_box_key(L, "dst", &options.dst);
+    unmarshal_anchor(L, &options.anchor);
+    unmarshal_visible_at(L, &options.visible_at);
+    unmarshal_projection(L, &options.projector);
+    unmarshal_box_key(L, "src", &options.src, false);
+    unmarshal_box_key(L, "dst", &options.dst, !anchor_is_absolute(&options.anchor));
 
     lua_pushstring(L, "shader");
     lua_rawget(L, ARG_OPTIONS);
@@ -607,6 +1687,167 @@ l_profile(lua_State *L) {
     return 1;
 }
 
+static int
+l_read_pixels(lua_State *L) {
+    static constexpr int ARG_BOX = 1;
+
+    // Prologue
+    struct config_vm *vm = config_vm_from(L);
+    struct wrap *wrap = config_vm_get_wrap(vm);
+    if (!wrap) {
+        return luaL_error(L, STARTUP_ERRMSG("read_pixels"));
+    }
+
+    if (!config_vm_is_thread(L)) {
+        // This function can only be called from within a coroutine (i.e. a keybind handler.)
+        return luaL_error(L, "read_pixels called from invalid execution context");
+    }
+
+    luaL_checktype(L, ARG_BOX, LUA_TTABLE);
+    lua_settop(L, ARG_BOX);
+
+    struct box box = {};
+    unmarshal_box(L, &box, false);
+
+    luaL_argcheck(L, box.width > 0 && box.height > 0, ARG_BOX, "box must not be empty");
+    luaL_argcheck(L, (int64_t)box.width * box.height <= SCENE_READBACK_MAX_PIXELS, ARG_BOX,
+                  "box is too large");
+
+    // Body. The coroutine is resumed once the pixel data is available.
+    struct waker_readback *waker = zalloc(1, sizeof(*waker));
+    waker->readback = scene_read_pixels(wrap->scene, &box, waker_read_pixels_done,
+                                        waker_readback_destroy, waker);
+    if (!waker->readback) {
+        free(waker);
+        return luaL_error(L, "failed to prepare readback");
+    }
+
+    waker->vm = config_vm_create_waker(L, waker_readback_vm_destroy, waker);
+
+    // Epilogue
+    return lua_yield(L, 0);
+}
+
+static int
+l_read_text(lua_State *L) {
+    static constexpr int ARG_BOX = 1;
+    static constexpr int ARG_OPTIONS = 2;
+
+    // Prologue
+    struct config_vm *vm = config_vm_from(L);
+    struct wrap *wrap = config_vm_get_wrap(vm);
+    if (!wrap) {
+        return luaL_error(L, STARTUP_ERRMSG("read_text"));
+    }
+
+    if (!config_vm_is_thread(L)) {
+        // This function can only be called from within a coroutine (i.e. a keybind handler.)
+        return luaL_error(L, "read_text called from invalid execution context");
+    }
+
+    luaL_checktype(L, ARG_BOX, LUA_TTABLE);
+    luaL_checktype(L, ARG_OPTIONS, LUA_TTABLE);
+
+    // Text on the F3 screen is drawn in a light gray.
+    struct util_glyph_options glyph = {
+        .rgb = {0xE0, 0xE0, 0xE0},
+        .tolerance = 0,
+        .scale = 1,
+    };
+
+    lua_getfield(L, ARG_OPTIONS, "color"); // stack: 3
+    if (!lua_isnil(L, -1)) {
+        const char *raw = lua_tostring(L, -1);
+        uint8_t u8_rgba[4] = {};
+        if (!raw || config_parse_hex(u8_rgba, raw) != 0) {
+            return luaL_error(L, "expected 'color' to be a valid hex color");
+        }
+        memcpy(glyph.rgb, u8_rgba, sizeof(glyph.rgb));
+    }
+    lua_pop(L, 1); // stack: 2
+
+    lua_getfield(L, ARG_OPTIONS, "tolerance"); // stack: 3
+    int tolerance = luaL_optinteger(L, -1, 0);
+    if (tolerance < 0 || tolerance > UINT8_MAX) {
+        return luaL_error(L, "expected 'tolerance' to be between 0 and 255");
+    }
+    glyph.tolerance = tolerance;
+    lua_pop(L, 1); // stack: 2
+
+    lua_getfield(L, ARG_OPTIONS, "scale"); // stack: 3
+    glyph.scale = luaL_optinteger(L, -1, 1);
+    if (glyph.scale <= 0) {
+        return luaL_error(L, "expected 'scale' to be a positive integer");
+    }
+    lua_pop(L, 1); // stack: 2
+
+    lua_settop(L, ARG_BOX);
+
+    struct box box = {};
+    unmarshal_box(L, &box, false);
+
+    luaL_argcheck(L, box.width > 0 && box.height > 0, ARG_BOX, "box must not be empty");
+    luaL_argcheck(L, (int64_t)box.width * box.height <= SCENE_READBACK_MAX_PIXELS, ARG_BOX,
+                  "box is too large");
+
+    // Body. The coroutine is resumed once the text has been read.
+    struct waker_readback *waker = zalloc(1, sizeof(*waker));
+    waker->glyph = glyph;
+    waker->readback = scene_read_pixels(wrap->scene, &box, waker_read_text_done,
+                                        waker_readback_destroy, waker);
+    if (!waker->readback) {
+        free(waker);
+        return luaL_error(L, "failed to prepare readback");
+    }
+
+    waker->vm = config_vm_create_waker(L, waker_readback_vm_destroy, waker);
+
+    // Epilogue
+    return lua_yield(L, 0);
+}
+
+static int
+l_screenshot(lua_State *L) {
+    static constexpr int ARG_PATH = 1;
+    static constexpr int ARG_OPTIONS = 2;
+
+    // Prologue
+    struct config_vm *vm = config_vm_from(L);
+    struct wrap *wrap = config_vm_get_wrap(vm);
+    if (!wrap) {
+        return luaL_error(L, STARTUP_ERRMSG("screenshot"));
+    }
+
+    if (!config_vm_is_thread(L)) {
+        // This function can only be called from within a coroutine (i.e. a keybind handler.)
+        return luaL_error(L, "screenshot called from invalid execution context");
+    }
+
+    const char *path = luaL_checkstring(L, ARG_PATH);
+    luaL_checktype(L, ARG_OPTIONS, LUA_TTABLE);
+
+    lua_getfield(L, ARG_OPTIONS, "overlay"); // stack: 3
+    bool overlay = lua_toboolean(L, -1);
+    lua_pop(L, 1); // stack: 2
+
+    // Body. The coroutine is resumed once the screenshot has been written to disk.
+    struct waker_screenshot *waker = zalloc(1, sizeof(*waker));
+    waker->wrap = wrap;
+    waker->path = ww_strdup(path);
+    waker->readback = scene_screenshot(wrap->scene, overlay, waker_screenshot_captured,
+                                       waker_screenshot_readback_destroy, waker);
+    if (!waker->readback) {
+        free(waker->path);
+        free(waker);
+        return luaL_error(L, "failed to prepare screenshot");
+    }
+
+    waker->vm = config_vm_create_waker(L, waker_screenshot_vm_destroy, waker);
+
+    // Epilogue
+    return lua_yield(L, 0);
+}
+
 static int
 l_set_keymap(lua_State *L) {
     static constexpr int ARG_KEYMAP = 1;
@@ -773,6 +2014,7 @@ static int
 l_set_resolution(lua_State *L) {
     static constexpr int ARG_WIDTH = 1;
     static constexpr int ARG_HEIGHT = 2;
+    static constexpr int ARG_SCALE = 3;
 
     // Prologue
     struct config_vm *vm = config_vm_from(L);
@@ -783,14 +2025,17 @@ l_set_resolution(lua_State *L) {
 
     int32_t width = luaL_checkint(L, ARG_WIDTH);
     int32_t height = luaL_checkint(L, ARG_HEIGHT);
+    double scale = luaL_optnumber(L, ARG_SCALE, 0);
 
     luaL_argcheck(L, width >= 0, ARG_WIDTH, "width must be non-negative");
     luaL_argcheck(L, height >= 0, ARG_HEIGHT, "height must be non-negative");
+    luaL_argcheck(L, scale == 0 || (scale >= 0.1 && scale <= 1), ARG_SCALE,
+                  "scale must be between 0.1 and 1");
 
-    lua_settop(L, ARG_HEIGHT);
+    lua_settop(L, ARG_SCALE);
 
     // Body
-    bool ok = wrap_lua_set_res(wrap, width, height) == 0;
+    bool ok = wrap_lua_set_res(wrap, width, height, scale) == 0;
     if (!ok) {
         return luaL_error(L, "cannot set resolution");
     }
@@ -970,12 +2215,6 @@ l_state(lua_State *L) {
         return luaL_error(L, "no state output");
     }
 
-    static const char *screen_names[] = {
-        [SCREEN_TITLE] = "title",           [SCREEN_WAITING] = "waiting",
-        [SCREEN_GENERATING] = "generating", [SCREEN_PREVIEWING] = "previewing",
-        [SCREEN_INWORLD] = "inworld",       [SCREEN_WALL] = "wall",
-    };
-
     static const char *inworld_names[] = {
         [INWORLD_UNPAUSED] = "unpaused",
         [INWORLD_PAUSED] = "paused",
@@ -1062,7 +2301,12 @@ l_text_legacy(lua_State *L, struct wrap *wrap) {
     luaL_getmetatable(L, METATABLE_TEXT);
     lua_setmetatable(L, -2);
 
-    *text = scene_add_text(wrap->scene, data, &options);
+    if (live) {
+        *text = scene_add_live_text(wrap->scene, &options, live_text_source, live_text_destroy,
+                                    live_text_create(wrap, data));
+    } else {
+        *text = scene_add_text(wrap->scene, data, &options);
+    }
     free(options.shader_name);
     if (!*text) {
         return luaL_error(L, "failed to create text");
@@ -1084,14 +2328,18 @@ l_text(lua_State *L) {
         return luaL_error(L, STARTUP_ERRMSG("text"));
     }
 
-    const char *data = luaL_checkstring(L, ARG_TEXT);
-
     if (!lua_istable(L, ARG_OPTIONS)) {
         return l_text_legacy(L, wrap);
     }
+    if (lua_type(L, ARG_TEXT) != LUA_TTABLE) {
+        luaL_checkstring(L, ARG_TEXT);
+    }
     lua_settop(L, ARG_OPTIONS);
 
     struct scene_text_options options = {};
+    unmarshal_anchor(L, &options.anchor);
+    unmarshal_visible_at(L, &options.visible_at);
+    unmarshal_projection(L, &options.projector);
 
     lua_pushstring(L, "x");
     lua_rawget(L, ARG_OPTIONS);
@@ -1132,11 +2380,60 @@ l_text(lua_State *L) {
     lua_rawget(L, ARG_OPTIONS);
     if (lua_type(L, -1) == LUA_TNUMBER) {
         options.size_multiplier = lua_tointeger(L, -1);
+        if (options.size_multiplier <= 0) {
+            return luaL_error(L, "expected 'size' to be positive, got %d",
+                              (int)options.size_multiplier);
+        }
     } else {
         options.size_multiplier = 1;
     }
     lua_pop(L, 1);
 
+    // The text can either be a single string or a list of runs, each of which can have its own
+    // style. Either way, the options table provides the default style.
+    struct scene_text_run base_run = {
+        .rgba = {options.rgba[0], options.rgba[1], options.rgba[2], options.rgba[3]},
+        .size_multiplier = options.size_multiplier,
+        .shadow_rgba = {0.0, 0.0, 0.0, 1.0},
+        .outline_rgba = {0.0, 0.0, 0.0, 1.0},
+    };
+    unmarshal_text_effect(L, "shadow", &base_run.shadow, base_run.shadow_rgba);
+    unmarshal_text_effect(L, "outline", &base_run.outline, base_run.outline_rgba);
+
+    size_t num_runs = (lua_type(L, ARG_TEXT) == LUA_TTABLE) ? lua_objlen(L, ARG_TEXT) : 1;
+    luaL_argcheck(L, num_runs > 0, ARG_TEXT, "at least one text run must be given");
+
+    struct scene_text_run *runs = lua_newuserdata(L, sizeof(*runs) * num_runs); // stack: 3
+    check_alloc(runs);
+    luaL_checkstack(L, num_runs, "too many text runs");
+
+    for (size_t i = 0; i < num_runs; i++) {
+        runs[i] = base_run;
+
+        if (lua_type(L, ARG_TEXT) == LUA_TTABLE) {
+            lua_rawgeti(L, ARG_TEXT, i + 1); // stack: 4+i
+        } else {
+            lua_pushvalue(L, ARG_TEXT); // stack: 4+i
+        }
+        unmarshal_text_run(L, &runs[i]);
+    }
+    lua_concat(L, num_runs); // stack: 4
+
+    const char *data = lua_tostring(L, -1);
+    options.runs = runs;
+    options.num_runs = num_runs;
+
+    // Live text treats its text as a format string, which is filled in by waywall every frame.
+    lua_pushstring(L, "live");  // stack: 5
+    lua_rawget(L, ARG_OPTIONS); // stack: 5
+    bool live = lua_toboolean(L, -1);
+    lua_pop(L, 1); // stack: 4
+    if (live) {
+        luaL_argcheck(L, lua_type(L, ARG_TEXT) == LUA_TSTRING, ARG_TEXT,
+                      "live text must be a string");
+        unmarshal_live_format(L, data);
+    }
+
     lua_pushstring(L, "shader");
     lua_rawget(L, ARG_OPTIONS);
     if (lua_type(L, -1) == LUA_TSTRING) {
@@ -1249,17 +2546,68 @@ l_toggle_fullscreen(lua_State *L) {
     return 0;
 }
 
+static int
+l_watch_region(lua_State *L) {
+    static constexpr int ARG_BOX = 1;
+    static constexpr int ARG_THRESHOLD = 2;
+
+    // Prologue
+    struct config_vm *vm = config_vm_from(L);
+    struct wrap *wrap = config_vm_get_wrap(vm);
+    if (!wrap) {
+        return luaL_error(L, STARTUP_ERRMSG("watch_region"));
+    }
+
+    luaL_checktype(L, ARG_BOX, LUA_TTABLE);
+    double threshold = luaL_optnumber(L, ARG_THRESHOLD, 0.0);
+    luaL_argcheck(L, threshold >= 0 && threshold < 1, ARG_THRESHOLD,
+                  "threshold must be between 0 and 1");
+
+    lua_settop(L, ARG_BOX);
+
+    struct box box = {};
+    unmarshal_box(L, &box, false);
+
+    luaL_argcheck(L, box.width > 0 && box.height > 0, ARG_BOX, "box must not be empty");
+    luaL_argcheck(L, box.width <= SCENE_WATCH_MAX_SIZE && box.height <= SCENE_WATCH_MAX_SIZE,
+                  ARG_BOX, "box is too large");
+
+    // Body
+    struct watch_region *region = lua_newuserdata(L, sizeof(*region)); // stack: 2
+    check_alloc(region);
+    region->vm = vm;
+
+    luaL_getmetatable(L, METATABLE_WATCH); // stack: 3
+    lua_setmetatable(L, -2);               // stack: 2
+
+    region->watch = scene_watch_region(wrap->scene, &box, threshold, watch_region_changed,
+                                       watch_region_destroy, region);
+    if (!region->watch) {
+        return luaL_error(L, "failed to create region watch");
+    }
+
+    // Epilogue
+    lua_pushlightuserdata(L, region); // stack: 3
+    return 2;
+}
+
 static const struct luaL_Reg lua_lib[] = {
     // public (see api.lua)
     {"active_res", l_active_res},
+    {"batch", l_batch},
+    {"count_colors", l_count_colors},
     {"current_time", l_current_time},
     {"exec", l_exec},
     {"floating_shown", l_floating_shown},
+    {"gpu_timings", l_gpu_timings},
     {"image", l_image},
     {"mirror", l_mirror},
     {"press_key", l_press_key},
     {"get_key", l_get_key},
     {"profile", l_profile},
+    {"read_pixels", l_read_pixels},
+    {"read_text", l_read_text},
+    {"screenshot", l_screenshot},
     {"set_keymap", l_set_keymap},
     {"set_remaps", l_set_remaps},
     {"set_resolution", l_set_resolution},
@@ -1269,6 +2617,7 @@ static const struct luaL_Reg lua_lib[] = {
     {"state", l_state},
     {"text", l_text},
     {"toggle_fullscreen", l_toggle_fullscreen},
+    {"watch_region", l_watch_region},
 
     // private (see init.lua)
     {"log", l_log},
@@ -1313,6 +2662,16 @@ config_api_init(struct config_vm *vm) {
     lua_settable(vm->L, -3);                  // stack: n+1
     lua_pop(vm->L, 1);                        // stack: n
 
+    // Create the metatable for "watch" objects.
+    luaL_newmetatable(vm->L, METATABLE_WATCH); // stack: n+1
+    lua_pushstring(vm->L, "__gc");             // stack: n+2
+    lua_pushcfunction(vm->L, watch_gc);        // stack: n+3
+    lua_settable(vm->L, -3);                   // stack: n+1
+    lua_pushstring(vm->L, "__index");          // stack: n+2
+    lua_pushcfunction(vm->L, watch_index);     // stack: n+3
+    lua_settable(vm->L, -3);                   // stack: n+1
+    lua_pop(vm->L, 1);                         // stack: n
+
     for (size_t i = 0; i < STATIC_ARRLEN(EMBEDDED_LUA); i++) {
         if (config_vm_exec_bcode(vm, EMBEDDED_LUA[i].data, EMBEDDED_LUA[i].size,
                                  EMBEDDED_LUA[i].name) != 0) {
@@ -27,11 +27,15 @@ static const struct config defaults = {
             .debug = false,
             .jit = false,
             .tearing = false,
+            .texture_budget = 0,
         },
     .window =
         {
             .fullscreen_width = 0,
             .fullscreen_height = 0,
+            .render_scale = 1.0,
+            .projector_width = 0,
+            .projector_height = 0,
         },
     .input =
         {
@@ -514,6 +518,16 @@ process_config_experimental(struct config *cfg) {
         return 1;
     }
 
+    if (get_int(cfg, "texture_budget", &cfg->experimental.texture_budget,
+                "experimental.texture_budget", false) != 0) {
+        return 1;
+    }
+    if (cfg->experimental.texture_budget < 0) {
+        ww_log(LOG_ERROR,
+               "'experimental.texture_budget' must be a non-negative integer (0 = unlimited)");
+        return 1;
+    }
+
     return 0;
 }
 
@@ -600,6 +614,30 @@ process_config_window(struct config *cfg) {
         return 1;
     }
 
+    if (get_double(cfg, "render_scale", &cfg->window.render_scale, "window.render_scale", false) !=
+        0) {
+        return 1;
+    }
+    if (cfg->window.render_scale < 0.1 || cfg->window.render_scale > 1) {
+        ww_log(LOG_ERROR, "'window.render_scale' must be between 0.1 and 1");
+        return 1;
+    }
+
+    if (get_int(cfg, "projector_width", &cfg->window.projector_width, "window.projector_width",
+                false) != 0) {
+        return 1;
+    }
+    if (get_int(cfg, "projector_height", &cfg->window.projector_height,
+                "window.projector_height", false) != 0) {
+        return 1;
+    }
+    if (cfg->window.projector_width < 0 || cfg->window.projector_height < 0 ||
+        (cfg->window.projector_width == 0) != (cfg->window.projector_height == 0)) {
+        ww_log(LOG_ERROR, "'window.projector_width' and 'window.projector_height' must both be "
+                          "positive integers, or both be 0 (no projector)");
+        return 1;
+    }
+
     return 0;
 }
 
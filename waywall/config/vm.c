@@ -306,11 +306,18 @@ config_vm_register_lib(struct config_vm *vm, const struct luaL_Reg *lib, const c
 
 void
 config_vm_resume(struct config_vm_waker *waker) {
-    // Clear the stack so that the coroutine resumes with no arguments.
+    config_vm_resume_with(waker, nullptr, nullptr);
+}
+
+void
+config_vm_resume_with(struct config_vm_waker *waker, config_vm_push_func_t push, void *data) {
+    // Clear the stack so that the coroutine resumes with only the values pushed by the caller,
+    // which become the return values of the function that yielded.
     lua_settop(waker->L, 0);
+    int nargs = push ? push(waker->L, data) : 0;
 
     lua_sethook(waker->L, on_debug_hook, LUA_MASKCOUNT, MAX_INSTRUCTIONS);
-    int ret = lua_resume(waker->L, 0);
+    int ret = lua_resume(waker->L, nargs);
     lua_sethook(waker->L, nullptr, 0, 0);
 
     switch (ret) {
@@ -333,6 +340,12 @@ config_vm_resume(struct config_vm_waker *waker) {
 
 void
 config_vm_signal_event(struct config_vm *vm, const char *name) {
+    config_vm_signal_event_with(vm, name, nullptr, nullptr);
+}
+
+void
+config_vm_signal_event_with(struct config_vm *vm, const char *name, config_vm_push_func_t push,
+                            void *data) {
     ssize_t stack_start = lua_gettop(vm->L);
 
     lua_pushlightuserdata(vm->L, (void *)&REG_KEYS.events); // stack: n+1
@@ -342,7 +355,9 @@ config_vm_signal_event(struct config_vm *vm, const char *name) {
     lua_rawget(vm->L, -2);       // stack: n+2
     ww_assert(lua_type(vm->L, -1) == LUA_TFUNCTION);
 
-    if (config_vm_pcall(vm, 0, 0, 0) != 0) {
+    int nargs = push ? push(vm->L, data) : 0; // stack: n+2+nargs
+
+    if (config_vm_pcall(vm, nargs, 0, 0) != 0) {
         ww_log(LOG_ERROR, "failed to signal event '%s': %s", name, lua_tostring(vm->L, -1));
         lua_pop(vm->L, 1); // stack: n+1
     }
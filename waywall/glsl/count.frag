@@ -0,0 +1,42 @@
+precision highp float;
+
+uniform sampler2D u_texture;
+uniform vec2 u_src_size;
+
+uniform vec4 u_box;
+uniform vec4 u_colors[4];
+uniform float u_tolerance;
+
+// Each output pixel counts the matches within a BLOCK*BLOCK area of the source texture. The count
+// for each color must fit within one 8-bit channel, so BLOCK*BLOCK must not exceed 255.
+const int BLOCK = 15;
+
+float matches(vec3 color, vec4 key) {
+    if (key.a == 0.0) {
+        return 0.0;
+    }
+    return all(lessThanEqual(abs(color - key.rgb), vec3(u_tolerance))) ? 1.0 : 0.0;
+}
+
+void main() {
+    vec2 origin = u_box.xy + floor(gl_FragCoord.xy) * float(BLOCK);
+    vec2 end = u_box.xy + u_box.zw;
+
+    vec4 count = vec4(0.0);
+    for (int y = 0; y < BLOCK; y++) {
+        for (int x = 0; x < BLOCK; x++) {
+            vec2 pos = origin + vec2(float(x), float(y));
+            if (any(greaterThanEqual(pos, end))) {
+                continue;
+            }
+
+            vec3 color = texture2D(u_texture, (pos + 0.5) / u_src_size).rgb;
+            count += vec4(matches(color, u_colors[0]), matches(color, u_colors[1]),
+                          matches(color, u_colors[2]), matches(color, u_colors[3]));
+        }
+    }
+
+    gl_FragColor = count / 255.0;
+}
+
+// vim:ft=glsl
@@ -0,0 +1,34 @@
+precision highp float;
+
+uniform sampler2D u_texture;
+uniform vec2 u_src_size;
+
+uniform vec4 u_box;
+uniform vec2 u_block;
+
+// Each output pixel is the average of a u_block-sized area of the source texture, which must not be
+// larger than MAX_BLOCK*MAX_BLOCK.
+const int MAX_BLOCK = 64;
+
+void main() {
+    vec2 origin = u_box.xy + floor(gl_FragCoord.xy) * u_block;
+    vec2 end = min(origin + u_block, u_box.xy + u_box.zw);
+
+    vec4 sum = vec4(0.0);
+    float count = 0.0;
+    for (int y = 0; y < MAX_BLOCK; y++) {
+        for (int x = 0; x < MAX_BLOCK; x++) {
+            vec2 pos = origin + vec2(float(x), float(y));
+            if (any(greaterThanEqual(pos, end))) {
+                continue;
+            }
+
+            sum += texture2D(u_texture, (pos + 0.5) / u_src_size);
+            count += 1.0;
+        }
+    }
+
+    gl_FragColor = sum / max(count, 1.0);
+}
+
+// vim:ft=glsl
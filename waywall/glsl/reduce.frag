@@ -0,0 +1,38 @@
+precision highp float;
+
+uniform sampler2D u_texture;
+
+uniform vec2 u_count_size;
+uniform vec2 u_offset;
+
+// Each pair of output pixels sums the counts within a BLOCK*BLOCK area of the output of count.frag.
+// The first pixel holds the sums of the first two colors and the second pixel holds the sums of
+// the last two, each encoded as a 16-bit value split across two channels.
+const int BLOCK = 15;
+
+void main() {
+    vec2 cell = floor(gl_FragCoord.xy - u_offset);
+    bool upper = mod(cell.x, 2.0) >= 1.0;
+    vec2 origin = vec2(floor(cell.x / 2.0), cell.y) * float(BLOCK);
+
+    vec2 sum = vec2(0.0);
+    for (int y = 0; y < BLOCK; y++) {
+        for (int x = 0; x < BLOCK; x++) {
+            vec2 pos = origin + vec2(float(x), float(y));
+            if (any(greaterThanEqual(pos, u_count_size))) {
+                continue;
+            }
+
+            vec4 count = texture2D(u_texture, (pos + 0.5) / u_count_size);
+            sum += upper ? count.ba : count.rg;
+        }
+    }
+
+    sum = floor(sum * 255.0 + 0.5);
+    vec2 hi = floor(sum / 256.0);
+    vec2 lo = sum - hi * 256.0;
+
+    gl_FragColor = vec4(lo.x, hi.x, lo.y, hi.y) / 255.0;
+}
+
+// vim:ft=glsl
@@ -5,6 +5,7 @@ varying vec4 f_src_rgba;
 varying vec4 f_dst_rgba;
 
 uniform sampler2D u_texture;
+uniform vec4 u_tint;
 
 const float threshold = 0.01;
 
@@ -20,6 +21,8 @@ void main() {
             gl_FragColor = vec4(0.0, 0.0, 0.0, 0.0);
         }
     }
+
+    gl_FragColor *= u_tint;
 }
 
 // vim:ft=glsl
@@ -41,6 +41,20 @@ events.load = event_handler("load")
 events.resolution = event_handler("resolution")
 events.state = event_handler("state")
 
+local watchers = {}
+
+priv.register("region", function(key, change)
+    local watcher = watchers[key]
+    if not watcher then
+        return
+    end
+
+    local ok, result = pcall(priv.spawn, watcher.callback, change)
+    if not ok then
+        priv.log_error("failed to create region watch coroutine: " .. result)
+    end
+end)
+
 local M = {}
 
 --- Register a listener for a specific event.
@@ -64,6 +78,34 @@ end
 -- @return height The height of the Minecraft window, or 0 if none has been set.
 M.active_res = priv.active_res
 
+--- Run a function which makes several changes to the scene at once.
+-- The function cannot yield, so it must not call sleep or any other function
+-- which waits.
+-- @param func The function to run.
+M.batch = priv.batch
+
+--- Counts the pixels in an area of the Minecraft window which match the given
+-- colors. The counting is done on the GPU, so only the counts are read back.
+-- Like read_pixels, the result is not available until the GPU has finished.
+-- @param box The area to count, in the same format as a mirror's src.
+-- @param colors A list of up to 8 hex colors to count.
+-- @param tolerance (optional) The maximum difference allowed in each channel.
+-- @param callback (optional) The function to call with the result.
+-- @return counts The number of matching pixels for each color.
+M.count_colors = function(box, colors, tolerance, callback)
+    if type(tolerance) == "function" then
+        callback, tolerance = tolerance, nil
+    end
+
+    if callback == nil then
+        return priv.count_colors(box, colors, tolerance)
+    end
+
+    priv.spawn(function()
+        callback(priv.count_colors(box, colors, tolerance))
+    end)
+end
+
 --- Get the current time, in milliseconds, with an arbitrary epoch.
 M.current_time = priv.current_time
 
@@ -82,6 +124,12 @@ M.exec = priv.exec
 -- @return shown Whether floating windows are shown.
 M.floating_shown = priv.floating_shown
 
+--- Returns how much GPU time was spent drawing each shader and scene object.
+-- Times are in milliseconds per frame, averaged over the last second. GPU
+-- timing is enabled by the first call to this function.
+-- @return timings A table of timings, or nil if GPU timing is unsupported.
+M.gpu_timings = priv.gpu_timings
+
 --- Creates an image object which displays a PNG image from the filesystem.
 -- @param path The filepath to the image.
 -- @param options The options to create the image with.
@@ -106,6 +154,74 @@ M.get_key = priv.get_key
 -- @return The current profile, or nil if the default profile is active.
 M.profile = priv.profile
 
+--- Reads back the pixels in an area of the Minecraft window.
+-- The pixels are read asynchronously, so the result is not available until
+-- the GPU has finished copying them. This is checked whenever Minecraft
+-- presents a frame, or every 50 milliseconds if it is not presenting any.
+-- If a callback is given, it is called with the result. Otherwise, the current
+-- action is paused until the result is available, in the same way as sleep.
+-- @param box The area to read, in the same format as a mirror's src.
+-- @param callback (optional) The function to call with the result.
+-- @return pixels A list of RGBA colors (0xRRGGBBAA), row by row.
+-- @return width The width of the area.
+-- @return height The height of the area.
+M.read_pixels = function(box, callback)
+    if callback == nil then
+        return priv.read_pixels(box)
+    end
+
+    priv.spawn(function()
+        callback(priv.read_pixels(box))
+    end)
+end
+
+--- Reads text drawn in Minecraft's font (e.g. the F3 screen) from an area of
+-- the Minecraft window. Only digits, '-', and '/' are recognized; any other
+-- glyphs are read as '?'. Like read_pixels, the result is not available until
+-- the GPU has finished copying the area.
+-- @param box The area to read, in the same format as a mirror's src.
+-- @param options (optional) The color, tolerance, and scale of the text.
+-- @param callback (optional) The function to call with the result.
+-- @return text The text which was read.
+M.read_text = function(box, options, callback)
+    if type(options) == "function" then
+        callback, options = options, nil
+    end
+    options = options or {}
+
+    if callback == nil then
+        return priv.read_text(box, options)
+    end
+
+    priv.spawn(function()
+        callback(priv.read_text(box, options))
+    end)
+end
+
+--- Saves a screenshot of the Minecraft window to a PNG file. The image is
+-- encoded in the background, so taking a screenshot does not stall input or
+-- rendering. Like read_pixels, the result is not available until the file has
+-- been written.
+-- @param path The path of the PNG file to write.
+-- @param options (optional) Whether to include waywall's overlay (mirrors,
+-- images, and text) in the screenshot.
+-- @param callback (optional) The function to call with the result.
+-- @return ok Whether the screenshot was written successfully.
+M.screenshot = function(path, options, callback)
+    if type(options) == "function" then
+        callback, options = options, nil
+    end
+    options = options or {}
+
+    if callback == nil then
+        return priv.screenshot(path, options)
+    end
+
+    priv.spawn(function()
+        callback(priv.screenshot(path, options))
+    end)
+end
+
 --- Attempts to update the current keymap to one with the specified settings.
 -- @param keymap The keymap options (layout, model, rules, variants, and options
 -- are valid keys.)
@@ -121,6 +237,8 @@ M.set_remaps = priv.set_remaps
 -- set back to the size of the waywall window.
 -- @param width The width to set the Minecraft window to.
 -- @param height The height to set the Minecraft window to.
+-- @param scale (optional) The fraction of the resolution to render the game at,
+-- overriding window.render_scale.
 M.set_resolution = priv.set_resolution
 
 --- Sets the sensitivity multiplier for relative pointer motion (3D ingame aim).
@@ -144,6 +262,7 @@ M.sleep = priv.sleep
 M.state = priv.state
 
 --- Creates a "text" object which displays arbitrary text.
+-- @param text The text to display, either as a string or a list of styled runs.
 -- @param options The options to create the text with.
 -- @return text The text object.
 M.text = priv.text
@@ -151,4 +270,63 @@ M.text = priv.text
 --- Toggle the Waywall window between fullscreen and not
 M.toggle_fullscreen = priv.toggle_fullscreen
 
+--- Calls a function whenever an area of the Minecraft window changes.
+-- The area is compared against its contents on the previous frame on the GPU,
+-- and the callback is only called when the difference exceeds the threshold.
+-- @param box The area to watch, in the same format as a mirror's src.
+-- @param threshold The mean difference (0 to 1) needed to call the callback.
+-- @param callback The function to call with the difference.
+-- @return cancel A function which stops watching the area.
+M.watch_region = function(box, threshold, callback)
+    if type(callback) ~= "function" then
+        error("callback must be a function")
+    end
+
+    local watch, key = priv.watch_region(box, threshold)
+    watchers[key] = { watch = watch, callback = callback }
+
+    return function()
+        if watchers[key] then
+            watchers[key] = nil
+            watch:close()
+        end
+    end
+end
+
+--- Calls a function whenever the text in an area of the Minecraft window
+-- changes. The text is only read again when the area changes.
+-- @param box The area to read, in the same format as a mirror's src.
+-- @param options The color, tolerance, and scale of the text.
+-- @param callback The function to call with the new text.
+-- @return cancel A function which stops watching the area.
+M.watch_text = function(box, options, callback)
+    if type(callback) ~= "function" then
+        error("callback must be a function")
+    end
+
+    local last = nil
+    local reading, dirty = false, false
+
+    return M.watch_region(box, 0, function()
+        -- If the area changes again while it is being read, read it once more afterwards.
+        if reading then
+            dirty = true
+            return
+        end
+
+        local text
+        reading = true
+        repeat
+            dirty = false
+            text = priv.read_text(box, options or {})
+        until not dirty
+        reading = false
+
+        if text ~= last then
+            last = text
+            callback(text)
+        end
+    end)
+end
+
 package.loaded["waywall"] = M
@@ -26,31 +26,52 @@ M.ingame_only = function(func)
     end
 end
 
+-- Scene objects cannot be created during startup, so objects created by the
+-- helpers below are deferred until the configuration has loaded. Whether it has
+-- loaded is checked with `active_res`, which fails during startup.
+local function create_on_load(create)
+    local object = nil
+    local cancel_listener = nil
+
+    if pcall(waywall.active_res) then
+        object = create()
+    else
+        cancel_listener = waywall.listen("load", function()
+            cancel_listener()
+            object = create()
+        end)
+    end
+
+    return function()
+        if object then
+            object:close()
+            object = nil
+        elseif cancel_listener then
+            cancel_listener()
+        end
+    end
+end
+
+local function with_visible_at(options, width, height)
+    local copy = {}
+    for k, v in pairs(options) do
+        copy[k] = v
+    end
+    copy.visible_at = { w = width, h = height }
+
+    return copy
+end
+
 --- Creates a mirror which only appears when a specific resolution is in use.
 -- @param options The options to create the mirror with
 -- @param width The width of the desired resolution
 -- @param height The height of the desired resolution
--- @return cancel A function to cancel the resolution listener for this mirror
+-- @return cancel A function to destroy the mirror
 M.res_mirror = function(options, width, height)
-    local mirror = nil
-
-    return waywall.listen("resolution", function()
-        local active_width, active_height = waywall.active_res()
+    options = with_visible_at(options, width, height)
 
-        if active_width == width and active_height == height then
-            if mirror then
-                return
-            end
-
-            mirror = waywall.mirror(options)
-        else
-            if not mirror then
-                return
-            end
-
-            mirror:close()
-            mirror = nil
-        end
+    return create_on_load(function()
+        return waywall.mirror(options)
     end)
 end
 
@@ -59,27 +80,12 @@ end
 -- @param options The options to create the image with
 -- @param width The width of the desired resolution
 -- @param height The height of the desired resolution
--- @return cancel A function to cancel the resolution listener for this image
+-- @return cancel A function to destroy the image
 M.res_image = function(path, options, width, height)
-    local image = nil
-
-    return waywall.listen("resolution", function()
-        local active_width, active_height = waywall.active_res()
+    options = with_visible_at(options, width, height)
 
-        if active_width == width and active_height == height then
-            if image then
-                return
-            end
-
-            image = waywall.image(path, options)
-        else
-            if not image then
-                return
-            end
-
-            image:close()
-            image = nil
-        end
+    return create_on_load(function()
+        return waywall.image(path, options)
     end)
 end
 
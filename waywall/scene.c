@@ -1,6 +1,7 @@
 #include "scene.h"
 #include "server/gl.h"
 #include "server/ui.h"
+#include "timer.h"
 #include "util/alloc.h"
 #include "util/debug.h"
 #include "util/font.h"
@@ -8,7 +9,11 @@
 #include "util/png.h"
 #include "util/prelude.h"
 #include <GLES2/gl2.h>
+#include <math.h>
 #include <spng.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 
 static constexpr int PACKED_ATLAS_SIZE = 4096;
 static constexpr int PACKED_ATLAS_WIDTH = 2048;
@@ -18,6 +23,7 @@ static constexpr int ATLAS_HEIGHT = 256;
 static constexpr int FONT_CHAR_WIDTH = 8;
 static constexpr int FONT_CHAR_HEIGHT = 16;
 static constexpr int CHARS_PER_ROW = (ATLAS_WIDTH / FONT_CHAR_WIDTH);
+static constexpr size_t ATLAS_BYTES = ATLAS_WIDTH * ATLAS_HEIGHT * 4;
 
 static_assert(PACKED_ATLAS_SIZE == STATIC_ARRLEN(UTIL_TERMINUS_FONT));
 static_assert(PACKED_ATLAS_WIDTH * PACKED_ATLAS_HEIGHT == ATLAS_WIDTH * ATLAS_HEIGHT);
@@ -31,6 +37,42 @@ static constexpr char SHADER_VERT_TEXCOPY[] = {
 #embed "glsl/texcopy.vert"
     , 0};
 
+static constexpr char SHADER_FRAG_COUNT[] = {
+#embed "glsl/count.frag"
+    , 0};
+
+static constexpr char SHADER_FRAG_REDUCE[] = {
+#embed "glsl/reduce.frag"
+    , 0};
+
+static constexpr char SHADER_FRAG_DOWNSAMPLE[] = {
+#embed "glsl/downsample.frag"
+    , 0};
+
+// The size of the area summed by each pixel of count.frag and reduce.frag.
+static constexpr int32_t COUNT_BLOCK = 15;
+
+// Each reduction pass handles four colors at once (one per channel of the count texture.)
+static constexpr size_t COUNT_GROUP_SIZE = 4;
+
+// The maximum size of the signature which watched regions are downsampled to before comparison.
+static constexpr int32_t WATCH_SIGNATURE_SIZE = 16;
+
+// Readbacks and watches are checked whenever the game commits a frame. While they are waiting on
+// the GPU and the game is not committing (e.g. on a static menu), they are checked on a timer
+// instead, so that their results are not held back until the game's next frame.
+static constexpr struct timespec POLL_INTERVAL = {
+    .tv_nsec = 50 * 1000000 // 50 milliseconds
+};
+
+// GPU timer queries are read a few frames after they are issued, so that reading them never waits
+// on the GPU. Objects beyond the per-frame query limit are not timed.
+static constexpr size_t PROFILE_FRAMES = 4;
+static constexpr size_t PROFILE_MAX_QUERIES = 256;
+
+// The number of most expensive objects which are listed in the debug text.
+static constexpr size_t PROFILE_DEBUG_OBJECTS = 8;
+
 struct vtx_shader {
     float src_pos[2];
     float dst_pos[2];
@@ -44,11 +86,43 @@ enum scene_object_type {
     SCENE_OBJECT_TEXT,
 };
 
+static const char *OBJECT_TYPE_NAMES[] = {
+    [SCENE_OBJECT_IMAGE] = "image",
+    [SCENE_OBJECT_MIRROR] = "mirror",
+    [SCENE_OBJECT_TEXT] = "text",
+};
+
 struct scene_object {
     struct wl_list link;
     struct scene *parent;
     enum scene_object_type type;
     int32_t depth;
+
+    struct box bounds; // relative to anchor
+
+    // The position at which the object was created, relative to its anchor. The object's
+    // transform moves it away from this position.
+    int32_t x, y;
+
+    struct scene_anchor anchor;
+    struct scene_visible_at visible_at;
+    struct scene_projection projector;
+    struct scene_transform transform;
+    struct {
+        struct scene_transform from, to;
+        uint64_t start; // milliseconds
+        uint32_t duration;
+        enum scene_easing easing;
+        bool active;
+    } animation;
+
+    struct {
+        uint64_t ns; // accumulated during the current profiling window
+        uint32_t draws;
+
+        float ms;   // per frame, averaged over the last profiling window
+        bool timed; // whether the object was drawn during the last profiling window
+    } timing;
 };
 
 struct scene_image {
@@ -57,9 +131,16 @@ struct scene_image {
 
     size_t shader_index;
 
-    GLuint tex, vbo;
+    GLuint tex, vbo, vao; // tex is 0 while the image is evicted
 
     int32_t width, height;
+
+    // The decoded image is kept so that an evicted texture can be uploaded again without reading
+    // the image from disk in the middle of a frame.
+    char *pixels;
+    size_t bytes; // size of tex
+
+    struct wl_list texture_link; // scene.textures.images
 };
 
 struct scene_mirror {
@@ -68,7 +149,7 @@ struct scene_mirror {
 
     size_t shader_index;
 
-    GLuint vbo;
+    GLuint vbo, vao;
 
     float src_rgba[4], dst_rgba[4];
 };
@@ -79,10 +160,108 @@ struct scene_text {
 
     size_t shader_index;
 
-    GLuint vbo;
+    GLuint vbo, vao;
     size_t vtxcount;
 
     int32_t x, y;
+
+    // Live text is rewritten from its source once per frame. The vertex data which was last
+    // uploaded is kept so that only the changed glyphs need to be uploaded again.
+    struct {
+        scene_text_source_func_t func;
+        scene_text_source_destroy_func_t destroy;
+        void *data;
+
+        struct scene_text_run style;
+        char current[SCENE_TEXT_LIVE_MAX];
+
+        struct vtx_shader *vertices, *scratch;
+        size_t capacity; // in vertices
+    } live;
+};
+
+struct profile_frame {
+    GLuint queries[PROFILE_MAX_QUERIES];
+    struct scene_object *objects[PROFILE_MAX_QUERIES]; // nullptr if destroyed
+    size_t shaders[PROFILE_MAX_QUERIES];
+    size_t count;
+
+    bool pending; // whether the results have yet to be read
+};
+
+struct scene_profile {
+    struct profile_frame frames[PROFILE_FRAMES];
+    size_t current;
+    bool recording;
+
+    uint64_t window_start; // milliseconds
+    uint32_t window_frames;
+
+    uint64_t *shader_ns; // accumulated during the current window
+    float *shader_ms;    // per frame, averaged over the last window
+};
+
+enum scene_readback_type {
+    SCENE_READBACK_PIXELS,
+    SCENE_READBACK_COUNT,
+    SCENE_READBACK_SCREENSHOT,
+};
+
+struct scene_readback {
+    struct wl_list link; // scene.readbacks
+    struct scene *parent;
+    enum scene_readback_type type;
+
+    struct box src;
+    GLuint fbo, tex;
+    int32_t width, height; // size of tex
+    struct server_gl_fence *fence;
+    uint8_t *rgba;
+
+    GLuint pbo;   // screenshots only, 0 if pixel buffer objects are unsupported
+    bool overlay; // screenshots only, see scene_screenshot
+    bool failed;
+
+    struct {
+        GLuint fbo, tex; // per-block counts, see count.frag
+        int32_t width, height;
+        int32_t group_width; // width of each group's section of the readback texture
+
+        float colors[SCENE_COUNT_MAX_COLORS][4];
+        size_t num_colors;
+        float tolerance;
+
+        uint32_t counts[SCENE_COUNT_MAX_COLORS];
+    } count;
+
+    union {
+        scene_readback_func_t pixels;
+        scene_count_func_t count;
+        scene_screenshot_func_t screenshot;
+    } done;
+    scene_readback_destroy_func_t destroy;
+    void *data;
+};
+
+struct scene_watch {
+    struct wl_list link; // scene.watches
+    struct scene *parent;
+
+    struct box src;
+    GLuint fbo, tex;
+    int32_t width, height; // size of tex
+    int32_t block_width, block_height;
+    struct server_gl_fence *fence;
+
+    uint8_t signature[WATCH_SIGNATURE_SIZE * WATCH_SIGNATURE_SIZE * 4];
+    bool has_signature;
+
+    float threshold, change;
+    bool changed, destroyed;
+
+    scene_watch_func_t func;
+    scene_readback_destroy_func_t destroy;
+    void *data;
 };
 
 static void object_add(struct scene *scene, struct scene_object *object,
@@ -91,13 +270,24 @@ static void object_list_destroy(struct wl_list *list);
 static void object_release(struct scene_object *object);
 static void object_render(struct scene_object *object);
 static void object_sort(struct scene *scene, struct scene_object *object);
+static uint64_t current_time();
+
+static void profile_forget(struct scene *scene, struct scene_object *object);
+
+static void object_use_transform(struct scene_object *object, struct scene_shader *shader);
+static bool object_visible(struct scene_object *object);
 
 static void draw_debug_text(struct scene *scene);
 static void draw_frame(struct scene *scene);
-static void draw_vertex_list(struct scene_shader *shader, size_t num_vertices);
+static void draw_projector(struct scene *scene);
+static GLuint vertex_array_create(struct scene *scene, GLuint vbo);
+static void vertex_array_destroy(struct scene *scene, GLuint vao);
+static void draw_vertex_list(struct scene *scene, GLuint vao, size_t num_vertices);
+static void box_union(struct box *dst, const struct box *src);
 static void rect_build(struct vtx_shader out[static 6], const struct box *src,
                        const struct box *dst, const float src_rgba[static 4],
                        const float dst_rgba[static 4]);
+static void image_upload(struct scene_image *image);
 static inline struct scene_image *scene_image_from_object(struct scene_object *object);
 static inline struct scene_mirror *scene_mirror_from_object(struct scene_object *object);
 static inline struct scene_text *scene_text_from_object(struct scene_object *object);
@@ -113,24 +303,42 @@ image_build(struct scene_image *out, struct scene *scene, const struct scene_ima
     server_gl_with(scene->gl, false) {
         glGenBuffers(1, &out->vbo);
         ww_assert(out->vbo != 0);
+        out->vao = vertex_array_create(scene, out->vbo);
 
-        gl_using_buffer(GL_ARRAY_BUFFER, out->vbo) {
+        gl_using_buffer(scene->gl, GL_ARRAY_BUFFER, out->vbo) {
             glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
         }
     }
 }
 
+static void
+image_evict(struct scene_image *image) {
+    // The OpenGL context must be current.
+    server_gl_delete_textures(image->parent->gl, 1, &image->tex);
+    image->tex = 0;
+    image->parent->textures.usage -= image->bytes;
+}
+
 static void
 image_release(struct scene_object *object) {
     struct scene_image *image = scene_image_from_object(object);
 
     if (image->parent) {
+        profile_forget(image->parent, object);
         server_gl_with(image->parent->gl, false) {
-            glDeleteTextures(1, &image->tex);
-            glDeleteBuffers(1, &image->vbo);
+            if (image->tex) {
+                image_evict(image);
+            }
+            vertex_array_destroy(image->parent, image->vao);
+            server_gl_delete_buffers(image->parent->gl, 1, &image->vbo);
         }
+
+        wl_list_remove(&image->texture_link);
+        wl_list_init(&image->texture_link);
     }
 
+    free(image->pixels);
+    image->pixels = nullptr;
     image->parent = nullptr;
 }
 
@@ -140,16 +348,25 @@ image_render(struct scene_object *object) {
     struct scene_image *image = scene_image_from_object(object);
     struct scene *scene = image->parent;
 
+    // An evicted image is uploaded again before drawing.
+    if (!image->tex) {
+        return;
+    }
+
+    wl_list_remove(&image->texture_link);
+    wl_list_insert(&scene->textures.images, &image->texture_link);
+
     server_gl_shader_use(scene->shaders.data[image->shader_index].shader);
     glUniform2f(scene->shaders.data[image->shader_index].shader_u_dst_size, scene->ui->render_width,
                 scene->ui->render_height);
     glUniform2f(scene->shaders.data[image->shader_index].shader_u_src_size, image->width,
                 image->height);
+    object_use_transform(object, &scene->shaders.data[image->shader_index]);
 
-    gl_using_buffer(GL_ARRAY_BUFFER, image->vbo) {
-        gl_using_texture(GL_TEXTURE_2D, image->tex) {
+    gl_using_buffer(scene->gl, GL_ARRAY_BUFFER, image->vbo) {
+        gl_using_texture(scene->gl, GL_TEXTURE_2D, image->tex) {
             // Each image has 6 vertices in its vertex buffer.
-            draw_vertex_list(&scene->shaders.data[image->shader_index], 6);
+            draw_vertex_list(scene, image->vao, 6);
         }
     }
 }
@@ -164,8 +381,9 @@ mirror_build(struct scene_mirror *mirror, const struct scene_mirror_options *opt
     server_gl_with(scene->gl, false) {
         glGenBuffers(1, &mirror->vbo);
         ww_assert(mirror->vbo != 0);
+        mirror->vao = vertex_array_create(scene, mirror->vbo);
 
-        gl_using_buffer(GL_ARRAY_BUFFER, mirror->vbo) {
+        gl_using_buffer(scene->gl, GL_ARRAY_BUFFER, mirror->vbo) {
             glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
         }
     }
@@ -176,8 +394,10 @@ mirror_release(struct scene_object *object) {
     struct scene_mirror *mirror = scene_mirror_from_object(object);
 
     if (mirror->parent) {
+        profile_forget(mirror->parent, object);
         server_gl_with(mirror->parent->gl, false) {
-            glDeleteBuffers(1, &mirror->vbo);
+            vertex_array_destroy(mirror->parent, mirror->vao);
+            server_gl_delete_buffers(mirror->parent->gl, 1, &mirror->vbo);
         }
     }
 
@@ -203,59 +423,150 @@ mirror_render(struct scene_object *object) {
     glUniform2f(scene->shaders.data[mirror->shader_index].shader_u_dst_size,
                 scene->ui->render_width, scene->ui->render_height);
     glUniform2f(scene->shaders.data[mirror->shader_index].shader_u_src_size, width, height);
+    object_use_transform(object, &scene->shaders.data[mirror->shader_index]);
 
-    gl_using_buffer(GL_ARRAY_BUFFER, mirror->vbo) {
-        gl_using_texture(GL_TEXTURE_2D, capture_texture) {
+    gl_using_buffer(scene->gl, GL_ARRAY_BUFFER, mirror->vbo) {
+        gl_using_texture(scene->gl, GL_TEXTURE_2D, capture_texture) {
             // Each mirror has 6 vertices in its vertex buffer.
-            draw_vertex_list(&scene->shaders.data[mirror->shader_index], 6);
+            draw_vertex_list(scene, mirror->vao, 6);
         }
     }
 }
 
+// Offsets, in units of the text's size multiplier, at which extra copies of each glyph are drawn
+// to form its shadow or outline.
+static const int32_t TEXT_SHADOW_OFFSETS[][2] = {{1, 1}};
+static const int32_t TEXT_OUTLINE_OFFSETS[][2] = {
+    {-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1},
+};
+
+static struct vtx_shader *
+text_build_effect(struct vtx_shader *ptr, const struct box *src, const struct box *dst,
+                  const int32_t (*offsets)[2], size_t num_offsets, int32_t size,
+                  const float rgba[static 4], struct box *bounds) {
+    for (size_t i = 0; i < num_offsets; i++) {
+        struct box effect_dst = *dst;
+        effect_dst.x += offsets[i][0] * size;
+        effect_dst.y += offsets[i][1] * size;
+
+        rect_build(ptr, src, &effect_dst, (float[4]){1.0, 1.0, 1.0, 1.0}, rgba);
+        ptr += 6;
+
+        box_union(bounds, &effect_dst);
+    }
+
+    return ptr;
+}
+
 static size_t
-text_build(GLuint vbo, struct scene *scene, const char *data,
-           const struct scene_text_options *options) {
-    // The OpenGL context must be current.
+text_count_vertices(const char *data, size_t len, const struct scene_text_run *runs,
+                    size_t num_runs) {
+    size_t max_quads = 0;
+    for (size_t i = 0, start = 0; i < num_runs && start < len; i++) {
+        size_t length = runs[i].length < len - start ? runs[i].length : len - start;
+        size_t quads = 1 + (runs[i].shadow ? STATIC_ARRLEN(TEXT_SHADOW_OFFSETS) : 0) +
+                       (runs[i].outline ? STATIC_ARRLEN(TEXT_OUTLINE_OFFSETS) : 0);
+
+        max_quads += length * quads;
+        start += length;
+    }
 
-    size_t vtxcount = strlen(data) * 6;
+    return max_quads * 6;
+}
 
-    struct vtx_shader *vertices = zalloc(vtxcount, sizeof(*vertices));
+static size_t
+text_fill(struct vtx_shader *vertices, const char *data, size_t len, int32_t x0, int32_t y0,
+          const struct scene_text_run *runs, size_t num_runs, struct box *bounds) {
     struct vtx_shader *ptr = vertices;
+    *bounds = (struct box){};
+
+    // Shadows and outlines are placed in the buffer before any of the glyphs, so that they are
+    // drawn beneath the glyphs of neighboring characters.
+    for (int pass = 0; pass < 2; pass++) {
+        bool effects = (pass == 0);
+
+        int32_t x = x0;
+        int32_t y = y0;
+        size_t i = 0;
+
+        for (size_t r = 0; r < num_runs && i < len; r++) {
+            const struct scene_text_run *run = &runs[r];
+            int32_t size = run->size_multiplier;
+
+            size_t end = run->length < len - i ? i + run->length : len;
+            for (const char *c = &data[i]; i < end; i++, c++) {
+                if (*c == '\n') {
+                    y += FONT_CHAR_HEIGHT * size;
+                    x = x0;
+                    continue;
+                } else if (*c == ' ') {
+                    x += FONT_CHAR_WIDTH * size;
+                    continue;
+                }
 
-    int32_t x = options->x;
-    int32_t y = options->y;
+                struct box src = {
+                    .x = (*c % CHARS_PER_ROW) * FONT_CHAR_WIDTH,
+                    .y = (*c / CHARS_PER_ROW) * FONT_CHAR_HEIGHT,
+                    .width = FONT_CHAR_WIDTH,
+                    .height = FONT_CHAR_HEIGHT,
+                };
+
+                struct box dst = {
+                    .x = x,
+                    .y = y,
+                    .width = FONT_CHAR_WIDTH * size,
+                    .height = FONT_CHAR_HEIGHT * size,
+                };
+
+                if (effects) {
+                    if (run->shadow) {
+                        ptr = text_build_effect(ptr, &src, &dst, TEXT_SHADOW_OFFSETS,
+                                                STATIC_ARRLEN(TEXT_SHADOW_OFFSETS), size,
+                                                run->shadow_rgba, bounds);
+                    }
+                    if (run->outline) {
+                        ptr = text_build_effect(ptr, &src, &dst, TEXT_OUTLINE_OFFSETS,
+                                                STATIC_ARRLEN(TEXT_OUTLINE_OFFSETS), size,
+                                                run->outline_rgba, bounds);
+                    }
+                } else {
+                    rect_build(ptr, &src, &dst, (float[4]){1.0, 1.0, 1.0, 1.0}, run->rgba);
+                    ptr += 6;
+
+                    box_union(bounds, &dst);
+                }
 
-    for (const char *c = data; *c != '\0'; c++) {
-        if (*c == '\n') {
-            y += FONT_CHAR_HEIGHT * options->size_multiplier;
-            x = options->x;
-            continue;
-        } else if (*c == ' ') {
-            x += FONT_CHAR_WIDTH * options->size_multiplier;
-            continue;
+                x += FONT_CHAR_WIDTH * size;
+            }
         }
+    }
 
-        struct box src = {
-            .x = (*c % CHARS_PER_ROW) * FONT_CHAR_WIDTH,
-            .y = (*c / CHARS_PER_ROW) * FONT_CHAR_HEIGHT,
-            .width = FONT_CHAR_WIDTH,
-            .height = FONT_CHAR_HEIGHT,
-        };
+    return ptr - vertices;
+}
 
-        struct box dst = {
-            .x = x,
-            .y = y,
-            .width = FONT_CHAR_WIDTH * options->size_multiplier,
-            .height = FONT_CHAR_HEIGHT * options->size_multiplier,
-        };
+static size_t
+text_build(GLuint vbo, struct scene *scene, const char *data,
+           const struct scene_text_options *options, struct box *bounds) {
+    // The OpenGL context must be current.
 
-        rect_build(ptr, &src, &dst, (float[4]){1.0, 1.0, 1.0, 1.0}, options->rgba);
-        ptr += 6;
+    size_t len = strlen(data);
 
-        x += FONT_CHAR_WIDTH * options->size_multiplier;
-    }
+    const struct scene_text_run default_run = {
+        .length = len,
+        .rgba = {options->rgba[0], options->rgba[1], options->rgba[2], options->rgba[3]},
+        .size_multiplier = options->size_multiplier,
+    };
+    const struct scene_text_run *runs = options->num_runs > 0 ? options->runs : &default_run;
+    size_t num_runs = options->num_runs > 0 ? options->num_runs : 1;
 
-    gl_using_buffer(GL_ARRAY_BUFFER, vbo) {
+    // Every run is drawn with the same shader and texture, so the whole text (including shadows
+    // and outlines) can be drawn at once.
+    struct vtx_shader *vertices =
+        zalloc(text_count_vertices(data, len, runs, num_runs), sizeof(*vertices));
+    size_t vtxcount =
+        text_fill(vertices, data, len, options->x, options->y, runs, num_runs, bounds);
+
+    gl_using_buffer(scene->gl, GL_ARRAY_BUFFER, vbo) {
         glBufferData(GL_ARRAY_BUFFER, vtxcount * sizeof(*vertices), vertices, GL_STATIC_DRAW);
     }
 
@@ -264,16 +575,121 @@ text_build(GLuint vbo, struct scene *scene, const char *data,
     return vtxcount;
 }
 
+static void
+text_update_live(struct scene_text *text) {
+    // The OpenGL context must be current.
+
+    char buf[SCENE_TEXT_LIVE_MAX];
+    size_t len = text->live.func(text->live.data, buf, sizeof(buf));
+    if (len >= sizeof(buf)) {
+        len = sizeof(buf) - 1;
+    }
+    buf[len] = '\0';
+
+    if (strcmp(buf, text->live.current) == 0) {
+        return;
+    }
+    memcpy(text->live.current, buf, len + 1);
+
+    struct scene_text_run run = text->live.style;
+    run.length = len;
+
+    // The vertex arrays only grow, so updating live text does not allocate once it has reached its
+    // longest contents.
+    size_t needed = text_count_vertices(buf, len, &run, 1);
+    if (needed > text->live.capacity) {
+        size_t capacity = text->live.capacity > 0 ? text->live.capacity : 64;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+
+        text->live.vertices = realloc(text->live.vertices, capacity * sizeof(struct vtx_shader));
+        check_alloc(text->live.vertices);
+        text->live.scratch = realloc(text->live.scratch, capacity * sizeof(struct vtx_shader));
+        check_alloc(text->live.scratch);
+
+        // Zero the new space, so that it is always considered to have changed below.
+        memset(text->live.vertices + text->live.capacity, 0,
+               (capacity - text->live.capacity) * sizeof(struct vtx_shader));
+        text->live.capacity = capacity;
+
+        gl_using_buffer(text->parent->gl, GL_ARRAY_BUFFER, text->vbo) {
+            glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(struct vtx_shader), nullptr,
+                         GL_DYNAMIC_DRAW);
+        }
+        text->vtxcount = 0;
+    }
+
+    size_t vtxcount = text_fill(text->live.scratch, buf, len, text->x, text->y, &run, 1,
+                                &text->object.bounds);
+
+    // Only upload the range of vertices which differs from what is already in the buffer. When
+    // the text is a counter or timer, this is usually only the last few digits.
+    size_t first = 0, last = vtxcount;
+    while (first < vtxcount && first < text->vtxcount &&
+           memcmp(&text->live.scratch[first], &text->live.vertices[first],
+                  sizeof(struct vtx_shader)) == 0) {
+        first++;
+    }
+    while (last > first && last <= text->vtxcount &&
+           memcmp(&text->live.scratch[last - 1], &text->live.vertices[last - 1],
+                  sizeof(struct vtx_shader)) == 0) {
+        last--;
+    }
+
+    if (last > first) {
+        memcpy(&text->live.vertices[first], &text->live.scratch[first],
+               (last - first) * sizeof(struct vtx_shader));
+
+        gl_using_buffer(text->parent->gl, GL_ARRAY_BUFFER, text->vbo) {
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(struct vtx_shader),
+                            (last - first) * sizeof(struct vtx_shader),
+                            &text->live.vertices[first]);
+        }
+    }
+    text->vtxcount = vtxcount;
+}
+
+static void
+update_live_text(struct scene *scene) {
+    // The OpenGL context must be current.
+
+    struct wl_list *lists[] = {&scene->objects.sorted, &scene->objects.unsorted_text};
+    for (size_t i = 0; i < STATIC_ARRLEN(lists); i++) {
+        struct scene_object *object;
+        wl_list_for_each (object, lists[i], link) {
+            if (object->type != SCENE_OBJECT_TEXT) {
+                continue;
+            }
+
+            struct scene_text *text = scene_text_from_object(object);
+            if (text->live.func && object_visible(object)) {
+                text_update_live(text);
+            }
+        }
+    }
+}
+
 static void
 text_release(struct scene_object *object) {
     struct scene_text *text = scene_text_from_object(object);
 
     if (text->parent) {
+        profile_forget(text->parent, object);
         server_gl_with(text->parent->gl, false) {
-            glDeleteBuffers(1, &text->vbo);
+            vertex_array_destroy(text->parent, text->vao);
+            server_gl_delete_buffers(text->parent->gl, 1, &text->vbo);
         }
     }
 
+    if (text->live.func) {
+        text->live.destroy(text->live.data);
+        text->live.func = nullptr;
+    }
+    free(text->live.vertices);
+    free(text->live.scratch);
+    text->live.vertices = text->live.scratch = nullptr;
+
     text->parent = nullptr;
 }
 
@@ -289,140 +705,1174 @@ text_render(struct scene_object *object) {
                 scene->ui->render_height);
     glUniform2f(scene->shaders.data[text->shader_index].shader_u_src_size, ATLAS_WIDTH,
                 ATLAS_HEIGHT);
+    object_use_transform(object, &scene->shaders.data[text->shader_index]);
 
-    gl_using_buffer(GL_ARRAY_BUFFER, text->vbo) {
-        gl_using_texture(GL_TEXTURE_2D, scene->buffers.font_tex) {
-            draw_vertex_list(&scene->shaders.data[text->shader_index], text->vtxcount);
+    gl_using_buffer(scene->gl, GL_ARRAY_BUFFER, text->vbo) {
+        gl_using_texture(scene->gl, GL_TEXTURE_2D, scene->buffers.font_tex) {
+            draw_vertex_list(scene, text->vao, text->vtxcount);
         }
     }
 }
 
-static void
-on_gl_frame(struct wl_listener *listener, void *data) {
-    struct scene *scene = wl_container_of(listener, scene, on_gl_frame);
+static bool
+readback_target_create(struct scene *scene, GLuint *fbo, GLuint *tex, int32_t width,
+                       int32_t height) {
+    // The OpenGL context must be current.
 
-    server_gl_with(scene->gl, true) {
-        draw_frame(scene);
+    glGenTextures(1, tex);
+    gl_using_texture(scene->gl, GL_TEXTURE_2D, *tex) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     }
-}
 
-static void
-object_add(struct scene *scene, struct scene_object *object, enum scene_object_type type) {
-    object->parent = scene;
-    object->type = type;
-    object_sort(scene, object);
+    glGenFramebuffers(1, fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, *fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *tex, 0);
+    bool ok = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return ok;
 }
 
 static void
-object_list_destroy(struct wl_list *list) {
-    struct scene_object *object, *tmp;
+readback_release(struct scene_readback *readback) {
+    // The OpenGL context must be current.
 
-    wl_list_for_each_safe (object, tmp, list, link) {
-        wl_list_remove(&object->link);
-        wl_list_init(&object->link);
+    if (readback->fence) {
+        server_gl_fence_destroy(readback->fence);
+        readback->fence = nullptr;
+    }
 
-        object_release(object);
+    glDeleteFramebuffers(2, (GLuint[]){readback->fbo, readback->count.fbo});
+    server_gl_delete_textures(readback->parent->gl, 2,
+                              (GLuint[]){readback->tex, readback->count.tex});
+    readback->fbo = readback->tex = 0;
+    readback->count.fbo = readback->count.tex = 0;
+
+    if (readback->pbo) {
+        server_gl_delete_buffers(readback->parent->gl, 1, &readback->pbo);
+        readback->pbo = 0;
     }
 }
 
 static void
-object_release(struct scene_object *object) {
-    switch (object->type) {
-    case SCENE_OBJECT_IMAGE:
-        image_release(object);
-        break;
-    case SCENE_OBJECT_MIRROR:
-        mirror_release(object);
-        break;
-    case SCENE_OBJECT_TEXT:
-        text_release(object);
-        break;
+readback_copy_pixels(struct scene_readback *readback, GLuint capture_texture, int32_t width,
+                     int32_t height) {
+    // The OpenGL context must be current.
+
+    struct scene *scene = readback->parent;
+
+    // The destination rectangle is flipped vertically so that glReadPixels, which reads from the
+    // bottom row upwards, returns rows in top to bottom order.
+    struct vtx_shader vertices[6];
+    rect_build(vertices, &readback->src,
+               &(struct box){0, readback->src.height, readback->src.width, -readback->src.height},
+               (float[4]){}, (float[4]){});
+
+    glBindFramebuffer(GL_FRAMEBUFFER, readback->fbo);
+    glViewport(0, 0, readback->width, readback->height);
+
+    server_gl_shader_use(scene->shaders.data[0].shader);
+    glUniform2f(scene->shaders.data[0].shader_u_dst_size, readback->width, readback->height);
+    glUniform2f(scene->shaders.data[0].shader_u_src_size, width, height);
+    object_use_transform(nullptr, &scene->shaders.data[0]);
+
+    gl_using_buffer(scene->gl, GL_ARRAY_BUFFER, scene->buffers.readback) {
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
+        gl_using_texture(scene->gl, GL_TEXTURE_2D, capture_texture) {
+            draw_vertex_list(scene, scene->buffers.readback_vao, 6);
+        }
     }
 }
 
 static void
-object_render(struct scene_object *object) {
-    switch (object->type) {
-    case SCENE_OBJECT_IMAGE:
-        image_render(object);
-        break;
-    case SCENE_OBJECT_MIRROR:
-        mirror_render(object);
-        break;
-    case SCENE_OBJECT_TEXT:
-        text_render(object);
-        break;
+readback_copy_count(struct scene_readback *readback, GLuint capture_texture, int32_t width,
+                    int32_t height) {
+    // The OpenGL context must be current.
+
+    struct scene *scene = readback->parent;
+    struct scene_shader *count = &scene->reduction.count;
+    struct scene_shader *reduce = &scene->reduction.reduce;
+
+    // Both passes draw a single rectangle which covers the whole viewport. Neither fragment shader
+    // makes use of the source position, so it is left unused.
+    int32_t group_width = readback->count.group_width;
+
+    struct vtx_shader count_vertices[6], reduce_vertices[6];
+    rect_build(count_vertices, &(struct box){0, 0, 1, 1},
+               &(struct box){0, 0, readback->count.width, readback->count.height}, (float[4]){},
+               (float[4]){});
+    rect_build(reduce_vertices, &(struct box){0, 0, 1, 1},
+               &(struct box){0, 0, group_width, readback->height}, (float[4]){}, (float[4]){});
+
+    gl_using_buffer(scene->gl, GL_ARRAY_BUFFER, scene->buffers.readback) {
+        for (size_t i = 0; i * COUNT_GROUP_SIZE < readback->count.num_colors; i++) {
+            // Count the matching pixels within each block of the source area.
+            glBindFramebuffer(GL_FRAMEBUFFER, readback->count.fbo);
+            glViewport(0, 0, readback->count.width, readback->count.height);
+
+            server_gl_shader_use(count->shader);
+            glUniform2f(count->shader_u_src_size, width, height);
+            glUniform2f(count->shader_u_dst_size, readback->count.width, readback->count.height);
+            glUniform4f(scene->reduction.count_u_box, readback->src.x, readback->src.y,
+                        readback->src.width, readback->src.height);
+            glUniform4fv(scene->reduction.count_u_colors, COUNT_GROUP_SIZE,
+                         readback->count.colors[i * COUNT_GROUP_SIZE]);
+            glUniform1f(scene->reduction.count_u_tolerance, readback->count.tolerance);
+
+            glBufferData(GL_ARRAY_BUFFER, sizeof(count_vertices), count_vertices, GL_STREAM_DRAW);
+            gl_using_texture(scene->gl, GL_TEXTURE_2D, capture_texture) {
+                draw_vertex_list(scene, scene->buffers.readback_vao, 6);
+            }
+
+            // Sum the per-block counts into this group's section of the readback texture.
+            int32_t offset = (int32_t)i * group_width;
+
+            glBindFramebuffer(GL_FRAMEBUFFER, readback->fbo);
+            glViewport(offset, 0, group_width, readback->height);
+
+            server_gl_shader_use(reduce->shader);
+            glUniform2f(reduce->shader_u_src_size, 1, 1);
+            glUniform2f(reduce->shader_u_dst_size, group_width, readback->height);
+            glUniform2f(scene->reduction.reduce_u_count_size, readback->count.width,
+                        readback->count.height);
+            glUniform2f(scene->reduction.reduce_u_offset, offset, 0);
+
+            glBufferData(GL_ARRAY_BUFFER, sizeof(reduce_vertices), reduce_vertices,
+                         GL_STREAM_DRAW);
+            gl_using_texture(scene->gl, GL_TEXTURE_2D, readback->count.tex) {
+                draw_vertex_list(scene, scene->buffers.readback_vao, 6);
+            }
+        }
     }
 }
 
 static void
-object_sort(struct scene *scene, struct scene_object *object) {
-    if (object->depth == 0) {
-        switch (object->type) {
-        case SCENE_OBJECT_IMAGE:
-            wl_list_insert(&scene->objects.unsorted_images, &object->link);
-            break;
-        case SCENE_OBJECT_MIRROR:
-            wl_list_insert(&scene->objects.unsorted_mirrors, &object->link);
-            break;
-        case SCENE_OBJECT_TEXT:
-            wl_list_insert(&scene->objects.unsorted_text, &object->link);
-            break;
-        }
+readback_copy_screenshot(struct scene_readback *readback, GLuint capture_texture, int32_t width,
+                         int32_t height) {
+    // The OpenGL context must be current.
+
+    struct scene *scene = readback->parent;
 
+    // The size of a screenshot is not known until it is taken. It is the size of the game's buffer,
+    // or the size of the whole window if the overlay is included.
+    readback->width = readback->overlay ? scene->ui->render_width : width;
+    readback->height = readback->overlay ? scene->ui->render_height : height;
+
+    if (!readback_target_create(scene, &readback->fbo, &readback->tex, readback->width,
+                                readback->height)) {
+        ww_log(LOG_ERROR, "failed to create screenshot framebuffer");
+        readback->failed = true;
         return;
     }
 
-    struct scene_object *needle = nullptr, *prev = nullptr;
-    wl_list_for_each (needle, &scene->objects.sorted, link) {
-        if (needle->depth >= object->depth) {
-            break;
+    glBindFramebuffer(GL_FRAMEBUFFER, readback->fbo);
+    glViewport(0, 0, readback->width, readback->height);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // Objects are drawn in the same order as in the overlay. Objects with negative depth are drawn
+    // before the game instead of being hidden behind it with the stencil buffer (see draw_frame.)
+    struct scene_object *object;
+    if (readback->overlay) {
+        scene->target = SCENE_TARGET_SCREENSHOT;
+        server_gl_set_blend(scene->gl, true);
+        server_gl_set_blend_func(scene->gl, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
+
+        wl_list_for_each (object, &scene->objects.sorted, link) {
+            if (object->depth < 0) {
+                object_render(object);
+            }
         }
+    }
 
-        prev = needle;
+    struct vtx_shader vertices[6];
+    rect_build(vertices, &(struct box){0, 0, width, height},
+               readback->overlay ? &scene->anchors.game : &(struct box){0, 0, width, height},
+               (float[4]){}, (float[4]){});
+
+    server_gl_set_blend(scene->gl, false);
+    server_gl_shader_use(scene->shaders.data[0].shader);
+    glUniform2f(scene->shaders.data[0].shader_u_dst_size, readback->width, readback->height);
+    glUniform2f(scene->shaders.data[0].shader_u_src_size, width, height);
+    object_use_transform(nullptr, &scene->shaders.data[0]);
+
+    gl_using_buffer(scene->gl, GL_ARRAY_BUFFER, scene->buffers.readback) {
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
+        gl_using_texture(scene->gl, GL_TEXTURE_2D, capture_texture) {
+            draw_vertex_list(scene, scene->buffers.readback_vao, 6);
+        }
     }
 
-    if (prev) {
-        wl_list_insert(&prev->link, &object->link);
-    } else {
-        wl_list_insert(&scene->objects.sorted, &object->link);
+    if (readback->overlay) {
+        server_gl_set_blend(scene->gl, true);
+
+        wl_list_for_each (object, &scene->objects.unsorted_mirrors, link) {
+            object_render(object);
+        }
+        wl_list_for_each (object, &scene->objects.unsorted_images, link) {
+            object_render(object);
+        }
+        wl_list_for_each (object, &scene->objects.unsorted_text, link) {
+            object_render(object);
+        }
+        wl_list_for_each (object, &scene->objects.sorted, link) {
+            if (object->depth > 0) {
+                object_render(object);
+            }
+        }
+
+        scene->target = SCENE_TARGET_OVERLAY;
+    }
+
+    // With pixel buffer objects, the copy into client memory is queued along with the drawing
+    // above, and the buffer only needs to be mapped once the fence has signalled. Otherwise, the
+    // pixels are read with glReadPixels once the fence has signalled.
+    if (scene->gl->gles.MapBufferRange) {
+        size_t size = (size_t)readback->width * (size_t)readback->height * 4;
+
+        glGenBuffers(1, &readback->pbo);
+        glBindBuffer(GLES3_PIXEL_PACK_BUFFER, readback->pbo);
+        glBufferData(GLES3_PIXEL_PACK_BUFFER, size, nullptr, GLES3_STREAM_READ);
+        glReadPixels(0, 0, readback->width, readback->height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GLES3_PIXEL_PACK_BUFFER, 0);
     }
 }
 
 static void
-draw_stencil(struct scene *scene) {
+readback_copy(struct scene_readback *readback) {
     // The OpenGL context must be current.
 
-    int32_t width, height;
-    GLuint tex = server_gl_get_capture(scene->gl);
-    if (tex == 0) {
+    struct scene *scene = readback->parent;
+
+    GLuint capture_texture = server_gl_get_capture(scene->gl);
+    if (capture_texture == 0) {
         return;
     }
+
+    int32_t width, height;
     server_gl_get_capture_size(scene->gl, &width, &height);
 
-    // It would be possible to listen for resizes instead of checking whether the stencil buffer
-    // needs an update every frame, but that would be more complicated and there is also no event
-    // for the game being resized (as of writing this comment, at least.)
-    //
-    // TODO: Is it possible to avoid the frame of leeway? Would also be nice to avoid it in
-    // draw_frame. This stuff really should be synchronized with the surface content. Might be worth
-    // always doing compositing if scene objects are visible but I'm not very happy with that
-    // solution.
-    bool stencil_equal = scene->ui->render_width == scene->prev_frame.width &&
-                         scene->ui->render_height == scene->prev_frame.height &&
-                         width == scene->prev_frame.tex_width &&
-                         height == scene->prev_frame.tex_height;
-    if (stencil_equal) {
-        scene->prev_frame.equal_frames++;
-        if (scene->prev_frame.equal_frames > 1) {
-            return;
-        }
+    server_gl_set_blend(scene->gl, false);
+
+    switch (readback->type) {
+    case SCENE_READBACK_PIXELS:
+        readback_copy_pixels(readback, capture_texture, width, height);
+        break;
+    case SCENE_READBACK_COUNT:
+        readback_copy_count(readback, capture_texture, width, height);
+        break;
+    case SCENE_READBACK_SCREENSHOT:
+        readback_copy_screenshot(readback, capture_texture, width, height);
+        break;
     }
 
-    scene->prev_frame.width = scene->ui->render_width;
-    scene->prev_frame.height = scene->ui->render_height;
-    scene->prev_frame.tex_width = width;
-    scene->prev_frame.tex_height = height;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!readback->failed) {
+        readback->fence = server_gl_fence_create(scene->gl);
+    }
+}
+
+static void
+readback_decode_counts(struct scene_readback *readback) {
+    // Each group of colors occupies a section of the readback texture, in which each pair of
+    // horizontally adjacent pixels holds the partial sums for one area of the source. The first
+    // pixel of a pair holds the sums of the first two colors of the group, and the second pixel
+    // holds the sums of the last two. Each sum is stored as a little-endian 16-bit value.
+    int32_t group_width = readback->count.group_width;
+
+    for (int32_t y = 0; y < readback->height; y++) {
+        for (int32_t x = 0; x < readback->width; x++) {
+            const uint8_t *px = readback->rgba + ((size_t)y * readback->width + x) * 4;
+
+            size_t base =
+                (size_t)(x / group_width) * COUNT_GROUP_SIZE + (size_t)((x % group_width) % 2) * 2;
+            for (size_t i = 0; i < 2; i++) {
+                if (base + i < readback->count.num_colors) {
+                    readback->count.counts[base + i] += px[i * 2] | (px[i * 2 + 1] << 8);
+                }
+            }
+        }
+    }
+}
+
+static void
+readback_read_screenshot(struct scene_readback *readback) {
+    // The OpenGL context must be current.
+
+    struct server_gl *gl = readback->parent->gl;
+
+    size_t row_size = (size_t)readback->width * 4;
+    size_t size = row_size * (size_t)readback->height;
+
+    readback->rgba = malloc(size);
+    check_alloc(readback->rgba);
+
+    // The rows of the framebuffer are read from the bottom upwards, so they are flipped into top to
+    // bottom order. With a pixel buffer object, this is done while copying out of the mapping.
+    if (readback->pbo) {
+        glBindBuffer(GLES3_PIXEL_PACK_BUFFER, readback->pbo);
+        const uint8_t *map =
+            gl->gles.MapBufferRange(GLES3_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT_EXT);
+        if (map) {
+            for (int32_t y = 0; y < readback->height; y++) {
+                memcpy(readback->rgba + row_size * y,
+                       map + row_size * (size_t)(readback->height - 1 - y), row_size);
+            }
+            gl->gles.UnmapBuffer(GLES3_PIXEL_PACK_BUFFER);
+        } else {
+            ww_log(LOG_ERROR, "failed to map screenshot buffer");
+            free(readback->rgba);
+            readback->rgba = nullptr;
+        }
+        glBindBuffer(GLES3_PIXEL_PACK_BUFFER, 0);
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, readback->fbo);
+    glReadPixels(0, 0, readback->width, readback->height, GL_RGBA, GL_UNSIGNED_BYTE,
+                 readback->rgba);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    uint8_t *tmp = malloc(row_size);
+    check_alloc(tmp);
+    for (int32_t y = 0; y < readback->height / 2; y++) {
+        uint8_t *top = readback->rgba + row_size * y;
+        uint8_t *bottom = readback->rgba + row_size * (size_t)(readback->height - 1 - y);
+
+        memcpy(tmp, top, row_size);
+        memcpy(top, bottom, row_size);
+        memcpy(bottom, tmp, row_size);
+    }
+    free(tmp);
+}
+
+static void
+readback_process(struct scene *scene, struct wl_list *finished) {
+    // The OpenGL context must be current.
+
+    struct scene_readback *readback, *tmp;
+    wl_list_for_each_safe (readback, tmp, &scene->readbacks, link) {
+        if (readback->failed) {
+            readback_release(readback);
+            wl_list_remove(&readback->link);
+            wl_list_insert(finished, &readback->link);
+            continue;
+        }
+
+        if (!readback->fence) {
+            readback_copy(readback);
+            continue;
+        }
+
+        if (!server_gl_fence_signaled(readback->fence)) {
+            continue;
+        }
+
+        // The GPU has finished copying the requested region into the readback texture, so reading
+        // it back will not stall.
+        if (readback->type == SCENE_READBACK_SCREENSHOT) {
+            readback_read_screenshot(readback);
+        } else {
+            readback->rgba = zalloc(readback->width * readback->height, 4);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, readback->fbo);
+            glReadPixels(0, 0, readback->width, readback->height, GL_RGBA, GL_UNSIGNED_BYTE,
+                         readback->rgba);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+
+        readback_release(readback);
+
+        if (readback->type == SCENE_READBACK_COUNT) {
+            readback_decode_counts(readback);
+        }
+
+        wl_list_remove(&readback->link);
+        wl_list_insert(finished, &readback->link);
+    }
+}
+
+static void
+watch_release(struct scene_watch *watch) {
+    // The OpenGL context must be current.
+
+    if (watch->fence) {
+        server_gl_fence_destroy(watch->fence);
+        watch->fence = nullptr;
+    }
+
+    glDeleteFramebuffers(1, &watch->fbo);
+    server_gl_delete_textures(watch->parent->gl, 1, &watch->tex);
+    watch->fbo = watch->tex = 0;
+}
+
+static void
+watch_copy(struct scene_watch *watch) {
+    // The OpenGL context must be current.
+
+    struct scene *scene = watch->parent;
+    struct scene_shader *downsample = &scene->reduction.downsample;
+
+    GLuint capture_texture = server_gl_get_capture(scene->gl);
+    if (capture_texture == 0) {
+        return;
+    }
+
+    int32_t width, height;
+    server_gl_get_capture_size(scene->gl, &width, &height);
+
+    struct vtx_shader vertices[6];
+    rect_build(vertices, &(struct box){0, 0, 1, 1},
+               &(struct box){0, 0, watch->width, watch->height}, (float[4]){}, (float[4]){});
+
+    glBindFramebuffer(GL_FRAMEBUFFER, watch->fbo);
+    glViewport(0, 0, watch->width, watch->height);
+    server_gl_set_blend(scene->gl, false);
+
+    server_gl_shader_use(downsample->shader);
+    glUniform2f(downsample->shader_u_src_size, width, height);
+    glUniform2f(downsample->shader_u_dst_size, watch->width, watch->height);
+    glUniform4f(scene->reduction.downsample_u_box, watch->src.x, watch->src.y, watch->src.width,
+                watch->src.height);
+    glUniform2f(scene->reduction.downsample_u_block, watch->block_width, watch->block_height);
+
+    gl_using_buffer(scene->gl, GL_ARRAY_BUFFER, scene->buffers.readback) {
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
+        gl_using_texture(scene->gl, GL_TEXTURE_2D, capture_texture) {
+            draw_vertex_list(scene, scene->buffers.readback_vao, 6);
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    watch->fence = server_gl_fence_create(scene->gl);
+}
+
+static void
+watch_compare(struct scene_watch *watch, const uint8_t *signature) {
+    size_t len = (size_t)watch->width * watch->height * 4;
+
+    if (!watch->has_signature) {
+        memcpy(watch->signature, signature, len);
+        watch->has_signature = true;
+        return;
+    }
+
+    // The alpha channel is ignored, since the game's output is always opaque.
+    uint32_t diff = 0;
+    for (size_t i = 0; i < len; i += 4) {
+        for (size_t j = 0; j < 3; j++) {
+            diff += abs((int)signature[i + j] - (int)watch->signature[i + j]);
+        }
+    }
+    memcpy(watch->signature, signature, len);
+
+    float change = (float)diff / ((len / 4) * 3 * UINT8_MAX);
+    if (change > watch->threshold) {
+        // If the watch has not been dispatched since its last change, report the largest change.
+        if (!watch->changed || change > watch->change) {
+            watch->change = change;
+        }
+        watch->changed = true;
+    }
+}
+
+static void
+watch_process(struct scene *scene, bool new_frame) {
+    // The OpenGL context must be current.
+
+    struct scene_watch *watch;
+    wl_list_for_each (watch, &scene->watches, link) {
+        if (watch->fence) {
+            if (!server_gl_fence_signaled(watch->fence)) {
+                continue;
+            }
+
+            uint8_t signature[sizeof(watch->signature)];
+
+            glBindFramebuffer(GL_FRAMEBUFFER, watch->fbo);
+            glReadPixels(0, 0, watch->width, watch->height, GL_RGBA, GL_UNSIGNED_BYTE, signature);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+            server_gl_fence_destroy(watch->fence);
+            watch->fence = nullptr;
+
+            watch_compare(watch, signature);
+        }
+
+        // Start downsampling the current frame as soon as the previous signature has been read,
+        // so that there is always at most one comparison in flight per watch. The game's frame
+        // can only have changed if it has committed a new one.
+        if (new_frame) {
+            watch_copy(watch);
+        }
+    }
+}
+
+static void
+watch_dispatch(struct scene *scene) {
+    // Watch callbacks may destroy any watch (including the one being dispatched), so destruction
+    // is deferred until all of the callbacks have been run.
+    scene->dispatching_watches = true;
+
+    struct scene_watch *watch, *tmp;
+    wl_list_for_each (watch, &scene->watches, link) {
+        if (!watch->changed || watch->destroyed) {
+            continue;
+        }
+
+        float change = watch->change;
+        watch->changed = false;
+        watch->change = 0.0f;
+
+        watch->func(watch->data, change);
+    }
+
+    scene->dispatching_watches = false;
+
+    wl_list_for_each_safe (watch, tmp, &scene->watches, link) {
+        if (watch->destroyed) {
+            scene_watch_destroy(watch);
+        }
+    }
+}
+
+static bool
+poll_needed(struct scene *scene) {
+    // Readbacks which have not been started yet can only be started once the game has presented a
+    // frame, and watches only need to be checked while a comparison is in flight.
+    bool has_capture = server_gl_get_capture(scene->gl) != 0;
+
+    struct scene_readback *readback;
+    wl_list_for_each (readback, &scene->readbacks, link) {
+        if (readback->fence || readback->failed || has_capture) {
+            return true;
+        }
+    }
+
+    struct scene_watch *watch;
+    wl_list_for_each (watch, &scene->watches, link) {
+        if (watch->fence) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void
+poll_timer_destroy(void *data) {
+    struct scene *scene = data;
+
+    scene->poll_timer = nullptr;
+}
+
+static void poll_timer_fire(void *data);
+
+static void
+poll_schedule(struct scene *scene) {
+    // The timer is pushed back whenever the game commits a frame, so that it only fires once the
+    // game has stopped committing.
+    if (scene->poll_timer) {
+        ww_timer_entry_set_duration(scene->poll_timer, POLL_INTERVAL);
+    } else if (poll_needed(scene)) {
+        scene->poll_timer = ww_timer_add_entry(scene->timer, POLL_INTERVAL, poll_timer_fire,
+                                               poll_timer_destroy, scene);
+        if (!scene->poll_timer) {
+            ww_log(LOG_ERROR, "failed to create timer entry for polling readbacks");
+        }
+    }
+}
+
+static void
+poll_pending(struct scene *scene, bool new_frame) {
+    struct wl_list finished;
+    wl_list_init(&finished);
+
+    server_gl_with(scene->gl, false) {
+        readback_process(scene, &finished);
+        watch_process(scene, new_frame);
+    }
+
+    // Readback callbacks are run outside of the OpenGL context, since they may end up calling back
+    // into the scene (e.g. to create new objects or readbacks.)
+    struct scene_readback *readback, *tmp;
+    wl_list_for_each_safe (readback, tmp, &finished, link) {
+        wl_list_remove(&readback->link);
+
+        switch (readback->type) {
+        case SCENE_READBACK_PIXELS:
+            readback->done.pixels(readback->data, readback->width, readback->height,
+                                  readback->rgba);
+            break;
+        case SCENE_READBACK_COUNT:
+            readback->done.count(readback->data, readback->count.num_colors,
+                                 readback->count.counts);
+            break;
+        case SCENE_READBACK_SCREENSHOT:
+            // The callback takes ownership of the pixel data.
+            readback->done.screenshot(readback->data, readback->width, readback->height,
+                                      readback->rgba);
+            readback->rgba = nullptr;
+            break;
+        }
+
+        free(readback->rgba);
+        free(readback);
+    }
+
+    watch_dispatch(scene);
+
+    poll_schedule(scene);
+}
+
+static void
+poll_timer_fire(void *data) {
+    struct scene *scene = data;
+
+    ww_timer_entry_destroy(scene->poll_timer);
+    scene->poll_timer = nullptr;
+
+    poll_pending(scene, false);
+}
+
+static void
+on_gl_frame(struct wl_listener *listener, void *data) {
+    struct scene *scene = wl_container_of(listener, scene, on_gl_frame);
+
+    uint64_t now = current_time();
+    scene->fps.frames++;
+    if (now - scene->fps.start >= 1000) {
+        scene->fps.value = (uint32_t)(scene->fps.frames * 1000 / (now - scene->fps.start));
+        scene->fps.frames = 0;
+        scene->fps.start = now;
+    }
+
+    server_gl_with(scene->gl, true) {
+        draw_frame(scene);
+        draw_projector(scene);
+    }
+
+    poll_pending(scene, true);
+}
+
+static size_t
+object_shader_index(struct scene_object *object) {
+    switch (object->type) {
+    case SCENE_OBJECT_IMAGE:
+        return scene_image_from_object(object)->shader_index;
+    case SCENE_OBJECT_MIRROR:
+        return scene_mirror_from_object(object)->shader_index;
+    case SCENE_OBJECT_TEXT:
+        return scene_text_from_object(object)->shader_index;
+    }
+    ww_unreachable();
+}
+
+static bool
+profile_begin(struct scene *scene, struct scene_object *object) {
+    // The OpenGL context must be current.
+    struct scene_profile *profile = scene->profile;
+    if (!profile || !profile->recording) {
+        return false;
+    }
+
+    struct profile_frame *frame = &profile->frames[profile->current];
+    if (frame->count == PROFILE_MAX_QUERIES) {
+        return false;
+    }
+
+    size_t i = frame->count++;
+    frame->objects[i] = object;
+    frame->shaders[i] = object_shader_index(object);
+    scene->gl->gles.BeginQueryEXT(GL_TIME_ELAPSED_EXT, frame->queries[i]);
+
+    return true;
+}
+
+static void
+profile_forget(struct scene *scene, struct scene_object *object) {
+    if (!scene->profile) {
+        return;
+    }
+
+    // The results of queries which are still in flight are kept for the object's shader, but the
+    // object itself must no longer be referenced.
+    for (size_t i = 0; i < PROFILE_FRAMES; i++) {
+        struct profile_frame *frame = &scene->profile->frames[i];
+        for (size_t j = 0; j < frame->count; j++) {
+            if (frame->objects[j] == object) {
+                frame->objects[j] = nullptr;
+            }
+        }
+    }
+}
+
+static void
+profile_publish_debug(struct scene *scene) {
+    struct scene_profile *profile = scene->profile;
+
+    char *buf = util_debug_data.profile.table;
+    size_t size = sizeof(util_debug_data.profile.table);
+    size_t len = 0;
+
+    for (size_t i = 0; i < scene->shaders.count && len < size; i++) {
+        len += snprintf(buf + len, size - len, "  %-16s %7.3f\n", scene->shaders.data[i].name,
+                        profile->shader_ms[i]);
+    }
+
+    // Only the most expensive objects are listed, in descending order.
+    struct scene_timing timings[PROFILE_MAX_QUERIES];
+    size_t num_timings = scene_get_object_timings(scene, timings, STATIC_ARRLEN(timings));
+    num_timings = num_timings < STATIC_ARRLEN(timings) ? num_timings : STATIC_ARRLEN(timings);
+
+    struct scene_timing top[PROFILE_DEBUG_OBJECTS] = {};
+    size_t num_top = num_timings < PROFILE_DEBUG_OBJECTS ? num_timings : PROFILE_DEBUG_OBJECTS;
+    for (size_t i = 0; i < num_timings; i++) {
+        for (size_t j = 0; j < num_top; j++) {
+            if (!top[j].type || timings[i].ms > top[j].ms) {
+                memmove(&top[j + 1], &top[j], (num_top - j - 1) * sizeof(*top));
+                top[j] = timings[i];
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < num_top && len < size; i++) {
+        len += snprintf(buf + len, size - len, "  %-6s %4" PRIi32 ",%4" PRIi32 " %-9s %7.3f\n",
+                        top[i].type, top[i].bounds.x, top[i].bounds.y, top[i].shader, top[i].ms);
+    }
+}
+
+static void
+profile_collect(struct scene *scene) {
+    // The OpenGL context must be current.
+    struct scene_profile *profile = scene->profile;
+
+    // A disjoint operation (such as the GPU changing its clock speed) invalidates the results of
+    // every timer query which is in flight.
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+    for (size_t i = 0; i < PROFILE_FRAMES; i++) {
+        struct profile_frame *frame = &profile->frames[i];
+        if (!frame->pending) {
+            continue;
+        }
+
+        if (!disjoint && frame->count > 0) {
+            // Queries complete in order, so the whole frame is available once its last query is.
+            GLuint available = 0;
+            scene->gl->gles.GetQueryObjectuivEXT(frame->queries[frame->count - 1],
+                                                 GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+            if (!available) {
+                continue;
+            }
+
+            for (size_t j = 0; j < frame->count; j++) {
+                GLuint64 ns = 0;
+                scene->gl->gles.GetQueryObjectui64vEXT(frame->queries[j], GL_QUERY_RESULT_EXT,
+                                                       &ns);
+
+                profile->shader_ns[frame->shaders[j]] += ns;
+                if (frame->objects[j]) {
+                    frame->objects[j]->timing.ns += ns;
+                    frame->objects[j]->timing.draws++;
+                }
+            }
+        }
+
+        if (!disjoint) {
+            profile->window_frames++;
+        }
+        frame->pending = false;
+    }
+
+    // Publish the averages from the last window once per second.
+    uint64_t now = current_time();
+    if (now - profile->window_start < 1000) {
+        return;
+    }
+
+    double frames = profile->window_frames > 0 ? profile->window_frames : 1;
+    for (size_t i = 0; i < scene->shaders.count; i++) {
+        profile->shader_ms[i] = (float)(profile->shader_ns[i] / 1e6 / frames);
+        profile->shader_ns[i] = 0;
+    }
+
+    struct wl_list *lists[] = {
+        &scene->objects.sorted,
+        &scene->objects.unsorted_images,
+        &scene->objects.unsorted_mirrors,
+        &scene->objects.unsorted_text,
+    };
+    for (size_t i = 0; i < STATIC_ARRLEN(lists); i++) {
+        struct scene_object *object;
+        wl_list_for_each (object, lists[i], link) {
+            object->timing.ms = (float)(object->timing.ns / 1e6 / frames);
+            object->timing.timed = (object->timing.draws > 0);
+            object->timing.ns = 0;
+            object->timing.draws = 0;
+        }
+    }
+
+    profile->window_start = now;
+    profile->window_frames = 0;
+
+    if (util_debug_enabled) {
+        profile_publish_debug(scene);
+    }
+}
+
+static void
+profile_frame_begin(struct scene *scene) {
+    // The OpenGL context must be current.
+    struct scene_profile *profile = scene->profile;
+    if (!profile) {
+        return;
+    }
+
+    profile_collect(scene);
+
+    // If the GPU has fallen far enough behind that every set of queries is still in flight, this
+    // frame is not timed.
+    size_t next = (profile->current + 1) % PROFILE_FRAMES;
+    if (profile->frames[next].pending) {
+        return;
+    }
+
+    profile->current = next;
+    profile->frames[next].count = 0;
+    profile->recording = true;
+}
+
+static void
+profile_frame_end(struct scene *scene) {
+    struct scene_profile *profile = scene->profile;
+    if (!profile || !profile->recording) {
+        return;
+    }
+
+    profile->frames[profile->current].pending = true;
+    profile->recording = false;
+}
+
+static void
+profile_destroy(struct scene *scene) {
+    // The OpenGL context must be current.
+    struct scene_profile *profile = scene->profile;
+    if (!profile) {
+        return;
+    }
+
+    for (size_t i = 0; i < PROFILE_FRAMES; i++) {
+        scene->gl->gles.DeleteQueriesEXT(PROFILE_MAX_QUERIES, profile->frames[i].queries);
+    }
+    free(profile->shader_ns);
+    free(profile->shader_ms);
+    free(profile);
+
+    scene->profile = nullptr;
+}
+
+static void
+object_add(struct scene *scene, struct scene_object *object, enum scene_object_type type) {
+    object->parent = scene;
+    object->type = type;
+    object->transform = (struct scene_transform){
+        .x = object->x,
+        .y = object->y,
+        .rgba = {1.0f, 1.0f, 1.0f, 1.0f},
+    };
+    object_sort(scene, object);
+}
+
+static void
+object_list_destroy(struct wl_list *list) {
+    struct scene_object *object, *tmp;
+
+    wl_list_for_each_safe (object, tmp, list, link) {
+        wl_list_remove(&object->link);
+        wl_list_init(&object->link);
+
+        object_release(object);
+    }
+}
+
+static void
+object_release(struct scene_object *object) {
+    switch (object->type) {
+    case SCENE_OBJECT_IMAGE:
+        image_release(object);
+        break;
+    case SCENE_OBJECT_MIRROR:
+        mirror_release(object);
+        break;
+    case SCENE_OBJECT_TEXT:
+        text_release(object);
+        break;
+    }
+}
+
+static void
+object_render(struct scene_object *object) {
+    if (!object_visible(object)) {
+        return;
+    }
+
+    struct scene *scene = object->parent;
+    if (scene->target == SCENE_TARGET_PROJECTOR && !object->projector.enabled) {
+        return;
+    }
+
+    // Only draws to the overlay are timed.
+    bool timed = scene->target == SCENE_TARGET_OVERLAY && profile_begin(scene, object);
+
+    switch (object->type) {
+    case SCENE_OBJECT_IMAGE:
+        image_render(object);
+        break;
+    case SCENE_OBJECT_MIRROR:
+        mirror_render(object);
+        break;
+    case SCENE_OBJECT_TEXT:
+        text_render(object);
+        break;
+    }
+
+    if (timed) {
+        scene->gl->gles.EndQueryEXT(GL_TIME_ELAPSED_EXT);
+    }
+}
+
+static void
+object_sort(struct scene *scene, struct scene_object *object) {
+    if (object->depth == 0) {
+        switch (object->type) {
+        case SCENE_OBJECT_IMAGE:
+            wl_list_insert(&scene->objects.unsorted_images, &object->link);
+            break;
+        case SCENE_OBJECT_MIRROR:
+            wl_list_insert(&scene->objects.unsorted_mirrors, &object->link);
+            break;
+        case SCENE_OBJECT_TEXT:
+            wl_list_insert(&scene->objects.unsorted_text, &object->link);
+            break;
+        }
+
+        return;
+    }
+
+    struct scene_object *needle = nullptr, *prev = nullptr;
+    wl_list_for_each (needle, &scene->objects.sorted, link) {
+        if (needle->depth >= object->depth) {
+            break;
+        }
+
+        prev = needle;
+    }
+
+    if (prev) {
+        wl_list_insert(&prev->link, &object->link);
+    } else {
+        wl_list_insert(&scene->objects.sorted, &object->link);
+    }
+}
+
+static void
+object_get_anchor_point(struct scene_object *object, int32_t *x, int32_t *y) {
+    struct scene *scene = object->parent;
+
+    struct box *target = (object->anchor.target == SCENE_ANCHOR_GAME) ? &scene->anchors.game
+                                                                      : &scene->anchors.screen;
+
+    // Anchor positions are laid out in rows of three, from left to right and top to bottom.
+    int column = object->anchor.position % 3;
+    int row = object->anchor.position / 3;
+
+    *x = target->x + (target->width * column) / 2;
+    *y = target->y + (target->height * row) / 2;
+}
+
+static struct box
+object_get_bounds(struct scene_object *object) {
+    int32_t origin_x, origin_y;
+    object_get_anchor_point(object, &origin_x, &origin_y);
+
+    // The bounds are rounded outwards, since an object may be placed at a fractional position
+    // while it is being animated.
+    float x = origin_x + object->transform.x + (object->bounds.x - object->x);
+    float y = origin_y + object->transform.y + (object->bounds.y - object->y);
+    int32_t x1 = (int32_t)floorf(x);
+    int32_t y1 = (int32_t)floorf(y);
+    int32_t x2 = (int32_t)ceilf(x + object->bounds.width);
+    int32_t y2 = (int32_t)ceilf(y + object->bounds.height);
+
+    return (struct box){x1, y1, x2 - x1, y2 - y1};
+}
+
+static void
+object_use_transform(struct scene_object *object, struct scene_shader *shader) {
+    // The OpenGL context must be current.
+
+    // Objects are moved (and kept at their anchor) by offsetting their vertices in the vertex
+    // shader, so that their vertex buffers do not need to be rebuilt. Passing no object resets the
+    // transform for other draws.
+    if (!object) {
+        glUniform2f(shader->shader_u_offset, 0.0f, 0.0f);
+        glUniform4f(shader->shader_u_tint, 1.0f, 1.0f, 1.0f, 1.0f);
+        return;
+    }
+
+    // In the projector, the object's bounds are mapped onto its place in the projector window
+    // instead. Scaling the destination size along with the offset lets any shader draw the object
+    // at a different size without its vertex buffer being rebuilt.
+    struct scene *scene = object->parent;
+    if (scene->target == SCENE_TARGET_PROJECTOR) {
+        const struct box *src = &object->bounds;
+        const struct box *dst = &object->projector.dst;
+
+        float scale_x = (dst->width > 0 && src->width > 0) ? (float)dst->width / src->width : 1;
+        float scale_y =
+            (dst->height > 0 && src->height > 0) ? (float)dst->height / src->height : 1;
+
+        glUniform2f(shader->shader_u_dst_size, scene->gl->projector.width / scale_x,
+                    scene->gl->projector.height / scale_y);
+        glUniform2f(shader->shader_u_offset, dst->x / scale_x - src->x, dst->y / scale_y - src->y);
+        glUniform4fv(shader->shader_u_tint, 1, object->transform.rgba);
+        return;
+    }
+
+    int32_t origin_x, origin_y;
+    object_get_anchor_point(object, &origin_x, &origin_y);
+
+    glUniform2f(shader->shader_u_offset, origin_x + object->transform.x - object->x,
+                origin_y + object->transform.y - object->y);
+    glUniform4fv(shader->shader_u_tint, 1, object->transform.rgba);
+}
+
+static bool
+object_visible(struct scene_object *object) {
+    // Objects restricted to a specific resolution are kept around (along with their vertex buffers
+    // and textures) while hidden, so that switching resolutions does not need to allocate.
+    if (object->visible_at.enabled) {
+        struct scene *scene = object->parent;
+        if (object->visible_at.width != scene->active_res.width ||
+            object->visible_at.height != scene->active_res.height) {
+            return false;
+        }
+    }
+
+    return object->transform.rgba[3] > 0.0f;
+}
+
+static float
+ease(enum scene_easing easing, float t) {
+    switch (easing) {
+    case SCENE_EASING_LINEAR:
+        return t;
+    case SCENE_EASING_IN:
+        return t * t;
+    case SCENE_EASING_OUT:
+        return t * (2.0f - t);
+    case SCENE_EASING_IN_OUT:
+        return t * t * (3.0f - 2.0f * t);
+    }
+
+    ww_unreachable();
+}
+
+static uint64_t
+current_time() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+static void
+object_animate(struct scene_object *object, uint64_t now) {
+    if (!object->animation.active) {
+        return;
+    }
+
+    uint64_t elapsed = now - object->animation.start;
+    if (elapsed >= object->animation.duration) {
+        object->transform = object->animation.to;
+        object->animation.active = false;
+        return;
+    }
+
+    float t = (float)elapsed / object->animation.duration;
+    float k = ease(object->animation.easing, t);
+    const struct scene_transform *from = &object->animation.from;
+    const struct scene_transform *to = &object->animation.to;
+
+    object->transform.x = from->x + (to->x - from->x) * k;
+    object->transform.y = from->y + (to->y - from->y) * k;
+    for (size_t i = 0; i < 4; i++) {
+        object->transform.rgba[i] = from->rgba[i] + (to->rgba[i] - from->rgba[i]) * k;
+    }
+}
+
+static void
+animate_objects(struct scene *scene) {
+    uint64_t now = current_time();
+
+    struct scene_object *object;
+    wl_list_for_each (object, &scene->objects.sorted, link) {
+        object_animate(object, now);
+    }
+    wl_list_for_each (object, &scene->objects.unsorted_images, link) {
+        object_animate(object, now);
+    }
+    wl_list_for_each (object, &scene->objects.unsorted_mirrors, link) {
+        object_animate(object, now);
+    }
+    wl_list_for_each (object, &scene->objects.unsorted_text, link) {
+        object_animate(object, now);
+    }
+}
+
+static void
+draw_stencil(struct scene *scene) {
+    // The OpenGL context must be current.
+
+    GLuint tex = server_gl_get_capture(scene->gl);
+    if (tex == 0) {
+        return;
+    }
+
+    // The stencil covers the game as it is drawn on screen, which may be scaled (see
+    // window.render_scale). update_anchors has already accounted for that.
+    const struct box *game = &scene->anchors.game;
+
+    // It would be possible to listen for resizes instead of checking whether the stencil buffer
+    // needs an update every frame, but that would be more complicated and there is also no event
+    // for the game being resized (as of writing this comment, at least.)
+    //
+    // TODO: Is it possible to avoid the frame of leeway? Would also be nice to avoid it in
+    // draw_frame. This stuff really should be synchronized with the surface content. Might be worth
+    // always doing compositing if scene objects are visible but I'm not very happy with that
+    // solution.
+    bool stencil_equal = scene->ui->render_width == scene->prev_frame.width &&
+                         scene->ui->render_height == scene->prev_frame.height &&
+                         memcmp(game, &scene->prev_frame.game, sizeof(*game)) == 0 &&
+                         memcmp(&scene->frame_bounds, &scene->prev_frame.bounds,
+                                sizeof(scene->frame_bounds)) == 0;
+    if (stencil_equal) {
+        scene->prev_frame.equal_frames++;
+        if (scene->prev_frame.equal_frames > 1) {
+            return;
+        }
+    }
+
+    scene->prev_frame.width = scene->ui->render_width;
+    scene->prev_frame.height = scene->ui->render_height;
+    scene->prev_frame.game = *game;
     scene->prev_frame.equal_frames = 0;
 
     glClearStencil(0);
@@ -435,20 +1885,14 @@ draw_stencil(struct scene *scene) {
     glStencilFunc(GL_ALWAYS, 1, 0xFF);
     glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
 
-    struct box dst = {
-        .x = (scene->ui->render_width / 2) - (width / 2),
-        .y = (scene->ui->render_height / 2) - (height / 2),
-        .width = width,
-        .height = height,
-    };
-
     struct vtx_shader buf[6];
-    rect_build(buf, &(struct box){0, 0, 1, 1}, &dst, (float[4]){}, (float[4]){});
-    gl_using_buffer(GL_ARRAY_BUFFER, scene->buffers.stencil_rect) {
-        gl_using_texture(GL_TEXTURE_2D, tex) {
+    rect_build(buf, &(struct box){0, 0, 1, 1}, game, (float[4]){}, (float[4]){});
+    gl_using_buffer(scene->gl, GL_ARRAY_BUFFER, scene->buffers.stencil_rect) {
+        gl_using_texture(scene->gl, GL_TEXTURE_2D, tex) {
             glBufferData(GL_ARRAY_BUFFER, sizeof(buf), buf, GL_STATIC_DRAW);
             server_gl_shader_use(scene->shaders.data[0].shader);
-            draw_vertex_list(&scene->shaders.data[0], 6);
+            object_use_transform(nullptr, &scene->shaders.data[0]);
+            draw_vertex_list(scene, scene->buffers.stencil_rect_vao, 6);
         }
     }
 
@@ -457,6 +1901,17 @@ draw_stencil(struct scene *scene) {
     glDisable(GL_STENCIL_TEST);
 }
 
+static void
+build_debug_text(struct scene *scene) {
+    // The OpenGL context must be current.
+    const char *str = util_debug_str();
+    scene->buffers.debug_vtxcount = text_build(
+        scene->buffers.debug, scene, str,
+        &(struct scene_text_options){
+            .x = 8, .y = 8, .rgba = {1, 1, 1, 1}, .size_multiplier = 1, .shader_name = nullptr},
+        &scene->buffers.debug_bounds);
+}
+
 static void
 draw_debug_text(struct scene *scene) {
     // The OpenGL context must be current.
@@ -464,58 +1919,233 @@ draw_debug_text(struct scene *scene) {
     glUniform2f(scene->shaders.data[0].shader_u_dst_size, scene->ui->render_width,
                 scene->ui->render_height);
     glUniform2f(scene->shaders.data[0].shader_u_src_size, ATLAS_WIDTH, ATLAS_HEIGHT);
+    object_use_transform(nullptr, &scene->shaders.data[0]);
 
-    const char *str = util_debug_str();
-    scene->buffers.debug_vtxcount = text_build(
-        scene->buffers.debug, scene, str,
-        &(struct scene_text_options){
-            .x = 8, .y = 8, .rgba = {1, 1, 1, 1}, .size_multiplier = 1, .shader_name = nullptr});
+    gl_using_buffer(scene->gl, GL_ARRAY_BUFFER, scene->buffers.debug) {
+        gl_using_texture(scene->gl, GL_TEXTURE_2D, scene->buffers.font_tex) {
+            draw_vertex_list(scene, scene->buffers.debug_vao, scene->buffers.debug_vtxcount);
+        }
+    }
+}
+
+static void
+textures_evict(struct scene *scene) {
+    // The OpenGL context must be current.
+    if (scene->textures.budget == 0) {
+        return;
+    }
+
+    // Evict the least recently drawn textures of hidden images until the budget is met. Visible
+    // images are never evicted, so the budget can still be exceeded if too many are shown at once.
+    struct scene_image *image;
+    wl_list_for_each_reverse (image, &scene->textures.images, texture_link) {
+        size_t usage = scene->textures.usage + ATLAS_BYTES + scene->gl->capture.bytes;
+        if (usage <= scene->textures.budget) {
+            return;
+        }
+
+        if (image->tex && !object_visible(&image->object)) {
+            image_evict(image);
+        }
+    }
+}
+
+static void
+update_textures(struct scene *scene) {
+    // The OpenGL context must be current.
+    struct scene_image *image;
+    wl_list_for_each (image, &scene->textures.images, texture_link) {
+        if (!image->tex && object_visible(&image->object)) {
+            image_upload(image);
+        }
+    }
+
+    textures_evict(scene);
 
-    gl_using_buffer(GL_ARRAY_BUFFER, scene->buffers.debug) {
-        gl_using_texture(GL_TEXTURE_2D, scene->buffers.font_tex) {
-            draw_vertex_list(&scene->shaders.data[0], scene->buffers.debug_vtxcount);
+    if (!util_debug_enabled) {
+        return;
+    }
+
+    size_t num_images = 0, num_resident = 0;
+    wl_list_for_each (image, &scene->textures.images, texture_link) {
+        num_images++;
+        if (image->tex) {
+            num_resident++;
+        }
+    }
+
+    WW_DEBUG(textures.images, scene->textures.usage);
+    WW_DEBUG(textures.font, ATLAS_BYTES);
+    WW_DEBUG(textures.capture, scene->gl->capture.bytes);
+    WW_DEBUG(textures.budget, scene->textures.budget);
+    WW_DEBUG(textures.num_images, num_images);
+    WW_DEBUG(textures.num_resident, num_resident);
+}
+
+static void
+update_anchors(struct scene *scene) {
+    scene->anchors.screen = (struct box){0, 0, scene->ui->render_width, scene->ui->render_height};
+    scene->anchors.game = scene->anchors.screen;
+
+    if (server_gl_get_capture(scene->gl) == 0) {
+        return;
+    }
+
+    struct server_view *view = nullptr, *iter;
+    wl_list_for_each (iter, &scene->ui->views, link) {
+        if (iter->surface == scene->gl->capture.surface) {
+            view = iter;
+            break;
+        }
+    }
+    if (!view || !view->current.centered) {
+        return;
+    }
+
+    // The game is centered within the window and may be scaled (see window.render_scale), so its
+    // rectangle is derived from the size of its most recent buffer.
+    int32_t width, height;
+    server_gl_get_capture_size(scene->gl, &width, &height);
+    width = (int32_t)(width / view->current.scale);
+    height = (int32_t)(height / view->current.scale);
+
+    scene->anchors.game = (struct box){
+        .x = (scene->ui->render_width / 2) - (width / 2),
+        .y = (scene->ui->render_height / 2) - (height / 2),
+        .width = width,
+        .height = height,
+    };
+}
+
+static void
+update_active_res(struct scene *scene) {
+    if (!scene->pending_res.active) {
+        return;
+    }
+
+    bool ready = current_time() >= scene->pending_res.deadline;
+    if (!ready && server_gl_get_capture(scene->gl) != 0) {
+        int32_t width, height;
+        server_gl_get_capture_size(scene->gl, &width, &height);
+
+        ready = (width == scene->pending_res.buffer_width &&
+                 height == scene->pending_res.buffer_height);
+    }
+    if (!ready) {
+        return;
+    }
+
+    scene->active_res.width = scene->pending_res.width;
+    scene->active_res.height = scene->pending_res.height;
+    scene->pending_res.active = false;
+}
+
+static struct box
+get_frame_bounds(struct scene *scene) {
+    struct box bounds = {};
+
+    struct wl_list *lists[] = {
+        &scene->objects.sorted,
+        &scene->objects.unsorted_images,
+        &scene->objects.unsorted_mirrors,
+        &scene->objects.unsorted_text,
+    };
+    for (size_t i = 0; i < STATIC_ARRLEN(lists); i++) {
+        struct scene_object *object;
+        wl_list_for_each (object, lists[i], link) {
+            if (object_visible(object)) {
+                struct box object_bounds = object_get_bounds(object);
+                box_union(&bounds, &object_bounds);
+            }
         }
     }
+    if (util_debug_enabled) {
+        box_union(&bounds, &scene->buffers.debug_bounds);
+    }
+
+    // Clip the bounds to the window. If nothing is visible, a single pixel is still used so that
+    // there is always a valid buffer size.
+    int32_t x1 = bounds.x > 0 ? bounds.x : 0;
+    int32_t y1 = bounds.y > 0 ? bounds.y : 0;
+    int32_t x2 = bounds.x + bounds.width;
+    int32_t y2 = bounds.y + bounds.height;
+    x2 = x2 < scene->ui->render_width ? x2 : scene->ui->render_width;
+    y2 = y2 < scene->ui->render_height ? y2 : scene->ui->render_height;
+
+    if (x2 <= x1 || y2 <= y1) {
+        return (struct box){0, 0, 1, 1};
+    }
+    return (struct box){x1, y1, x2 - x1, y2 - y1};
 }
 
-static inline bool
+static bool
 should_draw_frame(struct scene *scene) {
-    return util_debug_enabled || wl_list_length(&scene->objects.sorted) ||
-           wl_list_length(&scene->objects.unsorted_text) ||
-           wl_list_length(&scene->objects.unsorted_mirrors) ||
-           wl_list_length(&scene->objects.unsorted_images);
+    if (util_debug_enabled) {
+        return true;
+    }
+
+    struct wl_list *lists[] = {
+        &scene->objects.sorted,
+        &scene->objects.unsorted_images,
+        &scene->objects.unsorted_mirrors,
+        &scene->objects.unsorted_text,
+    };
+    for (size_t i = 0; i < STATIC_ARRLEN(lists); i++) {
+        struct scene_object *object;
+        wl_list_for_each (object, lists[i], link) {
+            if (object_visible(object)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
 }
 
 static void
 draw_frame(struct scene *scene) {
     // The OpenGL context must be current.
 
+    if (util_debug_enabled) {
+        build_debug_text(scene);
+    }
+
+    update_active_res(scene);
+    update_anchors(scene);
+    update_live_text(scene);
+    animate_objects(scene);
+    update_textures(scene);
+
+    // When there is nothing to draw, the overlay surface is unmapped instead of being given blank
+    // frames. Committing the overlay and game subsurfaces at separate times tends to break VRR,
+    // and an unmapped overlay leaves the host compositor free to scan out the game directly.
+    if (!should_draw_frame(scene)) {
+        server_gl_unmap(scene->gl);
+        return;
+    }
+
+    // The overlay surface only covers the area occupied by visible objects, which saves on fill
+    // rate and on compositing work in the host compositor. The viewport is offset so that the
+    // rest of the scene can keep drawing in window coordinates.
+    struct box bounds = get_frame_bounds(scene);
+    server_gl_set_bounds(scene->gl, &bounds);
+    scene->prev_frame.bounds = scene->frame_bounds;
+    scene->frame_bounds = bounds;
+
     glClearColor(0, 0, 0, 0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glEnable(GL_BLEND);
-    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
+    server_gl_set_blend(scene->gl, true);
+    server_gl_set_blend_func(scene->gl, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
 
-    glViewport(0, 0, scene->ui->render_width, scene->ui->render_height);
+    glViewport(-bounds.x, bounds.y + bounds.height - scene->ui->render_height,
+               scene->ui->render_width, scene->ui->render_height);
 
-    if (!should_draw_frame(scene)) {
-        // TODO: Scene rendering could potentially be synchronized with the game subsurface (or
-        // waywall could implement basic compositing) to avoid the need for this. Committing the
-        // scene subsurface and game subsurface at separate times tends to break VRR, so not
-        // committing new blank frames to the scene subsurface when there is nothing to draw is an
-        // easy workaround to get VRR to work most of the time.
-        //
-        // HACK: It should only be necessary to draw and commit one blank frame before pausing the
-        // drawing of new frames. However, in some unknown circumstances, Hyprland seems to never
-        // render the last blank frame that gets committed, leaving the last drawn frame of the
-        // scene visible. Rendering two blank frames appears to solve the issue.
-        scene->skipped_frames++;
-        if (scene->skipped_frames > 2) {
-            return;
-        }
-    } else {
-        scene->skipped_frames = 0;
+    // GPU timing is always enabled while the debug text is shown.
+    if (util_debug_enabled && !scene->profile) {
+        scene_enable_profiling(scene);
     }
+    profile_frame_begin(scene);
 
     draw_stencil(scene);
     glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
@@ -535,13 +2165,13 @@ draw_frame(struct scene *scene) {
     glDisable(GL_STENCIL_TEST);
 
     wl_list_for_each (object, &scene->objects.unsorted_mirrors, link) {
-        mirror_render(object);
+        object_render(object);
     }
     wl_list_for_each (object, &scene->objects.unsorted_images, link) {
-        image_render(object);
+        object_render(object);
     }
     wl_list_for_each (object, &scene->objects.unsorted_text, link) {
-        text_render(object);
+        object_render(object);
     }
     if (positive_depth) {
         wl_list_for_each (object, positive_depth, link) {
@@ -549,18 +2179,57 @@ draw_frame(struct scene *scene) {
         }
     }
 
+    profile_frame_end(scene);
+
     if (util_debug_enabled) {
         draw_debug_text(scene);
     }
 
-    glUseProgram(0);
     server_gl_swap_buffers(scene->gl);
 }
 
 static void
-draw_vertex_list(struct scene_shader *shader, size_t num_vertices) {
-    // The OpenGL context must be current, a texture must be bound to copy from, a vertex buffer
-    // with data must be bound, and a valid shader must be in use.
+draw_projector(struct scene *scene) {
+    // The OpenGL context must be current.
+
+    if (!server_gl_projector_begin(scene->gl)) {
+        return;
+    }
+
+    // Objects are drawn in the same order as in the overlay, but without the stencil which hides
+    // negative depth objects behind the game.
+    scene->target = SCENE_TARGET_PROJECTOR;
+    server_gl_set_blend(scene->gl, true);
+    server_gl_set_blend_func(scene->gl, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
+
+    struct scene_object *object;
+    wl_list_for_each (object, &scene->objects.sorted, link) {
+        if (object->depth < 0) {
+            object_render(object);
+        }
+    }
+    wl_list_for_each (object, &scene->objects.unsorted_mirrors, link) {
+        object_render(object);
+    }
+    wl_list_for_each (object, &scene->objects.unsorted_images, link) {
+        object_render(object);
+    }
+    wl_list_for_each (object, &scene->objects.unsorted_text, link) {
+        object_render(object);
+    }
+    wl_list_for_each (object, &scene->objects.sorted, link) {
+        if (object->depth > 0) {
+            object_render(object);
+        }
+    }
+
+    scene->target = SCENE_TARGET_OVERLAY;
+    server_gl_projector_swap(scene->gl);
+}
+
+static void
+vertex_attribs_set() {
+    // The OpenGL context must be current and a vertex buffer must be bound.
 
     glVertexAttribPointer(SHADER_SRC_POS_ATTRIB_LOC, 2, GL_FLOAT, GL_FALSE,
                           sizeof(struct vtx_shader),
@@ -574,18 +2243,86 @@ draw_vertex_list(struct scene_shader *shader, size_t num_vertices) {
     glVertexAttribPointer(SHADER_DST_RGBA_ATTRIB_LOC, 4, GL_FLOAT, GL_FALSE,
                           sizeof(struct vtx_shader),
                           (const void *)offsetof(struct vtx_shader, dst_rgba));
+}
+
+static GLuint
+vertex_array_create(struct scene *scene, GLuint vbo) {
+    // The OpenGL context must be current.
+
+    if (!scene->gl->gles.GenVertexArrays) {
+        return 0;
+    }
 
+    // Every shader uses the same attribute locations, so the vertex array object records the
+    // layout of the vertex buffer once instead of it being specified again on every draw.
+    GLuint vao = 0;
+    scene->gl->gles.GenVertexArrays(1, &vao);
+    ww_assert(vao != 0);
+
+    // The enabled attributes are part of the vertex array object's own state, so they are not
+    // tracked by server_gl_enable_attribs.
+    server_gl_bind_vertex_array(scene->gl, vao);
+    gl_using_buffer(scene->gl, GL_ARRAY_BUFFER, vbo) {
+        vertex_attribs_set();
+    }
     glEnableVertexAttribArray(SHADER_SRC_POS_ATTRIB_LOC);
     glEnableVertexAttribArray(SHADER_DST_POS_ATTRIB_LOC);
     glEnableVertexAttribArray(SHADER_SRC_RGBA_ATTRIB_LOC);
     glEnableVertexAttribArray(SHADER_DST_RGBA_ATTRIB_LOC);
 
+    return vao;
+}
+
+static void
+vertex_array_destroy(struct scene *scene, GLuint vao) {
+    // The OpenGL context must be current.
+
+    if (vao != 0) {
+        server_gl_delete_vertex_arrays(scene->gl, 1, &vao);
+    }
+}
+
+static void
+draw_vertex_list(struct scene *scene, GLuint vao, size_t num_vertices) {
+    // The OpenGL context must be current, a texture must be bound to copy from, and a valid shader
+    // must be in use. If there is no vertex array object (vao is 0), a vertex buffer with data
+    // must be bound.
+
+    if (vao != 0) {
+        server_gl_bind_vertex_array(scene->gl, vao);
+        glDrawArrays(GL_TRIANGLES, 0, num_vertices);
+        return;
+    }
+
+    if (scene->gl->gles.BindVertexArray) {
+        server_gl_bind_vertex_array(scene->gl, 0);
+    }
+    vertex_attribs_set();
+    server_gl_enable_attribs(scene->gl, (1u << SHADER_SRC_POS_ATTRIB_LOC) |
+                                            (1u << SHADER_DST_POS_ATTRIB_LOC) |
+                                            (1u << SHADER_SRC_RGBA_ATTRIB_LOC) |
+                                            (1u << SHADER_DST_RGBA_ATTRIB_LOC));
     glDrawArrays(GL_TRIANGLES, 0, num_vertices);
+}
+
+static void
+box_union(struct box *dst, const struct box *src) {
+    if (src->width <= 0 || src->height <= 0) {
+        return;
+    }
+    if (dst->width <= 0 || dst->height <= 0) {
+        *dst = *src;
+        return;
+    }
+
+    int32_t x1 = dst->x < src->x ? dst->x : src->x;
+    int32_t y1 = dst->y < src->y ? dst->y : src->y;
+    int32_t x2 = dst->x + dst->width > src->x + src->width ? dst->x + dst->width
+                                                           : src->x + src->width;
+    int32_t y2 = dst->y + dst->height > src->y + src->height ? dst->y + dst->height
+                                                             : src->y + src->height;
 
-    glDisableVertexAttribArray(SHADER_SRC_POS_ATTRIB_LOC);
-    glDisableVertexAttribArray(SHADER_DST_POS_ATTRIB_LOC);
-    glDisableVertexAttribArray(SHADER_SRC_RGBA_ATTRIB_LOC);
-    glDisableVertexAttribArray(SHADER_DST_RGBA_ATTRIB_LOC);
+    *dst = (struct box){x1, y1, x2 - x1, y2 - y1};
 }
 
 static void
@@ -634,29 +2371,20 @@ scene_text_from_object(struct scene_object *object) {
     return (struct scene_text *)object;
 }
 
-static bool
-image_load(struct scene_image *out, struct scene *scene, const char *path) {
-    struct util_png png = util_png_decode(path, scene->image_max_size);
-    if (!png.data) {
-        return false;
-    }
-
-    out->width = png.width;
-    out->height = png.height;
+static void
+image_upload(struct scene_image *image) {
+    // The OpenGL context must be current.
+    struct scene *scene = image->parent;
 
-    // Upload the decoded image data to a new OpenGL texture.
-    server_gl_with(scene->gl, false) {
-        glGenTextures(1, &out->tex);
-        gl_using_texture(GL_TEXTURE_2D, out->tex) {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, png.width, png.height, 0, GL_RGBA,
-                         GL_UNSIGNED_BYTE, png.data);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        }
+    glGenTextures(1, &image->tex);
+    gl_using_texture(scene->gl, GL_TEXTURE_2D, image->tex) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image->width, image->height, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, image->pixels);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
 
-    free(png.data);
-    return true;
+    scene->textures.usage += image->bytes;
 }
 
 static int
@@ -685,16 +2413,63 @@ shader_create(struct server_gl *gl, struct scene_shader *data, char *name, const
 
     data->shader_u_src_size = glGetUniformLocation(data->shader->program, "u_src_size");
     data->shader_u_dst_size = glGetUniformLocation(data->shader->program, "u_dst_size");
+    data->shader_u_offset = glGetUniformLocation(data->shader->program, "u_offset");
+    data->shader_u_tint = glGetUniformLocation(data->shader->program, "u_tint");
+
+    return true;
+}
+
+static bool
+reduction_create(struct scene *scene) {
+    // The OpenGL context must be current.
+
+    if (!shader_create(scene->gl, &scene->reduction.count, ww_strdup("count"), nullptr,
+                       SHADER_FRAG_COUNT)) {
+        free(scene->reduction.count.name);
+        return false;
+    }
+    if (!shader_create(scene->gl, &scene->reduction.reduce, ww_strdup("reduce"), nullptr,
+                       SHADER_FRAG_REDUCE)) {
+        server_gl_shader_destroy(scene->reduction.count.shader);
+        free(scene->reduction.count.name);
+        free(scene->reduction.reduce.name);
+        return false;
+    }
+
+    if (!shader_create(scene->gl, &scene->reduction.downsample, ww_strdup("downsample"), nullptr,
+                       SHADER_FRAG_DOWNSAMPLE)) {
+        server_gl_shader_destroy(scene->reduction.count.shader);
+        server_gl_shader_destroy(scene->reduction.reduce.shader);
+        free(scene->reduction.count.name);
+        free(scene->reduction.reduce.name);
+        free(scene->reduction.downsample.name);
+        return false;
+    }
+
+    GLuint count = scene->reduction.count.shader->program;
+    scene->reduction.count_u_box = glGetUniformLocation(count, "u_box");
+    scene->reduction.count_u_colors = glGetUniformLocation(count, "u_colors");
+    scene->reduction.count_u_tolerance = glGetUniformLocation(count, "u_tolerance");
+
+    GLuint reduce = scene->reduction.reduce.shader->program;
+    scene->reduction.reduce_u_count_size = glGetUniformLocation(reduce, "u_count_size");
+    scene->reduction.reduce_u_offset = glGetUniformLocation(reduce, "u_offset");
+
+    GLuint downsample = scene->reduction.downsample.shader->program;
+    scene->reduction.downsample_u_box = glGetUniformLocation(downsample, "u_box");
+    scene->reduction.downsample_u_block = glGetUniformLocation(downsample, "u_block");
 
     return true;
 }
 
 struct scene *
-scene_create(struct config *cfg, struct server_gl *gl, struct server_ui *ui) {
+scene_create(struct config *cfg, struct server_gl *gl, struct server_ui *ui,
+             struct ww_timer *timer) {
     struct scene *scene = zalloc(1, sizeof(*scene));
 
     scene->gl = gl;
     scene->ui = ui;
+    scene->timer = timer;
 
     // Initialize OpenGL resources.
     server_gl_with(scene->gl, false) {
@@ -724,9 +2499,20 @@ scene_create(struct config *cfg, struct server_gl *gl, struct server_ui *ui) {
             ww_log(LOG_INFO, "created %s shader", cfg->shaders.data[i].name);
         }
 
+        // The reduction shaders are optional. If they fail to compile, color counting and region
+        // watching are unavailable but everything else continues to work.
+        scene->reduction.enabled = reduction_create(scene);
+        if (!scene->reduction.enabled) {
+            ww_log(LOG_WARN, "failed to create reduction shaders");
+        }
+
         // Initialize vertex buffers.
         glGenBuffers(1, &scene->buffers.debug);
         glGenBuffers(1, &scene->buffers.stencil_rect);
+        glGenBuffers(1, &scene->buffers.readback);
+        scene->buffers.debug_vao = vertex_array_create(scene, scene->buffers.debug);
+        scene->buffers.stencil_rect_vao = vertex_array_create(scene, scene->buffers.stencil_rect);
+        scene->buffers.readback_vao = vertex_array_create(scene, scene->buffers.readback);
 
         // Initialize the font texture atlas.
         glGenTextures(1, &scene->buffers.font_tex);
@@ -749,7 +2535,7 @@ scene_create(struct config *cfg, struct server_gl *gl, struct server_ui *ui) {
             }
         }
 
-        gl_using_texture(GL_TEXTURE_2D, scene->buffers.font_tex) {
+        gl_using_texture(scene->gl, GL_TEXTURE_2D, scene->buffers.font_tex) {
             glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RGBA,
                          GL_UNSIGNED_BYTE, atlas);
 
@@ -768,6 +2554,12 @@ scene_create(struct config *cfg, struct server_gl *gl, struct server_ui *ui) {
     wl_list_init(&scene->objects.unsorted_mirrors);
     wl_list_init(&scene->objects.unsorted_text);
 
+    wl_list_init(&scene->textures.images);
+    scene->textures.budget = (size_t)cfg->experimental.texture_budget * 1024 * 1024;
+
+    wl_list_init(&scene->readbacks);
+    wl_list_init(&scene->watches);
+
     return scene;
 
 fail_compile_texture_copy:
@@ -783,34 +2575,192 @@ scene_destroy(struct scene *scene) {
     object_list_destroy(&scene->objects.unsorted_mirrors);
     object_list_destroy(&scene->objects.unsorted_text);
 
+    struct scene_readback *readback, *tmp;
+    wl_list_for_each_safe (readback, tmp, &scene->readbacks, link) {
+        readback->destroy(readback->data);
+        scene_readback_destroy(readback);
+    }
+
+    struct scene_watch *watch, *tmp_watch;
+    wl_list_for_each_safe (watch, tmp_watch, &scene->watches, link) {
+        watch->destroy(watch->data);
+        scene_watch_destroy(watch);
+    }
+
     server_gl_with(scene->gl, false) {
+        profile_destroy(scene);
+
         for (size_t i = 0; i < scene->shaders.count; i++) {
             server_gl_shader_destroy(scene->shaders.data[i].shader);
             free(scene->shaders.data[i].name);
         }
 
-        glDeleteBuffers(2, (GLuint[]){scene->buffers.debug, scene->buffers.stencil_rect});
-        glDeleteTextures(1, &scene->buffers.font_tex);
+        if (scene->reduction.enabled) {
+            server_gl_shader_destroy(scene->reduction.count.shader);
+            server_gl_shader_destroy(scene->reduction.reduce.shader);
+            server_gl_shader_destroy(scene->reduction.downsample.shader);
+            free(scene->reduction.count.name);
+            free(scene->reduction.reduce.name);
+            free(scene->reduction.downsample.name);
+        }
+
+        vertex_array_destroy(scene, scene->buffers.debug_vao);
+        vertex_array_destroy(scene, scene->buffers.stencil_rect_vao);
+        vertex_array_destroy(scene, scene->buffers.readback_vao);
+        server_gl_delete_buffers(scene->gl, 3,
+                                 (GLuint[]){scene->buffers.debug, scene->buffers.stencil_rect,
+                                            scene->buffers.readback});
+        server_gl_delete_textures(scene->gl, 1, &scene->buffers.font_tex);
     }
     free(scene->shaders.data);
 
+    if (scene->poll_timer) {
+        ww_timer_entry_destroy(scene->poll_timer);
+    }
     wl_list_remove(&scene->on_gl_frame.link);
 
     free(scene);
 }
 
+uint32_t
+scene_get_fps(struct scene *scene) {
+    // The frame rate is measured from the frames presented by the game, and is updated once per
+    // second.
+    return scene->fps.value;
+}
+
+bool
+scene_enable_profiling(struct scene *scene) {
+    if (scene->profile) {
+        return true;
+    }
+    if (!scene->gl->gles.GenQueriesEXT) {
+        return false;
+    }
+
+    struct scene_profile *profile = zalloc(1, sizeof(*profile));
+    profile->shader_ns = zalloc(scene->shaders.count, sizeof(*profile->shader_ns));
+    profile->shader_ms = zalloc(scene->shaders.count, sizeof(*profile->shader_ms));
+    profile->window_start = current_time();
+
+    server_gl_with(scene->gl, false) {
+        for (size_t i = 0; i < PROFILE_FRAMES; i++) {
+            scene->gl->gles.GenQueriesEXT(PROFILE_MAX_QUERIES, profile->frames[i].queries);
+        }
+    }
+
+    scene->profile = profile;
+    return true;
+}
+
+size_t
+scene_get_shader_timings(struct scene *scene, struct scene_timing *out, size_t max) {
+    if (!scene->profile) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < scene->shaders.count && i < max; i++) {
+        out[i] = (struct scene_timing){
+            .shader = scene->shaders.data[i].name,
+            .ms = scene->profile->shader_ms[i],
+        };
+    }
+    return scene->shaders.count;
+}
+
+size_t
+scene_get_object_timings(struct scene *scene, struct scene_timing *out, size_t max) {
+    // Returns the number of objects which were drawn during the last profiling window, of which at
+    // most max are written to out.
+    if (!scene->profile) {
+        return 0;
+    }
+
+    struct wl_list *lists[] = {
+        &scene->objects.sorted,
+        &scene->objects.unsorted_images,
+        &scene->objects.unsorted_mirrors,
+        &scene->objects.unsorted_text,
+    };
+
+    size_t n = 0;
+    for (size_t i = 0; i < STATIC_ARRLEN(lists); i++) {
+        struct scene_object *object;
+        wl_list_for_each (object, lists[i], link) {
+            if (!object->timing.timed) {
+                continue;
+            }
+
+            if (n < max) {
+                out[n] = (struct scene_timing){
+                    .type = OBJECT_TYPE_NAMES[object->type],
+                    .shader = scene->shaders.data[object_shader_index(object)].name,
+                    .bounds = object_get_bounds(object),
+                    .ms = object->timing.ms,
+                };
+            }
+            n++;
+        }
+    }
+    return n;
+}
+
+void
+scene_batch_begin(struct scene *scene) {
+    // Holding the OpenGL context for the duration of the batch means that creating and destroying
+    // objects within it does not make the context current and release it once per object.
+    server_gl_enter(scene->gl, false);
+}
+
+void
+scene_batch_end(struct scene *scene) {
+    server_gl_exit(scene->gl);
+}
+
+void
+scene_set_texture_budget(struct scene *scene, size_t budget) {
+    scene->textures.budget = budget;
+
+    server_gl_with(scene->gl, false) {
+        textures_evict(scene);
+    }
+}
+
+void
+scene_set_active_res(struct scene *scene, int32_t width, int32_t height, int32_t buffer_width,
+                     int32_t buffer_height) {
+    // Objects with a visible_at resolution are not shown or hidden until the game presents a frame
+    // at the new size (or the timeout expires), so that the overlay never shows the wrong objects
+    // for the game frame beneath it. See update_active_res.
+    scene->pending_res.width = width;
+    scene->pending_res.height = height;
+    scene->pending_res.buffer_width = buffer_width;
+    scene->pending_res.buffer_height = buffer_height;
+    scene->pending_res.deadline = current_time() + SCENE_RES_TIMEOUT_MS;
+    scene->pending_res.active = true;
+}
+
 struct scene_image *
 scene_add_image(struct scene *scene, const struct scene_image_options *options, const char *path) {
     struct scene_image *image = zalloc(1, sizeof(*image));
 
-    image->parent = scene;
-
-    // Load the PNG into an OpenGL texture.
-    if (!image_load(image, scene, path)) {
+    // Decode the PNG and upload it to an OpenGL texture.
+    struct util_png png = util_png_decode(path, scene->image_max_size);
+    if (!png.data) {
         free(image);
         return nullptr;
     }
 
+    image->parent = scene;
+    image->pixels = png.data;
+    image->width = png.width;
+    image->height = png.height;
+    image->bytes = (size_t)png.width * (size_t)png.height * 4;
+
+    server_gl_with(scene->gl, false) {
+        image_upload(image);
+    }
+
     // Find correct shader for this image
     image->shader_index = shader_find_index(scene, options->shader_name);
 
@@ -818,8 +2768,19 @@ scene_add_image(struct scene *scene, const struct scene_image_options *options,
     image_build(image, scene, options, image->width, image->height);
 
     image->object.depth = options->depth;
+    image->object.bounds = options->dst;
+    image->object.x = options->dst.x;
+    image->object.y = options->dst.y;
+    image->object.anchor = options->anchor;
+    image->object.visible_at = options->visible_at;
+    image->object.projector = options->projector;
     object_add(scene, (struct scene_object *)image, SCENE_OBJECT_IMAGE);
 
+    wl_list_insert(&scene->textures.images, &image->texture_link);
+    server_gl_with(scene->gl, false) {
+        textures_evict(scene);
+    }
+
     return image;
 }
 
@@ -837,6 +2798,12 @@ scene_add_mirror(struct scene *scene, const struct scene_mirror_options *options
     mirror_build(mirror, options, scene);
 
     mirror->object.depth = options->depth;
+    mirror->object.bounds = options->dst;
+    mirror->object.x = options->dst.x;
+    mirror->object.y = options->dst.y;
+    mirror->object.anchor = options->anchor;
+    mirror->object.visible_at = options->visible_at;
+    mirror->object.projector = options->projector;
     object_add(scene, (struct scene_object *)mirror, SCENE_OBJECT_MIRROR);
 
     return mirror;
@@ -849,6 +2816,8 @@ scene_add_text(struct scene *scene, const char *data, const struct scene_text_op
     text->parent = scene;
     text->x = options->x;
     text->y = options->y;
+    text->object.x = options->x;
+    text->object.y = options->y;
 
     // Find correct shader for this text
     text->shader_index = shader_find_index(scene, options->shader_name);
@@ -856,16 +2825,247 @@ scene_add_text(struct scene *scene, const char *data, const struct scene_text_op
     server_gl_with(scene->gl, false) {
         glGenBuffers(1, &text->vbo);
         ww_assert(text->vbo);
+        text->vao = vertex_array_create(scene, text->vbo);
 
-        text->vtxcount = text_build(text->vbo, scene, data, options);
+        text->vtxcount = text_build(text->vbo, scene, data, options, &text->object.bounds);
     }
 
     text->object.depth = options->depth;
+    text->object.anchor = options->anchor;
+    text->object.visible_at = options->visible_at;
+    text->object.projector = options->projector;
     object_add(scene, (struct scene_object *)text, SCENE_OBJECT_TEXT);
 
     return text;
 }
 
+struct scene_text *
+scene_add_live_text(struct scene *scene, const struct scene_text_options *options,
+                    scene_text_source_func_t source, scene_text_source_destroy_func_t destroy,
+                    void *data) {
+    struct scene_text *text = scene_add_text(scene, "", options);
+
+    // Live text is drawn with a single style, taken from the first run if there is one.
+    if (options->num_runs > 0) {
+        text->live.style = options->runs[0];
+    } else {
+        text->live.style = (struct scene_text_run){
+            .rgba = {options->rgba[0], options->rgba[1], options->rgba[2], options->rgba[3]},
+            .size_multiplier = options->size_multiplier,
+        };
+    }
+
+    text->live.func = source;
+    text->live.destroy = destroy;
+    text->live.data = data;
+
+    return text;
+}
+
+void *
+scene_text_get_source(struct scene_text *text) {
+    return text->live.data;
+}
+
+static struct scene_readback *
+readback_create(struct scene *scene, enum scene_readback_type type, const struct box *src,
+                int32_t width, int32_t height, scene_readback_destroy_func_t destroy, void *data) {
+    struct scene_readback *readback = zalloc(1, sizeof(*readback));
+
+    readback->parent = scene;
+    readback->type = type;
+    readback->src = *src;
+    readback->width = width;
+    readback->height = height;
+    readback->destroy = destroy;
+    readback->data = data;
+
+    return readback;
+}
+
+struct scene_readback *
+scene_read_pixels(struct scene *scene, const struct box *src, scene_readback_func_t done,
+                  scene_readback_destroy_func_t destroy, void *data) {
+    if (src->width <= 0 || src->height <= 0 ||
+        (int64_t)src->width * src->height > SCENE_READBACK_MAX_PIXELS) {
+        return nullptr;
+    }
+
+    struct scene_readback *readback = readback_create(scene, SCENE_READBACK_PIXELS, src,
+                                                      src->width, src->height, destroy, data);
+    readback->done.pixels = done;
+
+    // The region is copied into a texture of its own the next time the game commits a frame. The
+    // copy is then read back once the GPU signals that it has finished.
+    bool ok = true;
+    server_gl_with(scene->gl, false) {
+        ok = readback_target_create(scene, &readback->fbo, &readback->tex, readback->width,
+                                    readback->height);
+        if (!ok) {
+            readback_release(readback);
+        }
+    }
+
+    if (!ok) {
+        ww_log(LOG_ERROR, "failed to create readback framebuffer");
+        free(readback);
+        return nullptr;
+    }
+
+    wl_list_insert(&scene->readbacks, &readback->link);
+    poll_schedule(scene);
+    return readback;
+}
+
+struct scene_readback *
+scene_count_colors(struct scene *scene, const struct box *src, const float colors[][4],
+                   size_t num_colors, uint8_t tolerance, scene_count_func_t done,
+                   scene_readback_destroy_func_t destroy, void *data) {
+    if (!scene->reduction.enabled) {
+        return nullptr;
+    }
+    if (src->width <= 0 || src->height <= 0 || src->width > SCENE_COUNT_MAX_SIZE ||
+        src->height > SCENE_COUNT_MAX_SIZE) {
+        return nullptr;
+    }
+    if (num_colors == 0 || num_colors > SCENE_COUNT_MAX_COLORS) {
+        return nullptr;
+    }
+
+    // The region is reduced in two passes, each of which sums COUNT_BLOCK*COUNT_BLOCK areas of its
+    // input. The result of the second pass is small enough (at most a few dozen pixels) that
+    // reading it back and summing it on the CPU is trivial.
+    int32_t count_width = (src->width + COUNT_BLOCK - 1) / COUNT_BLOCK;
+    int32_t count_height = (src->height + COUNT_BLOCK - 1) / COUNT_BLOCK;
+    int32_t group_width = (count_width + COUNT_BLOCK - 1) / COUNT_BLOCK * 2;
+    int32_t num_groups = (int32_t)((num_colors + COUNT_GROUP_SIZE - 1) / COUNT_GROUP_SIZE);
+
+    struct scene_readback *readback =
+        readback_create(scene, SCENE_READBACK_COUNT, src, group_width * num_groups,
+                        (count_height + COUNT_BLOCK - 1) / COUNT_BLOCK, destroy, data);
+    readback->done.count = done;
+
+    readback->count.width = count_width;
+    readback->count.height = count_height;
+    readback->count.group_width = group_width;
+    readback->count.num_colors = num_colors;
+
+    // The alpha channel of each color is used to mark it as present, since the shader always takes
+    // a full group of colors. Half a step is added to the tolerance to account for rounding.
+    for (size_t i = 0; i < num_colors; i++) {
+        memcpy(readback->count.colors[i], colors[i], sizeof(float) * 3);
+        readback->count.colors[i][3] = 1.0;
+    }
+    readback->count.tolerance = ((float)tolerance + 0.5f) / UINT8_MAX;
+
+    bool ok = true;
+    server_gl_with(scene->gl, false) {
+        ok = readback_target_create(scene, &readback->fbo, &readback->tex, readback->width,
+                                    readback->height) &&
+             readback_target_create(scene, &readback->count.fbo, &readback->count.tex,
+                                    readback->count.width, readback->count.height);
+        if (!ok) {
+            readback_release(readback);
+        }
+    }
+
+    if (!ok) {
+        ww_log(LOG_ERROR, "failed to create color count framebuffers");
+        free(readback);
+        return nullptr;
+    }
+
+    wl_list_insert(&scene->readbacks, &readback->link);
+    poll_schedule(scene);
+    return readback;
+}
+
+struct scene_readback *
+scene_screenshot(struct scene *scene, bool overlay, scene_screenshot_func_t done,
+                 scene_readback_destroy_func_t destroy, void *data) {
+    struct scene_readback *readback =
+        readback_create(scene, SCENE_READBACK_SCREENSHOT, &(struct box){}, 0, 0, destroy, data);
+    readback->done.screenshot = done;
+    readback->overlay = overlay;
+
+    // The screenshot is drawn into a texture of its own the next time the readbacks are processed,
+    // once its size is known (see readback_copy_screenshot.)
+    wl_list_insert(&scene->readbacks, &readback->link);
+    poll_schedule(scene);
+    return readback;
+}
+
+void
+scene_readback_destroy(struct scene_readback *readback) {
+    server_gl_with(readback->parent->gl, false) {
+        readback_release(readback);
+    }
+
+    wl_list_remove(&readback->link);
+    free(readback);
+}
+
+struct scene_watch *
+scene_watch_region(struct scene *scene, const struct box *src, float threshold,
+                   scene_watch_func_t changed, scene_readback_destroy_func_t destroy, void *data) {
+    if (!scene->reduction.enabled) {
+        return nullptr;
+    }
+    if (src->width <= 0 || src->height <= 0 || src->width > SCENE_WATCH_MAX_SIZE ||
+        src->height > SCENE_WATCH_MAX_SIZE) {
+        return nullptr;
+    }
+
+    struct scene_watch *watch = zalloc(1, sizeof(*watch));
+
+    watch->parent = scene;
+    watch->src = *src;
+    watch->threshold = threshold;
+    watch->func = changed;
+    watch->destroy = destroy;
+    watch->data = data;
+
+    // The region is averaged down to a small signature on the GPU each frame, so that only a few
+    // hundred bytes need to be read back and compared against the previous frame.
+    watch->width = src->width < WATCH_SIGNATURE_SIZE ? src->width : WATCH_SIGNATURE_SIZE;
+    watch->height = src->height < WATCH_SIGNATURE_SIZE ? src->height : WATCH_SIGNATURE_SIZE;
+    watch->block_width = (src->width + watch->width - 1) / watch->width;
+    watch->block_height = (src->height + watch->height - 1) / watch->height;
+
+    bool ok = true;
+    server_gl_with(scene->gl, false) {
+        ok = readback_target_create(scene, &watch->fbo, &watch->tex, watch->width,
+                                    watch->height);
+        if (!ok) {
+            watch_release(watch);
+        }
+    }
+
+    if (!ok) {
+        ww_log(LOG_ERROR, "failed to create watch framebuffer");
+        free(watch);
+        return nullptr;
+    }
+
+    wl_list_insert(&scene->watches, &watch->link);
+    return watch;
+}
+
+void
+scene_watch_destroy(struct scene_watch *watch) {
+    if (watch->parent->dispatching_watches) {
+        watch->destroyed = true;
+        return;
+    }
+
+    server_gl_with(watch->parent->gl, false) {
+        watch_release(watch);
+    }
+
+    wl_list_remove(&watch->link);
+    free(watch);
+}
+
 void
 scene_object_destroy(struct scene_object *object) {
     wl_list_remove(&object->link);
@@ -890,3 +3090,25 @@ scene_object_set_depth(struct scene_object *object, int32_t depth) {
     wl_list_remove(&object->link);
     object_sort(object->parent, object);
 }
+
+void
+scene_object_get_transform(struct scene_object *object, struct scene_transform *out) {
+    *out = object->transform;
+}
+
+void
+scene_object_set_transform(struct scene_object *object, const struct scene_transform *transform) {
+    object->transform = *transform;
+    object->animation.active = false;
+}
+
+void
+scene_object_animate(struct scene_object *object, const struct scene_transform *transform,
+                     uint32_t duration, enum scene_easing easing) {
+    object->animation.from = object->transform;
+    object->animation.to = *transform;
+    object->animation.start = current_time();
+    object->animation.duration = duration;
+    object->animation.easing = easing;
+    object->animation.active = true;
+}
@@ -0,0 +1,189 @@
+#include "screenshot.h"
+#include "server/server.h"
+#include "util/alloc.h"
+#include "util/log.h"
+#include "util/png.h"
+#include "util/prelude.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+#include <wayland-util.h>
+
+static void
+screenshot_free(struct screenshot *screenshot) {
+    free(screenshot->path);
+    free(screenshot->rgba);
+    free(screenshot);
+}
+
+static int
+handle_eventfd(int32_t fd, uint32_t mask, void *data) {
+    struct screenshot_writer *writer = data;
+
+    uint64_t value;
+    if (read(fd, &value, sizeof(value)) != sizeof(value)) {
+        ww_log_errno(LOG_ERROR, "failed to read screenshot eventfd");
+    }
+
+    struct wl_list finished;
+    wl_list_init(&finished);
+
+    pthread_mutex_lock(&writer->lock);
+    wl_list_insert_list(&finished, &writer->finished);
+    wl_list_init(&writer->finished);
+    pthread_mutex_unlock(&writer->lock);
+
+    // Callbacks may start or cancel other screenshots, so the finished screenshots are taken off
+    // the shared list before any of them are run.
+    struct screenshot *screenshot, *tmp;
+    wl_list_for_each_reverse_safe (screenshot, tmp, &finished, link) {
+        wl_list_remove(&screenshot->link);
+
+        if (screenshot->done) {
+            screenshot->done(screenshot->data, screenshot->ok);
+        }
+        screenshot_free(screenshot);
+    }
+
+    return 0;
+}
+
+static void *
+writer_thread(void *data) {
+    struct screenshot_writer *writer = data;
+
+    pthread_mutex_lock(&writer->lock);
+    for (;;) {
+        while (wl_list_empty(&writer->queue) && !writer->stopping) {
+            pthread_cond_wait(&writer->cond, &writer->lock);
+        }
+
+        // Queued screenshots are still written when the writer is stopping.
+        if (wl_list_empty(&writer->queue)) {
+            break;
+        }
+
+        struct screenshot *screenshot = wl_container_of(writer->queue.prev, screenshot, link);
+        wl_list_remove(&screenshot->link);
+        pthread_mutex_unlock(&writer->lock);
+
+        // Encoding a PNG of the whole game can take tens of milliseconds, which would otherwise
+        // hold up the event loop (and with it, input forwarding.)
+        bool ok = util_png_encode(screenshot->path, screenshot->rgba, screenshot->width,
+                                  screenshot->height);
+
+        pthread_mutex_lock(&writer->lock);
+        screenshot->ok = ok;
+        wl_list_insert(&writer->finished, &screenshot->link);
+
+        uint64_t value = 1;
+        if (write(writer->fd, &value, sizeof(value)) != sizeof(value)) {
+            ww_log_errno(LOG_ERROR, "failed to signal screenshot eventfd");
+        }
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    return nullptr;
+}
+
+struct screenshot_writer *
+screenshot_writer_create(struct server *server) {
+    struct screenshot_writer *writer = zalloc(1, sizeof(*writer));
+
+    writer->fd = eventfd(0, EFD_CLOEXEC);
+    if (writer->fd == -1) {
+        ww_log_errno(LOG_ERROR, "failed to create eventfd");
+        goto fail_eventfd;
+    }
+
+    writer->src = wl_event_loop_add_fd(wl_display_get_event_loop(server->display), writer->fd,
+                                       WL_EVENT_READABLE, handle_eventfd, writer);
+    check_alloc(writer->src);
+
+    pthread_mutex_init(&writer->lock, nullptr);
+    pthread_cond_init(&writer->cond, nullptr);
+    wl_list_init(&writer->queue);
+    wl_list_init(&writer->finished);
+
+    int ret = pthread_create(&writer->thread, nullptr, writer_thread, writer);
+    if (ret != 0) {
+        ww_log(LOG_ERROR, "failed to create screenshot thread: %d", ret);
+        goto fail_thread;
+    }
+
+    return writer;
+
+fail_thread:
+    pthread_cond_destroy(&writer->cond);
+    pthread_mutex_destroy(&writer->lock);
+    wl_event_source_remove(writer->src);
+    close(writer->fd);
+
+fail_eventfd:
+    free(writer);
+    return nullptr;
+}
+
+void
+screenshot_writer_destroy(struct screenshot_writer *writer) {
+    // The thread cannot be stopped partway through encoding, so this waits for it to finish writing
+    // any queued screenshots.
+    pthread_mutex_lock(&writer->lock);
+    writer->stopping = true;
+    pthread_cond_signal(&writer->cond);
+    pthread_mutex_unlock(&writer->lock);
+
+    int ret = pthread_join(writer->thread, nullptr);
+    if (ret != 0) {
+        ww_log(LOG_ERROR, "failed to join screenshot thread: %d", ret);
+    }
+
+    struct screenshot *screenshot, *tmp;
+    wl_list_for_each_safe (screenshot, tmp, &writer->finished, link) {
+        if (screenshot->destroy) {
+            screenshot->destroy(screenshot->data);
+        }
+        wl_list_remove(&screenshot->link);
+        screenshot_free(screenshot);
+    }
+
+    pthread_cond_destroy(&writer->cond);
+    pthread_mutex_destroy(&writer->lock);
+    wl_event_source_remove(writer->src);
+    close(writer->fd);
+    free(writer);
+}
+
+struct screenshot *
+screenshot_write(struct screenshot_writer *writer, const char *path, uint8_t *rgba, int32_t width,
+                 int32_t height, screenshot_func_t done, screenshot_destroy_func_t destroy,
+                 void *data) {
+    // The screenshot takes ownership of the pixel data.
+    struct screenshot *screenshot = zalloc(1, sizeof(*screenshot));
+
+    screenshot->path = ww_strdup(path);
+    screenshot->rgba = rgba;
+    screenshot->width = width;
+    screenshot->height = height;
+    screenshot->done = done;
+    screenshot->destroy = destroy;
+    screenshot->data = data;
+
+    pthread_mutex_lock(&writer->lock);
+    wl_list_insert(&writer->queue, &screenshot->link);
+    pthread_cond_signal(&writer->cond);
+    pthread_mutex_unlock(&writer->lock);
+
+    return screenshot;
+}
+
+void
+screenshot_cancel(struct screenshot *screenshot) {
+    // The screenshot is still written, but its owner is no longer told about it. It is freed once
+    // the writer has finished with it.
+    screenshot->done = nullptr;
+    screenshot->destroy = nullptr;
+    screenshot->data = nullptr;
+}
@@ -1,9 +1,13 @@
 #include "server/backend.h"
 #include "alpha-modifier-v1-client-protocol.h"
+#include "commit-timing-v1-client-protocol.h"
 #include "cursor-shape-v1-client-protocol.h"
+#include "fifo-v1-client-protocol.h"
+#include "input-timestamps-unstable-v1-client-protocol.h"
 #include "linux-dmabuf-v1-client-protocol.h"
 #include "linux-drm-syncobj-v1-client-protocol.h"
 #include "pointer-constraints-unstable-v1-client-protocol.h"
+#include "presentation-time-client-protocol.h"
 #include "relative-pointer-unstable-v1-client-protocol.h"
 #include "single-pixel-buffer-v1-client-protocol.h"
 #include "tearing-control-v1-client-protocol.h"
@@ -30,12 +34,16 @@ wl_display_set_max_buffer_size(struct wl_display *display, size_t size) {
 static constexpr size_t MAX_BUFFER_SIZE = (1 << 20);
 
 static constexpr int USE_ALPHA_MODIFIER_VERSION = 1;
+static constexpr int USE_COMMIT_TIMING_VERSION = 1;
 static constexpr int USE_COMPOSITOR_VERSION = 5;
 static constexpr int USE_CURSOR_SHAPE_VERSION = 1;
 static constexpr int USE_DATA_DEVICE_MANAGER_VERSION = 2;
+static constexpr int USE_FIFO_VERSION = 1;
+static constexpr int USE_INPUT_TIMESTAMPS_VERSION = 1;
 static constexpr int USE_LINUX_DMABUF_VERSION = 4;
 static constexpr int USE_LINUX_DRM_SYNCOBJ_VERSION = 1;
 static constexpr int USE_POINTER_CONSTRAINTS_VERSION = 1;
+static constexpr int USE_PRESENTATION_VERSION = 1;
 static constexpr int USE_RELATIVE_POINTER_MANAGER_VERSION = 1;
 static constexpr int USE_SEAT_VERSION = 5;
 static constexpr int USE_SHM_VERSION = 1;
@@ -107,6 +115,17 @@ static const struct wl_shm_listener shm_listener = {
     .format = on_shm_format,
 };
 
+static void
+on_presentation_clock_id(void *data, struct wp_presentation *wl, uint32_t clk_id) {
+    struct server_backend *backend = data;
+
+    backend->presentation_clock = clk_id;
+}
+
+static const struct wp_presentation_listener presentation_listener = {
+    .clock_id = on_presentation_clock_id,
+};
+
 static void
 on_xdg_wm_base_ping(void *data, struct xdg_wm_base *xdg_wm_base, uint32_t serial) {
     xdg_wm_base_pong(xdg_wm_base, serial);
@@ -141,6 +160,16 @@ on_registry_global(void *data, struct wl_registry *wl, uint32_t name, const char
         backend->compositor =
             wl_registry_bind(wl, name, &wl_compositor_interface, USE_COMPOSITOR_VERSION);
         check_alloc(backend->compositor);
+    } else if (strcmp(iface, wp_commit_timing_manager_v1_interface.name) == 0) {
+        if (version < USE_COMMIT_TIMING_VERSION) {
+            ww_log(LOG_WARN, "host compositor provides outdated wp_commit_timing_manager (%d < %d)",
+                   version, USE_COMMIT_TIMING_VERSION);
+            return;
+        }
+
+        backend->commit_timing_manager = wl_registry_bind(
+            wl, name, &wp_commit_timing_manager_v1_interface, USE_COMMIT_TIMING_VERSION);
+        check_alloc(backend->commit_timing_manager);
     } else if (strcmp(iface, wp_cursor_shape_manager_v1_interface.name) == 0) {
         if (version < USE_CURSOR_SHAPE_VERSION) {
             ww_log(LOG_WARN, "host compositor provides outdated wp_cursor_shape_manager (%d < %d)",
@@ -161,6 +190,27 @@ on_registry_global(void *data, struct wl_registry *wl, uint32_t name, const char
         backend->data_device_manager = wl_registry_bind(wl, name, &wl_data_device_manager_interface,
                                                         USE_DATA_DEVICE_MANAGER_VERSION);
         check_alloc(backend->data_device_manager);
+    } else if (strcmp(iface, wp_fifo_manager_v1_interface.name) == 0) {
+        if (version < USE_FIFO_VERSION) {
+            ww_log(LOG_WARN, "host compositor provides outdated wp_fifo_manager (%d < %d)",
+                   version, USE_FIFO_VERSION);
+            return;
+        }
+
+        backend->fifo_manager =
+            wl_registry_bind(wl, name, &wp_fifo_manager_v1_interface, USE_FIFO_VERSION);
+        check_alloc(backend->fifo_manager);
+    } else if (strcmp(iface, zwp_input_timestamps_manager_v1_interface.name) == 0) {
+        if (version < USE_INPUT_TIMESTAMPS_VERSION) {
+            ww_log(LOG_WARN,
+                   "host compositor provides outdated zwp_input_timestamps_manager (%d < %d)",
+                   version, USE_INPUT_TIMESTAMPS_VERSION);
+            return;
+        }
+
+        backend->input_timestamps_manager = wl_registry_bind(
+            wl, name, &zwp_input_timestamps_manager_v1_interface, USE_INPUT_TIMESTAMPS_VERSION);
+        check_alloc(backend->input_timestamps_manager);
     } else if (strcmp(iface, zwp_linux_dmabuf_v1_interface.name) == 0) {
         if (version < USE_LINUX_DMABUF_VERSION) {
             ww_log(LOG_ERROR, "host compositor provides outdated zwp_linux_dmabuf (%d < %d)",
@@ -192,6 +242,19 @@ on_registry_global(void *data, struct wl_registry *wl, uint32_t name, const char
         backend->pointer_constraints = wl_registry_bind(
             wl, name, &zwp_pointer_constraints_v1_interface, USE_POINTER_CONSTRAINTS_VERSION);
         check_alloc(backend->pointer_constraints);
+    } else if (strcmp(iface, wp_presentation_interface.name) == 0) {
+        if (version < USE_PRESENTATION_VERSION) {
+            ww_log(LOG_WARN, "host compositor provides outdated wp_presentation (%d < %d)",
+                   version, USE_PRESENTATION_VERSION);
+            return;
+        }
+
+        backend->presentation =
+            wl_registry_bind(wl, name, &wp_presentation_interface, USE_PRESENTATION_VERSION);
+        check_alloc(backend->presentation);
+
+        wp_presentation_add_listener(backend->presentation, &presentation_listener, backend);
+        wl_display_roundtrip(backend->display);
     } else if (strcmp(iface, zwp_relative_pointer_manager_v1_interface.name) == 0) {
         if (version < USE_RELATIVE_POINTER_MANAGER_VERSION) {
             ww_log(LOG_ERROR,
@@ -371,12 +434,24 @@ server_backend_create() {
     if (!backend->alpha_modifier) {
         ww_log(LOG_INFO, "host compositor does not provide wp_alpha_modifier");
     }
+    if (!backend->commit_timing_manager) {
+        ww_log(LOG_INFO, "host compositor does not provide wp_commit_timing_manager");
+    }
     if (!backend->cursor_shape_manager) {
         ww_log(LOG_WARN, "host compositor does not provide wp_cursor_shape_manager");
     }
+    if (!backend->fifo_manager) {
+        ww_log(LOG_INFO, "host compositor does not provide wp_fifo_manager");
+    }
+    if (!backend->input_timestamps_manager) {
+        ww_log(LOG_INFO, "host compositor does not provide zwp_input_timestamps_manager");
+    }
     if (!backend->linux_drm_syncobj_manager) {
         ww_log(LOG_INFO, "host compositor does not provide wp_linux_drm_syncobj_manager");
     }
+    if (!backend->presentation) {
+        ww_log(LOG_INFO, "host compositor does not provide wp_presentation");
+    }
     if (!backend->single_pixel_buffer_manager) {
         ww_log(LOG_INFO, "host compositor does not provide wp_single_pixel_buffer_manager");
     }
@@ -435,12 +510,24 @@ server_backend_destroy(struct server_backend *backend) {
     if (backend->alpha_modifier) {
         wp_alpha_modifier_v1_destroy(backend->alpha_modifier);
     }
+    if (backend->commit_timing_manager) {
+        wp_commit_timing_manager_v1_destroy(backend->commit_timing_manager);
+    }
     if (backend->cursor_shape_manager) {
         wp_cursor_shape_manager_v1_destroy(backend->cursor_shape_manager);
     }
+    if (backend->fifo_manager) {
+        wp_fifo_manager_v1_destroy(backend->fifo_manager);
+    }
+    if (backend->input_timestamps_manager) {
+        zwp_input_timestamps_manager_v1_destroy(backend->input_timestamps_manager);
+    }
     if (backend->linux_drm_syncobj_manager) {
         wp_linux_drm_syncobj_manager_v1_destroy(backend->linux_drm_syncobj_manager);
     }
+    if (backend->presentation) {
+        wp_presentation_destroy(backend->presentation);
+    }
     if (backend->single_pixel_buffer_manager) {
         wp_single_pixel_buffer_manager_v1_destroy(backend->single_pixel_buffer_manager);
     }
@@ -0,0 +1,179 @@
+#include "server/dmabuf_feedback.h"
+#include "util/alloc.h"
+#include "util/prelude.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// One bit for each possible index into the format table.
+static constexpr size_t INDEX_BITMAP_LEN = (UINT16_MAX + 1) / 64;
+
+static void
+tranche_append(struct dmabuf_tranche *tranche, const uint16_t *indices, size_t num_indices) {
+    if (num_indices == 0) {
+        return;
+    }
+
+    tranche->indices =
+        realloc(tranche->indices, (tranche->num_indices + num_indices) * sizeof(*indices));
+    check_alloc(tranche->indices);
+
+    memcpy(tranche->indices + tranche->num_indices, indices, num_indices * sizeof(*indices));
+    tranche->num_indices += num_indices;
+}
+
+static bool
+tranche_contains(struct dmabuf_tranche *tranche, uint16_t index) {
+    for (size_t i = 0; i < tranche->num_indices; i++) {
+        if (tranche->indices[i] == index) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void
+tranche_filter(struct dmabuf_tranche *tranche, const uint64_t *bitmap) {
+    size_t n = 0;
+    for (size_t i = 0; i < tranche->num_indices; i++) {
+        uint16_t index = tranche->indices[i];
+        if (bitmap[index / 64] & (1ull << (index % 64))) {
+            tranche->indices[n++] = index;
+        }
+    }
+    tranche->num_indices = n;
+}
+
+void
+dmabuf_feedback_init(struct dmabuf_feedback *feedback) {
+    *feedback = (struct dmabuf_feedback){};
+    feedback->table_fd = -1;
+}
+
+void
+dmabuf_feedback_finish(struct dmabuf_feedback *feedback) {
+    dmabuf_feedback_reset(feedback);
+    free(feedback->tranches);
+}
+
+void
+dmabuf_feedback_merge(struct dmabuf_feedback *feedback) {
+    // waywall must be able to import the game's buffers to draw mirrors and to capture the game,
+    // which is only known to work for the formats the host renders with on its main device.
+    // Scanout tranches can list formats that only the display engine (or another device) supports,
+    // so they are limited to those which are also in a rendering tranche.
+    uint64_t *importable = zalloc(INDEX_BITMAP_LEN, sizeof(*importable));
+    bool has_render_tranche = false;
+
+    for (size_t i = 0; i < feedback->num_tranches; i++) {
+        struct dmabuf_tranche *tranche = &feedback->tranches[i];
+        if ((tranche->flags & DMABUF_TRANCHE_SCANOUT) ||
+            tranche->target_device != feedback->main_device) {
+            continue;
+        }
+
+        has_render_tranche = true;
+        for (size_t j = 0; j < tranche->num_indices; j++) {
+            uint16_t index = tranche->indices[j];
+            importable[index / 64] |= (1ull << (index % 64));
+        }
+    }
+
+    // If the host did not send a rendering tranche for its main device, there is nothing to check
+    // the scanout tranches against and they are passed through as they are.
+    if (has_render_tranche) {
+        for (size_t i = 0; i < feedback->num_tranches; i++) {
+            if (feedback->tranches[i].flags & DMABUF_TRANCHE_SCANOUT) {
+                tranche_filter(&feedback->tranches[i], importable);
+            }
+        }
+    }
+    free(importable);
+
+    // Adjacent tranches with the same target device and flags are merged, and tranches left
+    // without any formats are removed. The order of the remaining tranches (which is the host's
+    // order of preference) is kept.
+    size_t n = 0;
+    for (size_t i = 0; i < feedback->num_tranches; i++) {
+        struct dmabuf_tranche *tranche = &feedback->tranches[i];
+
+        if (tranche->num_indices == 0) {
+            free(tranche->indices);
+            continue;
+        }
+
+        struct dmabuf_tranche *prev = (n > 0) ? &feedback->tranches[n - 1] : nullptr;
+        if (prev && prev->target_device == tranche->target_device &&
+            prev->flags == tranche->flags) {
+            for (size_t j = 0; j < tranche->num_indices; j++) {
+                if (!tranche_contains(prev, tranche->indices[j])) {
+                    tranche_append(prev, &tranche->indices[j], 1);
+                }
+            }
+            free(tranche->indices);
+            continue;
+        }
+
+        feedback->tranches[n++] = *tranche;
+    }
+    feedback->num_tranches = n;
+}
+
+void
+dmabuf_feedback_reset(struct dmabuf_feedback *feedback) {
+    if (feedback->table_fd != -1) {
+        close(feedback->table_fd);
+        feedback->table_fd = -1;
+    }
+    feedback->table_size = 0;
+
+    for (size_t i = 0; i < feedback->num_tranches; i++) {
+        free(feedback->tranches[i].indices);
+    }
+    feedback->num_tranches = 0;
+
+    free(feedback->pending.indices);
+    feedback->pending = (struct dmabuf_tranche){};
+}
+
+void
+dmabuf_feedback_format_table(struct dmabuf_feedback *feedback, int fd, uint32_t size) {
+    if (feedback->table_fd != -1) {
+        close(feedback->table_fd);
+    }
+
+    feedback->table_fd = fd;
+    feedback->table_size = size;
+}
+
+void
+dmabuf_feedback_main_device(struct dmabuf_feedback *feedback, dev_t device) {
+    feedback->main_device = device;
+}
+
+void
+dmabuf_feedback_tranche_done(struct dmabuf_feedback *feedback) {
+    feedback->tranches =
+        realloc(feedback->tranches, (feedback->num_tranches + 1) * sizeof(*feedback->tranches));
+    check_alloc(feedback->tranches);
+
+    feedback->tranches[feedback->num_tranches++] = feedback->pending;
+    feedback->pending = (struct dmabuf_tranche){};
+}
+
+void
+dmabuf_feedback_tranche_flags(struct dmabuf_feedback *feedback, uint32_t flags) {
+    feedback->pending.flags = flags;
+}
+
+void
+dmabuf_feedback_tranche_formats(struct dmabuf_feedback *feedback, const uint16_t *indices,
+                                size_t num_indices) {
+    // Formats may be sent in several events for a single tranche.
+    tranche_append(&feedback->pending, indices, num_indices);
+}
+
+void
+dmabuf_feedback_tranche_target_device(struct dmabuf_feedback *feedback, dev_t device) {
+    feedback->pending.target_device = device;
+}
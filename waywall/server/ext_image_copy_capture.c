@@ -0,0 +1,684 @@
+#include "server/ext_image_copy_capture.h"
+#include "ext-image-capture-source-v1-server-protocol.h"
+#include "ext-image-copy-capture-v1-server-protocol.h"
+#include "server/buffer.h"
+#include "server/gl.h"
+#include "server/server.h"
+#include "server/wl_shm.h"
+#include "server/wp_linux_dmabuf.h"
+#include "util/alloc.h"
+#include "util/prelude.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <wayland-server-core.h>
+#include <wayland-server-protocol.h>
+#include <wayland-util.h>
+
+// This only provides capture of the game's buffers (through the output image capture source, since
+// waywall only has one output.) Sources for other toplevels would require the foreign toplevel list
+// protocol, and the overlay can already be captured from the host compositor.
+
+static constexpr int SRV_IMAGE_COPY_CAPTURE_VERSION = 1;
+static constexpr int SRV_OUTPUT_IMAGE_CAPTURE_SOURCE_VERSION = 1;
+
+static constexpr uint32_t DRM_FORMAT_ARGB8888 = 0x34325241;
+static constexpr uint32_t DRM_FORMAT_XRGB8888 = 0x34325258;
+static constexpr uint64_t DRM_FORMAT_MOD_LINEAR = 0;
+static constexpr uint64_t DRM_FORMAT_MOD_INVALID = 0x00FFFFFFFFFFFFFF;
+
+struct cursor_session {
+    struct wl_resource *resource;
+    bool has_session;
+};
+
+static void
+send_dmabuf_format(struct wl_resource *resource, uint32_t format, const uint64_t *modifiers,
+                   size_t num_modifiers) {
+    struct wl_array array;
+    wl_array_init(&array);
+
+    uint64_t *data = wl_array_add(&array, num_modifiers * sizeof(*modifiers));
+    check_alloc(data);
+    memcpy(data, modifiers, num_modifiers * sizeof(*modifiers));
+
+    ext_image_copy_capture_session_v1_send_dmabuf_format(resource, format, &array);
+    wl_array_release(&array);
+}
+
+static void
+session_send_constraints(struct server_image_copy_session *session) {
+    struct server_gl *gl = session->parent->gl;
+
+    // The constraints cannot be known until the game has presented a frame. They are sent once it
+    // does (see on_gl_capture.)
+    if (!server_gl_get_capture(gl)) {
+        return;
+    }
+
+    int32_t width, height;
+    uint32_t format;
+    uint64_t modifier;
+    server_gl_get_capture_size(gl, &width, &height);
+    server_gl_get_capture_format(gl, &format, &modifier);
+
+    bool changed = !session->constraints.sent || session->constraints.width != width ||
+                   session->constraints.height != height ||
+                   session->constraints.format != format ||
+                   session->constraints.modifier != modifier;
+    if (!changed) {
+        return;
+    }
+
+    session->constraints.width = width;
+    session->constraints.height = height;
+    session->constraints.format = format;
+    session->constraints.modifier = modifier;
+    session->constraints.sent = true;
+
+    ext_image_copy_capture_session_v1_send_buffer_size(session->resource, width, height);
+    ext_image_copy_capture_session_v1_send_shm_format(session->resource, WL_SHM_FORMAT_ARGB8888);
+    ext_image_copy_capture_session_v1_send_shm_format(session->resource, WL_SHM_FORMAT_XRGB8888);
+
+    // DMABUF formats can only be advertised along with the device they should be allocated on.
+    dev_t device;
+    if (server_gl_get_device(gl, &device)) {
+        struct wl_array array;
+        wl_array_init(&array);
+
+        dev_t *data = wl_array_add(&array, sizeof(device));
+        check_alloc(data);
+        *data = device;
+
+        ext_image_copy_capture_session_v1_send_dmabuf_device(session->resource, &array);
+        wl_array_release(&array);
+
+        // Buffers with the same format and modifier as the game's buffers can be copied into most
+        // cheaply, so they are listed first.
+        if (modifier != DRM_FORMAT_MOD_INVALID && modifier != DRM_FORMAT_MOD_LINEAR) {
+            send_dmabuf_format(session->resource, format,
+                               (uint64_t[]){modifier, DRM_FORMAT_MOD_LINEAR}, 2);
+        } else {
+            send_dmabuf_format(session->resource, format, (uint64_t[]){DRM_FORMAT_MOD_LINEAR}, 1);
+        }
+
+        if (format != DRM_FORMAT_ARGB8888) {
+            send_dmabuf_format(session->resource, DRM_FORMAT_ARGB8888,
+                               (uint64_t[]){DRM_FORMAT_MOD_LINEAR}, 1);
+        }
+        if (format != DRM_FORMAT_XRGB8888) {
+            send_dmabuf_format(session->resource, DRM_FORMAT_XRGB8888,
+                               (uint64_t[]){DRM_FORMAT_MOD_LINEAR}, 1);
+        }
+    }
+
+    ext_image_copy_capture_session_v1_send_done(session->resource);
+}
+
+static bool
+frame_buffer_valid(struct server_image_copy_frame *frame) {
+    struct server_image_copy_session *session = frame->session;
+    struct server_buffer *buffer = frame->buffer;
+
+    if (!buffer->resource) {
+        return false;
+    }
+
+    int32_t width, height;
+    server_buffer_get_size(buffer, &width, &height);
+    if (width != session->constraints.width || height != session->constraints.height) {
+        return false;
+    }
+
+    if (strcmp(buffer->impl->name, SERVER_BUFFER_SHM) == 0) {
+        struct server_shm_buffer_data *data = buffer->data;
+
+        bool format_ok =
+            data->format == WL_SHM_FORMAT_ARGB8888 || data->format == WL_SHM_FORMAT_XRGB8888;
+        return format_ok && data->stride >= data->width * 4;
+    } else if (strcmp(buffer->impl->name, SERVER_BUFFER_DMABUF) == 0) {
+        struct server_dmabuf_data *data = buffer->data;
+
+        bool format_ok = data->format == session->constraints.format ||
+                         data->format == DRM_FORMAT_ARGB8888 ||
+                         data->format == DRM_FORMAT_XRGB8888;
+        return format_ok && data->num_planes == 1;
+    }
+
+    return false;
+}
+
+static void
+frame_fail(struct server_image_copy_frame *frame,
+           enum ext_image_copy_capture_frame_v1_failure_reason reason) {
+    if (frame->readback) {
+        server_gl_readback_destroy(frame->readback);
+        frame->readback = nullptr;
+    }
+    if (frame->fence) {
+        server_gl_fence_destroy(frame->fence);
+        frame->fence = nullptr;
+    }
+
+    frame->capturing = false;
+    frame->done = true;
+
+    ext_image_copy_capture_frame_v1_send_failed(frame->resource, reason);
+}
+
+static void
+frame_send_ready(struct server_image_copy_frame *frame) {
+    struct server_image_copy_session *session = frame->session;
+
+    frame->capturing = false;
+    frame->done = true;
+
+    // The whole buffer is copied each time, so the whole buffer is reported as damaged.
+    ext_image_copy_capture_frame_v1_send_transform(frame->resource, WL_OUTPUT_TRANSFORM_NORMAL);
+    ext_image_copy_capture_frame_v1_send_damage(frame->resource, 0, 0, session->constraints.width,
+                                                session->constraints.height);
+    ext_image_copy_capture_frame_v1_send_presentation_time(
+        frame->resource, (uint64_t)frame->captured.tv_sec >> 32,
+        (uint64_t)frame->captured.tv_sec & 0xFFFFFFFF, frame->captured.tv_nsec);
+    ext_image_copy_capture_frame_v1_send_ready(frame->resource);
+}
+
+static void
+frame_complete(struct server_image_copy_frame *frame) {
+    struct server_image_copy_session *session = frame->session;
+    struct server_gl *gl = session->parent->gl;
+
+    if (!frame_buffer_valid(frame)) {
+        frame_fail(frame, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_BUFFER_CONSTRAINTS);
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &frame->captured);
+
+    // SHM destinations cannot be written by the GPU, so the game frame is read back first. The
+    // frame is finished once the read back has completed (see on_gl_frame.)
+    if (strcmp(frame->buffer->impl->name, SERVER_BUFFER_SHM) == 0) {
+        server_gl_with(gl, false) {
+            frame->readback = server_gl_readback_create(gl);
+        }
+        if (!frame->readback) {
+            frame_fail(frame, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_UNKNOWN);
+            return;
+        }
+
+        session->damaged = false;
+        return;
+    }
+
+    // The client may read the DMABUF as soon as it is told the frame is ready, so that is only sent
+    // once the copy has finished on the GPU (see on_gl_frame.)
+    bool ok = false;
+    server_gl_with(gl, false) {
+        ok = server_gl_copy_capture(gl, frame->buffer);
+        if (ok) {
+            frame->fence = server_gl_fence_create(gl);
+        }
+    }
+    if (!ok) {
+        frame_fail(frame, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_UNKNOWN);
+        return;
+    }
+
+    session->damaged = false;
+}
+
+static void
+frame_complete_readback(struct server_image_copy_frame *frame) {
+    struct server_image_copy_session *session = frame->session;
+    struct server_gl *gl = session->parent->gl;
+
+    // The game may have been resized, or the client may have destroyed the buffer, while the game
+    // frame was being read back.
+    int32_t width, height;
+    server_buffer_get_size(frame->buffer, &width, &height);
+    if (!frame->buffer->resource || width != frame->readback->width ||
+        height != frame->readback->height) {
+        frame_fail(frame, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_BUFFER_CONSTRAINTS);
+        return;
+    }
+
+    bool ok = false;
+    server_gl_with(gl, false) {
+        ok = server_gl_readback_write(frame->readback, frame->buffer);
+    }
+
+    server_gl_readback_destroy(frame->readback);
+    frame->readback = nullptr;
+
+    if (!ok) {
+        frame_fail(frame, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_UNKNOWN);
+        return;
+    }
+
+    frame_send_ready(frame);
+}
+
+static void
+session_stop(struct server_image_copy_session *session) {
+    if (session->frame && session->frame->capturing) {
+        frame_fail(session->frame, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_STOPPED);
+    }
+
+    ext_image_copy_capture_session_v1_send_stopped(session->resource);
+
+    session->parent = nullptr;
+    wl_list_remove(&session->link);
+    wl_list_init(&session->link);
+}
+
+static void
+on_gl_capture(struct wl_listener *listener, void *data) {
+    struct server_image_copy_capture *capture =
+        wl_container_of(listener, capture, on_gl_capture);
+
+    struct server_image_copy_session *session;
+    wl_list_for_each (session, &capture->sessions, link) {
+        session->damaged = true;
+        session_send_constraints(session);
+
+        struct server_image_copy_frame *frame = session->frame;
+        if (frame && frame->capturing && !frame->readback && !frame->fence) {
+            frame_complete(frame);
+        }
+    }
+}
+
+static void
+on_gl_frame(struct wl_listener *listener, void *data) {
+    struct server_image_copy_capture *capture = wl_container_of(listener, capture, on_gl_frame);
+
+    struct server_image_copy_session *session, *tmp;
+    wl_list_for_each_safe (session, tmp, &capture->sessions, link) {
+        struct server_image_copy_frame *frame = session->frame;
+        if (!frame) {
+            continue;
+        }
+
+        if (frame->readback && server_gl_readback_ready(frame->readback)) {
+            frame_complete_readback(frame);
+        } else if (frame->fence && server_gl_fence_signaled(frame->fence)) {
+            server_gl_fence_destroy(frame->fence);
+            frame->fence = nullptr;
+            frame_send_ready(frame);
+        }
+    }
+}
+
+static void
+frame_resource_destroy(struct wl_resource *resource) {
+    struct server_image_copy_frame *frame = wl_resource_get_user_data(resource);
+
+    if (frame->session) {
+        frame->session->frame = nullptr;
+    }
+    if (frame->readback) {
+        server_gl_readback_destroy(frame->readback);
+    }
+    if (frame->fence) {
+        server_gl_fence_destroy(frame->fence);
+    }
+    if (frame->buffer) {
+        server_buffer_unref(frame->buffer);
+    }
+
+    free(frame);
+}
+
+static void
+frame_attach_buffer(struct wl_client *client, struct wl_resource *resource,
+                    struct wl_resource *buffer_resource) {
+    struct server_image_copy_frame *frame = wl_resource_get_user_data(resource);
+
+    if (frame->capturing || frame->done) {
+        wl_resource_post_error(resource, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_ERROR_ALREADY_CAPTURED,
+                               "cannot attach buffer to frame which was already captured");
+        return;
+    }
+
+    struct server_buffer *buffer = server_buffer_from_resource(buffer_resource);
+    if (frame->buffer) {
+        server_buffer_unref(frame->buffer);
+    }
+    frame->buffer = server_buffer_ref(buffer);
+}
+
+static void
+frame_capture(struct wl_client *client, struct wl_resource *resource) {
+    struct server_image_copy_frame *frame = wl_resource_get_user_data(resource);
+
+    if (frame->capturing || frame->done) {
+        wl_resource_post_error(resource, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_ERROR_ALREADY_CAPTURED,
+                               "frame was already captured");
+        return;
+    }
+    if (!frame->buffer) {
+        wl_resource_post_error(resource, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_ERROR_NO_BUFFER,
+                               "cannot capture frame without a buffer");
+        return;
+    }
+
+    frame->capturing = true;
+
+    struct server_image_copy_session *session = frame->session;
+    if (!session || !session->parent) {
+        frame_fail(frame, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_STOPPED);
+        return;
+    }
+
+    // If the game has presented a frame which this session has not yet captured, it can be copied
+    // immediately. Otherwise, the capture is completed once the game presents its next frame.
+    if (session->damaged && server_gl_get_capture(session->parent->gl)) {
+        frame_complete(frame);
+    }
+}
+
+static void
+frame_damage_buffer(struct wl_client *client, struct wl_resource *resource, int32_t x, int32_t y,
+                    int32_t width, int32_t height) {
+    struct server_image_copy_frame *frame = wl_resource_get_user_data(resource);
+
+    if (frame->capturing || frame->done) {
+        wl_resource_post_error(resource, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_ERROR_ALREADY_CAPTURED,
+                               "cannot damage frame which was already captured");
+        return;
+    }
+    if (x < 0 || y < 0 || width <= 0 || height <= 0) {
+        wl_resource_post_error(resource,
+                               EXT_IMAGE_COPY_CAPTURE_FRAME_V1_ERROR_INVALID_BUFFER_DAMAGE,
+                               "invalid buffer damage (%d, %d, %dx%d)", (int)x, (int)y,
+                               (int)width, (int)height);
+        return;
+    }
+
+    // Buffer damage is not tracked, since the whole buffer is copied for each capture.
+}
+
+static void
+frame_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static const struct ext_image_copy_capture_frame_v1_interface frame_impl = {
+    .attach_buffer = frame_attach_buffer,
+    .capture = frame_capture,
+    .damage_buffer = frame_damage_buffer,
+    .destroy = frame_destroy,
+};
+
+static void
+session_resource_destroy(struct wl_resource *resource) {
+    struct server_image_copy_session *session = wl_resource_get_user_data(resource);
+
+    // A frame which is still being captured can never be finished without its session.
+    if (session->frame) {
+        if (session->frame->capturing) {
+            frame_fail(session->frame, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_STOPPED);
+        }
+        session->frame->session = nullptr;
+    }
+
+    wl_list_remove(&session->link);
+    free(session);
+}
+
+static void
+session_create_frame(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    struct server_image_copy_session *session = wl_resource_get_user_data(resource);
+
+    if (session->frame) {
+        wl_resource_post_error(resource, EXT_IMAGE_COPY_CAPTURE_SESSION_V1_ERROR_DUPLICATE_FRAME,
+                               "session already has a frame");
+        return;
+    }
+
+    struct server_image_copy_frame *frame = zalloc(1, sizeof(*frame));
+
+    frame->resource = wl_resource_create(client, &ext_image_copy_capture_frame_v1_interface,
+                                         wl_resource_get_version(resource), id);
+    check_alloc(frame->resource);
+    wl_resource_set_implementation(frame->resource, &frame_impl, frame, frame_resource_destroy);
+
+    frame->session = session;
+    session->frame = frame;
+}
+
+static void
+session_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static const struct ext_image_copy_capture_session_v1_interface session_impl = {
+    .create_frame = session_create_frame,
+    .destroy = session_destroy,
+};
+
+static struct server_image_copy_session *
+session_create(struct wl_client *client, struct server_image_copy_capture *capture,
+               uint32_t version, uint32_t id) {
+    struct server_image_copy_session *session = zalloc(1, sizeof(*session));
+
+    session->resource =
+        wl_resource_create(client, &ext_image_copy_capture_session_v1_interface, version, id);
+    check_alloc(session->resource);
+    wl_resource_set_implementation(session->resource, &session_impl, session,
+                                   session_resource_destroy);
+
+    // Sessions created after waywall has stopped providing captures are stopped immediately.
+    if (!capture) {
+        wl_list_init(&session->link);
+        ext_image_copy_capture_session_v1_send_stopped(session->resource);
+        return session;
+    }
+
+    session->parent = capture;
+    session->damaged = true;
+    wl_list_insert(&capture->sessions, &session->link);
+
+    session_send_constraints(session);
+    return session;
+}
+
+static void
+cursor_session_resource_destroy(struct wl_resource *resource) {
+    struct cursor_session *cursor_session = wl_resource_get_user_data(resource);
+
+    free(cursor_session);
+}
+
+static void
+cursor_session_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static void
+cursor_session_get_capture_session(struct wl_client *client, struct wl_resource *resource,
+                                   uint32_t id) {
+    struct cursor_session *cursor_session = wl_resource_get_user_data(resource);
+
+    if (cursor_session->has_session) {
+        wl_resource_post_error(resource,
+                               EXT_IMAGE_COPY_CAPTURE_CURSOR_SESSION_V1_ERROR_DUPLICATE_SESSION,
+                               "cursor session already has a capture session");
+        return;
+    }
+    cursor_session->has_session = true;
+
+    // The cursor is drawn by the host compositor, so there is never a cursor image to capture.
+    session_create(client, nullptr, wl_resource_get_version(resource), id);
+}
+
+static const struct ext_image_copy_capture_cursor_session_v1_interface cursor_session_impl = {
+    .destroy = cursor_session_destroy,
+    .get_capture_session = cursor_session_get_capture_session,
+};
+
+static void
+manager_resource_destroy(struct wl_resource *resource) {
+    wl_list_remove(wl_resource_get_link(resource));
+}
+
+static void
+manager_create_pointer_cursor_session(struct wl_client *client, struct wl_resource *resource,
+                                      uint32_t id, struct wl_resource *source,
+                                      struct wl_resource *pointer) {
+    struct cursor_session *cursor_session = zalloc(1, sizeof(*cursor_session));
+
+    cursor_session->resource =
+        wl_resource_create(client, &ext_image_copy_capture_cursor_session_v1_interface,
+                           wl_resource_get_version(resource), id);
+    check_alloc(cursor_session->resource);
+    wl_resource_set_implementation(cursor_session->resource, &cursor_session_impl, cursor_session,
+                                   cursor_session_resource_destroy);
+}
+
+static void
+manager_create_session(struct wl_client *client, struct wl_resource *resource, uint32_t id,
+                       struct wl_resource *source, uint32_t options) {
+    struct server_image_copy_capture *capture = wl_resource_get_user_data(resource);
+
+    if (options & ~EXT_IMAGE_COPY_CAPTURE_MANAGER_V1_OPTIONS_PAINT_CURSORS) {
+        wl_resource_post_error(resource, EXT_IMAGE_COPY_CAPTURE_MANAGER_V1_ERROR_INVALID_OPTION,
+                               "invalid options %" PRIu32, options);
+        return;
+    }
+
+    // All capture sources refer to the game, so the source itself does not need to be inspected.
+    // The cursor is never painted, since it is drawn by the host compositor.
+    session_create(client, capture, wl_resource_get_version(resource), id);
+}
+
+static void
+manager_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static const struct ext_image_copy_capture_manager_v1_interface manager_impl = {
+    .create_pointer_cursor_session = manager_create_pointer_cursor_session,
+    .create_session = manager_create_session,
+    .destroy = manager_destroy,
+};
+
+static void
+on_global_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    ww_assert(version <= SRV_IMAGE_COPY_CAPTURE_VERSION);
+
+    struct server_image_copy_capture *capture = data;
+
+    struct wl_resource *resource =
+        wl_resource_create(client, &ext_image_copy_capture_manager_v1_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &manager_impl, capture, manager_resource_destroy);
+
+    wl_list_insert(&capture->objects, wl_resource_get_link(resource));
+}
+
+static void
+source_resource_destroy(struct wl_resource *resource) {
+    // Unused.
+}
+
+static void
+source_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static const struct ext_image_capture_source_v1_interface source_impl = {
+    .destroy = source_destroy,
+};
+
+static void
+source_manager_resource_destroy(struct wl_resource *resource) {
+    // Unused.
+}
+
+static void
+source_manager_create_source(struct wl_client *client, struct wl_resource *resource, uint32_t id,
+                             struct wl_resource *output) {
+    struct wl_resource *source_resource = wl_resource_create(
+        client, &ext_image_capture_source_v1_interface, wl_resource_get_version(resource), id);
+    check_alloc(source_resource);
+    wl_resource_set_implementation(source_resource, &source_impl, nullptr,
+                                   source_resource_destroy);
+}
+
+static void
+source_manager_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static const struct ext_output_image_capture_source_manager_v1_interface source_manager_impl = {
+    .create_source = source_manager_create_source,
+    .destroy = source_manager_destroy,
+};
+
+static void
+on_source_global_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    ww_assert(version <= SRV_OUTPUT_IMAGE_CAPTURE_SOURCE_VERSION);
+
+    struct wl_resource *resource = wl_resource_create(
+        client, &ext_output_image_capture_source_manager_v1_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &source_manager_impl, nullptr,
+                                   source_manager_resource_destroy);
+}
+
+struct server_image_copy_capture *
+server_image_copy_capture_create(struct server *server, struct server_gl *gl) {
+    struct server_image_copy_capture *capture = zalloc(1, sizeof(*capture));
+
+    capture->global =
+        wl_global_create(server->display, &ext_image_copy_capture_manager_v1_interface,
+                         SRV_IMAGE_COPY_CAPTURE_VERSION, capture, on_global_bind);
+    check_alloc(capture->global);
+
+    capture->source_global = wl_global_create(
+        server->display, &ext_output_image_capture_source_manager_v1_interface,
+        SRV_OUTPUT_IMAGE_CAPTURE_SOURCE_VERSION, capture, on_source_global_bind);
+    check_alloc(capture->source_global);
+
+    capture->server = server;
+    capture->gl = gl;
+
+    wl_list_init(&capture->objects);
+    wl_list_init(&capture->sessions);
+
+    capture->on_gl_capture.notify = on_gl_capture;
+    wl_signal_add(&gl->events.capture, &capture->on_gl_capture);
+
+    capture->on_gl_frame.notify = on_gl_frame;
+    wl_signal_add(&gl->events.frame, &capture->on_gl_frame);
+
+    return capture;
+}
+
+void
+server_image_copy_capture_destroy(struct server_image_copy_capture *capture) {
+    // The capture globals are owned by the wrap rather than the display, since they depend on the
+    // OpenGL context. Any resources which outlive them must not refer back to them.
+    wl_global_destroy(capture->global);
+    wl_global_destroy(capture->source_global);
+
+    struct wl_resource *resource, *tmp;
+    wl_resource_for_each_safe(resource, tmp, &capture->objects) {
+        wl_resource_set_user_data(resource, nullptr);
+        wl_list_remove(wl_resource_get_link(resource));
+        wl_list_init(wl_resource_get_link(resource));
+    }
+
+    struct server_image_copy_session *session, *session_tmp;
+    wl_list_for_each_safe (session, session_tmp, &capture->sessions, link) {
+        session_stop(session);
+    }
+
+    wl_list_remove(&capture->on_gl_capture.link);
+    wl_list_remove(&capture->on_gl_frame.link);
+
+    free(capture);
+}
@@ -6,15 +6,22 @@
 #include "server/server.h"
 #include "server/surface.h"
 #include "server/ui.h"
+#include "server/wl_shm.h"
 #include "server/wp_linux_dmabuf.h"
 #include "util/alloc.h"
+#include "util/debug.h"
 #include "util/log.h"
 #include "util/prelude.h"
 #include "viewporter-client-protocol.h"
+#include "xdg-decoration-unstable-v1-client-protocol.h"
+#include "xdg-shell-client-protocol.h"
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <spng.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <wayland-client-core.h>
 #include <wayland-egl.h>
 
@@ -97,21 +104,49 @@
 
 static constexpr uint64_t DRM_FORMAT_MOD_INVALID = 0xFFFFFFFFFFFFFFF;
 static constexpr int MAX_CACHED_DMABUF = 2;
+static constexpr int MAX_CACHED_EXPORTS = 4;
 
 #define ww_log_egl(lvl, fmt, ...)                                                                  \
     util_log(lvl, "[%s:%d] " fmt ": %s", __FILE__, __LINE__, ##__VA_ARGS__, egl_strerror())
 
+struct server_gl_fence {
+    struct server_gl *gl;
+    EGLSyncKHR sync; // EGL_NO_SYNC_KHR if fences are unavailable
+};
+
+struct server_gl_readback {
+    struct server_gl *gl;
+    struct server_gl_fence *fence;
+    int32_t width, height;
+
+    // With pixel buffer objects, the game frame is read into the buffer object before the fence is
+    // created. Otherwise, it is copied into a texture and read once the fence has signalled.
+    GLuint pbo, tex;
+};
+
 struct gl_buffer {
-    struct wl_list link; // server_gl.capture.buffers
+    struct wl_list link; // server_gl.capture.buffers or server_gl.capture.exports
     struct server_gl *gl;
 
     struct server_buffer *parent;
     EGLImageKHR image; // imported DMABUF - must not be modified
     GLuint texture;    // must not be modified
+    size_t bytes;
 };
 
 // clang-format off
-static constexpr EGLint CONFIG_ATTRIBUTES[] = {
+static constexpr EGLint CONFIG_ATTRIBUTES_GLES3[] = {
+    EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_ALPHA_SIZE, 8,
+    EGL_STENCIL_SIZE, 8,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
+    EGL_NONE,
+};
+
+static constexpr EGLint CONFIG_ATTRIBUTES_GLES2[] = {
     EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
     EGL_RED_SIZE, 8,
     EGL_GREEN_SIZE, 8,
@@ -122,12 +157,27 @@ static constexpr EGLint CONFIG_ATTRIBUTES[] = {
     EGL_NONE,
 };
 
-static constexpr EGLint CONTEXT_ATTRIBUTES[] = {
+static constexpr EGLint CONTEXT_ATTRIBUTES_GLES3[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_NONE,
+};
+
+static constexpr EGLint CONTEXT_ATTRIBUTES_GLES2[] = {
     EGL_CONTEXT_MAJOR_VERSION, 2,
     EGL_NONE,
 };
 // clang-format on
 
+// The context versions to try, from most to least capable. All shaders are written against GLSL
+// ES 1.00, which every version supports, so only optional features depend on the version.
+static const struct {
+    const EGLint *config, *context;
+    int version;
+} CONTEXT_VERSIONS[] = {
+    {CONFIG_ATTRIBUTES_GLES3, CONTEXT_ATTRIBUTES_GLES3, 3},
+    {CONFIG_ATTRIBUTES_GLES2, CONTEXT_ATTRIBUTES_GLES2, 2},
+};
+
 static const char *REQUIRED_EGL_EXTENSIONS[] = {
     "EGL_EXT_image_dma_buf_import",
     "EGL_EXT_image_dma_buf_import_modifiers",
@@ -178,9 +228,12 @@ static const struct {
 
 static const char *egl_strerror();
 static bool gl_checkerr(const char *msg);
+static bool make_current(struct server_gl *gl, EGLSurface surface);
+static void projector_destroy(struct server_gl *gl);
 
 static void gl_buffer_destroy(struct gl_buffer *gl_buffer);
-static struct gl_buffer *gl_buffer_import(struct server_gl *gl, struct server_buffer *buffer);
+static struct gl_buffer *gl_buffer_import(struct server_gl *gl, struct server_buffer *buffer,
+                                          struct wl_list *list);
 
 static void
 on_surface_commit(struct wl_listener *listener, void *data) {
@@ -199,12 +252,13 @@ on_surface_commit(struct wl_listener *listener, void *data) {
     wl_list_for_each (gl_buffer, &gl->capture.buffers, link) {
         if (gl_buffer->parent == buffer) {
             gl->capture.current = gl_buffer;
+            wl_signal_emit_mutable(&gl->events.capture, nullptr);
             return;
         }
     }
 
     // If the given wl_buffer has not yet been imported, try to import it.
-    gl_buffer = gl_buffer_import(gl, buffer);
+    gl_buffer = gl_buffer_import(gl, buffer, &gl->capture.buffers);
     if (!gl_buffer) {
         gl->capture.current = nullptr;
         return;
@@ -220,6 +274,7 @@ on_surface_commit(struct wl_listener *listener, void *data) {
     }
 
     gl->capture.current = gl_buffer;
+    wl_signal_emit_mutable(&gl->events.capture, nullptr);
 }
 
 static void
@@ -233,11 +288,10 @@ static void
 on_ui_resize(struct wl_listener *listener, void *data) {
     struct server_gl *gl = wl_container_of(listener, gl, on_ui_resize);
 
-    wl_egl_window_resize(gl->surface.window, gl->server->ui->render_width,
-                         gl->server->ui->render_height, 0, 0);
-
-    wp_viewport_set_destination(gl->surface.viewport, gl->server->ui->width,
-                                gl->server->ui->height);
+    // Cover the whole window until the scene provides tighter bounds on its next frame.
+    gl->surface.bounds = (struct box){};
+    server_gl_set_bounds(gl, &(struct box){0, 0, gl->server->ui->render_width,
+                                           gl->server->ui->render_height});
 }
 
 static void
@@ -253,6 +307,154 @@ static const struct wl_callback_listener frame_callback_listener = {
     .done = on_frame_callback_done,
 };
 
+static void
+on_projector_toplevel_close(void *data, struct xdg_toplevel *xdg_toplevel) {
+    struct server_gl *gl = data;
+
+    // The projector stays closed until the configuration is next loaded.
+    ww_log(LOG_INFO, "projector window closed");
+    projector_destroy(gl);
+}
+
+static void
+on_projector_toplevel_configure(void *data, struct xdg_toplevel *xdg_toplevel, int32_t width,
+                                int32_t height, struct wl_array *states) {
+    struct server_gl *gl = data;
+
+    gl->projector.width = width > 0 ? width : gl->projector.requested_width;
+    gl->projector.height = height > 0 ? height : gl->projector.requested_height;
+}
+
+static void
+on_projector_toplevel_configure_bounds(void *data, struct xdg_toplevel *xdg_toplevel,
+                                       int32_t width, int32_t height) {
+    // Unused.
+}
+
+static void
+on_projector_toplevel_wm_capabilities(void *data, struct xdg_toplevel *xdg_toplevel,
+                                      struct wl_array *capabilities) {
+    // Unused.
+}
+
+static const struct xdg_toplevel_listener projector_toplevel_listener = {
+    .close = on_projector_toplevel_close,
+    .configure = on_projector_toplevel_configure,
+    .configure_bounds = on_projector_toplevel_configure_bounds,
+    .wm_capabilities = on_projector_toplevel_wm_capabilities,
+};
+
+static void
+on_projector_surface_configure(void *data, struct xdg_surface *xdg_surface, uint32_t serial) {
+    struct server_gl *gl = data;
+
+    xdg_surface_set_window_geometry(xdg_surface, 0, 0, gl->projector.width, gl->projector.height);
+    xdg_surface_ack_configure(xdg_surface, serial);
+
+    // The new size takes effect when the next frame is swapped.
+    wl_egl_window_resize(gl->projector.window, gl->projector.width, gl->projector.height, 0, 0);
+    gl->projector.configured = true;
+}
+
+static const struct xdg_surface_listener projector_surface_listener = {
+    .configure = on_projector_surface_configure,
+};
+
+static void
+projector_destroy(struct server_gl *gl) {
+    // The projector's surface cannot be left bound to the context once it is destroyed.
+    if (gl->context.current && gl->context.surface == gl->projector.egl) {
+        eglMakeCurrent(gl->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE, gl->egl.ctx);
+        gl->context.surface = EGL_NO_SURFACE;
+    }
+
+    eglDestroySurface(gl->egl.display, gl->projector.egl);
+    wl_egl_window_destroy(gl->projector.window);
+    if (gl->projector.xdg_decoration) {
+        zxdg_toplevel_decoration_v1_destroy(gl->projector.xdg_decoration);
+    }
+    xdg_toplevel_destroy(gl->projector.xdg_toplevel);
+    xdg_surface_destroy(gl->projector.xdg_surface);
+    wl_surface_destroy(gl->projector.remote);
+
+    gl->projector.remote = nullptr;
+    gl->projector.xdg_surface = nullptr;
+    gl->projector.xdg_toplevel = nullptr;
+    gl->projector.xdg_decoration = nullptr;
+    gl->projector.window = nullptr;
+    gl->projector.egl = EGL_NO_SURFACE;
+    gl->projector.configured = false;
+}
+
+static bool
+projector_create(struct server_gl *gl, int32_t width, int32_t height) {
+    struct server *server = gl->server;
+
+    gl->projector.remote = wl_compositor_create_surface(server->backend->compositor);
+    check_alloc(gl->projector.remote);
+
+    // The projector is only meant to be captured, so it does not take any pointer input.
+    wl_surface_set_input_region(gl->projector.remote, server->ui->empty_region);
+
+    gl->projector.window = wl_egl_window_create(gl->projector.remote, width, height);
+    check_alloc(gl->projector.window);
+
+    gl->projector.egl = gl->egl.CreatePlatformWindowSurfaceEXT(
+        gl->egl.display, gl->egl.config, gl->projector.window, nullptr);
+    if (gl->projector.egl == EGL_NO_SURFACE) {
+        ww_log_egl(LOG_ERROR, "failed to create EGL surface for projector");
+        wl_egl_window_destroy(gl->projector.window);
+        wl_surface_destroy(gl->projector.remote);
+        gl->projector.window = nullptr;
+        gl->projector.remote = nullptr;
+        return false;
+    }
+
+    gl->projector.xdg_surface =
+        xdg_wm_base_get_xdg_surface(server->backend->xdg_wm_base, gl->projector.remote);
+    check_alloc(gl->projector.xdg_surface);
+    xdg_surface_add_listener(gl->projector.xdg_surface, &projector_surface_listener, gl);
+
+    gl->projector.xdg_toplevel = xdg_surface_get_toplevel(gl->projector.xdg_surface);
+    check_alloc(gl->projector.xdg_toplevel);
+    xdg_toplevel_add_listener(gl->projector.xdg_toplevel, &projector_toplevel_listener, gl);
+
+    xdg_toplevel_set_title(gl->projector.xdg_toplevel, "waywall projector");
+    xdg_toplevel_set_app_id(gl->projector.xdg_toplevel, "waywall-projector");
+
+    if (server->backend->xdg_decoration_manager) {
+        gl->projector.xdg_decoration = zxdg_decoration_manager_v1_get_toplevel_decoration(
+            server->backend->xdg_decoration_manager, gl->projector.xdg_toplevel);
+        check_alloc(gl->projector.xdg_decoration);
+
+        zxdg_toplevel_decoration_v1_set_mode(gl->projector.xdg_decoration,
+                                             ZXDG_TOPLEVEL_DECORATION_V1_MODE_SERVER_SIDE);
+    }
+
+    gl->projector.width = width;
+    gl->projector.height = height;
+    return true;
+}
+
+static void
+bounds_align(int32_t *start, int32_t *size, int32_t render, int32_t logical) {
+    // Grow the range [start, start + size) outwards so that both of its edges map to whole logical
+    // pixels. The overlay would otherwise be resampled by the host compositor when the render size
+    // differs from the window size.
+    int32_t a = render, b = logical;
+    while (b != 0) {
+        int32_t tmp = a % b;
+        a = b;
+        b = tmp;
+    }
+    int32_t step = render / a;
+
+    int32_t end = *start + *size;
+    *start = (*start / step) * step;
+    end = ((end + step - 1) / step) * step;
+    *size = (end > render ? render : end) - *start;
+}
+
 static bool
 egl_getproc(void *out, const char *name) {
     void *addr = (void *)eglGetProcAddress(name);
@@ -265,6 +467,57 @@ egl_getproc(void *out, const char *name) {
     return true;
 }
 
+static void
+egl_query_device(struct server_gl *gl) {
+    // The DRM device used by EGL is only needed to tell capture clients where to allocate their
+    // buffers, so it is not an error if it cannot be found.
+    const char *client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (!client_extensions || !strstr(client_extensions, "EGL_EXT_device_query")) {
+        return;
+    }
+
+    PFNEGLQUERYDISPLAYATTRIBEXTPROC QueryDisplayAttribEXT;
+    PFNEGLQUERYDEVICESTRINGEXTPROC QueryDeviceStringEXT;
+    if (!egl_getproc(&QueryDisplayAttribEXT, "eglQueryDisplayAttribEXT") ||
+        !egl_getproc(&QueryDeviceStringEXT, "eglQueryDeviceStringEXT")) {
+        return;
+    }
+
+    EGLAttrib device_attrib;
+    if (!QueryDisplayAttribEXT(gl->egl.display, EGL_DEVICE_EXT, &device_attrib)) {
+        return;
+    }
+    EGLDeviceEXT device = (EGLDeviceEXT)device_attrib;
+
+    const char *device_extensions = QueryDeviceStringEXT(device, EGL_EXTENSIONS);
+    if (!device_extensions || !strstr(device_extensions, "EGL_EXT_device_drm")) {
+        return;
+    }
+
+    const char *path = nullptr;
+#ifdef EGL_DRM_RENDER_NODE_FILE_EXT
+    if (strstr(device_extensions, "EGL_EXT_device_drm_render_node")) {
+        path = QueryDeviceStringEXT(device, EGL_DRM_RENDER_NODE_FILE_EXT);
+    }
+#endif
+    if (!path) {
+        path = QueryDeviceStringEXT(device, EGL_DRM_DEVICE_FILE_EXT);
+    }
+    if (!path) {
+        return;
+    }
+
+    struct stat dev_stat;
+    if (stat(path, &dev_stat) != 0) {
+        ww_log_errno(LOG_WARN, "failed to stat DRM device '%s'", path);
+        return;
+    }
+
+    gl->egl.device = dev_stat.st_rdev;
+    gl->egl.has_device = true;
+    ww_log(LOG_INFO, "using DRM device '%s'", path);
+}
+
 static void
 egl_print_sysinfo(struct server_gl *gl) {
     static const struct {
@@ -352,22 +605,42 @@ gl_checkerr(const char *msg) {
     return false;
 }
 
+static bool
+make_current(struct server_gl *gl, EGLSurface surface) {
+    // The context is left current once it has been made current, since waywall only has one
+    // context. It only needs to be made current again if a different surface must be bound.
+    if (gl->context.current && (surface == EGL_NO_SURFACE || gl->context.surface == surface)) {
+        gl->state.calls.skipped++;
+        return true;
+    }
+
+    gl->state.calls.issued++;
+    if (!eglMakeCurrent(gl->egl.display, surface, surface, gl->egl.ctx)) {
+        gl->context.current = false;
+        return false;
+    }
+
+    gl->context.current = true;
+    gl->context.surface = surface;
+    return true;
+}
+
 static void
 gl_buffer_destroy(struct gl_buffer *gl_buffer) {
     server_buffer_unref(gl_buffer->parent);
 
-    eglMakeCurrent(gl_buffer->gl->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE,
-                   gl_buffer->gl->egl.ctx);
+    make_current(gl_buffer->gl, EGL_NO_SURFACE);
 
-    glDeleteTextures(1, &gl_buffer->texture);
+    server_gl_delete_textures(gl_buffer->gl, 1, &gl_buffer->texture);
     gl_buffer->gl->egl.DestroyImageKHR(gl_buffer->gl->egl.display, gl_buffer->image);
 
+    gl_buffer->gl->capture.bytes -= gl_buffer->bytes;
     wl_list_remove(&gl_buffer->link);
     free(gl_buffer);
 }
 
 static struct gl_buffer *
-gl_buffer_import(struct server_gl *gl, struct server_buffer *buffer) {
+gl_buffer_import(struct server_gl *gl, struct server_buffer *buffer, struct wl_list *list) {
     if (strcmp(buffer->impl->name, SERVER_BUFFER_DMABUF) != 0) {
         ww_log(LOG_ERROR, "cannot create server_gl_surface for non-DMABUF buffer");
         return nullptr;
@@ -426,14 +699,13 @@ gl_buffer_import(struct server_gl *gl, struct server_buffer *buffer) {
     }
 
     // Create an OpenGL texture with the imported EGLImageKHR.
-    if (!eglMakeCurrent(gl_buffer->gl->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE,
-                        gl_buffer->gl->egl.ctx)) {
+    if (!make_current(gl, EGL_NO_SURFACE)) {
         ww_log_egl(LOG_ERROR, "failed to make EGL context current");
         goto fail_make_current;
     }
 
     glGenTextures(1, &gl_buffer->texture);
-    gl_using_texture(GL_TEXTURE_2D, gl_buffer->texture) {
+    gl_using_texture(gl, GL_TEXTURE_2D, gl_buffer->texture) {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -441,17 +713,23 @@ gl_buffer_import(struct server_gl *gl, struct server_buffer *buffer) {
 
         gl_buffer->gl->egl.ImageTargetTexture2DOES(GL_TEXTURE_2D, gl_buffer->image);
         if (!gl_checkerr("failed to import texture")) {
-            glBindTexture(GL_TEXTURE_2D, 0);
             goto fail_image_target;
         }
     }
 
-    wl_list_insert(&gl->capture.buffers, &gl_buffer->link);
+    // The memory backing the DMABUF is owned by the client, but it stays resident for as long as
+    // it is imported. The size is only an estimate, since the layout of each plane is opaque.
+    for (uint32_t p = 0; p < data->num_planes; p++) {
+        gl_buffer->bytes += (size_t)data->planes[p].stride * (size_t)data->height;
+    }
+    gl->capture.bytes += gl_buffer->bytes;
+
+    wl_list_insert(list, &gl_buffer->link);
 
     return gl_buffer;
 
 fail_image_target:
-    glDeleteTextures(1, &gl_buffer->texture);
+    server_gl_delete_textures(gl, 1, &gl_buffer->texture);
 fail_make_current:
     gl_buffer->gl->egl.DestroyImageKHR(gl_buffer->gl->egl.display, gl_buffer->image);
 
@@ -519,6 +797,10 @@ server_gl_create(struct server *server) {
 
     gl->server = server;
 
+    // The initial blend function is (GL_ONE, GL_ZERO) for both color and alpha.
+    gl->state.blend_func[0] = gl->state.blend_func[2] = GL_ONE;
+    gl->state.blend_func[1] = gl->state.blend_func[3] = GL_ZERO;
+
     // Initialize the EGL display.
     if (!egl_getproc(&gl->egl.GetPlatformDisplayEXT, "eglGetPlatformDisplayEXT")) {
         goto fail_get_proc;
@@ -540,6 +822,8 @@ server_gl_create(struct server *server) {
         goto fail_initialize;
     }
 
+    egl_query_device(gl);
+
     // Query for EGL extension support. In particular, we need to be able to import and export
     // DMABUFs.
     const char *egl_extensions = eglQueryString(gl->egl.display, EGL_EXTENSIONS);
@@ -565,19 +849,43 @@ server_gl_create(struct server *server) {
         goto fail_extensions_egl;
     }
 
-    // Choose a configuration and create an EGL context.
-    EGLint n = 0;
-    if (!eglChooseConfig(gl->egl.display, CONFIG_ATTRIBUTES, &gl->egl.config, 1, &n) || n == 0) {
-        ww_log_egl(LOG_ERROR, "failed to choose EGL config");
-        goto fail_choose_config;
+    // Fences are used for asynchronous readback from the GPU, but are not required. Readbacks will
+    // stall if they are not available.
+    if (strstr(egl_extensions, "EGL_KHR_fence_sync")) {
+        bool ok = egl_getproc(&gl->egl.CreateSyncKHR, "eglCreateSyncKHR") &&
+                  egl_getproc(&gl->egl.DestroySyncKHR, "eglDestroySyncKHR") &&
+                  egl_getproc(&gl->egl.GetSyncAttribKHR, "eglGetSyncAttribKHR");
+        if (!ok) {
+            gl->egl.CreateSyncKHR = nullptr;
+        }
+    }
+    if (!gl->egl.CreateSyncKHR) {
+        ww_log(LOG_WARN, "no support for 'EGL_KHR_fence_sync', readbacks will block");
     }
 
-    gl->egl.ctx =
-        eglCreateContext(gl->egl.display, gl->egl.config, EGL_NO_CONTEXT, CONTEXT_ATTRIBUTES);
+    // Choose a configuration and create an EGL context, preferring the newest version of OpenGL ES
+    // which is available.
+    gl->egl.ctx = EGL_NO_CONTEXT;
+    for (size_t i = 0; i < STATIC_ARRLEN(CONTEXT_VERSIONS); i++) {
+        EGLint n = 0;
+        if (!eglChooseConfig(gl->egl.display, CONTEXT_VERSIONS[i].config, &gl->egl.config, 1,
+                             &n) ||
+            n == 0) {
+            continue;
+        }
+
+        gl->egl.ctx = eglCreateContext(gl->egl.display, gl->egl.config, EGL_NO_CONTEXT,
+                                       CONTEXT_VERSIONS[i].context);
+        if (gl->egl.ctx != EGL_NO_CONTEXT) {
+            gl->gles.version = CONTEXT_VERSIONS[i].version;
+            break;
+        }
+    }
     if (gl->egl.ctx == EGL_NO_CONTEXT) {
-        ww_log(LOG_ERROR, "failed to create EGL context");
+        ww_log_egl(LOG_ERROR, "failed to create EGL context");
         goto fail_create_context;
     }
+    ww_log(LOG_INFO, "created OpenGL ES %d context", gl->gles.version);
 
     // Ensure the required OpenGL extensions are present.
     if (!eglMakeCurrent(gl->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE, gl->egl.ctx)) {
@@ -598,6 +906,51 @@ server_gl_create(struct server *server) {
         }
     }
 
+    // Vertex array objects are core in OpenGL ES 3.0 and available as an extension on some OpenGL
+    // ES 2.0 implementations. They are optional, and the scene specifies vertex attributes on each
+    // draw without them.
+    if (gl->gles.version >= 3) {
+        bool ok = egl_getproc(&gl->gles.BindVertexArray, "glBindVertexArray") &&
+                  egl_getproc(&gl->gles.DeleteVertexArrays, "glDeleteVertexArrays") &&
+                  egl_getproc(&gl->gles.GenVertexArrays, "glGenVertexArrays");
+        if (!ok) {
+            gl->gles.GenVertexArrays = nullptr;
+        }
+    } else if (strstr(gl_extensions, "GL_OES_vertex_array_object")) {
+        bool ok = egl_getproc(&gl->gles.BindVertexArray, "glBindVertexArrayOES") &&
+                  egl_getproc(&gl->gles.DeleteVertexArrays, "glDeleteVertexArraysOES") &&
+                  egl_getproc(&gl->gles.GenVertexArrays, "glGenVertexArraysOES");
+        if (!ok) {
+            gl->gles.GenVertexArrays = nullptr;
+        }
+    }
+    if (!gl->gles.GenVertexArrays) {
+        ww_log(LOG_INFO, "no support for vertex array objects");
+    }
+
+    // Pixel buffer objects are core in OpenGL ES 3.0. Without them, large readbacks (such as
+    // screenshots) are read synchronously once their fence has signalled.
+    if (gl->gles.version >= 3) {
+        bool ok = egl_getproc(&gl->gles.MapBufferRange, "glMapBufferRange") &&
+                  egl_getproc(&gl->gles.UnmapBuffer, "glUnmapBuffer");
+        if (!ok) {
+            gl->gles.MapBufferRange = nullptr;
+        }
+    }
+
+    // Timer queries are only used for profiling scene objects, and are not required.
+    if (strstr(gl_extensions, "GL_EXT_disjoint_timer_query")) {
+        bool ok = egl_getproc(&gl->gles.BeginQueryEXT, "glBeginQueryEXT") &&
+                  egl_getproc(&gl->gles.DeleteQueriesEXT, "glDeleteQueriesEXT") &&
+                  egl_getproc(&gl->gles.EndQueryEXT, "glEndQueryEXT") &&
+                  egl_getproc(&gl->gles.GenQueriesEXT, "glGenQueriesEXT") &&
+                  egl_getproc(&gl->gles.GetQueryObjectui64vEXT, "glGetQueryObjectui64vEXT") &&
+                  egl_getproc(&gl->gles.GetQueryObjectuivEXT, "glGetQueryObjectuivEXT");
+        if (!ok) {
+            gl->gles.GenQueriesEXT = nullptr;
+        }
+    }
+
     // Create the OpenGL surface.
     gl->surface.remote = wl_compositor_create_surface(server->backend->compositor);
     check_alloc(gl->surface.remote);
@@ -638,8 +991,10 @@ server_gl_create(struct server *server) {
     }
 
     wl_list_init(&gl->capture.buffers);
+    wl_list_init(&gl->capture.exports);
 
     wl_signal_init(&gl->events.frame);
+    wl_signal_init(&gl->events.capture);
 
     return gl;
 
@@ -655,7 +1010,6 @@ fail_make_current:
     eglDestroyContext(gl->egl.display, gl->egl.ctx);
 
 fail_create_context:
-fail_choose_config:
 fail_extensions_egl:
     eglTerminate(gl->egl.display);
 
@@ -669,7 +1023,10 @@ fail_get_proc:
 
 void
 server_gl_destroy(struct server_gl *gl) {
+    // The surface is unbound before it is destroyed below.
     eglMakeCurrent(gl->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE, gl->egl.ctx);
+    gl->context.current = true;
+    gl->context.surface = EGL_NO_SURFACE;
 
     // Destroy capture resources.
     if (gl->capture.surface) {
@@ -681,8 +1038,18 @@ server_gl_destroy(struct server_gl *gl) {
     wl_list_for_each_safe (gl_buffer, gl_buffer_tmp, &gl->capture.buffers, link) {
         gl_buffer_destroy(gl_buffer);
     }
+    wl_list_for_each_safe (gl_buffer, gl_buffer_tmp, &gl->capture.exports, link) {
+        gl_buffer_destroy(gl_buffer);
+    }
+    if (gl->capture.fbo) {
+        glDeleteFramebuffers(1, &gl->capture.fbo);
+    }
 
     // Destroy surface resources.
+    if (gl->projector.remote) {
+        projector_destroy(gl);
+    }
+
     wl_list_remove(&gl->on_ui_resize.link);
 
     eglDestroySurface(gl->egl.display, gl->surface.egl);
@@ -705,9 +1072,12 @@ server_gl_destroy(struct server_gl *gl) {
 
 void
 server_gl_enter(struct server_gl *gl, bool surface) {
-    EGLSurface egl_surface = surface ? gl->surface.egl : EGL_NO_SURFACE;
+    // Entering the context is reentrant, so that callers can hold it across many operations (see
+    // scene_batch_begin.) The context is only made current if it is not already, or if the surface
+    // is needed and not yet bound.
+    gl->context.depth++;
 
-    if (!eglMakeCurrent(gl->egl.display, egl_surface, egl_surface, gl->egl.ctx)) {
+    if (!make_current(gl, surface ? gl->surface.egl : EGL_NO_SURFACE)) {
         ww_panic("failed to make EGL context current (surface: %s): %s", surface ? "yes" : "no",
                  egl_strerror());
     }
@@ -715,9 +1085,9 @@ server_gl_enter(struct server_gl *gl, bool surface) {
 
 void
 server_gl_exit(struct server_gl *gl) {
-    if (!eglMakeCurrent(gl->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT)) {
-        ww_panic("failed to exit EGL context: %s", egl_strerror());
-    }
+    // The context is not released, so that the next entry does not need to make it current again.
+    ww_assert(gl->context.depth > 0);
+    gl->context.depth--;
 }
 
 struct server_gl_shader *
@@ -725,6 +1095,7 @@ server_gl_compile(struct server_gl *gl, const char *vert, const char *frag) {
     // The OpenGL context must be current.
 
     struct server_gl_shader *shader = zalloc(1, sizeof(*shader));
+    shader->gl = gl;
 
     if (!compile_shader(&shader->vert, GL_VERTEX_SHADER, vert)) {
         goto fail_vert;
@@ -750,6 +1121,96 @@ fail_vert:
     return nullptr;
 }
 
+static struct gl_buffer *
+export_buffer_get(struct server_gl *gl, struct server_buffer *buffer) {
+    struct gl_buffer *gl_buffer, *tmp;
+    wl_list_for_each_safe (gl_buffer, tmp, &gl->capture.exports, link) {
+        if (gl_buffer->parent == buffer) {
+            // Keep the most recently used buffers at the front of the list.
+            wl_list_remove(&gl_buffer->link);
+            wl_list_insert(&gl->capture.exports, &gl_buffer->link);
+            return gl_buffer;
+        }
+
+        // Buffers which the capture client has destroyed will never be used again.
+        if (!gl_buffer->parent->resource) {
+            gl_buffer_destroy(gl_buffer);
+        }
+    }
+
+    gl_buffer = gl_buffer_import(gl, buffer, &gl->capture.exports);
+    if (!gl_buffer) {
+        return nullptr;
+    }
+
+    if (wl_list_length(&gl->capture.exports) > MAX_CACHED_EXPORTS) {
+        struct gl_buffer *oldest = wl_container_of(gl->capture.exports.prev, oldest, link);
+        gl_buffer_destroy(oldest);
+    }
+
+    return gl_buffer;
+}
+
+static bool
+capture_fbo_bind(struct server_gl *gl, GLuint texture) {
+    // The OpenGL context must be current.
+
+    if (!gl->capture.fbo) {
+        glGenFramebuffers(1, &gl->capture.fbo);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, gl->capture.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        ww_log(LOG_ERROR, "capture texture cannot be used as a framebuffer");
+        return false;
+    }
+    return true;
+}
+
+static void
+capture_fbo_unbind(struct server_gl *gl) {
+    // The OpenGL context must be current.
+
+    // Detach the texture so that the game's buffer is not kept alive after it is released.
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool
+server_gl_copy_capture(struct server_gl *gl, struct server_buffer *buffer) {
+    // The OpenGL context must be current.
+    //
+    // The current game frame is copied into the given DMABUF, which must have the same size. The
+    // destination is imported (and cached) so that the copy stays on the GPU. The caller should use
+    // a fence to find out when the copy has finished. SHM destinations are written with a
+    // server_gl_readback instead, so that the event loop never waits on the GPU.
+    ww_assert(gl->capture.current);
+
+    int32_t width, height;
+    server_gl_get_capture_size(gl, &width, &height);
+
+    bool ok = false;
+    if (!capture_fbo_bind(gl, gl->capture.current->texture)) {
+        goto done;
+    }
+
+    struct gl_buffer *dst = export_buffer_get(gl, buffer);
+    if (!dst) {
+        goto done;
+    }
+
+    gl_using_texture(gl, GL_TEXTURE_2D, dst->texture) {
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+    }
+    ok = gl_checkerr("failed to copy capture");
+
+done:
+    capture_fbo_unbind(gl);
+    return ok;
+}
+
 GLuint
 server_gl_get_capture(struct server_gl *gl) {
     if (!gl->capture.current) {
@@ -759,12 +1220,60 @@ server_gl_get_capture(struct server_gl *gl) {
     return gl->capture.current->texture;
 }
 
+void
+server_gl_get_capture_format(struct server_gl *gl, uint32_t *format, uint64_t *modifier) {
+    ww_assert(gl->capture.current);
+
+    struct server_dmabuf_data *data = gl->capture.current->parent->data;
+    *format = data->format;
+    *modifier = ((uint64_t)data->modifier_hi << 32) | (uint64_t)data->modifier_lo;
+}
+
 void
 server_gl_get_capture_size(struct server_gl *gl, int32_t *width, int32_t *height) {
     ww_assert(gl->capture.current);
     server_buffer_get_size(gl->capture.current->parent, width, height);
 }
 
+bool
+server_gl_get_device(struct server_gl *gl, dev_t *device) {
+    if (!gl->egl.has_device) {
+        return false;
+    }
+
+    *device = gl->egl.device;
+    return true;
+}
+
+void
+server_gl_set_bounds(struct server_gl *gl, struct box *bounds) {
+    // The given bounds are in render coordinates and must lie within the window. They are expanded
+    // as needed so that the overlay surface can be placed on exact logical pixels, and the caller
+    // must render with the adjusted bounds.
+    struct server_ui *ui = gl->server->ui;
+    if (ui->width <= 0 || ui->height <= 0 || ui->render_width <= 0 || ui->render_height <= 0) {
+        return;
+    }
+
+    ww_assert(bounds->width > 0 && bounds->height > 0);
+    bounds_align(&bounds->x, &bounds->width, ui->render_width, ui->width);
+    bounds_align(&bounds->y, &bounds->height, ui->render_height, ui->height);
+
+    if (memcmp(bounds, &gl->surface.bounds, sizeof(*bounds)) == 0) {
+        return;
+    }
+    gl->surface.bounds = *bounds;
+
+    // Both of these take effect when the next buffer is swapped. The subsurface position is
+    // applied by server_gl_swap_buffers afterwards.
+    wl_egl_window_resize(gl->surface.window, bounds->width, bounds->height, 0, 0);
+    wp_viewport_set_destination(
+        gl->surface.viewport, (int64_t)bounds->width * ui->width / ui->render_width,
+        (int64_t)bounds->height * ui->height / ui->render_height);
+
+    gl->surface.reposition = true;
+}
+
 void
 server_gl_set_capture(struct server_gl *gl, struct server_surface *surface) {
     if (gl->capture.surface) {
@@ -780,6 +1289,32 @@ server_gl_set_capture(struct server_gl *gl, struct server_surface *surface) {
     wl_signal_add(&surface->events.destroy, &gl->on_surface_destroy);
 }
 
+void
+server_gl_set_projector(struct server_gl *gl, int32_t width, int32_t height) {
+    if (width == 0 || height == 0) {
+        if (gl->projector.remote) {
+            projector_destroy(gl);
+        }
+        return;
+    }
+
+    if (!gl->projector.remote) {
+        if (!projector_create(gl, width, height)) {
+            return;
+        }
+    } else if (gl->projector.requested_width == width && gl->projector.requested_height == height) {
+        return;
+    }
+
+    // The projector is given a fixed size, so that its contents are laid out in the same way that
+    // the user configured them.
+    gl->projector.requested_width = width;
+    gl->projector.requested_height = height;
+    xdg_toplevel_set_min_size(gl->projector.xdg_toplevel, width, height);
+    xdg_toplevel_set_max_size(gl->projector.xdg_toplevel, width, height);
+    wl_surface_commit(gl->projector.remote);
+}
+
 void
 server_gl_swap_buffers(struct server_gl *gl) {
     // HACK: NVIDIA bug workaround. Check git blame for details.
@@ -797,12 +1332,269 @@ server_gl_swap_buffers(struct server_gl *gl) {
 
     eglSwapInterval(gl->egl.display, 0);
     eglSwapBuffers(gl->egl.display, gl->surface.egl);
+    gl->surface.unmapped = false;
+
+    WW_DEBUG(gl.issued, gl->state.calls.issued);
+    WW_DEBUG(gl.skipped, gl->state.calls.skipped);
+    gl->state.calls.issued = gl->state.calls.skipped = 0;
+
+    if (gl->surface.reposition) {
+        struct server_ui *ui = gl->server->ui;
+
+        wl_subsurface_set_position(
+            gl->surface.subsurface, (int64_t)gl->surface.bounds.x * ui->width / ui->render_width,
+            (int64_t)gl->surface.bounds.y * ui->height / ui->render_height);
+        wl_surface_commit(ui->tree.surface);
+
+        gl->surface.reposition = false;
+    }
+}
+
+void
+server_gl_unmap(struct server_gl *gl) {
+    // The overlay surface is unmapped until the next buffer is swapped. Attaching a null buffer
+    // rather than a transparent one means that the host compositor has nothing to blend over the
+    // game, and can scan it out directly.
+    if (gl->surface.unmapped) {
+        return;
+    }
+
+    wl_surface_attach(gl->surface.remote, nullptr, 0, 0);
+    wl_surface_commit(gl->surface.remote);
+    gl->surface.unmapped = true;
+}
+
+bool
+server_gl_projector_begin(struct server_gl *gl) {
+    // The OpenGL context must be current. If there is a projector which can be drawn to, its
+    // surface is bound until the context is next entered with the overlay surface.
+    if (!gl->projector.remote || !gl->projector.configured) {
+        return false;
+    }
+
+    if (!make_current(gl, gl->projector.egl)) {
+        ww_log_egl(LOG_ERROR, "failed to bind projector surface");
+        return false;
+    }
+
+    glViewport(0, 0, gl->projector.width, gl->projector.height);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    return true;
+}
+
+void
+server_gl_projector_swap(struct server_gl *gl) {
+    // The OpenGL context must be current, and server_gl_projector_begin must have succeeded.
+
+    // The projector is drawn once per game frame, and should never block waiting on the host
+    // compositor if it is not being shown.
+    eglSwapInterval(gl->egl.display, 0);
+    eglSwapBuffers(gl->egl.display, gl->projector.egl);
+}
+
+struct server_gl_fence *
+server_gl_fence_create(struct server_gl *gl) {
+    // The OpenGL context must be current.
+
+    struct server_gl_fence *fence = zalloc(1, sizeof(*fence));
+    fence->gl = gl;
+    fence->sync = EGL_NO_SYNC_KHR;
+
+    if (gl->egl.CreateSyncKHR) {
+        fence->sync = gl->egl.CreateSyncKHR(gl->egl.display, EGL_SYNC_FENCE_KHR, nullptr);
+        if (fence->sync == EGL_NO_SYNC_KHR) {
+            ww_log_egl(LOG_ERROR, "failed to create EGL fence");
+        }
+    }
+
+    // The fence is polled instead of waited on, so the command stream containing it must be
+    // flushed or it may never signal.
+    glFlush();
+
+    return fence;
+}
+
+void
+server_gl_fence_destroy(struct server_gl_fence *fence) {
+    if (fence->sync != EGL_NO_SYNC_KHR) {
+        fence->gl->egl.DestroySyncKHR(fence->gl->egl.display, fence->sync);
+    }
+
+    free(fence);
+}
+
+bool
+server_gl_fence_signaled(struct server_gl_fence *fence) {
+    // If no fence could be created, the caller will have to stall on whatever it does next.
+    if (fence->sync == EGL_NO_SYNC_KHR) {
+        return true;
+    }
+
+    EGLint status;
+    if (!fence->gl->egl.GetSyncAttribKHR(fence->gl->egl.display, fence->sync, EGL_SYNC_STATUS_KHR,
+                                         &status)) {
+        ww_log_egl(LOG_ERROR, "failed to query EGL fence status");
+        return true;
+    }
+
+    return status == EGL_SIGNALED_KHR;
+}
+
+struct server_gl_readback *
+server_gl_readback_create(struct server_gl *gl) {
+    // The OpenGL context must be current.
+    //
+    // The current game frame is read back so that it can later be written into a SHM buffer (see
+    // server_gl_readback_write.) The read is queued along with a fence, so that neither this nor
+    // the write has to wait for the GPU.
+    ww_assert(gl->capture.current);
+
+    struct server_gl_readback *readback = zalloc(1, sizeof(*readback));
+    readback->gl = gl;
+    server_gl_get_capture_size(gl, &readback->width, &readback->height);
+
+    if (!capture_fbo_bind(gl, gl->capture.current->texture)) {
+        capture_fbo_unbind(gl);
+        goto fail;
+    }
+
+    if (gl->gles.MapBufferRange) {
+        size_t size = (size_t)readback->width * (size_t)readback->height * 4;
+
+        glGenBuffers(1, &readback->pbo);
+        glBindBuffer(GLES3_PIXEL_PACK_BUFFER, readback->pbo);
+        glBufferData(GLES3_PIXEL_PACK_BUFFER, size, nullptr, GLES3_STREAM_READ);
+        glReadPixels(0, 0, readback->width, readback->height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GLES3_PIXEL_PACK_BUFFER, 0);
+    } else {
+        // OpenGL ES 2.0 only allows copying into a texture whose components are a subset of the
+        // framebuffer's. The game's buffer may not have an alpha channel, so it is left out.
+        glGenTextures(1, &readback->tex);
+        gl_using_texture(gl, GL_TEXTURE_2D, readback->tex) {
+            glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 0, 0, readback->width, readback->height, 0);
+        }
+    }
+    capture_fbo_unbind(gl);
+
+    if (!gl_checkerr("failed to read capture")) {
+        goto fail;
+    }
+
+    readback->fence = server_gl_fence_create(gl);
+    return readback;
+
+fail:
+    server_gl_readback_destroy(readback);
+    return nullptr;
+}
+
+void
+server_gl_readback_destroy(struct server_gl_readback *readback) {
+    // Readbacks can be destroyed from outside of the OpenGL context (e.g. when a capture client
+    // disconnects), so the context is entered here.
+    server_gl_with(readback->gl, false) {
+        if (readback->fence) {
+            server_gl_fence_destroy(readback->fence);
+        }
+        if (readback->pbo) {
+            server_gl_delete_buffers(readback->gl, 1, &readback->pbo);
+        }
+        if (readback->tex) {
+            server_gl_delete_textures(readback->gl, 1, &readback->tex);
+        }
+    }
+
+    free(readback);
+}
+
+bool
+server_gl_readback_ready(struct server_gl_readback *readback) {
+    return server_gl_fence_signaled(readback->fence);
+}
+
+bool
+server_gl_readback_write(struct server_gl_readback *readback, struct server_buffer *buffer) {
+    // The OpenGL context must be current.
+    //
+    // The given SHM buffer must have the same size as the game frame which was read back.
+    ww_assert(strcmp(buffer->impl->name, SERVER_BUFFER_SHM) == 0);
+
+    struct server_gl *gl = readback->gl;
+    struct server_shm_buffer_data *data = buffer->data;
+    ww_assert(data->width == readback->width && data->height == readback->height);
+
+    size_t row_size = (size_t)readback->width * 4;
+    size_t size = row_size * (size_t)readback->height;
+
+    const uint8_t *rgba = nullptr;
+    uint8_t *pixels = nullptr;
+
+    if (readback->pbo) {
+        glBindBuffer(GLES3_PIXEL_PACK_BUFFER, readback->pbo);
+        rgba = gl->gles.MapBufferRange(GLES3_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT_EXT);
+        if (!rgba) {
+            ww_log(LOG_ERROR, "failed to map capture readback buffer");
+            glBindBuffer(GLES3_PIXEL_PACK_BUFFER, 0);
+            return false;
+        }
+    } else {
+        pixels = malloc(size);
+        check_alloc(pixels);
+
+        bool ok = capture_fbo_bind(gl, readback->tex);
+        if (ok) {
+            glReadPixels(0, 0, readback->width, readback->height, GL_RGBA, GL_UNSIGNED_BYTE,
+                         pixels);
+        }
+        capture_fbo_unbind(gl);
+
+        if (!ok || !gl_checkerr("failed to read capture")) {
+            free(pixels);
+            return false;
+        }
+        rgba = pixels;
+    }
+
+    bool ok = false;
+    struct server_shm_access access;
+    if (server_shm_buffer_begin_access(data, &access)) {
+        // Both of the allowed formats (ARGB8888 and XRGB8888) are stored as BGRA in memory. The
+        // rows of the texture are already in the same order as the rows of the game's buffer.
+        for (int32_t y = 0; y < readback->height; y++) {
+            const uint8_t *src = rgba + row_size * (size_t)y;
+            uint8_t *dst = access.data + (size_t)data->stride * (size_t)y;
+
+            for (int32_t x = 0; x < readback->width; x++) {
+                dst[x * 4 + 0] = src[x * 4 + 2];
+                dst[x * 4 + 1] = src[x * 4 + 1];
+                dst[x * 4 + 2] = src[x * 4 + 0];
+                dst[x * 4 + 3] = src[x * 4 + 3];
+            }
+        }
+
+        ok = server_shm_buffer_end_access(&access);
+    }
+
+    if (readback->pbo) {
+        gl->gles.UnmapBuffer(GLES3_PIXEL_PACK_BUFFER);
+        glBindBuffer(GLES3_PIXEL_PACK_BUFFER, 0);
+    } else {
+        free(pixels);
+    }
+
+    return ok;
 }
 
 void
 server_gl_shader_destroy(struct server_gl_shader *shader) {
     // The OpenGL context must be current.
 
+    // A program which is in use is only deleted once another program is used.
+    if (shader->gl->state.program == shader->program) {
+        glUseProgram(0);
+        shader->gl->state.program = 0;
+    }
     glDeleteProgram(shader->program);
     glDeleteShader(shader->frag);
     glDeleteShader(shader->vert);
@@ -813,6 +1605,152 @@ server_gl_shader_destroy(struct server_gl_shader *shader) {
 void
 server_gl_shader_use(struct server_gl_shader *shader) {
     // The OpenGL context must be current.
+    struct server_gl *gl = shader->gl;
+
+    if (gl->state.program == shader->program) {
+        gl->state.calls.skipped++;
+        return;
+    }
 
     glUseProgram(shader->program);
+    gl->state.program = shader->program;
+    gl->state.calls.issued++;
+}
+
+void
+server_gl_bind_buffer(struct server_gl *gl, GLenum type, GLuint buffer) {
+    // The OpenGL context must be current. Only GL_ARRAY_BUFFER bindings are cached.
+    if (type == GL_ARRAY_BUFFER) {
+        if (gl->state.array_buffer == buffer) {
+            gl->state.calls.skipped++;
+            return;
+        }
+        gl->state.array_buffer = buffer;
+    }
+
+    glBindBuffer(type, buffer);
+    gl->state.calls.issued++;
+}
+
+void
+server_gl_bind_texture(struct server_gl *gl, GLenum type, GLuint texture) {
+    // The OpenGL context must be current. Only GL_TEXTURE_2D bindings are cached.
+    if (type == GL_TEXTURE_2D) {
+        if (gl->state.texture_2d == texture) {
+            gl->state.calls.skipped++;
+            return;
+        }
+        gl->state.texture_2d = texture;
+    }
+
+    glBindTexture(type, texture);
+    gl->state.calls.issued++;
+}
+
+void
+server_gl_bind_vertex_array(struct server_gl *gl, GLuint vao) {
+    // The OpenGL context must be current, and vertex array objects must be supported.
+    if (gl->state.vertex_array == vao) {
+        gl->state.calls.skipped++;
+        return;
+    }
+
+    gl->gles.BindVertexArray(vao);
+    gl->state.vertex_array = vao;
+    gl->state.calls.issued++;
+}
+
+void
+server_gl_delete_buffers(struct server_gl *gl, size_t n, const GLuint *buffers) {
+    // The OpenGL context must be current.
+
+    // Deleting a bound buffer unbinds it, and its name may be reused by a new buffer.
+    for (size_t i = 0; i < n; i++) {
+        if (gl->state.array_buffer == buffers[i]) {
+            gl->state.array_buffer = 0;
+        }
+    }
+    glDeleteBuffers(n, buffers);
+}
+
+void
+server_gl_delete_textures(struct server_gl *gl, size_t n, const GLuint *textures) {
+    // The OpenGL context must be current.
+
+    // Deleting a bound texture unbinds it, and its name may be reused by a new texture.
+    for (size_t i = 0; i < n; i++) {
+        if (gl->state.texture_2d == textures[i]) {
+            gl->state.texture_2d = 0;
+        }
+    }
+    glDeleteTextures(n, textures);
+}
+
+void
+server_gl_delete_vertex_arrays(struct server_gl *gl, size_t n, const GLuint *vaos) {
+    // The OpenGL context must be current, and vertex array objects must be supported.
+
+    // Deleting the bound vertex array object binds the default one in its place.
+    for (size_t i = 0; i < n; i++) {
+        if (gl->state.vertex_array == vaos[i]) {
+            gl->state.vertex_array = 0;
+        }
+    }
+    gl->gles.DeleteVertexArrays(n, vaos);
+}
+
+void
+server_gl_enable_attribs(struct server_gl *gl, uint32_t mask) {
+    // The OpenGL context must be current, and the default vertex array object must be bound.
+    uint32_t changed = gl->state.attribs ^ mask;
+
+    for (GLuint i = 0; changed >> i; i++) {
+        if (!(changed & (1u << i))) {
+            continue;
+        }
+
+        if (mask & (1u << i)) {
+            glEnableVertexAttribArray(i);
+        } else {
+            glDisableVertexAttribArray(i);
+        }
+        gl->state.calls.issued++;
+    }
+    if (!changed) {
+        gl->state.calls.skipped++;
+    }
+
+    gl->state.attribs = mask;
+}
+
+void
+server_gl_set_blend(struct server_gl *gl, bool enabled) {
+    // The OpenGL context must be current.
+    if (gl->state.blend == enabled) {
+        gl->state.calls.skipped++;
+        return;
+    }
+
+    if (enabled) {
+        glEnable(GL_BLEND);
+    } else {
+        glDisable(GL_BLEND);
+    }
+    gl->state.blend = enabled;
+    gl->state.calls.issued++;
+}
+
+void
+server_gl_set_blend_func(struct server_gl *gl, GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha,
+                         GLenum dst_alpha) {
+    // The OpenGL context must be current.
+    GLenum func[4] = {src_rgb, dst_rgb, src_alpha, dst_alpha};
+    if (memcmp(gl->state.blend_func, func, sizeof(func)) == 0) {
+        gl->state.calls.skipped++;
+        return;
+    }
+
+    glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+    memcpy(gl->state.blend_func, func, sizeof(func));
+    gl->state.calls.issued++;
 }
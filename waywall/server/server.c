@@ -8,9 +8,13 @@
 #include "server/wl_output.h"
 #include "server/wl_seat.h"
 #include "server/wl_shm.h"
+#include "server/wp_commit_timing.h"
+#include "server/wp_fifo.h"
+#include "server/wp_input_timestamps.h"
 #include "server/wp_linux_dmabuf.h"
 #include "server/wp_linux_drm_syncobj.h"
 #include "server/wp_pointer_constraints.h"
+#include "server/wp_presentation.h"
 #include "server/wp_relative_pointer.h"
 #include "server/xdg_decoration.h"
 #include "server/xdg_shell.h"
@@ -237,6 +241,36 @@ server_create(struct config *cfg) {
         }
     }
 
+    // Frame pacing requests from the game are forwarded to the host compositor, so these are only
+    // offered when the host supports them. Commit timestamps are given in the presentation clock,
+    // so commit timing is useless to clients unless wp_presentation is offered as well.
+    if (server->backend->presentation) {
+        server->presentation = server_presentation_create(server);
+        if (!server->presentation) {
+            goto fail_globals;
+        }
+    }
+    if (server->backend->fifo_manager) {
+        server->fifo = server_fifo_manager_create(server);
+        if (!server->fifo) {
+            goto fail_globals;
+        }
+    }
+    if (server->backend->commit_timing_manager && server->presentation) {
+        server->commit_timing = server_commit_timing_manager_create(server);
+        if (!server->commit_timing) {
+            goto fail_globals;
+        }
+    }
+
+    // High resolution timestamps can only be passed through if the host compositor provides them.
+    if (server->backend->input_timestamps_manager) {
+        server->input_timestamps = server_input_timestamps_create(server);
+        if (!server->input_timestamps) {
+            goto fail_globals;
+        }
+    }
+
     server->xwayland_shell = server_xwayland_shell_create(server);
     if (!server->xwayland_shell) {
         goto fail_globals;
@@ -165,6 +165,9 @@ surface_commit(struct wl_client *client, struct wl_resource *resource) {
             server_buffer_lock(surface->current.buffer);
         }
     }
+    if (surface->pending.present & SURFACE_STATE_OPAQUE) {
+        surface->current.opaque = surface->pending.opaque;
+    }
     if (surface->pending.present & SURFACE_STATE_DAMAGE) {
         struct server_surface_damage *dmg;
         wl_array_for_each(dmg, &surface->pending.damage) {
@@ -287,8 +290,12 @@ surface_set_input_region(struct wl_client *client, struct wl_resource *resource,
 static void
 surface_set_opaque_region(struct wl_client *client, struct wl_resource *resource,
                           struct wl_resource *region_resource) {
-    // Unused. `set_opaque_region` is just an optimization hint that clients can give to the
-    // compositor, but it requires additional bookkeeping code from waywall.
+    struct server_surface *surface = wl_resource_get_user_data(resource);
+
+    // The region itself is not forwarded, since waywall decides which of its surfaces are opaque
+    // (see server_view_commit.) Only whether the client considers its surface opaque is kept.
+    surface->pending.opaque = !!region_resource;
+    surface->pending.present |= SURFACE_STATE_OPAQUE;
 }
 
 static const struct wl_surface_interface surface_impl = {
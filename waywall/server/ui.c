@@ -5,6 +5,8 @@
 #include "server/buffer.h"
 #include "server/server.h"
 #include "server/surface.h"
+#include "server/wl_shm.h"
+#include "server/wp_linux_dmabuf.h"
 #include "single-pixel-buffer-v1-client-protocol.h"
 #include "tearing-control-v1-client-protocol.h"
 #include "util/alloc.h"
@@ -26,6 +28,9 @@
 static constexpr int32_t DEFAULT_WIDTH = 640;
 static constexpr int32_t DEFAULT_HEIGHT = 480;
 
+static constexpr uint32_t DRM_FORMAT_XBGR8888 = 0x34324258;
+static constexpr uint32_t DRM_FORMAT_XRGB8888 = 0x34325258;
+
 #define COLOR_BLEND(c, a) (COLOR_MULT(((c) * (a)) / UINT8_MAX))
 #define COLOR_MULT(c) ((uint32_t)(((uint64_t)(c) * UINT32_MAX) / UINT8_MAX))
 
@@ -114,7 +119,7 @@ color_buffer_new(struct server *server, const uint8_t color[static 4]) {
 }
 
 static struct wl_buffer *
-image_buffer_new(struct server *server, const char *path) {
+image_buffer_new(struct server *server, const char *path, bool *opaque) {
     struct util_png png = util_png_decode(path, 16384); // arbitrary max size
     if (!png.data) {
         return nullptr;
@@ -128,12 +133,18 @@ image_buffer_new(struct server *server, const char *path) {
         return nullptr;
     }
 
+    *opaque = true;
+
     size_t pixels = png.width * png.height;
     for (size_t i = 0; i < pixels; i++) {
         buf[i * 4 + 0] = png.data[i * 4 + 2];
         buf[i * 4 + 1] = png.data[i * 4 + 1];
         buf[i * 4 + 2] = png.data[i * 4 + 0];
         buf[i * 4 + 3] = png.data[i * 4 + 3];
+
+        if (png.data[i * 4 + 3] != UINT8_MAX) {
+            *opaque = false;
+        }
     }
 
     free(png.data);
@@ -148,8 +159,10 @@ layout_centered(struct server_view *view) {
     int32_t buf_w, buf_h;
     server_buffer_get_size(server_surface_next_buffer(view->surface), &buf_w, &buf_h);
 
-    double scale_x = (double)view->ui->width / view->ui->render_width;
-    double scale_y = (double)view->ui->height / view->ui->render_height;
+    // If the view is rendered at a lower resolution than it is displayed at, its buffer is scaled
+    // up by the host compositor.
+    double scale_x = (double)view->ui->width / view->ui->render_width / view->current.scale;
+    double scale_y = (double)view->ui->height / view->ui->render_height / view->current.scale;
 
     int32_t logical_w = (int32_t)(buf_w * scale_x);
     int32_t logical_h = (int32_t)(buf_h * scale_y);
@@ -307,9 +320,48 @@ static const struct xdg_surface_listener xdg_surface_listener = {
     .configure = on_xdg_surface_configure,
 };
 
+static bool
+buffer_opaque(struct server_buffer *buffer) {
+    if (strcmp(buffer->impl->name, SERVER_BUFFER_SHM) == 0) {
+        struct server_shm_buffer_data *data = buffer->data;
+        return data->format == WL_SHM_FORMAT_XRGB8888 || data->format == WL_SHM_FORMAT_XBGR8888;
+    } else if (strcmp(buffer->impl->name, SERVER_BUFFER_DMABUF) == 0) {
+        struct server_dmabuf_data *data = buffer->data;
+        return data->format == DRM_FORMAT_XRGB8888 || data->format == DRM_FORMAT_XBGR8888;
+    }
+
+    return false;
+}
+
+static void
+view_update_opaque(struct server_view *view, struct server_buffer *buffer, bool client_opaque) {
+    // A centered view can be marked as opaque, which lets the host compositor scan out the game
+    // directly when nothing is drawn over it. This is only done if the client's buffer has no alpha
+    // channel or the client marked its surface as opaque itself. Floating views (e.g. Ninjabrain
+    // Bot) are drawn translucently and are never marked. The opaque region is applied when the
+    // client next commits.
+    bool opaque = view->current.centered && (client_opaque || (buffer && buffer_opaque(buffer)));
+    if (opaque == view->opaque) {
+        return;
+    }
+
+    view->opaque = opaque;
+    wl_surface_set_opaque_region(view->surface->remote, opaque ? view->ui->opaque_region : nullptr);
+}
+
 static void
 on_view_surface_commit(struct wl_listener *listener, void *data) {
     struct server_view *view = wl_container_of(listener, view, on_surface_commit);
+    struct server_surface_state *current = &view->surface->current;
+    struct server_surface_state *pending = &view->surface->pending;
+
+    // The surface's pending state has not been applied yet, so the opaque region is sent to the
+    // host compositor along with the buffer it describes.
+    struct server_buffer *buffer =
+        (pending->present & SURFACE_STATE_BUFFER) ? pending->buffer : current->buffer;
+    bool client_opaque =
+        (pending->present & SURFACE_STATE_OPAQUE) ? pending->opaque : current->opaque;
+    view_update_opaque(view, buffer, client_opaque);
 
     if (!(view->surface->pending.present & SURFACE_STATE_BUFFER)) {
         return;
@@ -341,6 +393,12 @@ server_ui_create(struct server *server, struct config *cfg) {
     ui->empty_region = wl_compositor_create_region(server->backend->compositor);
     check_alloc(ui->empty_region);
 
+    // Regions are clipped to the bounds of the surface they are set on, so one region can mark
+    // any surface as entirely opaque regardless of its size.
+    ui->opaque_region = wl_compositor_create_region(server->backend->compositor);
+    check_alloc(ui->opaque_region);
+    wl_region_add(ui->opaque_region, 0, 0, INT32_MAX, INT32_MAX);
+
     ui->root.surface = wl_compositor_create_surface(server->backend->compositor);
     check_alloc(ui->root.surface);
 
@@ -419,6 +477,7 @@ fail_config:
     bg_buffer_destroy(ui->tree.buffer);
     wp_viewport_destroy(ui->root.viewport);
     wl_surface_destroy(ui->root.surface);
+    wl_region_destroy(ui->opaque_region);
     wl_region_destroy(ui->empty_region);
     free(ui);
     return nullptr;
@@ -442,6 +501,7 @@ server_ui_destroy(struct server_ui *ui) {
     bg_buffer_destroy(ui->tree.buffer);
     wp_viewport_destroy(ui->root.viewport);
     wl_surface_destroy(ui->root.surface);
+    wl_region_destroy(ui->opaque_region);
     wl_region_destroy(ui->empty_region);
 
     free(ui);
@@ -508,6 +568,11 @@ server_ui_use_config(struct server_ui *ui, struct server_ui_config *config) {
                                           ? WP_TEARING_CONTROL_V1_PRESENTATION_HINT_ASYNC
                                           : WP_TEARING_CONTROL_V1_PRESENTATION_HINT_VSYNC);
     }
+
+    // The opaque region lets the host compositor skip drawing anything beneath the background,
+    // and is applied along with the next buffer attached to the root surface.
+    wl_surface_set_opaque_region(ui->root.surface,
+                                 config->background_opaque ? ui->opaque_region : nullptr);
     if (ui->mapped) {
         wl_surface_attach(ui->root.surface, config->background, 0, 0);
         wl_surface_damage_buffer(ui->root.surface, 0, 0, INT32_MAX, INT32_MAX);
@@ -527,9 +592,11 @@ server_ui_config_create(struct server_ui *ui, struct config *cfg) {
     struct server_ui_config *config = zalloc(1, sizeof(*config));
 
     if (*cfg->theme.background_path) {
-        config->background = image_buffer_new(ui->server, cfg->theme.background_path);
+        config->background = image_buffer_new(ui->server, cfg->theme.background_path,
+                                               &config->background_opaque);
     } else {
         config->background = color_buffer_new(ui->server, cfg->theme.background);
+        config->background_opaque = cfg->theme.background[3] == UINT8_MAX;
     }
 
     if (!config->background) {
@@ -584,6 +651,8 @@ server_view_commit(struct server_view *view) {
                 view->alpha_surface,
                 view->current.centered ? UINT32_MAX : view->ui->config->ninb_opacity);
         }
+
+        view_update_opaque(view, view->surface->current.buffer, view->surface->current.opaque);
     }
     if (view->pending.present & VIEW_STATE_POS) {
         view->current.x = view->pending.x;
@@ -601,6 +670,9 @@ server_view_commit(struct server_view *view) {
 
         view->current.visible = view->pending.visible;
     }
+    if (view->pending.present & VIEW_STATE_SCALE) {
+        view->current.scale = view->pending.scale;
+    }
 
     if (size_changed) {
         view->impl->set_size(view->impl_data, view->current.width, view->current.height);
@@ -653,6 +725,14 @@ server_view_set_pos(struct server_view *view, uint32_t x, uint32_t y) {
     view->pending.present |= VIEW_STATE_POS;
 }
 
+void
+server_view_set_scale(struct server_view *view, double scale) {
+    ww_assert(scale > 0);
+
+    view->pending.scale = scale;
+    view->pending.present |= VIEW_STATE_SCALE;
+}
+
 void
 server_view_set_size(struct server_view *view, uint32_t width, uint32_t height) {
     view->pending.width = width;
@@ -673,6 +753,7 @@ server_view_create(struct server_ui *ui, struct server_surface *surface,
 
     view->ui = ui;
     view->surface = surface;
+    view->current.scale = 1.0;
 
     view->viewport = wp_viewporter_get_viewport(ui->server->backend->viewporter, surface->remote);
     check_alloc(view->viewport);
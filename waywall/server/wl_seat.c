@@ -4,6 +4,7 @@
 #include "server/server.h"
 #include "server/ui.h"
 #include "server/surface.h"
+#include "server/wp_input_timestamps.h"
 #include "server/xwayland.h"
 #include "util/alloc.h"
 #include "util/debug.h"
@@ -76,11 +77,40 @@ static const struct server_surface_role cursor_role = {
     .destroy = cursor_role_destroy,
 };
 
-static uint32_t
+static struct timespec
 current_time() {
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
-    return (uint32_t)((uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000);
+    return now;
+}
+
+static struct timespec
+host_time(struct server_seat *seat, enum server_input_device device, uint32_t time) {
+    struct timespec ts;
+    if (seat->server->input_timestamps &&
+        server_input_timestamps_take(seat->server->input_timestamps, device, time, &ts)) {
+        return ts;
+    }
+
+    // Without a high resolution timestamp from the host, the millisecond timestamp of the event is
+    // passed through unchanged.
+    ts.tv_sec = time / 1000;
+    ts.tv_nsec = (long)(time % 1000) * 1000000;
+    return ts;
+}
+
+static uint32_t
+timespec_to_ms(const struct timespec *ts) {
+    return (uint32_t)((uint64_t)ts->tv_sec * 1000 + (uint64_t)ts->tv_nsec / 1000000);
+}
+
+static void
+send_timestamp(struct server_seat *seat, enum server_input_device device,
+               struct wl_resource *input_resource, const struct timespec *time) {
+    if (seat->server->input_timestamps) {
+        server_input_timestamps_send(seat->server->input_timestamps, device, input_resource,
+                                     time);
+    }
 }
 
 static void
@@ -111,15 +141,21 @@ get_pointer_offset(struct server_seat *seat, double *x, double *y) {
         //
         // TODO: This is a bit stupid, maybe it can be improved at some point when I improve
         // surface management logic
-        uint32_t width = seat->input_focus->current.width;
-        uint32_t height = seat->input_focus->current.height;
+        double scale = seat->input_focus->current.scale;
+        double width = seat->input_focus->current.width / scale;
+        double height = seat->input_focus->current.height / scale;
 
-        if ((int32_t)width > render_w) {
-            *x += (double)(width - render_w) / 2;
+        if (width > render_w) {
+            *x += (width - render_w) / 2;
         }
-        if ((int32_t)height > render_h) {
-            *y += (double)(height - render_h) / 2;
+        if (height > render_h) {
+            *y += (height - render_h) / 2;
         }
+
+        // If the view is rendered at a lower resolution than it is displayed at, the position
+        // needs to be scaled down to match the size of its buffer.
+        *x *= scale;
+        *y *= scale;
     } else {
         *x = logical_x;
         *y = logical_y;
@@ -295,7 +331,8 @@ send_keyboard_enter(struct server_seat *seat) {
 }
 
 static void
-send_keyboard_key(struct server_seat *seat, uint32_t key, enum wl_keyboard_key_state state) {
+send_keyboard_key(struct server_seat *seat, const struct timespec *time, uint32_t key,
+                  enum wl_keyboard_key_state state) {
     if (!seat->input_focus) {
         return;
     }
@@ -307,7 +344,8 @@ send_keyboard_key(struct server_seat *seat, uint32_t key, enum wl_keyboard_key_s
             continue;
         }
 
-        wl_keyboard_send_key(resource, next_serial(resource), current_time(), key, state);
+        send_timestamp(seat, SERVER_INPUT_KEYBOARD, resource, time);
+        wl_keyboard_send_key(resource, next_serial(resource), timespec_to_ms(time), key, state);
     }
 }
 
@@ -366,7 +404,8 @@ send_keyboard_repeat_info(struct server_seat *seat, struct wl_resource *keyboard
 }
 
 static void
-send_pointer_button(struct server_seat *seat, uint32_t button, bool state) {
+send_pointer_button(struct server_seat *seat, const struct timespec *time, uint32_t button,
+                    bool state) {
     if (!seat->input_focus) {
         return;
     }
@@ -378,7 +417,9 @@ send_pointer_button(struct server_seat *seat, uint32_t button, bool state) {
             continue;
         }
 
-        wl_pointer_send_button(resource, next_serial(resource), current_time(), button, state);
+        send_timestamp(seat, SERVER_INPUT_POINTER, resource, time);
+        wl_pointer_send_button(resource, next_serial(resource), timespec_to_ms(time), button,
+                               state);
     }
 }
 
@@ -421,13 +462,15 @@ send_pointer_leave(struct server_seat *seat) {
 
 static void
 reset_keyboard_state(struct server_seat *seat) {
+    struct timespec time = current_time();
+
     bool modifiers_updated = false;
     for (ssize_t i = 0; i < seat->keyboard.pressed.len; i++) {
         uint32_t keycode = seat->keyboard.pressed.data[i];
 
         modifiers_updated |=
             xkb_state_update_key(seat->config->keymap.state, keycode + 8, XKB_KEY_UP);
-        send_keyboard_key(seat, keycode, WL_KEYBOARD_KEY_STATE_RELEASED);
+        send_keyboard_key(seat, &time, keycode, WL_KEYBOARD_KEY_STATE_RELEASED);
     }
 
     seat->keyboard.pressed.len = 0;
@@ -454,7 +497,8 @@ use_local_keymap(struct server_seat *seat, struct server_seat_keymap keymap) {
 }
 
 static void
-process_remap_key(struct server_seat *seat, uint32_t keycode, bool state) {
+process_remap_key(struct server_seat *seat, const struct timespec *time, uint32_t keycode,
+                  bool state) {
     struct key_update update = modify_pressed_keys(seat, keycode, state);
     WW_DEBUG(keyboard.num_pressed, seat->keyboard.pressed.len);
 
@@ -463,18 +507,19 @@ process_remap_key(struct server_seat *seat, uint32_t keycode, bool state) {
     }
 
     if (update.changed_keys) {
-        send_keyboard_key(seat, keycode, state);
+        send_keyboard_key(seat, time, keycode, state);
     }
 }
 
 static void
-process_remap(struct server_seat *seat, struct server_seat_remap remap, bool state) {
+process_remap(struct server_seat *seat, const struct timespec *time, struct server_seat_remap remap,
+              bool state) {
     switch (remap.type) {
     case CONFIG_REMAP_BUTTON:
-        send_pointer_button(seat, remap.dst, state);
+        send_pointer_button(seat, time, remap.dst, state);
         return;
     case CONFIG_REMAP_KEY:
-        process_remap_key(seat, remap.dst, state);
+        process_remap_key(seat, time, remap.dst, state);
         return;
     case CONFIG_REMAP_NONE:
         ww_unreachable();
@@ -482,10 +527,11 @@ process_remap(struct server_seat *seat, struct server_seat_remap remap, bool sta
 }
 
 static bool
-try_remap_button(struct server_seat *seat, uint32_t button, bool state) {
+try_remap_button(struct server_seat *seat, const struct timespec *time, uint32_t button,
+                 bool state) {
     for (size_t i = 0; i < seat->config->remaps.num_buttons; i++) {
         if (seat->config->remaps.buttons[i].src == button) {
-            process_remap(seat, seat->config->remaps.buttons[i], state);
+            process_remap(seat, time, seat->config->remaps.buttons[i], state);
             return true;
         }
     }
@@ -493,10 +539,10 @@ try_remap_button(struct server_seat *seat, uint32_t button, bool state) {
 }
 
 static bool
-try_remap_key(struct server_seat *seat, uint32_t keycode, bool state) {
+try_remap_key(struct server_seat *seat, const struct timespec *time, uint32_t keycode, bool state) {
     for (size_t i = 0; i < seat->config->remaps.num_keys; i++) {
         if (seat->config->remaps.keys[i].src == keycode) {
-            process_remap(seat, seat->config->remaps.keys[i], state);
+            process_remap(seat, time, seat->config->remaps.keys[i], state);
             return true;
         }
     }
@@ -520,6 +566,8 @@ on_keyboard_key(void *data, struct wl_keyboard *wl, uint32_t serial, uint32_t ti
     struct server_seat *seat = data;
     seat->last_serial = serial;
 
+    struct timespec event_time = host_time(seat, SERVER_INPUT_KEYBOARD, time);
+
     // Actions should take priority over remaps.
     if (seat->listener) {
         const xkb_keysym_t *syms;
@@ -539,7 +587,7 @@ on_keyboard_key(void *data, struct wl_keyboard *wl, uint32_t serial, uint32_t ti
         }
     }
 
-    if (try_remap_key(seat, key, state == WL_KEYBOARD_KEY_STATE_PRESSED)) {
+    if (try_remap_key(seat, &event_time, key, state == WL_KEYBOARD_KEY_STATE_PRESSED)) {
         return;
     }
 
@@ -559,7 +607,7 @@ on_keyboard_key(void *data, struct wl_keyboard *wl, uint32_t serial, uint32_t ti
     }
 
     if (update.changed_keys) {
-        send_keyboard_key(seat, key, state == WL_KEYBOARD_KEY_STATE_PRESSED);
+        send_keyboard_key(seat, &event_time, key, state == WL_KEYBOARD_KEY_STATE_PRESSED);
     }
 }
 
@@ -694,6 +742,8 @@ static void
 on_pointer_axis(void *data, struct wl_pointer *wl, uint32_t time, uint32_t axis, wl_fixed_t value) {
     struct server_seat *seat = data;
 
+    struct timespec event_time = host_time(seat, SERVER_INPUT_POINTER, time);
+
     if (!seat->input_focus) {
         return;
     }
@@ -705,7 +755,8 @@ on_pointer_axis(void *data, struct wl_pointer *wl, uint32_t time, uint32_t axis,
             continue;
         }
 
-        wl_pointer_send_axis(resource, current_time(), axis, value);
+        send_timestamp(seat, SERVER_INPUT_POINTER, resource, &event_time);
+        wl_pointer_send_axis(resource, time, axis, value);
     }
 }
 
@@ -755,6 +806,8 @@ static void
 on_pointer_axis_stop(void *data, struct wl_pointer *wl, uint32_t time, uint32_t axis) {
     struct server_seat *seat = data;
 
+    struct timespec event_time = host_time(seat, SERVER_INPUT_POINTER, time);
+
     if (!seat->input_focus) {
         return;
     }
@@ -767,7 +820,8 @@ on_pointer_axis_stop(void *data, struct wl_pointer *wl, uint32_t time, uint32_t
         }
 
         if (wl_resource_get_version(resource) >= WL_POINTER_AXIS_STOP_SINCE_VERSION) {
-            wl_pointer_send_axis_stop(resource, current_time(), axis);
+            send_timestamp(seat, SERVER_INPUT_POINTER, resource, &event_time);
+            wl_pointer_send_axis_stop(resource, time, axis);
         }
     }
 }
@@ -778,6 +832,8 @@ on_pointer_button(void *data, struct wl_pointer *wl, uint32_t serial, uint32_t t
     struct server_seat *seat = data;
     seat->last_serial = serial;
 
+    struct timespec event_time = host_time(seat, SERVER_INPUT_POINTER, time);
+
     if (seat->listener) {
         bool consumed = seat->listener->button(seat->listener_data, button,
                                                state == WL_POINTER_BUTTON_STATE_PRESSED);
@@ -786,11 +842,11 @@ on_pointer_button(void *data, struct wl_pointer *wl, uint32_t serial, uint32_t t
         }
     }
 
-    if (try_remap_button(seat, button, state == WL_POINTER_BUTTON_STATE_PRESSED)) {
+    if (try_remap_button(seat, &event_time, button, state == WL_POINTER_BUTTON_STATE_PRESSED)) {
         return;
     }
 
-    send_pointer_button(seat, button, state == WL_POINTER_BUTTON_STATE_PRESSED);
+    send_pointer_button(seat, &event_time, button, state == WL_POINTER_BUTTON_STATE_PRESSED);
 }
 
 static void
@@ -843,6 +899,8 @@ on_pointer_motion(void *data, struct wl_pointer *wl, uint32_t time, wl_fixed_t s
                   wl_fixed_t surface_y) {
     struct server_seat *seat = data;
 
+    struct timespec event_time = host_time(seat, SERVER_INPUT_POINTER, time);
+
     seat->pointer.x = wl_fixed_to_double(surface_x);
     seat->pointer.y = wl_fixed_to_double(surface_y);
 
@@ -867,8 +925,8 @@ on_pointer_motion(void *data, struct wl_pointer *wl, uint32_t time, wl_fixed_t s
             continue;
         }
 
-        wl_pointer_send_motion(resource, current_time(), wl_fixed_from_double(x),
-                               wl_fixed_from_double(y));
+        send_timestamp(seat, SERVER_INPUT_POINTER, resource, &event_time);
+        wl_pointer_send_motion(resource, time, wl_fixed_from_double(x), wl_fixed_from_double(y));
     }
 }
 
@@ -1133,7 +1191,8 @@ void
 server_seat_send_click(struct server_seat *seat, struct server_view *view) {
     ww_assert(seat->input_focus != view);
 
-    uint32_t time = current_time();
+    struct timespec ts = current_time();
+    uint32_t time = timespec_to_ms(&ts);
 
     struct wl_client *client = wl_resource_get_client(view->surface->resource);
     struct wl_resource *resource;
@@ -1143,8 +1202,10 @@ server_seat_send_click(struct server_seat *seat, struct server_view *view) {
         }
 
         wl_pointer_send_enter(resource, next_serial(resource), view->surface->resource, 0, 0);
+        send_timestamp(seat, SERVER_INPUT_POINTER, resource, &ts);
         wl_pointer_send_button(resource, next_serial(resource), time, BTN_LEFT,
                                WL_POINTER_BUTTON_STATE_PRESSED);
+        send_timestamp(seat, SERVER_INPUT_POINTER, resource, &ts);
         wl_pointer_send_button(resource, next_serial(resource), time, BTN_LEFT,
                                WL_POINTER_BUTTON_STATE_RELEASED);
         wl_pointer_send_leave(resource, next_serial(resource), view->surface->resource);
@@ -1160,7 +1221,8 @@ server_seat_send_keys(struct server_seat *seat, struct server_view *view, size_t
     struct wl_array wl_keys;
     wl_array_init(&wl_keys);
 
-    uint32_t time = current_time();
+    struct timespec ts = current_time();
+    uint32_t time = timespec_to_ms(&ts);
 
     wl_resource_for_each(resource, &seat->keyboards) {
         if (wl_resource_get_client(resource) != client) {
@@ -1173,6 +1235,7 @@ server_seat_send_keys(struct server_seat *seat, struct server_view *view, size_t
         }
 
         for (size_t i = 0; i < num_keys; i++) {
+            send_timestamp(seat, SERVER_INPUT_KEYBOARD, resource, &ts);
             wl_keyboard_send_key(resource, next_serial(resource), time, keys[i].keycode,
                                  keys[i].press ? WL_KEYBOARD_KEY_STATE_PRESSED
                                                : WL_KEYBOARD_KEY_STATE_RELEASED);
@@ -3,29 +3,99 @@
 #include "server/buffer.h"
 #include "server/server.h"
 #include "util/alloc.h"
+#include "util/log.h"
 #include "util/prelude.h"
+#include <fcntl.h>
 #include <inttypes.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <wayland-client-protocol.h>
 #include <wayland-server-protocol.h>
 
 static constexpr int SRV_SHM_VERSION = 1;
 
-struct shm_buffer_data {
-    int32_t width, height;
-};
+// Accessing memory past the end of a file mapping raises SIGBUS, and clients can shrink the files
+// backing their SHM pools at any time. Like libwayland (see wl_shm_buffer_begin_access), waywall
+// handles SIGBUS while it is accessing a client's buffer by replacing the mapping with zeroed
+// memory and failing the access, rather than crashing.
+static struct server_shm_access *volatile current_access;
+static struct sigaction prev_sigbus_action;
+static int zero_fd = -1;
+
+static void
+reraise_sigbus() {
+    // The fault did not come from a client's buffer, so it must be handled as it would have been
+    // without waywall's handler. The signal is delivered once the handler returns.
+    sigaction(SIGBUS, &prev_sigbus_action, nullptr);
+    raise(SIGBUS);
+}
+
+static void
+handle_sigbus(int signal, siginfo_t *info, void *ucontext) {
+    struct server_shm_access *access = current_access;
+    if (!access) {
+        reraise_sigbus();
+        return;
+    }
+
+    uint8_t *addr = info->si_addr;
+    uint8_t *map = access->map;
+    if (addr < map || addr >= map + access->size) {
+        reraise_sigbus();
+        return;
+    }
+
+    // The remaining writes to the buffer go to the zeroed pages, and are thrown away once the
+    // access ends.
+    access->failed = true;
+    if (mmap(map, access->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, zero_fd, 0) ==
+        MAP_FAILED) {
+        reraise_sigbus();
+    }
+}
+
+static bool
+sigbus_init() {
+    if (zero_fd != -1) {
+        return true;
+    }
+
+    zero_fd = open("/dev/zero", O_RDWR | O_CLOEXEC);
+    if (zero_fd == -1) {
+        ww_log_errno(LOG_ERROR, "failed to open /dev/zero");
+        return false;
+    }
+
+    struct sigaction action = {
+        .sa_sigaction = handle_sigbus,
+        .sa_flags = SA_SIGINFO,
+    };
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(SIGBUS, &action, &prev_sigbus_action) != 0) {
+        ww_log_errno(LOG_ERROR, "failed to install SIGBUS handler");
+        close(zero_fd);
+        zero_fd = -1;
+        return false;
+    }
+
+    return true;
+}
 
 static void
 shm_buffer_destroy(void *data) {
-    struct shm_buffer_data *buffer_data = data;
+    struct server_shm_buffer_data *buffer_data = data;
 
+    close(buffer_data->fd);
     free(buffer_data);
 }
 
 static void
 shm_buffer_size(void *data, int32_t *width, int32_t *height) {
-    struct shm_buffer_data *buffer_data = data;
+    struct server_shm_buffer_data *buffer_data = data;
 
     *width = buffer_data->width;
     *height = buffer_data->height;
@@ -75,10 +145,22 @@ shm_pool_create_buffer(struct wl_client *client, struct wl_resource *resource, u
         return;
     }
 
-    struct shm_buffer_data *buffer_data = zalloc(1, sizeof(*buffer_data));
+    // The buffer keeps its own copy of the pool's file descriptor, since it may outlive the pool.
+    int fd = fcntl(shm_pool->fd, F_DUPFD_CLOEXEC, 0);
+    if (fd == -1) {
+        ww_log_errno(LOG_ERROR, "failed to duplicate wl_shm_pool fd %d", (int)shm_pool->fd);
+        wl_resource_post_no_memory(resource);
+        return;
+    }
+
+    struct server_shm_buffer_data *buffer_data = zalloc(1, sizeof(*buffer_data));
 
+    buffer_data->fd = fd;
+    buffer_data->offset = offset;
     buffer_data->width = width;
     buffer_data->height = height;
+    buffer_data->stride = stride;
+    buffer_data->format = format;
 
     struct wl_resource *buffer_resource = wl_resource_create(client, &wl_buffer_interface, 1, id);
     check_alloc(buffer_resource);
@@ -204,3 +286,44 @@ server_shm_create(struct server *server) {
 
     return shm;
 }
+
+bool
+server_shm_buffer_begin_access(struct server_shm_buffer_data *data,
+                               struct server_shm_access *access) {
+    ww_assert(!current_access);
+
+    if (!sigbus_init()) {
+        return false;
+    }
+
+    *access = (struct server_shm_access){};
+    access->size = (size_t)data->offset + (size_t)data->stride * (size_t)data->height;
+    access->map = mmap(nullptr, access->size, PROT_READ | PROT_WRITE, MAP_SHARED, data->fd, 0);
+    if (access->map == MAP_FAILED) {
+        ww_log_errno(LOG_ERROR, "failed to map shm buffer");
+        return false;
+    }
+    access->data = (uint8_t *)access->map + data->offset;
+
+    current_access = access;
+    atomic_signal_fence(memory_order_seq_cst);
+
+    return true;
+}
+
+bool
+server_shm_buffer_end_access(struct server_shm_access *access) {
+    ww_assert(current_access == access);
+
+    // Every access to the buffer must be finished before the SIGBUS handler stops covering it.
+    atomic_signal_fence(memory_order_seq_cst);
+    current_access = nullptr;
+
+    munmap(access->map, access->size);
+
+    if (access->failed) {
+        ww_log(LOG_ERROR, "shm buffer was truncated by its client during access");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,196 @@
+#include "server/wp_commit_timing.h"
+#include "commit-timing-v1-client-protocol.h"
+#include "commit-timing-v1-server-protocol.h"
+#include "server/backend.h"
+#include "server/server.h"
+#include "server/surface.h"
+#include "util/alloc.h"
+#include "util/prelude.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <wayland-client-protocol.h>
+#include <wayland-server-protocol.h>
+
+static constexpr int SRV_COMMIT_TIMING_VERSION = 1;
+
+static constexpr uint32_t NSEC_PER_SEC = 1000000000;
+
+/*
+ * Timestamps are passed straight through to the host compositor, in the same way as FIFO barriers
+ * (see wp_fifo.c.) They are given in the presentation clock, which is the host's clock since
+ * waywall forwards wp_presentation as well (see wp_presentation.c.)
+ */
+
+static bool
+commit_timer_exists(struct server_commit_timing_manager *timing_manager,
+                    struct server_surface *surface) {
+    struct wl_resource *resource;
+    wl_resource_for_each(resource, &timing_manager->timers) {
+        struct server_commit_timer *timer = wl_resource_get_user_data(resource);
+
+        if (timer->parent == surface) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void
+on_surface_commit(struct wl_listener *listener, void *data) {
+    struct server_commit_timer *timer = wl_container_of(listener, timer, on_surface_commit);
+
+    timer->pending = false;
+}
+
+static void
+on_surface_destroy(struct wl_listener *listener, void *data) {
+    struct server_commit_timer *timer = wl_container_of(listener, timer, on_surface_destroy);
+
+    timer->parent = nullptr;
+
+    wl_list_remove(&timer->on_surface_commit.link);
+    wl_list_init(&timer->on_surface_commit.link);
+    wl_list_remove(&timer->on_surface_destroy.link);
+    wl_list_init(&timer->on_surface_destroy.link);
+}
+
+static void
+commit_timer_resource_destroy(struct wl_resource *resource) {
+    struct server_commit_timer *timer = wl_resource_get_user_data(resource);
+
+    wp_commit_timer_v1_destroy(timer->remote);
+
+    wl_list_remove(&timer->on_surface_commit.link);
+    wl_list_remove(&timer->on_surface_destroy.link);
+    wl_list_remove(wl_resource_get_link(resource));
+
+    free(timer);
+}
+
+static void
+commit_timer_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static void
+commit_timer_set_timestamp(struct wl_client *client, struct wl_resource *resource,
+                           uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec) {
+    struct server_commit_timer *timer = wl_resource_get_user_data(resource);
+
+    if (!timer->parent) {
+        wl_resource_post_error(resource, WP_COMMIT_TIMER_V1_ERROR_SURFACE_DESTROYED,
+                               "wl_surface associated with wp_commit_timer_v1 already destroyed");
+        return;
+    }
+    if (tv_nsec >= NSEC_PER_SEC) {
+        wl_resource_post_error(resource, WP_COMMIT_TIMER_V1_ERROR_INVALID_TIMESTAMP,
+                               "invalid nanosecond value %" PRIu32, tv_nsec);
+        return;
+    }
+    if (timer->pending) {
+        wl_resource_post_error(resource, WP_COMMIT_TIMER_V1_ERROR_TIMESTAMP_EXISTS,
+                               "timestamp already set for this commit");
+        return;
+    }
+
+    wp_commit_timer_v1_set_timestamp(timer->remote, tv_sec_hi, tv_sec_lo, tv_nsec);
+    timer->pending = true;
+}
+
+static const struct wp_commit_timer_v1_interface commit_timer_impl = {
+    .destroy = commit_timer_destroy,
+    .set_timestamp = commit_timer_set_timestamp,
+};
+
+static void
+commit_timing_manager_resource_destroy(struct wl_resource *resource) {
+    // Unused.
+}
+
+static void
+commit_timing_manager_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static void
+commit_timing_manager_get_timer(struct wl_client *client, struct wl_resource *resource,
+                                uint32_t id, struct wl_resource *surface_resource) {
+    struct server_commit_timing_manager *timing_manager = wl_resource_get_user_data(resource);
+    struct server_surface *surface = server_surface_from_resource(surface_resource);
+
+    if (commit_timer_exists(timing_manager, surface)) {
+        wl_resource_post_error(resource, WP_COMMIT_TIMING_MANAGER_V1_ERROR_COMMIT_TIMER_EXISTS,
+                               "wp_commit_timer_v1 already exists for given surface");
+        return;
+    }
+
+    struct server_commit_timer *timer = zalloc(1, sizeof(*timer));
+
+    timer->resource = wl_resource_create(client, &wp_commit_timer_v1_interface,
+                                         wl_resource_get_version(resource), id);
+    check_alloc(timer->resource);
+    wl_resource_set_implementation(timer->resource, &commit_timer_impl, timer,
+                                   commit_timer_resource_destroy);
+
+    timer->parent = surface;
+
+    timer->remote = wp_commit_timing_manager_v1_get_timer(timing_manager->remote, surface->remote);
+    check_alloc(timer->remote);
+
+    timer->on_surface_commit.notify = on_surface_commit;
+    wl_signal_add(&surface->events.commit, &timer->on_surface_commit);
+
+    timer->on_surface_destroy.notify = on_surface_destroy;
+    wl_signal_add(&surface->events.destroy, &timer->on_surface_destroy);
+
+    wl_list_insert(&timing_manager->timers, wl_resource_get_link(timer->resource));
+}
+
+static const struct wp_commit_timing_manager_v1_interface commit_timing_manager_impl = {
+    .destroy = commit_timing_manager_destroy,
+    .get_timer = commit_timing_manager_get_timer,
+};
+
+static void
+on_global_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    ww_assert(version <= SRV_COMMIT_TIMING_VERSION);
+
+    struct server_commit_timing_manager *timing_manager = data;
+
+    struct wl_resource *resource =
+        wl_resource_create(client, &wp_commit_timing_manager_v1_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &commit_timing_manager_impl, timing_manager,
+                                   commit_timing_manager_resource_destroy);
+}
+
+static void
+on_display_destroy(struct wl_listener *listener, void *data) {
+    struct server_commit_timing_manager *timing_manager =
+        wl_container_of(listener, timing_manager, on_display_destroy);
+
+    wl_global_destroy(timing_manager->global);
+
+    wl_list_remove(&timing_manager->on_display_destroy.link);
+
+    free(timing_manager);
+}
+
+struct server_commit_timing_manager *
+server_commit_timing_manager_create(struct server *server) {
+    struct server_commit_timing_manager *timing_manager = zalloc(1, sizeof(*timing_manager));
+
+    timing_manager->global =
+        wl_global_create(server->display, &wp_commit_timing_manager_v1_interface,
+                         SRV_COMMIT_TIMING_VERSION, timing_manager, on_global_bind);
+    check_alloc(timing_manager->global);
+
+    wl_list_init(&timing_manager->timers);
+    timing_manager->remote = server->backend->commit_timing_manager;
+
+    timing_manager->on_display_destroy.notify = on_display_destroy;
+    wl_display_add_destroy_listener(server->display, &timing_manager->on_display_destroy);
+
+    return timing_manager;
+}
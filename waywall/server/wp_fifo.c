@@ -0,0 +1,181 @@
+#include "server/wp_fifo.h"
+#include "fifo-v1-client-protocol.h"
+#include "fifo-v1-server-protocol.h"
+#include "server/backend.h"
+#include "server/server.h"
+#include "server/surface.h"
+#include "util/alloc.h"
+#include "util/prelude.h"
+#include <stdlib.h>
+#include <wayland-client-protocol.h>
+#include <wayland-server-protocol.h>
+
+static constexpr int SRV_FIFO_VERSION = 1;
+
+/*
+ * Barriers are passed straight through to the host compositor. Every commit made by the client is
+ * immediately forwarded to the remote surface (see surface_commit), so the barrier requests stay
+ * ordered relative to the commits they apply to without any state being kept here.
+ */
+
+static bool
+fifo_surface_exists(struct server_fifo_manager *fifo_manager, struct server_surface *surface) {
+    struct wl_resource *resource;
+    wl_resource_for_each(resource, &fifo_manager->surfaces) {
+        struct server_fifo_surface *fifo_surface = wl_resource_get_user_data(resource);
+
+        if (fifo_surface->parent == surface) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void
+on_surface_destroy(struct wl_listener *listener, void *data) {
+    struct server_fifo_surface *fifo_surface =
+        wl_container_of(listener, fifo_surface, on_surface_destroy);
+
+    fifo_surface->parent = nullptr;
+
+    wl_list_remove(&fifo_surface->on_surface_destroy.link);
+    wl_list_init(&fifo_surface->on_surface_destroy.link);
+}
+
+static void
+fifo_resource_destroy(struct wl_resource *resource) {
+    struct server_fifo_surface *fifo_surface = wl_resource_get_user_data(resource);
+
+    wp_fifo_v1_destroy(fifo_surface->remote);
+
+    wl_list_remove(&fifo_surface->on_surface_destroy.link);
+    wl_list_remove(wl_resource_get_link(resource));
+
+    free(fifo_surface);
+}
+
+static void
+fifo_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static void
+fifo_set_barrier(struct wl_client *client, struct wl_resource *resource) {
+    struct server_fifo_surface *fifo_surface = wl_resource_get_user_data(resource);
+
+    if (!fifo_surface->parent) {
+        wl_resource_post_error(resource, WP_FIFO_V1_ERROR_SURFACE_DESTROYED,
+                               "wl_surface associated with wp_fifo_v1 already destroyed");
+        return;
+    }
+
+    wp_fifo_v1_set_barrier(fifo_surface->remote);
+}
+
+static void
+fifo_wait_barrier(struct wl_client *client, struct wl_resource *resource) {
+    struct server_fifo_surface *fifo_surface = wl_resource_get_user_data(resource);
+
+    if (!fifo_surface->parent) {
+        wl_resource_post_error(resource, WP_FIFO_V1_ERROR_SURFACE_DESTROYED,
+                               "wl_surface associated with wp_fifo_v1 already destroyed");
+        return;
+    }
+
+    wp_fifo_v1_wait_barrier(fifo_surface->remote);
+}
+
+static const struct wp_fifo_v1_interface fifo_impl = {
+    .destroy = fifo_destroy,
+    .set_barrier = fifo_set_barrier,
+    .wait_barrier = fifo_wait_barrier,
+};
+
+static void
+fifo_manager_resource_destroy(struct wl_resource *resource) {
+    // Unused.
+}
+
+static void
+fifo_manager_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static void
+fifo_manager_get_fifo(struct wl_client *client, struct wl_resource *resource, uint32_t id,
+                      struct wl_resource *surface_resource) {
+    struct server_fifo_manager *fifo_manager = wl_resource_get_user_data(resource);
+    struct server_surface *surface = server_surface_from_resource(surface_resource);
+
+    if (fifo_surface_exists(fifo_manager, surface)) {
+        wl_resource_post_error(resource, WP_FIFO_MANAGER_V1_ERROR_ALREADY_EXISTS,
+                               "wp_fifo_v1 already exists for given surface");
+        return;
+    }
+
+    struct server_fifo_surface *fifo_surface = zalloc(1, sizeof(*fifo_surface));
+
+    fifo_surface->resource =
+        wl_resource_create(client, &wp_fifo_v1_interface, wl_resource_get_version(resource), id);
+    check_alloc(fifo_surface->resource);
+    wl_resource_set_implementation(fifo_surface->resource, &fifo_impl, fifo_surface,
+                                   fifo_resource_destroy);
+
+    fifo_surface->parent = surface;
+
+    fifo_surface->remote = wp_fifo_manager_v1_get_fifo(fifo_manager->remote, surface->remote);
+    check_alloc(fifo_surface->remote);
+
+    fifo_surface->on_surface_destroy.notify = on_surface_destroy;
+    wl_signal_add(&surface->events.destroy, &fifo_surface->on_surface_destroy);
+
+    wl_list_insert(&fifo_manager->surfaces, wl_resource_get_link(fifo_surface->resource));
+}
+
+static const struct wp_fifo_manager_v1_interface fifo_manager_impl = {
+    .destroy = fifo_manager_destroy,
+    .get_fifo = fifo_manager_get_fifo,
+};
+
+static void
+on_global_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    ww_assert(version <= SRV_FIFO_VERSION);
+
+    struct server_fifo_manager *fifo_manager = data;
+
+    struct wl_resource *resource =
+        wl_resource_create(client, &wp_fifo_manager_v1_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &fifo_manager_impl, fifo_manager,
+                                   fifo_manager_resource_destroy);
+}
+
+static void
+on_display_destroy(struct wl_listener *listener, void *data) {
+    struct server_fifo_manager *fifo_manager =
+        wl_container_of(listener, fifo_manager, on_display_destroy);
+
+    wl_global_destroy(fifo_manager->global);
+
+    wl_list_remove(&fifo_manager->on_display_destroy.link);
+
+    free(fifo_manager);
+}
+
+struct server_fifo_manager *
+server_fifo_manager_create(struct server *server) {
+    struct server_fifo_manager *fifo_manager = zalloc(1, sizeof(*fifo_manager));
+
+    fifo_manager->global = wl_global_create(server->display, &wp_fifo_manager_v1_interface,
+                                            SRV_FIFO_VERSION, fifo_manager, on_global_bind);
+    check_alloc(fifo_manager->global);
+
+    wl_list_init(&fifo_manager->surfaces);
+    fifo_manager->remote = server->backend->fifo_manager;
+
+    fifo_manager->on_display_destroy.notify = on_display_destroy;
+    wl_display_add_destroy_listener(server->display, &fifo_manager->on_display_destroy);
+
+    return fifo_manager;
+}
@@ -0,0 +1,289 @@
+#include "server/wp_input_timestamps.h"
+#include "input-timestamps-unstable-v1-client-protocol.h"
+#include "input-timestamps-unstable-v1-server-protocol.h"
+#include "server/backend.h"
+#include "server/server.h"
+#include "util/alloc.h"
+#include "util/prelude.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <wayland-client-protocol.h>
+#include <wayland-server-protocol.h>
+
+static constexpr int SRV_INPUT_TIMESTAMPS_VERSION = 1;
+
+static void
+on_remote_timestamp(void *data, struct zwp_input_timestamps_v1 *wl, uint32_t tv_sec_hi,
+                    uint32_t tv_sec_lo, uint32_t tv_nsec) {
+    struct server_input_timestamps_remote *remote = data;
+
+    remote->last.tv_sec = (time_t)(((uint64_t)tv_sec_hi << 32) | tv_sec_lo);
+    remote->last.tv_nsec = tv_nsec;
+    remote->pending = true;
+}
+
+static const struct zwp_input_timestamps_v1_listener remote_listener = {
+    .timestamp = on_remote_timestamp,
+};
+
+static void
+process_keyboard(struct server_input_timestamps *input_timestamps, struct wl_keyboard *keyboard) {
+    struct server_input_timestamps_remote *remote = &input_timestamps->remote_keyboard;
+
+    if (remote->wl) {
+        zwp_input_timestamps_v1_destroy(remote->wl);
+        remote->wl = nullptr;
+    }
+    remote->pending = false;
+
+    if (keyboard) {
+        remote->wl = zwp_input_timestamps_manager_v1_get_keyboard_timestamps(
+            input_timestamps->remote, keyboard);
+        check_alloc(remote->wl);
+
+        zwp_input_timestamps_v1_add_listener(remote->wl, &remote_listener, remote);
+    }
+}
+
+static void
+process_pointer(struct server_input_timestamps *input_timestamps, struct wl_pointer *pointer) {
+    struct server_input_timestamps_remote *remote = &input_timestamps->remote_pointer;
+
+    if (remote->wl) {
+        zwp_input_timestamps_v1_destroy(remote->wl);
+        remote->wl = nullptr;
+    }
+    remote->pending = false;
+
+    if (pointer) {
+        remote->wl = zwp_input_timestamps_manager_v1_get_pointer_timestamps(
+            input_timestamps->remote, pointer);
+        check_alloc(remote->wl);
+
+        zwp_input_timestamps_v1_add_listener(remote->wl, &remote_listener, remote);
+    }
+}
+
+// A zwp_input_timestamps_v1 object only receives the timestamps of events sent to the wl_keyboard
+// or wl_pointer it was created for.
+struct timestamps {
+    struct wl_resource *resource;
+    struct wl_resource *input; // nullptr if the wl_keyboard or wl_pointer has been destroyed
+
+    struct wl_listener on_input_destroy;
+};
+
+static void
+on_input_destroy(struct wl_listener *listener, void *data) {
+    struct timestamps *timestamps = wl_container_of(listener, timestamps, on_input_destroy);
+
+    timestamps->input = nullptr;
+    wl_list_remove(&timestamps->on_input_destroy.link);
+    wl_list_init(&timestamps->on_input_destroy.link);
+}
+
+static void
+timestamps_resource_destroy(struct wl_resource *resource) {
+    struct timestamps *timestamps = wl_resource_get_user_data(resource);
+
+    wl_list_remove(wl_resource_get_link(resource));
+    wl_list_remove(&timestamps->on_input_destroy.link);
+    free(timestamps);
+}
+
+static void
+timestamps_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static const struct zwp_input_timestamps_v1_interface timestamps_impl = {
+    .destroy = timestamps_destroy,
+};
+
+static void
+create_timestamps(struct wl_client *client, struct wl_resource *resource, uint32_t id,
+                  struct wl_resource *input_resource, struct wl_list *list) {
+    struct timestamps *timestamps = zalloc(1, sizeof(*timestamps));
+
+    timestamps->resource = wl_resource_create(client, &zwp_input_timestamps_v1_interface,
+                                              wl_resource_get_version(resource), id);
+    check_alloc(timestamps->resource);
+    wl_resource_set_implementation(timestamps->resource, &timestamps_impl, timestamps,
+                                   timestamps_resource_destroy);
+
+    timestamps->input = input_resource;
+    timestamps->on_input_destroy.notify = on_input_destroy;
+    wl_resource_add_destroy_listener(input_resource, &timestamps->on_input_destroy);
+
+    wl_list_insert(list, wl_resource_get_link(timestamps->resource));
+}
+
+static void
+input_timestamps_manager_resource_destroy(struct wl_resource *resource) {
+    // Unused.
+}
+
+static void
+input_timestamps_manager_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static void
+input_timestamps_manager_get_keyboard_timestamps(struct wl_client *client,
+                                                 struct wl_resource *resource, uint32_t id,
+                                                 struct wl_resource *keyboard_resource) {
+    struct server_input_timestamps *input_timestamps = wl_resource_get_user_data(resource);
+
+    create_timestamps(client, resource, id, keyboard_resource, &input_timestamps->keyboards);
+}
+
+static void
+input_timestamps_manager_get_pointer_timestamps(struct wl_client *client,
+                                                struct wl_resource *resource, uint32_t id,
+                                                struct wl_resource *pointer_resource) {
+    struct server_input_timestamps *input_timestamps = wl_resource_get_user_data(resource);
+
+    create_timestamps(client, resource, id, pointer_resource, &input_timestamps->pointers);
+}
+
+static void
+input_timestamps_manager_get_touch_timestamps(struct wl_client *client,
+                                              struct wl_resource *resource, uint32_t id,
+                                              struct wl_resource *touch_resource) {
+    // wl_seat.get_touch is not supported, so no client can have a wl_touch to pass here.
+    wl_client_post_implementation_error(
+        client, "zwp_input_timestamps_manager_v1.get_touch_timestamps is not supported");
+}
+
+static const struct zwp_input_timestamps_manager_v1_interface input_timestamps_manager_impl = {
+    .destroy = input_timestamps_manager_destroy,
+    .get_keyboard_timestamps = input_timestamps_manager_get_keyboard_timestamps,
+    .get_pointer_timestamps = input_timestamps_manager_get_pointer_timestamps,
+    .get_touch_timestamps = input_timestamps_manager_get_touch_timestamps,
+};
+
+static void
+on_global_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    ww_assert(version <= SRV_INPUT_TIMESTAMPS_VERSION);
+
+    struct server_input_timestamps *input_timestamps = data;
+
+    struct wl_resource *resource =
+        wl_resource_create(client, &zwp_input_timestamps_manager_v1_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &input_timestamps_manager_impl, input_timestamps,
+                                   input_timestamps_manager_resource_destroy);
+}
+
+static void
+on_keyboard(struct wl_listener *listener, void *data) {
+    struct server_input_timestamps *input_timestamps =
+        wl_container_of(listener, input_timestamps, on_keyboard);
+
+    process_keyboard(input_timestamps, server_get_wl_keyboard(input_timestamps->server));
+}
+
+static void
+on_pointer(struct wl_listener *listener, void *data) {
+    struct server_input_timestamps *input_timestamps =
+        wl_container_of(listener, input_timestamps, on_pointer);
+
+    process_pointer(input_timestamps, server_get_wl_pointer(input_timestamps->server));
+}
+
+static void
+on_display_destroy(struct wl_listener *listener, void *data) {
+    struct server_input_timestamps *input_timestamps =
+        wl_container_of(listener, input_timestamps, on_display_destroy);
+
+    wl_global_destroy(input_timestamps->global);
+
+    if (input_timestamps->remote_keyboard.wl) {
+        zwp_input_timestamps_v1_destroy(input_timestamps->remote_keyboard.wl);
+    }
+    if (input_timestamps->remote_pointer.wl) {
+        zwp_input_timestamps_v1_destroy(input_timestamps->remote_pointer.wl);
+    }
+
+    wl_list_remove(&input_timestamps->on_keyboard.link);
+    wl_list_remove(&input_timestamps->on_pointer.link);
+    wl_list_remove(&input_timestamps->on_display_destroy.link);
+
+    free(input_timestamps);
+}
+
+struct server_input_timestamps *
+server_input_timestamps_create(struct server *server) {
+    struct server_input_timestamps *input_timestamps = zalloc(1, sizeof(*input_timestamps));
+
+    input_timestamps->server = server;
+
+    input_timestamps->global =
+        wl_global_create(server->display, &zwp_input_timestamps_manager_v1_interface,
+                         SRV_INPUT_TIMESTAMPS_VERSION, input_timestamps, on_global_bind);
+    check_alloc(input_timestamps->global);
+
+    wl_list_init(&input_timestamps->keyboards);
+    wl_list_init(&input_timestamps->pointers);
+
+    input_timestamps->remote = server->backend->input_timestamps_manager;
+    process_keyboard(input_timestamps, server_get_wl_keyboard(server));
+    process_pointer(input_timestamps, server_get_wl_pointer(server));
+
+    input_timestamps->on_keyboard.notify = on_keyboard;
+    wl_signal_add(&server->backend->events.seat_keyboard, &input_timestamps->on_keyboard);
+
+    input_timestamps->on_pointer.notify = on_pointer;
+    wl_signal_add(&server->backend->events.seat_pointer, &input_timestamps->on_pointer);
+
+    input_timestamps->on_display_destroy.notify = on_display_destroy;
+    wl_display_add_destroy_listener(server->display, &input_timestamps->on_display_destroy);
+
+    return input_timestamps;
+}
+
+void
+server_input_timestamps_send(struct server_input_timestamps *input_timestamps,
+                             enum server_input_device device, struct wl_resource *input_resource,
+                             const struct timespec *time) {
+    struct wl_list *list = (device == SERVER_INPUT_KEYBOARD) ? &input_timestamps->keyboards
+                                                             : &input_timestamps->pointers;
+
+    uint64_t sec = (uint64_t)time->tv_sec;
+
+    struct wl_resource *resource;
+    wl_resource_for_each(resource, list) {
+        struct timestamps *timestamps = wl_resource_get_user_data(resource);
+        if (timestamps->input != input_resource) {
+            continue;
+        }
+
+        zwp_input_timestamps_v1_send_timestamp(resource, (uint32_t)(sec >> 32),
+                                               (uint32_t)(sec & UINT32_MAX),
+                                               (uint32_t)time->tv_nsec);
+    }
+}
+
+bool
+server_input_timestamps_take(struct server_input_timestamps *input_timestamps,
+                             enum server_input_device device, uint32_t time, struct timespec *out) {
+    struct server_input_timestamps_remote *remote = (device == SERVER_INPUT_KEYBOARD)
+                                                        ? &input_timestamps->remote_keyboard
+                                                        : &input_timestamps->remote_pointer;
+
+    if (!remote->pending) {
+        return false;
+    }
+    remote->pending = false;
+
+    // The high resolution timestamp is only used if it belongs to the event being processed, which
+    // should always be the case unless the host sends timestamps inconsistently.
+    uint32_t last_ms = (uint32_t)((uint64_t)remote->last.tv_sec * 1000 +
+                                  (uint64_t)remote->last.tv_nsec / 1000000);
+    if (last_ms != time) {
+        return false;
+    }
+
+    *out = remote->last;
+    return true;
+}
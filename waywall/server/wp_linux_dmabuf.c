@@ -6,9 +6,11 @@
 #include "server/server.h"
 #include "server/surface.h"
 #include "util/alloc.h"
+#include "util/log.h"
 #include "util/prelude.h"
 #include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <wayland-client-core.h>
 #include <wayland-client-protocol.h>
@@ -125,11 +127,66 @@ static const struct zwp_linux_buffer_params_v1_listener linux_buffer_params_list
     .failed = on_linux_buffer_params_failed,
 };
 
+static void
+send_device(struct wl_resource *resource, dev_t device,
+            void (*send)(struct wl_resource *resource, struct wl_array *device)) {
+    struct wl_array array;
+    wl_array_init(&array);
+
+    dev_t *data = wl_array_add(&array, sizeof(device));
+    check_alloc(data);
+    *data = device;
+
+    send(resource, &array);
+    wl_array_release(&array);
+}
+
+static bool
+read_device(struct wl_array *array, dev_t *device) {
+    if (array->size != sizeof(*device)) {
+        ww_log(LOG_ERROR, "received device of invalid size %zu from remote compositor",
+               array->size);
+        return false;
+    }
+
+    memcpy(device, array->data, sizeof(*device));
+    return true;
+}
+
 static void
 on_linux_dmabuf_feedback_done(void *data, struct zwp_linux_dmabuf_feedback_v1 *wl) {
     struct server_linux_dmabuf_feedback *feedback = data;
+    struct dmabuf_feedback *state = &feedback->state;
+
+    // The host's feedback is only sent on once all of it has been received, since its tranches
+    // are adjusted as a whole. See dmabuf_feedback_merge.
+    dmabuf_feedback_merge(state);
+
+    if (state->table_fd != -1) {
+        zwp_linux_dmabuf_feedback_v1_send_format_table(feedback->resource, state->table_fd,
+                                                       state->table_size);
+    }
+    send_device(feedback->resource, state->main_device,
+                zwp_linux_dmabuf_feedback_v1_send_main_device);
+
+    for (size_t i = 0; i < state->num_tranches; i++) {
+        struct dmabuf_tranche *tranche = &state->tranches[i];
+
+        send_device(feedback->resource, tranche->target_device,
+                    zwp_linux_dmabuf_feedback_v1_send_tranche_target_device);
+        zwp_linux_dmabuf_feedback_v1_send_tranche_flags(feedback->resource, tranche->flags);
+
+        struct wl_array indices = {
+            .size = tranche->num_indices * sizeof(*tranche->indices),
+            .alloc = 0,
+            .data = tranche->indices,
+        };
+        zwp_linux_dmabuf_feedback_v1_send_tranche_formats(feedback->resource, &indices);
+        zwp_linux_dmabuf_feedback_v1_send_tranche_done(feedback->resource);
+    }
 
     zwp_linux_dmabuf_feedback_v1_send_done(feedback->resource);
+    dmabuf_feedback_reset(state);
 }
 
 static void
@@ -137,8 +194,8 @@ on_linux_dmabuf_feedback_format_table(void *data, struct zwp_linux_dmabuf_feedba
                                       int32_t fd, uint32_t size) {
     struct server_linux_dmabuf_feedback *feedback = data;
 
-    zwp_linux_dmabuf_feedback_v1_send_format_table(feedback->resource, fd, size);
-    close(fd);
+    // The format table is passed through unchanged, since tranches only refer to it by index.
+    dmabuf_feedback_format_table(&feedback->state, fd, size);
 }
 
 static void
@@ -146,14 +203,17 @@ on_linux_dmabuf_feedback_main_device(void *data, struct zwp_linux_dmabuf_feedbac
                                      struct wl_array *device) {
     struct server_linux_dmabuf_feedback *feedback = data;
 
-    zwp_linux_dmabuf_feedback_v1_send_main_device(feedback->resource, device);
+    dev_t dev;
+    if (read_device(device, &dev)) {
+        dmabuf_feedback_main_device(&feedback->state, dev);
+    }
 }
 
 static void
 on_linux_dmabuf_feedback_tranche_done(void *data, struct zwp_linux_dmabuf_feedback_v1 *wl) {
     struct server_linux_dmabuf_feedback *feedback = data;
 
-    zwp_linux_dmabuf_feedback_v1_send_tranche_done(feedback->resource);
+    dmabuf_feedback_tranche_done(&feedback->state);
 }
 
 static void
@@ -161,7 +221,7 @@ on_linux_dmabuf_feedback_tranche_flags(void *data, struct zwp_linux_dmabuf_feedb
                                        uint32_t flags) {
     struct server_linux_dmabuf_feedback *feedback = data;
 
-    zwp_linux_dmabuf_feedback_v1_send_tranche_flags(feedback->resource, flags);
+    dmabuf_feedback_tranche_flags(&feedback->state, flags);
 }
 
 static void
@@ -169,7 +229,8 @@ on_linux_dmabuf_feedback_tranche_formats(void *data, struct zwp_linux_dmabuf_fee
                                          struct wl_array *indices) {
     struct server_linux_dmabuf_feedback *feedback = data;
 
-    zwp_linux_dmabuf_feedback_v1_send_tranche_formats(feedback->resource, indices);
+    dmabuf_feedback_tranche_formats(&feedback->state, indices->data,
+                                    indices->size / sizeof(uint16_t));
 }
 
 static void
@@ -177,7 +238,10 @@ on_linux_dmabuf_feedback_tranche_target_device(void *data, struct zwp_linux_dmab
                                                struct wl_array *device) {
     struct server_linux_dmabuf_feedback *feedback = data;
 
-    zwp_linux_dmabuf_feedback_v1_send_tranche_target_device(feedback->resource, device);
+    dev_t dev;
+    if (read_device(device, &dev)) {
+        dmabuf_feedback_tranche_target_device(&feedback->state, dev);
+    }
 }
 
 static const struct zwp_linux_dmabuf_feedback_v1_listener linux_dmabuf_feedback_listener = {
@@ -317,6 +381,7 @@ linux_dmabuf_feedback_resource_destroy(struct wl_resource *resource) {
     struct server_linux_dmabuf_feedback *feedback = wl_resource_get_user_data(resource);
 
     zwp_linux_dmabuf_feedback_v1_destroy(feedback->remote);
+    dmabuf_feedback_finish(&feedback->state);
     free(feedback);
 }
 
@@ -374,6 +439,7 @@ linux_dmabuf_get_default_feedback(struct wl_client *client, struct wl_resource *
     struct server_linux_dmabuf *linux_dmabuf = wl_resource_get_user_data(resource);
 
     struct server_linux_dmabuf_feedback *feedback = zalloc(1, sizeof(*feedback));
+    dmabuf_feedback_init(&feedback->state);
 
     feedback->resource = wl_resource_create(client, &zwp_linux_dmabuf_feedback_v1_interface,
                                             wl_resource_get_version(resource), id);
@@ -387,6 +453,10 @@ linux_dmabuf_get_default_feedback(struct wl_client *client, struct wl_resource *
     zwp_linux_dmabuf_feedback_v1_add_listener(feedback->remote, &linux_dmabuf_feedback_listener,
                                               feedback);
     wl_display_roundtrip_queue(linux_dmabuf->remote_display, linux_dmabuf->queue);
+
+    // The host resends feedback whenever it changes (e.g. once the surface can be scanned out.)
+    // Later feedback is handled on the main queue so that it is forwarded without delay.
+    wl_proxy_set_queue((struct wl_proxy *)feedback->remote, linux_dmabuf->main_queue);
 }
 
 static void
@@ -396,6 +466,7 @@ linux_dmabuf_get_surface_feedback(struct wl_client *client, struct wl_resource *
     struct server_surface *surface = server_surface_from_resource(surface_resource);
 
     struct server_linux_dmabuf_feedback *feedback = zalloc(1, sizeof(*feedback));
+    dmabuf_feedback_init(&feedback->state);
 
     feedback->resource = wl_resource_create(client, &zwp_linux_dmabuf_feedback_v1_interface,
                                             wl_resource_get_version(resource), id);
@@ -410,6 +481,10 @@ linux_dmabuf_get_surface_feedback(struct wl_client *client, struct wl_resource *
     zwp_linux_dmabuf_feedback_v1_add_listener(feedback->remote, &linux_dmabuf_feedback_listener,
                                               feedback);
     wl_display_roundtrip_queue(linux_dmabuf->remote_display, linux_dmabuf->queue);
+
+    // The host resends feedback whenever it changes (e.g. once the surface can be scanned out.)
+    // Later feedback is handled on the main queue so that it is forwarded without delay.
+    wl_proxy_set_queue((struct wl_proxy *)feedback->remote, linux_dmabuf->main_queue);
 }
 
 static const struct zwp_linux_dmabuf_v1_interface linux_dmabuf_impl = {
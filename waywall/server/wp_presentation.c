@@ -0,0 +1,144 @@
+#include "server/wp_presentation.h"
+#include "presentation-time-client-protocol.h"
+#include "presentation-time-server-protocol.h"
+#include "server/backend.h"
+#include "server/server.h"
+#include "server/surface.h"
+#include "util/alloc.h"
+#include "util/prelude.h"
+#include <stdlib.h>
+#include <wayland-client-protocol.h>
+#include <wayland-server-protocol.h>
+
+static constexpr int SRV_PRESENTATION_VERSION = 1;
+
+/*
+ * Feedback is requested from the host compositor for the remote surface. Commits are forwarded as
+ * soon as the client makes them (see surface_commit), so the remote feedback applies to the same
+ * content update as the client's. The host's clock is advertised as-is, which lets timestamps given
+ * to wp_commit_timer_v1 be passed through unchanged.
+ */
+
+static void
+feedback_finish(struct server_presentation_feedback *feedback) {
+    // The wp_presentation_feedback object is destroyed by the compositor after the presented or
+    // discarded event, so there is no request for the client to destroy it with.
+    wl_resource_destroy(feedback->resource);
+}
+
+static void
+on_feedback_discarded(void *data, struct wp_presentation_feedback *wl) {
+    struct server_presentation_feedback *feedback = data;
+
+    wp_presentation_feedback_send_discarded(feedback->resource);
+    feedback_finish(feedback);
+}
+
+static void
+on_feedback_presented(void *data, struct wp_presentation_feedback *wl, uint32_t tv_sec_hi,
+                      uint32_t tv_sec_lo, uint32_t tv_nsec, uint32_t refresh, uint32_t seq_hi,
+                      uint32_t seq_lo, uint32_t flags) {
+    struct server_presentation_feedback *feedback = data;
+
+    wp_presentation_feedback_send_presented(feedback->resource, tv_sec_hi, tv_sec_lo, tv_nsec,
+                                            refresh, seq_hi, seq_lo, flags);
+    feedback_finish(feedback);
+}
+
+static void
+on_feedback_sync_output(void *data, struct wp_presentation_feedback *wl,
+                        struct wl_output *output) {
+    // Unused. waywall's wl_output does not correspond to any of the host compositor's outputs.
+}
+
+static const struct wp_presentation_feedback_listener feedback_listener = {
+    .discarded = on_feedback_discarded,
+    .presented = on_feedback_presented,
+    .sync_output = on_feedback_sync_output,
+};
+
+static void
+feedback_resource_destroy(struct wl_resource *resource) {
+    struct server_presentation_feedback *feedback = wl_resource_get_user_data(resource);
+
+    wp_presentation_feedback_destroy(feedback->remote);
+    free(feedback);
+}
+
+static void
+presentation_resource_destroy(struct wl_resource *resource) {
+    // Unused.
+}
+
+static void
+presentation_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static void
+presentation_feedback(struct wl_client *client, struct wl_resource *resource,
+                      struct wl_resource *surface_resource, uint32_t id) {
+    struct server_presentation *presentation = wl_resource_get_user_data(resource);
+    struct server_surface *surface = server_surface_from_resource(surface_resource);
+
+    struct server_presentation_feedback *feedback = zalloc(1, sizeof(*feedback));
+
+    feedback->resource = wl_resource_create(client, &wp_presentation_feedback_interface,
+                                            wl_resource_get_version(resource), id);
+    check_alloc(feedback->resource);
+    wl_resource_set_implementation(feedback->resource, nullptr, feedback,
+                                   feedback_resource_destroy);
+
+    feedback->remote = wp_presentation_feedback(presentation->remote, surface->remote);
+    check_alloc(feedback->remote);
+    wp_presentation_feedback_add_listener(feedback->remote, &feedback_listener, feedback);
+}
+
+static const struct wp_presentation_interface presentation_impl = {
+    .destroy = presentation_destroy,
+    .feedback = presentation_feedback,
+};
+
+static void
+on_global_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    ww_assert(version <= SRV_PRESENTATION_VERSION);
+
+    struct server_presentation *presentation = data;
+
+    struct wl_resource *resource =
+        wl_resource_create(client, &wp_presentation_interface, version, id);
+    check_alloc(resource);
+    wl_resource_set_implementation(resource, &presentation_impl, presentation,
+                                   presentation_resource_destroy);
+
+    wp_presentation_send_clock_id(resource, presentation->clock_id);
+}
+
+static void
+on_display_destroy(struct wl_listener *listener, void *data) {
+    struct server_presentation *presentation =
+        wl_container_of(listener, presentation, on_display_destroy);
+
+    wl_global_destroy(presentation->global);
+
+    wl_list_remove(&presentation->on_display_destroy.link);
+
+    free(presentation);
+}
+
+struct server_presentation *
+server_presentation_create(struct server *server) {
+    struct server_presentation *presentation = zalloc(1, sizeof(*presentation));
+
+    presentation->global = wl_global_create(server->display, &wp_presentation_interface,
+                                            SRV_PRESENTATION_VERSION, presentation, on_global_bind);
+    check_alloc(presentation->global);
+
+    presentation->remote = server->backend->presentation;
+    presentation->clock_id = server->backend->presentation_clock;
+
+    presentation->on_display_destroy.notify = on_display_destroy;
+    wl_display_add_destroy_listener(server->display, &presentation->on_display_destroy);
+
+    return presentation;
+}
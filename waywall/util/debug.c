@@ -48,6 +48,41 @@ dbg_ui() {
     fprintf(debug_file, "  fullscreen: %s\n", util_debug_data.ui.fullscreen ? "yes" : "no");
 }
 
+static void
+dbg_textures() {
+    size_t total = util_debug_data.textures.images + util_debug_data.textures.font +
+                   util_debug_data.textures.capture;
+
+    fprintf(debug_file, "textures:\n");
+    fprintf(debug_file, "  images:  %zu KiB (%zu/%zu resident)\n",
+            util_debug_data.textures.images / 1024, util_debug_data.textures.num_resident,
+            util_debug_data.textures.num_images);
+    fprintf(debug_file, "  font:    %zu KiB\n", util_debug_data.textures.font / 1024);
+    fprintf(debug_file, "  capture: %zu KiB\n", util_debug_data.textures.capture / 1024);
+    if (util_debug_data.textures.budget > 0) {
+        fprintf(debug_file, "  total:   %zu/%zu KiB\n", total / 1024,
+                util_debug_data.textures.budget / 1024);
+    } else {
+        fprintf(debug_file, "  total:   %zu KiB\n", total / 1024);
+    }
+}
+
+static void
+dbg_gl() {
+    fprintf(debug_file, "gl state changes:\n");
+    fprintf(debug_file, "  issued:  %" PRIu32 "\n", util_debug_data.gl.issued);
+    fprintf(debug_file, "  skipped: %" PRIu32 "\n", util_debug_data.gl.skipped);
+}
+
+static void
+dbg_profile() {
+    if (util_debug_data.profile.table[0] == '\0') {
+        return;
+    }
+
+    fprintf(debug_file, "gpu time (ms/frame):\n%s", util_debug_data.profile.table);
+}
+
 bool
 util_debug_init() {
     debug_file = fmemopen(debug_buf, STATIC_STRLEN(debug_buf), "wb");
@@ -68,6 +103,9 @@ util_debug_str() {
     dbg_keyboard();
     dbg_pointer();
     dbg_ui();
+    dbg_textures();
+    dbg_gl();
+    dbg_profile();
     fwrite("\0", 1, 1, debug_file);
 
     ww_assert(fflush(debug_file) == 0);
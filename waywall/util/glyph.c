@@ -0,0 +1,171 @@
+#include "util/glyph.h"
+#include "util/alloc.h"
+#include "util/prelude.h"
+#include "util/str.h"
+#include <stdlib.h>
+
+// The height of a glyph in Minecraft's default font, excluding descenders.
+static constexpr int32_t GLYPH_HEIGHT = 7;
+
+// The number of empty columns between two glyphs which indicates a space. Glyphs are normally
+// separated by a single empty column, and a space is three columns wide.
+static constexpr int32_t SPACE_WIDTH = 3;
+
+struct glyph {
+    char c;
+    int32_t width;
+    const char *rows[GLYPH_HEIGHT];
+};
+
+// Glyphs from Minecraft's default font (the one used by the F3 screen), which are recognized by
+// util_glyph_read. Any other glyphs are read as '?'.
+static const struct glyph GLYPHS[] = {
+    {'0', 5, {".###.", "#...#", "#..##", "#.#.#", "##..#", "#...#", ".###."}},
+    {'1', 5, {"..#..", ".##..", "..#..", "..#..", "..#..", "..#..", "#####"}},
+    {'2', 5, {".###.", "#...#", "....#", "..##.", ".#...", "#...#", "#####"}},
+    {'3', 5, {".###.", "#...#", "....#", "..##.", "....#", "#...#", ".###."}},
+    {'4', 5, {"...##", "..#.#", ".#..#", "#...#", "#####", "....#", "....#"}},
+    {'5', 5, {"#####", "#....", "####.", "....#", "....#", "#...#", ".###."}},
+    {'6', 5, {"..##.", ".#...", "#....", "####.", "#...#", "#...#", ".###."}},
+    {'7', 5, {"#####", "#...#", "....#", "...#.", "..#..", "..#..", "..#.."}},
+    {'8', 5, {".###.", "#...#", "#...#", ".###.", "#...#", "#...#", ".###."}},
+    {'9', 5, {".###.", "#...#", "#...#", ".####", "....#", "...#.", ".##.."}},
+    {'-', 5, {".....", ".....", ".....", "#####", ".....", ".....", "....."}},
+    {'/', 5, {"....#", "...#.", "...#.", "..#..", ".#...", ".#...", "#...."}},
+};
+
+struct mask {
+    bool *data;
+    int32_t width, height;
+};
+
+static inline bool
+mask_get(struct mask *mask, int32_t x, int32_t y) {
+    return mask->data[y * mask->width + x];
+}
+
+static bool
+column_empty(struct mask *mask, int32_t x, int32_t row) {
+    for (int32_t y = row; y < row + GLYPH_HEIGHT; y++) {
+        if (mask_get(mask, x, y)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool
+glyph_matches(struct mask *mask, const struct glyph *glyph, int32_t x, int32_t row) {
+    if (x + glyph->width > mask->width) {
+        return false;
+    }
+
+    for (int32_t gy = 0; gy < GLYPH_HEIGHT; gy++) {
+        for (int32_t gx = 0; gx < glyph->width; gx++) {
+            if (mask_get(mask, x + gx, row + gy) != (glyph->rows[gy][gx] == '#')) {
+                return false;
+            }
+        }
+    }
+
+    // The glyph must be followed by an empty column (or the edge of the area), or else it is only
+    // part of a wider glyph.
+    return x + glyph->width == mask->width || column_empty(mask, x + glyph->width, row);
+}
+
+static int32_t
+read_line(struct mask *mask, int32_t row, strbuf *out) {
+    int32_t matched = 0;
+    int32_t gap = 0;
+
+    int32_t x = 0;
+    while (x < mask->width) {
+        if (column_empty(mask, x, row)) {
+            gap++;
+            x++;
+            continue;
+        }
+
+        if (out->len > 0 && gap >= SPACE_WIDTH) {
+            strbuf_append_char(out, ' ');
+        }
+        gap = 0;
+
+        const struct glyph *glyph = nullptr;
+        for (size_t i = 0; i < STATIC_ARRLEN(GLYPHS); i++) {
+            if (glyph_matches(mask, &GLYPHS[i], x, row)) {
+                glyph = &GLYPHS[i];
+                break;
+            }
+        }
+
+        if (glyph) {
+            strbuf_append_char(out, glyph->c);
+            x += glyph->width;
+            matched++;
+        } else {
+            strbuf_append_char(out, '?');
+            while (x < mask->width && !column_empty(mask, x, row)) {
+                x++;
+            }
+        }
+    }
+
+    return matched;
+}
+
+char *
+util_glyph_read(const uint8_t *rgba, int32_t width, int32_t height,
+                const struct util_glyph_options *options) {
+    ww_assert(options->scale > 0);
+
+    // Threshold the image at the center of each font pixel.
+    struct mask mask = {
+        .width = width / options->scale,
+        .height = height / options->scale,
+    };
+    if (mask.width == 0 || mask.height < GLYPH_HEIGHT) {
+        return ww_strdup("");
+    }
+
+    mask.data = zalloc(mask.width * mask.height, sizeof(*mask.data));
+    for (int32_t y = 0; y < mask.height; y++) {
+        for (int32_t x = 0; x < mask.width; x++) {
+            int32_t px = x * options->scale + options->scale / 2;
+            int32_t py = y * options->scale + options->scale / 2;
+            const uint8_t *color = &rgba[(py * width + px) * 4];
+
+            bool set = true;
+            for (size_t i = 0; i < 3; i++) {
+                if (abs((int)color[i] - (int)options->rgb[i]) > options->tolerance) {
+                    set = false;
+                }
+            }
+            mask.data[y * mask.width + x] = set;
+        }
+    }
+
+    // The text may not be aligned to the top of the area, so read it at every possible vertical
+    // offset and keep whichever line contains the most recognized glyphs.
+    strbuf best = strbuf_new();
+    int32_t best_matched = -1;
+
+    for (int32_t row = 0; row + GLYPH_HEIGHT <= mask.height; row++) {
+        strbuf line = strbuf_new();
+        int32_t matched = read_line(&mask, row, &line);
+
+        if (matched > best_matched) {
+            strbuf_free(&best);
+            best = line;
+            best_matched = matched;
+        } else {
+            strbuf_free(&line);
+        }
+    }
+
+    free(mask.data);
+
+    char *result = strbuf_clone_cstr(best);
+    strbuf_free(&best);
+    return result;
+}
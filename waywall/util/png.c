@@ -4,6 +4,7 @@
 #include <fcntl.h>
 #include <spng.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -93,3 +94,60 @@ fail_stat:
     result.data = nullptr;
     return result;
 }
+
+bool
+util_png_encode(const char *path, const uint8_t *rgba, uint32_t width, uint32_t height) {
+    // This function may be called from any thread.
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        ww_log_errno(LOG_ERROR, "failed to open '%s' for writing", path);
+        return false;
+    }
+
+    struct spng_ctx *ctx = spng_ctx_new(SPNG_CTX_ENCODER);
+    if (!ctx) {
+        ww_log(LOG_ERROR, "failed to create spng context");
+        goto fail_spng_ctx;
+    }
+
+    int err = spng_set_png_file(ctx, file);
+    if (err != 0) {
+        ww_log(LOG_ERROR, "failed to set PNG file: %s", spng_strerror(err));
+        goto fail_spng;
+    }
+
+    struct spng_ihdr ihdr = {
+        .width = width,
+        .height = height,
+        .bit_depth = 8,
+        .color_type = SPNG_COLOR_TYPE_TRUECOLOR_ALPHA,
+    };
+    err = spng_set_ihdr(ctx, &ihdr);
+    if (err != 0) {
+        ww_log(LOG_ERROR, "failed to set image header: %s", spng_strerror(err));
+        goto fail_spng;
+    }
+
+    err = spng_encode_image(ctx, rgba, (size_t)width * (size_t)height * 4, SPNG_FMT_PNG,
+                            SPNG_ENCODE_FINALIZE);
+    if (err != 0) {
+        ww_log(LOG_ERROR, "failed to encode image: %s", spng_strerror(err));
+        goto fail_spng;
+    }
+
+    spng_ctx_free(ctx);
+    if (fclose(file) != 0) {
+        ww_log_errno(LOG_ERROR, "failed to write '%s'", path);
+        return false;
+    }
+
+    return true;
+
+fail_spng:
+    spng_ctx_free(ctx);
+
+fail_spng_ctx:
+    fclose(file);
+
+    return false;
+}
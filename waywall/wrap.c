@@ -4,9 +4,11 @@
 #include "inotify.h"
 #include "instance.h"
 #include "scene.h"
+#include "screenshot.h"
 #include "server/backend.h"
 #include "server/buffer.h"
 #include "server/cursor.h"
+#include "server/ext_image_copy_capture.h"
 #include "server/fake_input.h"
 #include "server/gl.h"
 #include "server/server.h"
@@ -20,6 +22,7 @@
 #include "util/prelude.h"
 #include "xdg-shell-client-protocol.h"
 #include <linux/input-event-codes.h>
+#include <math.h>
 #include <signal.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -262,6 +265,23 @@ floating_view_destroy(struct wrap *wrap, struct server_view *view) {
     ww_panic("could not find floating view");
 }
 
+static void
+main_view_set_size(struct wrap *wrap, int32_t width, int32_t height) {
+    ww_assert(wrap->view);
+
+    // The game may be rendered at a fraction of its displayed size, in which case the host
+    // compositor scales it back up (see layout_centered.)
+    double scale =
+        wrap->active_res.scale > 0 ? wrap->active_res.scale : wrap->cfg->window.render_scale;
+
+    int32_t scaled_width = (int32_t)lround(width * scale);
+    int32_t scaled_height = (int32_t)lround(height * scale);
+
+    server_view_set_size(wrap->view, scaled_width > 0 ? scaled_width : 1,
+                         scaled_height > 0 ? scaled_height : 1);
+    server_view_set_scale(wrap->view, scale);
+}
+
 static void
 process_state_update(int wd, uint32_t mask, const char *name, void *data) {
     struct wrap *wrap = data;
@@ -318,7 +338,7 @@ on_resize(struct wl_listener *listener, void *data) {
 
     if (wrap->view) {
         if (wrap->active_res.w == 0) {
-            server_view_set_size(wrap->view, wrap->width, wrap->height);
+            main_view_set_size(wrap, wrap->width, wrap->height);
             server_view_commit(wrap->view);
         } else {
             server_view_refresh(wrap->view);
@@ -404,7 +424,7 @@ on_view_create(struct wl_listener *listener, void *data) {
     ww_assert(wrap->width > 0 && wrap->height > 0);
     ww_assert(wrap->view);
 
-    server_view_set_size(wrap->view, wrap->width, wrap->height);
+    main_view_set_size(wrap, wrap->width, wrap->height);
     server_view_set_centered(wrap->view, true);
     server_view_set_visible(wrap->view, true);
     server_view_commit(wrap->view);
@@ -575,11 +595,20 @@ wrap_create(struct server *server, struct inotify *inotify, struct ww_timer *tim
         goto fail_gl;
     }
 
-    wrap->scene = scene_create(cfg, wrap->gl, server->ui);
+    wrap->image_capture = server_image_copy_capture_create(server, wrap->gl);
+
+    wrap->scene = scene_create(cfg, wrap->gl, server->ui, timer);
     if (!wrap->scene) {
         ww_log(LOG_ERROR, "failed to create scene");
         goto fail_scene;
     }
+    server_gl_set_projector(wrap->gl, cfg->window.projector_width, cfg->window.projector_height);
+
+    wrap->screenshots = screenshot_writer_create(server);
+    if (!wrap->screenshots) {
+        ww_log(LOG_ERROR, "failed to create screenshot writer");
+        goto fail_screenshots;
+    }
 
     wrap->cfg = cfg;
     wrap->server = server;
@@ -613,7 +642,11 @@ wrap_create(struct server *server, struct inotify *inotify, struct ww_timer *tim
 
     return wrap;
 
+fail_screenshots:
+    scene_destroy(wrap->scene);
+
 fail_scene:
+    server_image_copy_capture_destroy(wrap->image_capture);
     server_gl_destroy(wrap->gl);
 
 fail_gl:
@@ -628,7 +661,9 @@ wrap_destroy(struct wrap *wrap) {
         instance_destroy(wrap->instance);
     }
 
+    screenshot_writer_destroy(wrap->screenshots);
     scene_destroy(wrap->scene);
+    server_image_copy_capture_destroy(wrap->image_capture);
     server_gl_destroy(wrap->gl);
 
     subproc_destroy(wrap->subproc);
@@ -663,6 +698,14 @@ wrap_set_config(struct wrap *wrap, struct config *cfg) {
     config_vm_set_wrap(cfg->vm, wrap);
 
     wrap->cfg = cfg;
+    scene_set_texture_budget(wrap->scene, (size_t)cfg->experimental.texture_budget * 1024 * 1024);
+    server_gl_set_projector(wrap->gl, cfg->window.projector_width, cfg->window.projector_height);
+    if (wrap->view) {
+        // The new configuration may have a different render scale.
+        main_view_set_size(wrap, wrap->active_res.w > 0 ? wrap->active_res.w : wrap->width,
+                           wrap->active_res.h > 0 ? wrap->active_res.h : wrap->height);
+        server_view_commit(wrap->view);
+    }
     if (wrap->cfg->theme.ninb.anchor == ANCHOR_NONE) {
         // If anchoring has been disabled, ensure there is no anchored view.
         if (wrap->floating.anchored) {
@@ -699,7 +742,7 @@ wrap_lua_press_key(struct wrap *wrap, uint32_t keycode) {
 }
 
 int
-wrap_lua_set_res(struct wrap *wrap, int32_t width, int32_t height) {
+wrap_lua_set_res(struct wrap *wrap, int32_t width, int32_t height, double scale) {
     if ((width == 0) != (height == 0)) {
         return 1;
     }
@@ -708,17 +751,24 @@ wrap_lua_set_res(struct wrap *wrap, int32_t width, int32_t height) {
         return 1;
     }
 
-    if (wrap->active_res.w == width && wrap->active_res.h == height) {
+    if (wrap->active_res.w == width && wrap->active_res.h == height &&
+        wrap->active_res.scale == scale) {
         return 0;
     }
 
     wrap->active_res.w = width;
     wrap->active_res.h = height;
+    wrap->active_res.scale = scale;
 
-    server_view_set_size(wrap->view, wrap->active_res.w > 0 ? wrap->active_res.w : wrap->width,
-                         wrap->active_res.h > 0 ? wrap->active_res.h : wrap->height);
+    main_view_set_size(wrap, wrap->active_res.w > 0 ? wrap->active_res.w : wrap->width,
+                       wrap->active_res.h > 0 ? wrap->active_res.h : wrap->height);
     server_view_commit(wrap->view);
 
+    // The scene holds off on switching resolution-specific objects until the game has presented a
+    // frame at its new size.
+    scene_set_active_res(wrap->scene, width, height, wrap->view->current.width,
+                         wrap->view->current.height);
+
     return 0;
 }
 